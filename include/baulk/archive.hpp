@@ -4,8 +4,20 @@
 #include <bela/base.hpp>
 #include <bela/time.hpp>
 #include <bela/io.hpp>
+#include <algorithm>
 #include <functional>
 #include <filesystem>
+#include <optional>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <string>
+#include <vector>
 #include "archive/format.hpp"
 
 namespace baulk::archive {
@@ -26,16 +38,167 @@ public:
   File &operator=(const File &) = delete;
   ~File();
   bool WriteFull(const void *data, size_t bytes, bela::error_code &ec);
+  // Sparse sets the size of a sparse file, ranges not written afterwards are holes. File systems without sparse
+  // files allocate the whole size and read the holes as zeros
+  bool Sparse(int64_t size, bela::error_code &ec);
+  bool Seek(int64_t pos, bela::error_code &ec);
+  // Preallocate reserves size bytes and sets the end of file, the file system can place it contiguously. Truncate
+  // sets the end of file
+  bool Preallocate(int64_t size, bela::error_code &ec);
+  bool Truncate(int64_t size, bela::error_code &ec);
   bool Discard();
   bool Chtimes(bela::Time t, bela::error_code &ec);
   static std::optional<File> NewFile(const fs::path &path, bela::Time modified, bool overwrite_mode,
                                      bela::error_code &ec);
+  // Create is NewFile for a path whose directory is known to exist: one CreateFileW without existence checks, an
+  // existing file is an error unless overwrite_mode
+  static std::optional<File> Create(const fs::path &path, bela::Time modified, bool overwrite_mode,
+                                    bela::error_code &ec);
+
+  HANDLE NativeFD() const { return fd; }
 
 private:
   File() = default;
   HANDLE fd{INVALID_HANDLE_VALUE};
 };
 bool Chtimes(const fs::path &file, bela::Time t, bela::error_code &ec);
+
+// LargeFile fills a file whose size is known up front: the size is preallocated so the file does not fragment as it
+// grows, then decoded data is gathered into 1 MiB writes instead of one write per decoded chunk. With mapped the data
+// is copied into a writable mapping of the file, an I/O error under it raises EXCEPTION_IN_PAGE_ERROR
+class LargeFile {
+public:
+  LargeFile(File &file_) : file(file_) {}
+  LargeFile(const LargeFile &) = delete;
+  LargeFile &operator=(const LargeFile &) = delete;
+  ~LargeFile() { unmap(); }
+  // Initialize preallocates size bytes and maps them when mapped is set, on failure writes are gathered instead
+  void Initialize(int64_t size_, bool mapped);
+  bool Write(const void *data, size_t len, bela::error_code &ec);
+  // Finish completes the writes and sets the end of file to the bytes written, a mapped file gets its times again
+  bool Finish(bela::Time modified, bela::error_code &ec);
+  [[nodiscard]] bool Mapped() const { return view != nullptr; }
+
+private:
+  void unmap();
+  File &file;
+  HANDLE mapping{nullptr};
+  uint8_t *view{nullptr};
+  bool mapped_once{false};
+  int64_t size{0};
+  int64_t written{0};
+  std::vector<uint8_t> buffer;
+};
+
+// Concurrency is the number of workers an extractor runs for its threads option, 0 selects the hardware concurrency
+inline uint32_t Concurrency(uint32_t threads) {
+  if (threads != 0) {
+    return threads;
+  }
+  return (std::max)(std::thread::hardware_concurrency(), 1U);
+}
+using WorkerProgress = std::function<bool(size_t bytes)>;
+using WorkerTask = std::function<bool(size_t index, const WorkerProgress &progress, bela::error_code &ec)>;
+// RunWorkers runs task for every index below count on at most threads threads, the calling thread is one of them and
+// tasks start in index order. The progress handed to tasks serializes the caller's callback and returns false once the
+// workers stop. A task failing with ErrCanceled, or with any error unless ignore_error, stops the workers and its error
+// is returned
+bool RunWorkers(uint32_t threads, size_t count, bool ignore_error, const WorkerProgress &progress,
+                const WorkerTask &task, bela::error_code &ec);
+
+// FilePool finishes extracted files on a few threads: small files are created, written with a single call and
+// stamped there, larger files written by the caller are closed there. CreateFileW and CloseHandle are slow when filter
+// drivers or antivirus scanners inspect every file, the pool overlaps them with decoding. Jobs for the same path run
+// in the order they are queued
+class FilePool {
+public:
+  explicit FilePool(uint32_t threads = 4, size_t limit = 64 << 20);
+  FilePool(const FilePool &) = delete;
+  FilePool &operator=(const FilePool &) = delete;
+  ~FilePool();
+  // Write creates path with the contents of data, with parents missing parent directories are created first. It
+  // blocks while more than limit bytes are queued
+  void Write(fs::path &&path, std::vector<uint8_t> &&data, bela::Time modified, bool overwrite_mode, bool parents);
+  // Close closes a file the caller has written to path
+  void Close(const fs::path &path, File &&file);
+  // Flush blocks until the queued jobs for path have run, the caller is about to create it itself
+  void Flush(const fs::path &path);
+  // Wait blocks until every queued job has run, it returns false with the first error since the last Wait
+  bool Wait(bela::error_code &ec);
+  [[nodiscard]] uint64_t Files() const { return files; }
+  [[nodiscard]] uint64_t Bytes() const { return bytes; }
+  // FilesPerSecond is the rate at which files were finished since the pool started
+  [[nodiscard]] double FilesPerSecond() const;
+
+private:
+  struct job {
+    std::wstring key; // folded path, paths differing in case only name the same file
+    fs::path path;
+    std::vector<uint8_t> data;
+    std::optional<File> file;
+    bela::Time modified;
+    bool overwrite_mode{true};
+    bool parents{false};
+  };
+  struct lane {
+    std::deque<job> jobs;
+    std::condition_variable cv;
+  };
+  static std::wstring fold(const fs::path &path);
+  void push(job &&j);
+  bool run(job &j, bela::error_code &ec);
+  void work(lane &l);
+  std::mutex mu;
+  std::condition_variable room; // queued bytes dropped below the limit
+  std::condition_variable idle; // a job finished
+  std::vector<std::unique_ptr<lane>> lanes;
+  std::unordered_map<std::wstring, size_t> inflight; // keys of the jobs not finished
+  std::vector<std::thread> workers;
+  size_t limit{0};
+  size_t queued{0};  // bytes of the jobs not finished
+  size_t pending{0}; // jobs not finished
+  bool closed{false};
+  bela::error_code firstEc;
+  std::atomic_uint64_t files{0};
+  std::atomic_uint64_t bytes{0};
+  std::chrono::steady_clock::time_point started;
+};
+
+// MappedView: read-only view of a whole file
+class MappedView {
+public:
+  MappedView() = default;
+  MappedView(MappedView &&o) noexcept;
+  MappedView &operator=(MappedView &&o) noexcept;
+  MappedView(const MappedView &) = delete;
+  MappedView &operator=(const MappedView &) = delete;
+  ~MappedView();
+  const uint8_t *data() const { return base; }
+  int64_t size() const { return length; }
+  explicit operator bool() const { return base != nullptr; }
+  static std::optional<MappedView> Map(HANDLE fd, int64_t size, bela::error_code &ec);
+
+private:
+  void Free();
+  HANDLE mapping{nullptr};
+  const uint8_t *base{nullptr};
+  int64_t length{0};
+};
+// ReadAt reads len bytes at offset pos without moving the shared file pointer (pread)
+bool ReadAt(HANDLE fd, void *buffer, size_t len, int64_t pos, bela::error_code &ec);
+// CopyObserver sees the data CopyRange copies through its buffer, in order
+using CopyObserver = std::function<void(const void *data, size_t len)>;
+// CopyRange fills the new file dst with len bytes of src at offset pos. When both are on a volume with block cloning
+// (ReFS, Dev Drive) and pos is cluster aligned the clusters are shared instead of copied, otherwise the range is copied
+// with 1 MiB reads and writes into the preallocated file. cloned is the length of the leading part that was cloned,
+// observer sees the rest as it is copied
+bool CopyRange(HANDLE src, int64_t pos, File &dst, int64_t len, const CopyObserver &observer, int64_t &cloned,
+               bela::error_code &ec);
+inline bool CopyRange(HANDLE src, int64_t pos, File &dst, int64_t len, bela::error_code &ec) {
+  int64_t cloned = 0;
+  return CopyRange(src, pos, dst, len, nullptr, cloned, ec);
+}
+
 inline bool MakeDirectories(const fs::path &path, bela::Time modified, bela::error_code &ec) {
   std::error_code e;
   if (fs::create_directories(path, e); e) {
@@ -45,7 +208,16 @@ inline bool MakeDirectories(const fs::path &path, bela::Time modified, bela::err
   return baulk::archive::Chtimes(path, modified, ec);
 }
 
+// NewDirectory creates one directory whose parent exists, an existing directory is not an error
+bool NewDirectory(const fs::path &path, bela::error_code &ec);
 bool NewSymlink(const fs::path &path, const fs::path &source, bool overwrite_mode, bela::error_code &ec);
+// NewSymlinkBelow creates path as a symlink to linkname, relative to the folder of path, when the target stays inside
+// root
+bool NewSymlinkBelow(const fs::path &root, const fs::path &path, const std::wstring &linkname, bool overwrite_mode,
+                     bela::error_code &ec);
+// NewHardLink makes path another name of the file source, source is copied when it is on another volume or has run
+// out of links. An existing path is replaced only once the new link is in place
+bool NewHardLink(const fs::path &path, const fs::path &source, bool overwrite_mode, bela::error_code &ec);
 
 std::wstring_view PathStripExtension(std::wstring_view p);
 
@@ -62,13 +234,75 @@ inline std::wstring FileDestination(std::wstring_view arfile) {
   return bela::StringCat(arfile, L".out");
 }
 
+// Charset is the codepage of the names of an archive that are not flagged UTF-8, detected once from all of them.
+// Single and double byte codepages are decoded through tables shared by every archive using them
+class Charset {
+public:
+  Charset() = default;
+  // Detect runs the detector once over the names that are not ascii. Names the codepage found cannot decode are
+  // conflicting evidence, when more than a tenth conflict the charset stays undecided
+  static Charset Detect(const std::vector<std::string_view> &names);
+  [[nodiscard]] uint32_t CodePage() const { return codePage; }
+  // Decode converts name with the codepage, a name it cannot decode and every name of an undecided charset is
+  // detected on its own
+  std::wstring Decode(std::string_view name) const;
+
+private:
+  struct table;
+  static std::shared_ptr<const table> lookup(uint32_t codePage);
+  bool decode(std::string_view name, std::wstring &out) const;
+  std::shared_ptr<const table> decoder;
+  uint32_t codePage{0};
+};
+
 std::optional<std::wstring> JoinSanitizePath(std::wstring_view root, std::string_view child_path,
                                              bool always_utf8 = true);
 //
 std::wstring EncodeToNativePath(std::string_view filename, bool always_utf8);
+std::wstring EncodeToNativePath(std::string_view filename, bool always_utf8, const Charset &charset);
 bool IsHarmfulPath(std::string_view child_path);
+// StripComponents drops the first n components of an archive path, leading "." components are not counted. It
+// returns an empty view when nothing is left
+inline std::string_view StripComponents(std::string_view name, uint32_t n) {
+  auto is_separator = [](char c) { return c == '/' || c == '\\'; };
+  while (n > 0 && !name.empty()) {
+    auto pos = name.find_first_of("/\\");
+    auto component = name.substr(0, pos);
+    name = pos == std::string_view::npos ? std::string_view{} : name.substr(pos + 1);
+    while (!name.empty() && is_separator(name.front())) {
+      name.remove_prefix(1);
+    }
+    if (component != ".") {
+      n--;
+    }
+  }
+  return name;
+}
+
+// Flattener tracks the chain of single folders, none named bin, that holds every entry seen so far. They are the
+// folders baulk::fs::MakeFlattened removes after extraction, stripping them from entry names puts files in their
+// final place the first time
+class Flattener {
+public:
+  // Add records an entry and returns the depth of the chain, directory tells whether the last component of name is a
+  // folder. The chain grows while every entry is one of its folders and only gets shorter once anything else is seen
+  size_t Add(std::string_view name, bool directory);
+  [[nodiscard]] size_t Depth() const { return depth; }
+  // Folders joins the folders from..to of the chain, after Add lowered the depth they are the folders that are no
+  // longer stripped
+  [[nodiscard]] std::string Folders(size_t from, size_t to) const;
+
+private:
+  std::vector<std::string> chain;
+  size_t depth{0};
+  bool closed{false};
+};
+
 std::optional<fs::path> JoinSanitizeFsPath(const fs::path &root, std::string_view child_path, bool always_utf8,
                                            std::wstring &encoded_path);
+// JoinSanitizeFsPath decodes a name not flagged UTF-8 with the charset of its archive
+std::optional<fs::path> JoinSanitizeFsPath(const fs::path &root, std::string_view child_path, bool always_utf8,
+                                           const Charset &charset, std::wstring &encoded_path);
 
 //
 bool CheckFormat(bela::io::FD &fd, file_format_t &afmt, int64_t &offset, bela::error_code &ec);
@@ -1,9 +1,99 @@
 //
 #ifndef BAULK_ARCHIVE_7Z_HPP
 #define BAULK_ARCHIVE_7Z_HPP
+#include <bela/base.hpp>
 #include <bela/io.hpp>
+#include <bela/time.hpp>
+#include <functional>
+#include <algorithm>
+#include <vector>
+#include <baulk/archive.hpp>
 
 namespace baulk::archive::n7z {
+using bela::os::FileMode;
+// https://github.com/ip7z/7zip/blob/main/DOC/7zFormat.txt
+// https://py7zr.readthedocs.io/en/latest/archive_format.html
+// coder method ids, the id bytes read as a big-endian integer
+typedef enum method_e : uint64_t {
+  METHOD_COPY = 0x00,
+  METHOD_DELTA = 0x03,
+  METHOD_X86 = 0x03030103,
+  METHOD_PPC = 0x03030205,
+  METHOD_IA64 = 0x03030401,
+  METHOD_ARM = 0x03030501,
+  METHOD_ARMT = 0x03030701,
+  METHOD_SPARC = 0x03030805,
+  METHOD_ARM64 = 0x0A,
+  METHOD_RISCV = 0x0B,
+  METHOD_BCJ2 = 0x0303011B,
+  METHOD_LZMA = 0x030101,
+  METHOD_LZMA2 = 0x21,
+  METHOD_PPMD = 0x030401,
+  METHOD_DEFLATE = 0x040108,
+  METHOD_DEFLATE64 = 0x040109,
+  METHOD_BZIP2 = 0x040202,
+  METHOD_ZSTD = 0x04F71101,
+  METHOD_BROTLI = 0x04F71102,
+  METHOD_AES = 0x06F10701,
+} method_t;
+
+constexpr uint32_t noFolder = 0xFFFFFFFFU;
+
+struct Coder {
+  uint64_t method{0};
+  uint32_t num_in_streams{1};  // packed side
+  uint32_t num_out_streams{1}; // unpacked side
+  std::vector<uint8_t> props;
+};
+
+// BindPair connects the in stream of one coder to the out stream of another
+struct BindPair {
+  uint32_t in_index{0};
+  uint32_t out_index{0};
+};
+
+// Folder is a coder graph decoded as one unit, solid archives keep many files in one folder
+struct Folder {
+  std::vector<Coder> coders;
+  std::vector<BindPair> bind_pairs;
+  std::vector<uint32_t> packed_streams; // coder in streams fed from pack streams
+  std::vector<uint64_t> unpack_sizes;   // one per coder out stream
+  std::vector<uint32_t> entries;        // indexes of the files stored in this folder, in decode order
+  uint32_t first_pack_stream{0};
+  uint32_t crc32_value{0};
+  bool has_crc{false};
+  // MainOutStream is the out stream not bound to any coder, it yields the folder data
+  uint32_t MainOutStream() const {
+    for (uint32_t i = 0; i < unpack_sizes.size(); i++) {
+      if (!std::ranges::any_of(bind_pairs, [i](const BindPair &bp) { return bp.out_index == i; })) {
+        return i;
+      }
+    }
+    return 0;
+  }
+  uint64_t UnpackSize() const { return unpack_sizes.empty() ? 0 : unpack_sizes[MainOutStream()]; }
+};
+
+struct File {
+  std::string name;            /* UTF-8 path */
+  uint64_t size{0};            /* uncompressed size */
+  uint64_t offset{0};          /* offset in the folder data */
+  bela::Time time;             /* last modified date */
+  uint32_t attributes{0};      /* windows attributes, unix mode in the high 16 bits */
+  uint32_t crc32_value{0};     /* crc32 */
+  uint32_t folder{noFolder};   /* folder index, noFolder when the file has no data */
+  FileMode mode{0};            /* file mode */
+  bool has_crc{false};         /* crc32_value is defined */
+  bool has_stream{false};      /* the file data lives in a folder */
+  bool is_anti{false};         /* anti item, deletes the path in update archives */
+  bool IsDir() const { return (mode & FileMode::ModeDir) != 0; }
+  bool IsSymlink() const { return (mode & FileMode::ModeSymlink) != 0; }
+};
+
+using Writer = std::function<bool(const void *data, size_t bytes)>;
+// OpenWriter prepares the destination of a file decoded from a folder, leaving w empty discards its data
+using OpenWriter = std::function<bool(const File &file, Writer &w, bela::error_code &ec)>;
+
 class Reader {
 public:
   Reader() = default;
@@ -11,12 +101,30 @@ public:
   Reader &operator=(const Reader &) = delete;
   bool OpenReader(std::wstring_view file, bela::error_code &ec);
   bool OpenReader(HANDLE nfd, int64_t size_, int64_t offset_, bela::error_code &ec);
+  [[nodiscard]] const auto &Files() const { return files; }
+  [[nodiscard]] const auto &Folders() const { return folders; }
+  [[nodiscard]] uint64_t UncompressedSize() const { return uncompressedSize; }
+  [[nodiscard]] uint64_t CompressedSize() const { return compressedSize; }
+  // CheckFolders walks the coder graph of every folder without reading data, ErrUnimplemented names a coder or a
+  // filter chain Decompress cannot decode. Nothing needs to be written to find out
+  bool CheckFolders(bela::error_code &ec) const;
+  // Decompress decodes folder index once, every file stored in it is handed to open in order and checked against
+  // its crc32. Folders are independent, distinct folders may be decompressed concurrently
+  bool Decompress(size_t index, const OpenWriter &open, bela::error_code &ec) const;
 
 private:
+  bool Initialize(bela::error_code &ec);
+  bool readPackedHeader(std::vector<uint8_t> &header, bela::error_code &ec);
   bela::io::FD fd;
   int64_t size{bela::SizeUnInitialized};
   int64_t startPosition{0};
+  std::vector<int64_t> packPositions; // absolute
+  std::vector<uint64_t> packSizes;
+  std::vector<Folder> folders;
+  std::vector<File> files;
+  uint64_t uncompressedSize{0};
+  uint64_t compressedSize{0};
 };
 } // namespace baulk::archive::n7z
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,77 @@
+//
+#ifndef BAULK_ARCHIVE_CAB_HPP
+#define BAULK_ARCHIVE_CAB_HPP
+#include <bela/base.hpp>
+#include <bela/io.hpp>
+#include <bela/time.hpp>
+#include <functional>
+#include <vector>
+#include <baulk/archive.hpp>
+
+namespace baulk::archive::cab {
+// https://learn.microsoft.com/en-us/previous-versions/bb417343(v=msdn.10)
+typedef enum method_e : uint16_t {
+  METHOD_NONE = 0,
+  METHOD_MSZIP = 1,
+  METHOD_QUANTUM = 2,
+  METHOD_LZX = 3,
+} method_t;
+
+constexpr uint16_t attributeReadOnly = 0x01;
+constexpr uint16_t attributeNameIsUtf8 = 0x80;
+
+// Source reads len bytes at offset of the cabinet, which is either a file or a stream of an MSI package.
+// Folders decoded on several threads call it concurrently
+using Source = std::function<bool(void *buffer, size_t len, int64_t offset, bela::error_code &ec)>;
+
+// Folder is a run of CFDATA blocks compressed as one unit, its files are slices of the decoded data
+struct Folder {
+  uint32_t offset{0};            // first CFDATA block
+  uint16_t blocks{0};            // CFDATA block count
+  uint16_t compression{0};       // method in the low 4 bits, LZX/Quantum window bits above
+  uint64_t unpack_size{0};       // end of the last file in the folder data
+  std::vector<uint32_t> entries; // indexes of the files stored in this folder, sorted by offset
+  method_t Method() const { return static_cast<method_t>(compression & 0x0F); }
+};
+
+struct File {
+  std::string name;        /* UTF-8 when attributeNameIsUtf8 is set, otherwise the producer codepage */
+  uint32_t size{0};        /* uncompressed size */
+  uint32_t offset{0};      /* offset in the folder data */
+  uint16_t folder{0};      /* folder index */
+  uint16_t attributes{0};  /* dos attributes */
+  bela::Time time;         /* last modified date */
+};
+
+using Writer = std::function<bool(const void *data, size_t bytes)>;
+// OpenWriter prepares the destination of a file decoded from a folder, leaving w empty discards its data
+using OpenWriter = std::function<bool(const File &file, Writer &w, bela::error_code &ec)>;
+
+class Reader {
+public:
+  Reader() = default;
+  Reader(const Reader &) = delete;
+  Reader &operator=(const Reader &) = delete;
+  bool OpenReader(std::wstring_view file, bela::error_code &ec);
+  bool OpenReader(Source &&source_, int64_t size_, bela::error_code &ec);
+  [[nodiscard]] const auto &Files() const { return files; }
+  [[nodiscard]] const auto &Folders() const { return folders; }
+  [[nodiscard]] uint64_t UncompressedSize() const { return uncompressedSize; }
+  [[nodiscard]] int64_t CompressedSize() const { return size; }
+  // Decompress decodes folder index once, every file stored in it is handed to open in order. Folders are
+  // independent, distinct folders may be decompressed concurrently
+  bool Decompress(size_t index, const OpenWriter &open, bela::error_code &ec) const;
+
+private:
+  bool Initialize(bela::error_code &ec);
+  bela::io::FD fd;
+  Source source;
+  int64_t size{bela::SizeUnInitialized};
+  std::vector<Folder> folders;
+  std::vector<File> files;
+  uint64_t uncompressedSize{0};
+  uint8_t dataReserved{0}; // per CFDATA reserved bytes
+};
+} // namespace baulk::archive::cab
+
+#endif
@@ -2,9 +2,16 @@
 #ifndef BAULK_ARCHIVE_CRC32_HPP
 #define BAULK_ARCHIVE_CRC32_HPP
 #include <cstdint>
+#include <cstddef>
 #include "details/crc32.h"
 
 namespace baulk::archive {
+// Crc32 computes CRC-32 with the fastest kernel of the running CPU, zlib-ng selects folding with
+// PCLMULQDQ/VPCLMULQDQ on x86 and the CRC32 instructions on ARMv8 at runtime
+uint32_t Crc32(const void *data, size_t bytes, uint32_t previous = 0);
+// Crc32Combine returns the CRC-32 of A followed by B, blocks can be summed in parallel and combined in order
+uint32_t Crc32Combine(uint32_t crcA, uint32_t crcB, uint64_t bytesB);
+
 class Summator {
 public:
   Summator(uint32_t val = 0) : crc32_target_val(val) {}
@@ -12,7 +19,7 @@ public:
     if (crc32_target_val == 0) {
       return;
     }
-    current = crc32_fast(data, bytes, current);
+    current = Crc32(data, bytes, current);
   }
   bool Valid() const {
     if (crc32_target_val == 0) {
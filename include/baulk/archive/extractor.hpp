@@ -3,10 +3,22 @@
 #define BAULK_ARCHIVE_EXTRACTOR_HPP
 #include <bela/base.hpp>
 #include <bela/io.hpp>
+#include <bela/hash.hpp>
 #include <baulk/archive.hpp>
 #include <baulk/archive/zip.hpp>
 #include <baulk/archive/tar.hpp>
+#include <baulk/archive/7z.hpp>
+#include <baulk/archive/msidb.hpp>
 #include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace baulk::archive {
 namespace fs = std::filesystem;
@@ -14,6 +26,36 @@ namespace fs = std::filesystem;
 struct ExtractorOptions {
   bool ignore_error{false};
   bool overwrite_mode{true};
+  // zip: number of worker threads used to extract entries, 7z and msi: folders decoded at once,
+  // 0 selects the hardware concurrency
+  uint32_t threads{1};
+  // zip: read entries from a read-only mapping of the archive, falls back to positional reads. Reads through the view
+  // are not guarded, an I/O error under the mapping (network share gone, truncated file, bad sector) raises
+  // EXCEPTION_IN_PAGE_ERROR and ends the process instead of returning an error. Only for local, trusted archives
+  bool memory_mapped{false};
+  // tar: decompress, parse and write on separate threads connected by bounded queues
+  bool pipelined{false};
+  // zip: threads decoding the blocks of one xz or zstd entry and their memory limit, see zip::DecoderOptions
+  uint32_t decoder_threads{1};
+  uint64_t decoder_memlimit{0};
+  // zip and tar: drop this many leading components of entry names, entries that have no more are skipped
+  uint32_t strip_components{0};
+  // zip and tar: extract the contents of the single folders holding every entry into the destination, the layout
+  // baulk::fs::MakeFlattened produces after extraction
+  bool flatten{false};
+  // zip and tar: files up to this size are buffered and created, written and closed by a FilePool, larger files are
+  // only closed there. 0 finishes every file on the extracting thread
+  uint32_t small_file_size{64 * 1024};
+  // zip and tar: entries of at least this size are preallocated and written in 1 MiB chunks, 0 writes them like any
+  // other file
+  uint64_t large_file_size{32 * 1024 * 1024};
+  // zip and tar: copy large entries into a writable mapping of the output file instead. Writes through the view are
+  // not guarded, a failed page-in or flush (disk full, quota, network destination, bad sector) raises
+  // EXCEPTION_IN_PAGE_ERROR and ends the process instead of returning an error. Only for local destinations
+  bool mapped_writes{false};
+  // tar: hash regular files as they are written and replace one whose contents match an earlier file with a hard link
+  // to it, the linked names share the timestamps of the first one
+  bool dedupe{false};
 };
 
 namespace zip {
@@ -21,7 +63,9 @@ using Filter = std::function<bool(const File &file, const std::wstring &relative
 using OnProgress = std::function<bool(size_t bytes)>;
 class Extractor {
 public:
-  Extractor(const ExtractorOptions &opts_) noexcept : opts(opts_) {}
+  Extractor(const ExtractorOptions &opts_) noexcept : opts(opts_) {
+    reader.SetDecoderOptions(DecoderOptions{.threads = opts.decoder_threads, .memlimit = opts.decoder_memlimit});
+  }
   Extractor(const Extractor &) = delete;
   Extractor &operator=(const Extractor &) = delete;
   auto UncompressedSize() const { return reader.UncompressedSize(); }
@@ -37,7 +81,11 @@ public:
       ec = bela::make_error_code_from_std(e, L"fs::canonical() ");
       return false;
     }
-    return reader.OpenReader(zipfile.c_str(), ec);
+    if (!reader.OpenReader(zipfile.c_str(), ec)) {
+      return false;
+    }
+    enable_mapping();
+    return true;
   }
   bool OpenReader(bela::io::FD &fd, const fs::path &dest, int64_t size, int64_t offset, bela::error_code &ec) {
     std::error_code e;
@@ -45,87 +93,171 @@ public:
       ec = bela::make_error_code_from_std(e, L"fs::absolute() ");
       return false;
     }
-    return reader.OpenReader(fd.NativeFD(), size, offset, ec);
-  }
-  bool Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
-    std::error_code e;
-    if (fs::create_directories(destination, e); e) {
-      ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", destination, L"' "));
+    if (!reader.OpenReader(fd.NativeFD(), size, offset, ec)) {
       return false;
     }
-    for (const auto &file : reader.Files()) {
-      if (!extract_entry(file, filter, progress, ec)) {
-        if (ec.code == bela::ErrCanceled || opts.ignore_error == false) {
-          return false;
-        }
-      }
-    }
+    enable_mapping();
     return true;
   }
+  bool Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec);
 
 private:
   ExtractorOptions opts;
   Reader reader;
   fs::path destination;
-  bool create_symlink(const fs::path &_New_symlink, std::string_view linkname, bool always_utf8, bela::error_code &ec) {
-    auto nativeLinkName = baulk::archive::EncodeToNativePath(linkname, always_utf8);
-    std::error_code e;
-    auto linkPath = fs::absolute(_New_symlink.parent_path() / nativeLinkName, e);
-    if (e) {
-      ec = bela::make_error_code_from_std(e, L"absolute() ");
-      return false;
+  std::unique_ptr<FilePool> pool; // finishes files while Extract runs
+  struct entry_task {
+    const File *file{nullptr};
+    fs::path out;
+  };
+  // extract_plan is built from the central directory before anything is written: targets are sanitized once, the
+  // directory tree is deduplicated so it is created with one call per directory and every path has a single writer
+  struct extract_plan {
+    std::vector<fs::path> directories; // parents first
+    std::vector<entry_task> folders;   // directory entries
+    std::vector<entry_task> targets;   // files and symlinks, a null file was replaced by a later entry
+  };
+  void enable_mapping() {
+    if (!opts.memory_mapped) {
+      return;
     }
-    auto relativePath = fs::relative(linkPath, destination, e);
-    if (e) {
-      ec = bela::make_error_code_from_std(e, L"relative() ");
-      return false;
-    }
-    if (bela::StrContains(relativePath.c_str(), L"..\\")) {
-      ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", nativeLinkName);
-      return false;
-    }
-    return baulk::archive::NewSymlink(_New_symlink, nativeLinkName, opts.overwrite_mode, ec);
+    // mapping is an optimization only, positional reads keep working when it fails
+    bela::error_code ec;
+    reader.EnableMapping(ec);
   }
+  static std::wstring fold_case(const fs::path &p);
+  bool make_plan(const Filter &filter, extract_plan &plan, bela::error_code &ec);
+  bool extract_file(const File &file, const fs::path &out, const OnProgress &progress, bela::error_code &ec);
+  bool extract_parallel(std::vector<entry_task> &tasks, const OnProgress &progress, uint32_t threads,
+                        bela::error_code &ec);
+};
+} // namespace zip
+namespace tar {
+using Filter = std::function<bool(const Header &hdr, const std::wstring &relative_name)>;
+using OnProgress = std::function<bool(size_t bytes)>;
 
-  bool extract_entry(const File &file, const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
-    std::wstring encoded_path;
-    auto out = baulk::archive::JoinSanitizeFsPath(destination, file.name, file.IsFileNameUTF8(), encoded_path);
-    if (!out) {
-      ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", bela::encode_into<char, wchar_t>(file.name));
+// write_job is a step of the write stage, payload data points into a pipe buffer kept alive by the lease
+struct write_job {
+  enum kind_t : uint8_t { Directory, Symlink, HardLink, Relocate, Open, Sparse, Seek, Write, Close, Discard };
+  kind_t kind{Write};
+  fs::path path;
+  fs::path source;               // HardLink: extracted file that path becomes another name of
+  std::vector<fs::path> entries; // Relocate: top level entries moved into path
+  bela::Time time;
+  std::string linkname;
+  const void *data{nullptr};
+  size_t len{0};
+  int64_t offset{0}; // Open: size of a regular file, Sparse: size of the file, Seek: offset of the next write
+  std::shared_ptr<const void> lease;
+};
+
+// write_queue runs jobs on its own thread in the order they are pushed. Push blocks while the queue is full, a failed
+// job stops the queue and later pushes return its error
+class write_queue {
+public:
+  using Handler = std::function<bool(write_job &job, bela::error_code &ec)>;
+  write_queue(Handler &&h, size_t limit_ = 4096) : handler(std::move(h)), limit(limit_) {
+    worker = std::thread([this] { run(); });
+  }
+  write_queue(const write_queue &) = delete;
+  write_queue &operator=(const write_queue &) = delete;
+  ~write_queue() {
+    Cancel();
+    bela::error_code ec;
+    Finish(ec);
+  }
+  bool Push(write_job &&job, bela::error_code &ec) {
+    auto begin = std::chrono::steady_clock::now();
+    std::unique_lock lock(mu);
+    cv.wait(lock, [&] { return stopped || jobs.size() < limit; });
+    blocked += std::chrono::steady_clock::now() - begin;
+    if (stopped) {
+      ec = failed ? firstEc : bela::make_error_code(bela::ErrCanceled, L"canceled");
       return false;
     }
-    if (filter && !filter(file, encoded_path)) {
-      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
-      return false;
+    jobs.emplace_back(std::move(job));
+    lock.unlock();
+    cv.notify_all();
+    return true;
+  }
+  // Cancel drops the jobs not yet started
+  void Cancel() {
+    std::deque<write_job> dropped;
+    {
+      std::scoped_lock lock(mu);
+      stopped = true;
+      dropped.swap(jobs);
     }
-    std::error_code e;
-    if (file.IsDir()) {
-      return MakeDirectories(*out, file.time, ec);
+    cv.notify_all();
+  }
+  // Finish waits for the pushed jobs, it returns false with the error of the job that failed
+  bool Finish(bela::error_code &ec) {
+    {
+      std::scoped_lock lock(mu);
+      closed = true;
     }
-    if (file.IsSymlink()) {
-      return create_symlink(*out, reader.ResolveLinkName(file, ec), file.IsFileNameUTF8(), ec);
+    cv.notify_all();
+    if (worker.joinable()) {
+      worker.join();
     }
-    auto fd = baulk::archive::File::NewFile(*out, file.time, opts.overwrite_mode, ec);
-    if (!fd) {
+    if (failed) {
+      ec = firstEc;
       return false;
     }
-    bela::error_code writeEc;
-    return reader.Decompress(
-        file,
-        [&](const void *data, size_t len) {
-          if (progress && !progress(len)) {
-            // canceled
-            return false;
-          }
-          return fd->WriteFull(data, len, writeEc);
-        },
-        ec);
+    return true;
+  }
+  // Stage and Blocked are complete once Finish returns, Blocked is the time Push waited for room
+  [[nodiscard]] const PipelineStage &Stage() const { return stage; }
+  [[nodiscard]] std::chrono::nanoseconds Blocked() const { return blocked; }
+
+private:
+  void run() {
+    for (;;) {
+      write_job job;
+      {
+        auto begin = std::chrono::steady_clock::now();
+        std::unique_lock lock(mu);
+        cv.wait(lock, [&] { return stopped || closed || !jobs.empty(); });
+        stage.stalled += std::chrono::steady_clock::now() - begin;
+        if (stopped || jobs.empty()) {
+          return;
+        }
+        job = std::move(jobs.front());
+        jobs.pop_front();
+      }
+      cv.notify_all();
+      auto begin = std::chrono::steady_clock::now();
+      bela::error_code ec;
+      auto ok = handler(job, ec);
+      job.lease.reset();
+      stage.busy += std::chrono::steady_clock::now() - begin;
+      if (!ok) {
+        std::deque<write_job> dropped;
+        {
+          std::scoped_lock lock(mu);
+          failed = true;
+          stopped = true;
+          firstEc = std::move(ec);
+          dropped.swap(jobs);
+        }
+        cv.notify_all();
+        return;
+      }
+    }
   }
+  Handler handler;
+  size_t limit{0};
+  std::deque<write_job> jobs;
+  std::mutex mu;
+  std::condition_variable cv;
+  bela::error_code firstEc;
+  PipelineStage stage;
+  std::chrono::nanoseconds blocked{0};
+  bool stopped{false};
+  bool closed{false};
+  bool failed{false};
+  std::thread worker;
 };
-} // namespace zip
-namespace tar {
-using Filter = std::function<bool(const Header &hdr, const std::wstring &relative_name)>;
-using OnProgress = std::function<bool(size_t bytes)>;
 
 class Extractor {
 public:
@@ -150,14 +282,21 @@ public:
       ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", destination, L"' "));
       return false;
     }
+    // dedupe links to files once they are closed, they are finished on the extracting thread
+    if (opts.small_file_size != 0 && !opts.dedupe) {
+      pool = std::make_unique<FilePool>();
+    }
+    auto closer = bela::finally([&] { pool.reset(); });
+    if (opts.pipelined) {
+      return extract_pipelined(filter, progress, ec);
+    }
     auto tr = std::make_shared<baulk::archive::tar::Reader>(reader);
-    std::wstring encoded_path;
+    Header fh;
     for (;;) {
-      auto fh = tr->Next(ec);
-      if (!fh) {
+      if (!tr->Next(fh, ec)) {
         break;
       }
-      if (extract_entry(*tr, *fh, filter, progress, ec)) {
+      if (extract_entry(*tr, fh, filter, progress, ec)) {
         continue;
       }
       if (ec == bela::ErrCanceled) {
@@ -175,37 +314,210 @@ public:
       return false;
     }
     ec.clear();
-    return true;
+    return finish_pool(ec);
   }
+  // Stats reports the time each stage of the last pipelined extraction spent working and waiting
+  [[nodiscard]] const PipelineStats &Stats() const { return stats; }
 
 private:
   ExtractReader *reader{nullptr};
   ExtractorOptions opts;
   fs::path destination;
+  PipelineStats stats;
+  std::optional<baulk::archive::File> pending; // file being written by the write stage
+  fs::path pending_path;
+  bela::Time pending_time;
+  std::optional<LargeFile> pending_large; // fills pending when it is a large file
+  std::unique_ptr<FilePool> pool; // finishes files while Extract runs
+  // dedupe: the contents of the file being written and the first file extracted with each contents
+  struct contents_hasher {
+    bela::hash::blake3::Hasher hasher;
+    fs::path path;
+    int64_t size{0};
+    bool active{false};
+  } contents;
+  std::unordered_map<std::string, fs::path> extracted;
+  bool linked{false}; // a hard link entry was extracted, files may share their data with other names
+  // flatten: the folders stripped from entry names and the top level entries extracted so far
+  Flattener flattener;
+  std::unordered_set<std::wstring> tops;
   bool create_symlink(const fs::path &_New_symlink, std::string_view linkname, bela::error_code &ec) {
-    auto nativeLinkName = baulk::archive::EncodeToNativePath(linkname, true);
+    return NewSymlinkBelow(destination, _New_symlink, EncodeToNativePath(linkname, true), opts.overwrite_mode, ec);
+  }
+  // hardlink_source resolves the target of a hard link entry, a name of an earlier entry of the archive
+  std::optional<fs::path> hardlink_source(const Header &fh, bela::error_code &ec) {
+    std::wstring encoded_path;
+    auto linkname = StripComponents(fh.LinkName, opts.strip_components + static_cast<uint32_t>(flattener.Depth()));
+    auto source = baulk::archive::JoinSanitizeFsPath(destination, linkname, true, encoded_path);
+    if (!source) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <h>: ",
+                                 bela::encode_into<char, wchar_t>(fh.LinkName));
+    }
+    return source;
+  }
+  void begin_contents(const fs::path &path) {
+    if (!opts.dedupe) {
+      return;
+    }
+    contents.hasher.Initialize();
+    contents.path = path;
+    contents.size = 0;
+    contents.active = true;
+  }
+  void update_contents(const void *data, size_t len) {
+    if (contents.active) {
+      contents.hasher.Update(data, len);
+      contents.size += static_cast<int64_t>(len);
+    }
+  }
+  // end_contents runs once the file is closed, a file with the contents of an earlier one becomes a hard link to it.
+  // When the link cannot be made the file is kept and later duplicates link to it
+  void end_contents() {
+    if (!contents.active) {
+      return;
+    }
+    contents.active = false;
+    if (contents.size == 0) {
+      return;
+    }
+    std::string key(BLAKE3_OUT_LEN + sizeof(int64_t), '\0');
+    contents.hasher.Finalize(reinterpret_cast<uint8_t *>(key.data()), BLAKE3_OUT_LEN);
+    memcpy(key.data() + BLAKE3_OUT_LEN, &contents.size, sizeof(int64_t));
+    auto [it, inserted] = extracted.try_emplace(std::move(key), contents.path);
+    if (inserted) {
+      return;
+    }
+    bela::error_code ec;
+    if (!baulk::archive::NewHardLink(contents.path, it->second, true, ec)) {
+      it->second = std::move(contents.path);
+    }
+  }
+
+  // flush_target waits for the pool to finish an earlier file of the same name, it may still be creating, writing or
+  // holding path when a directory, symlink or another file takes its place
+  void flush_target(const fs::path &path) {
+    if (pool) {
+      pool->Flush(path);
+    }
+  }
+  // release_target runs before a file, symlink or hard link replaces what an earlier entry wrote at path. With dedupe
+  // or after hard link entries that file may share its data with other names, opening it again would truncate them
+  // all: it is removed instead, and later duplicates no longer link to it
+  void release_target(const fs::path &path) {
+    if (!opts.dedupe && !linked) {
+      return;
+    }
+    flush_target(path);
     std::error_code e;
-    auto linkPath = fs::absolute(_New_symlink.parent_path() / nativeLinkName, e);
-    if (e) {
-      ec = bela::make_error_code_from_std(e, L"absolute() ");
+    if (!fs::remove(path, e) && !e) {
+      // nothing was there
+      return;
+    }
+    std::erase_if(extracted, [&](const auto &it) { return it.second == path; });
+  }
+
+  // strip_name strips opts.strip_components and, with flatten, the folders holding every entry so far from the name
+  // of an entry, an empty name is skipped. When an entry outside those folders appears the entries already extracted
+  // belong one or more folders down, relocation is set to that folder
+  bool strip_name(const Header &fh, std::string_view &name, std::optional<fs::path> &relocation, bela::error_code &ec) {
+    name = StripComponents(fh.Name, opts.strip_components);
+    if (!opts.flatten || name.empty()) {
+      return true;
+    }
+    auto depth = flattener.Depth();
+    if (flattener.Add(name, fh.IsDir()) < depth) {
+      std::wstring encoded_path;
+      auto folders = flattener.Folders(flattener.Depth(), depth);
+      if (relocation = baulk::archive::JoinSanitizeFsPath(destination, folders, true, encoded_path); !relocation) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"harmful path: ", bela::encode_into<char, wchar_t>(folders));
+        return false;
+      }
+    }
+    name = StripComponents(name, static_cast<uint32_t>(flattener.Depth()));
+    return true;
+  }
+  void record_top(std::wstring_view encoded_path) {
+    if (!opts.flatten) {
+      return;
+    }
+    for (;;) {
+      encoded_path.remove_prefix((std::min)(encoded_path.find_first_not_of(L"/\\"), encoded_path.size()));
+      auto top = encoded_path.substr(0, encoded_path.find_first_of(L"/\\"));
+      if (top.empty()) {
+        return;
+      }
+      if (top != L".") {
+        tops.emplace(top);
+        return;
+      }
+      encoded_path.remove_prefix(top.size());
+    }
+  }
+  // relocated_entries hands the top level entries extracted so far to a relocation into folder, afterwards folder is
+  // the only one
+  std::vector<fs::path> relocated_entries(const fs::path &folder) {
+    std::vector<fs::path> entries;
+    entries.reserve(tops.size());
+    for (const auto &top : tops) {
+      entries.emplace_back(destination / top);
+    }
+    tops.clear();
+    record_top(folder.lexically_relative(destination).native());
+    return entries;
+  }
+  // relocate moves entries into folder through a temporary folder, folder may have the name of one of them
+  bool relocate(const fs::path &folder, const std::vector<fs::path> &entries, bela::error_code &ec) {
+    auto temp = destination / bela::StringCat(L".baulk-flatten-", GetCurrentProcessId());
+    std::error_code e;
+    if (fs::create_directory(temp, e); e) {
+      ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directory() '", temp, L"' "));
       return false;
     }
-    auto relativePath = fs::relative(linkPath, destination, e);
-    if (e) {
-      ec = bela::make_error_code_from_std(e, L"relative() ");
+    for (const auto &entry : entries) {
+      if (fs::rename(entry, temp / entry.filename(), e); e) {
+        ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::rename() '", entry, L"' "));
+        return false;
+      }
+    }
+    auto parent = folder.parent_path();
+    if (fs::create_directories(parent, e); e) {
+      ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", parent, L"' "));
       return false;
     }
-    if (bela::StrContains(relativePath.c_str(), L"..\\")) {
-      ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", nativeLinkName);
+    if (fs::rename(temp, folder, e); e) {
+      ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::rename() '", temp, L"' "));
       return false;
     }
-    return baulk::archive::NewSymlink(_New_symlink, nativeLinkName, opts.overwrite_mode, ec);
+    // the files kept for dedupe moved with them
+    for (auto &[_, path] : extracted) {
+      path = folder / path.lexically_relative(destination);
+    }
+    return true;
+  }
+
+  // finish_pool waits for the files handed to the pool, hard links and relocations need them in place
+  bool finish_pool(bela::error_code &ec) {
+    if (!pool) {
+      return true;
+    }
+    return pool->Wait(ec) || opts.ignore_error;
   }
 
   bool extract_entry(Reader &tr, const Header &fh, const Filter &filter, const OnProgress &progress,
                      bela::error_code &ec) {
+    std::string_view name;
+    std::optional<fs::path> relocation;
+    if (!strip_name(fh, name, relocation, ec)) {
+      return false;
+    }
+    if (relocation && (!finish_pool(ec) || !relocate(*relocation, relocated_entries(*relocation), ec))) {
+      return false;
+    }
+    if (name.empty()) {
+      return true;
+    }
     std::wstring encoded_path;
-    auto out = baulk::archive::JoinSanitizeFsPath(destination, fh.Name, true, encoded_path);
+    auto out = baulk::archive::JoinSanitizeFsPath(destination, name, true, encoded_path);
     if (!out) {
       ec = bela::make_error_code(bela::ErrGeneral, L"harmful path: ", bela::encode_into<char, wchar_t>(fh.Name));
       return false;
@@ -214,36 +526,452 @@ private:
       ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
       return false;
     }
+    record_top(encoded_path);
     if (fh.IsDir()) {
+      flush_target(*out);
       return MakeDirectories(*out, fh.ModTime, ec);
     }
     if (fh.IsSymlink()) {
+      flush_target(*out);
+      release_target(*out);
       return create_symlink(*out, fh.LinkName, ec);
     }
-    // i
+    if (fh.IsHardLink()) {
+      auto source = hardlink_source(fh, ec);
+      if (!source) {
+        return false;
+      }
+      flush_target(*out);
+      if (*source != *out) {
+        release_target(*out);
+      }
+      linked = true;
+      return finish_pool(ec) && baulk::archive::NewHardLink(*out, *source, opts.overwrite_mode, ec);
+    }
     if (!fh.IsRegular()) {
       return true;
     }
+    release_target(*out);
+    if (pool && !fh.IsSparse() && fh.Size <= static_cast<int64_t>(opts.small_file_size)) {
+      // the whole file is handed to the pool, it is created and written there with a single call
+      std::vector<uint8_t> buffer;
+      buffer.reserve(static_cast<size_t>(fh.Size));
+      auto w = [&](const void *data, size_t len, bela::error_code &) -> bool {
+        if (progress && !progress(len)) {
+          // canceled
+          return false;
+        }
+        auto p = static_cast<const uint8_t *>(data);
+        buffer.insert(buffer.end(), p, p + len);
+        return true;
+      };
+      if (!tr.WriteTo(w, fh.Size, ec)) {
+        return false;
+      }
+      pool->Write(std::move(*out), std::move(buffer), fh.ModTime, true, true);
+      return true;
+    }
+    // an earlier entry of the same name may still be in the pool
+    flush_target(*out);
     auto fd = baulk::archive::File::NewFile(*out, fh.ModTime, true, ec);
     if (!fd) {
       return false;
     }
-    if (!tr.WriteTo(
-            [&](const void *data, size_t len, bela::error_code &ec) -> bool {
-              if (progress && !progress(len)) {
-                // canceled
-                return false;
-              }
-              return fd->WriteFull(data, len, ec);
-            },
-            fh.Size, ec)) {
+    if (!fh.IsSparse() && !opts.dedupe) {
+      // a tarball without a filter is copied range to range, on ReFS and Dev Drive the clusters are cloned
+      if (tr.CopyTo(*fd, fh.Size, ec)) {
+        if (progress && !progress(static_cast<size_t>(fh.Size))) {
+          ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+          fd->Discard();
+          return false;
+        }
+        if (pool) {
+          pool->Close(*out, std::move(*fd));
+        }
+        return true;
+      }
+      if (ec.code != bela::ErrUnimplemented) {
+        fd->Discard();
+        return false;
+      }
+      ec.clear();
+    }
+    std::optional<LargeFile> large;
+    if (opts.large_file_size != 0 && !fh.IsSparse() && fh.Size >= static_cast<int64_t>(opts.large_file_size)) {
+      large.emplace(*fd);
+      large->Initialize(fh.Size, opts.mapped_writes);
+    }
+    auto w = [&](const void *data, size_t len, bela::error_code &ec) -> bool {
+      if (progress && !progress(len)) {
+        // canceled
+        return false;
+      }
+      update_contents(data, len);
+      return large ? large->Write(data, len, ec) : fd->WriteFull(data, len, ec);
+    };
+    if (!fh.IsSparse()) {
+      begin_contents(*out);
+      if (!tr.WriteTo(w, fh.Size, ec) || (large && !large->Finish(fh.ModTime, ec))) {
+        contents.active = false;
+        large.reset();
+        fd->Discard();
+        return false;
+      }
+      large.reset();
+      if (pool) {
+        pool->Close(*out, std::move(*fd));
+        return true;
+      }
+      fd.reset();
+      end_contents();
+      return true;
+    }
+    // only the data fragments are written, the holes between them are never allocated
+    if (!fd->Sparse(fh.SparseSize, ec)) {
       fd->Discard();
       return false;
     }
+    for (const auto &sp : fh.SparseMap) {
+      if (!fd->Seek(sp.Offset, ec) || !tr.WriteTo(w, sp.Length, ec)) {
+        fd->Discard();
+        return false;
+      }
+    }
+    if (pool) {
+      pool->Close(*out, std::move(*fd));
+    }
     return true;
   }
+
+  // extract_pipelined decodes on the pipe thread and writes on the write queue thread, the calling thread parses
+  // headers and checks paths. Entries are written in archive order
+  bool extract_pipelined(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
+    stats = PipelineStats{};
+    auto begin = std::chrono::steady_clock::now();
+    PipeReader pr(reader);
+    if (!pr.Initialize(ec)) {
+      return false;
+    }
+    Reader tr(&pr);
+    {
+      write_queue wq([this](write_job &job, bela::error_code &jobEc) { return apply_job(job, jobEc); });
+      Header fh;
+      for (;;) {
+        if (!tr.Next(fh, ec)) {
+          break;
+        }
+        if (submit_entry(tr, pr, wq, fh, filter, progress, ec)) {
+          continue;
+        }
+        if (ec == bela::ErrCanceled || ec == ErrNotTarFile || ec == ErrExtractGeneral || !opts.ignore_error) {
+          break;
+        }
+      }
+      if (ec == bela::ErrCanceled) {
+        wq.Cancel();
+      }
+      bela::error_code writeEc;
+      if (!wq.Finish(writeEc) && !ec) {
+        ec = std::move(writeEc);
+      }
+      pr.Close();
+      stats.write = wq.Stage();
+      stats.parse.stalled = pr.Starved() + wq.Blocked();
+    }
+    if (pending) {
+      // the stream stopped in the middle of a file
+      discard_pending();
+    }
+    stats.decode = pr.DecodeStage();
+    stats.decoded = pr.Decoded();
+    stats.parse.busy = std::chrono::steady_clock::now() - begin - stats.parse.stalled;
+    if (ec == bela::ErrCanceled) {
+      return false;
+    }
+    if (tr.Index() == 0 && ec == ErrNotTarFile) {
+      ec = bela::make_error_code(ErrAnotherWay, L"extract another way");
+      return false;
+    }
+    if (ec && ec != bela::ErrEnded) {
+      return false;
+    }
+    ec.clear();
+    return finish_pool(ec);
+  }
+
+  // submit_entry runs on the parsing thread, file payloads are queued as leased slices of the pipe buffers
+  bool submit_entry(Reader &tr, PipeReader &pr, write_queue &wq, const Header &fh, const Filter &filter,
+                    const OnProgress &progress, bela::error_code &ec) {
+    std::string_view name;
+    std::optional<fs::path> relocation;
+    if (!strip_name(fh, name, relocation, ec)) {
+      return false;
+    }
+    if (relocation) {
+      auto entries = relocated_entries(*relocation);
+      write_job job{.kind = write_job::Relocate, .path = std::move(*relocation), .entries = std::move(entries)};
+      if (!wq.Push(std::move(job), ec)) {
+        return false;
+      }
+    }
+    if (name.empty()) {
+      return true;
+    }
+    std::wstring encoded_path;
+    auto out = baulk::archive::JoinSanitizeFsPath(destination, name, true, encoded_path);
+    if (!out) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"harmful path: ", bela::encode_into<char, wchar_t>(fh.Name));
+      return false;
+    }
+    if (filter && !filter(fh, encoded_path)) {
+      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+      return false;
+    }
+    record_top(encoded_path);
+    if (fh.IsDir()) {
+      return wq.Push(write_job{.kind = write_job::Directory, .path = std::move(*out), .time = fh.ModTime}, ec);
+    }
+    if (fh.IsSymlink()) {
+      return wq.Push(write_job{.kind = write_job::Symlink, .path = std::move(*out), .linkname = fh.LinkName}, ec);
+    }
+    if (fh.IsHardLink()) {
+      auto source = hardlink_source(fh, ec);
+      return source &&
+             wq.Push(write_job{.kind = write_job::HardLink, .path = std::move(*out), .source = std::move(*source)}, ec);
+    }
+    if (!fh.IsRegular()) {
+      return true;
+    }
+    auto size = fh.IsSparse() ? 0 : fh.Size;
+    if (!wq.Push(write_job{.kind = write_job::Open, .path = std::move(*out), .time = fh.ModTime, .offset = size}, ec)) {
+      return false;
+    }
+    auto w = [&](const void *data, size_t len, bela::error_code &ec) -> bool {
+      if (progress && !progress(len)) {
+        // canceled
+        return false;
+      }
+      return wq.Push(write_job{.kind = write_job::Write, .data = data, .len = len, .lease = pr.Lease()}, ec);
+    };
+    auto discard = [&]() {
+      bela::error_code discardEc;
+      wq.Push(write_job{.kind = write_job::Discard}, discardEc);
+      return false;
+    };
+    if (!fh.IsSparse()) {
+      if (!tr.WriteTo(w, fh.Size, ec)) {
+        return discard();
+      }
+      return wq.Push(write_job{.kind = write_job::Close}, ec);
+    }
+    if (!wq.Push(write_job{.kind = write_job::Sparse, .offset = fh.SparseSize}, ec)) {
+      return discard();
+    }
+    for (const auto &sp : fh.SparseMap) {
+      if (!wq.Push(write_job{.kind = write_job::Seek, .offset = sp.Offset}, ec) || !tr.WriteTo(w, sp.Length, ec)) {
+        return discard();
+      }
+    }
+    return wq.Push(write_job{.kind = write_job::Close}, ec);
+  }
+
+  // apply_job runs on the write queue thread, with ignore_error a failed file is skipped up to its next entry
+  // discard_pending removes the file being written, its mapping is closed first
+  void discard_pending() {
+    pending_large.reset();
+    if (pending) {
+      pending->Discard();
+      pending.reset();
+    }
+  }
+
+  bool apply_job(write_job &job, bela::error_code &ec) {
+    auto ok = true;
+    switch (job.kind) {
+    case write_job::Directory:
+      flush_target(job.path);
+      ok = MakeDirectories(job.path, job.time, ec);
+      break;
+    case write_job::Symlink:
+      flush_target(job.path);
+      release_target(job.path);
+      ok = create_symlink(job.path, job.linkname, ec);
+      break;
+    case write_job::HardLink:
+      flush_target(job.path);
+      if (job.source != job.path) {
+        release_target(job.path);
+      }
+      linked = true;
+      ok = finish_pool(ec) && baulk::archive::NewHardLink(job.path, job.source, opts.overwrite_mode, ec);
+      break;
+    case write_job::Relocate:
+      // entries written in the wrong place would stay there, a failed relocation stops the queue
+      return finish_pool(ec) && relocate(job.path, job.entries, ec);
+    case write_job::Open:
+      contents.active = false;
+      flush_target(job.path);
+      release_target(job.path);
+      if (pending = baulk::archive::File::NewFile(job.path, job.time, true, ec); !pending) {
+        ok = false;
+        break;
+      }
+      pending_path = job.path;
+      pending_time = job.time;
+      if (opts.large_file_size != 0 && job.offset >= static_cast<int64_t>(opts.large_file_size)) {
+        pending_large.emplace(*pending);
+        pending_large->Initialize(job.offset, opts.mapped_writes);
+      }
+      begin_contents(job.path);
+      break;
+    case write_job::Sparse:
+      // holes are not hashed, sparse files are never deduplicated
+      contents.active = false;
+      if (pending && !pending->Sparse(job.offset, ec)) {
+        discard_pending();
+        ok = false;
+      }
+      break;
+    case write_job::Seek:
+      if (pending && !pending->Seek(job.offset, ec)) {
+        discard_pending();
+        ok = false;
+      }
+      break;
+    case write_job::Write:
+      if (!pending) {
+        break;
+      }
+      update_contents(job.data, job.len);
+      if (pending_large ? !pending_large->Write(job.data, job.len, ec) : !pending->WriteFull(job.data, job.len, ec)) {
+        contents.active = false;
+        discard_pending();
+        ok = false;
+      }
+      break;
+    case write_job::Close:
+      if (!pending) {
+        break;
+      }
+      if (pending_large && !pending_large->Finish(pending_time, ec)) {
+        contents.active = false;
+        discard_pending();
+        ok = false;
+        break;
+      }
+      pending_large.reset();
+      if (pool) {
+        pool->Close(pending_path, std::move(*pending));
+        pending.reset();
+        break;
+      }
+      pending.reset();
+      end_contents();
+      break;
+    case write_job::Discard:
+      contents.active = false;
+      discard_pending();
+      break;
+    }
+    return ok || opts.ignore_error;
+  }
 };
 } // namespace tar
+namespace n7z {
+using Filter = std::function<bool(const File &file, const std::wstring &relative_name)>;
+using OnProgress = std::function<bool(size_t bytes)>;
+class Extractor {
+public:
+  Extractor(const ExtractorOptions &opts_) noexcept : opts(opts_) {}
+  Extractor(const Extractor &) = delete;
+  Extractor &operator=(const Extractor &) = delete;
+  auto UncompressedSize() const { return reader.UncompressedSize(); }
+  auto CompressedSize() const { return reader.CompressedSize(); }
+  bool OpenReader(const fs::path &file, const fs::path &dest, bela::error_code &ec) {
+    std::error_code e;
+    if (destination = fs::absolute(dest, e); e) {
+      ec = bela::make_error_code_from_std(e, L"fs::absolute() ");
+      return false;
+    }
+    auto archive = fs::canonical(file, e);
+    if (e) {
+      ec = bela::make_error_code_from_std(e, L"fs::canonical() ");
+      return false;
+    }
+    return reader.OpenReader(archive.c_str(), ec);
+  }
+  bool OpenReader(bela::io::FD &fd, const fs::path &dest, int64_t size, int64_t offset, bela::error_code &ec) {
+    std::error_code e;
+    if (destination = fs::absolute(dest, e); e) {
+      ec = bela::make_error_code_from_std(e, L"fs::absolute() ");
+      return false;
+    }
+    return reader.OpenReader(fd.NativeFD(), size, offset, ec);
+  }
+  // CheckFolders fails with ErrUnimplemented when a folder uses a coder this reader lacks (AES, unknown methods,
+  // filters outside an LZMA chain). Nothing is written yet, callers may hand the archive to 7z.exe
+  bool CheckFolders(bela::error_code &ec) const { return reader.CheckFolders(ec); }
+  // Extract: paths, directories and the filter run in archive order on the calling thread, then folders are decoded
+  // by a worker pool, largest first. Files inside a solid folder are written sequentially as the folder decodes.
+  // Every folder is checked before the first write
+  bool Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec);
+
+private:
+  ExtractorOptions opts;
+  Reader reader;
+  fs::path destination;
+  std::vector<std::optional<fs::path>> targets; // regular files and symlinks waiting for folder data
+  std::vector<std::string> links;
+  // prepare_entry handles directories and empty files, out keeps the path of entries stored in a folder
+  bool prepare_entry(const File &file, const Filter &filter, std::optional<fs::path> &out, bela::error_code &ec);
+  bool open_entry(const File &file, const OnProgress &progress, Writer &w, bela::error_code &ec);
+  bool extract_folders(const std::vector<size_t> &order, const OnProgress &progress, bela::error_code &ec);
+};
+} // namespace n7z
+
+namespace msi {
+using Filter = std::function<bool(const File &file, const std::wstring &relative_name)>;
+using OnProgress = std::function<bool(size_t bytes)>;
+// PackageExtractor writes the files of an installer package where an administrative install would put them,
+// without the installer service. Cabinet folders are decoded by a worker pool
+class PackageExtractor {
+public:
+  PackageExtractor(const ExtractorOptions &opts_) noexcept : opts(opts_) {}
+  PackageExtractor(const PackageExtractor &) = delete;
+  PackageExtractor &operator=(const PackageExtractor &) = delete;
+  auto UncompressedSize() const { return package.UncompressedSize(); }
+  bool OpenReader(const fs::path &file, const fs::path &dest, bela::error_code &ec) {
+    std::error_code e;
+    if (destination = fs::absolute(dest, e); e) {
+      ec = bela::make_error_code_from_std(e, L"fs::absolute() ");
+      return false;
+    }
+    auto archive = fs::canonical(file, e);
+    if (e) {
+      ec = bela::make_error_code_from_std(e, L"fs::canonical() ");
+      return false;
+    }
+    return package.OpenReader(archive.c_str(), ec);
+  }
+  // Extract opens every cabinet and checks it can be decoded before the first file is written, so callers may fall
+  // back to the installer service on ErrUnimplemented
+  bool Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec);
+
+private:
+  ExtractorOptions opts;
+  Package package;
+  fs::path destination;
+  std::vector<std::unique_ptr<cab::Reader>> cabinets;         // indexed by disk
+  std::vector<std::unordered_map<std::string, size_t>> keys; // cabinet file name to package file, by disk
+  std::vector<std::optional<fs::path>> targets;
+  std::vector<uint8_t> written; // each file belongs to one cabinet folder, only its worker touches the flag
+  static std::string_view strip_system_folder(std::string_view name);
+  bool prepare_entry(const File &file, const Filter &filter, std::optional<fs::path> &out, bela::error_code &ec);
+  bool open_entry(size_t disk, const cab::File &cf, const OnProgress &progress, cab::Writer &w, bela::error_code &ec);
+  bool extract_folders(const std::vector<std::pair<size_t, size_t>> &order, const OnProgress &progress,
+                       bela::error_code &ec);
+};
+} // namespace msi
 } // namespace baulk::archive
 
 #endif
\ No newline at end of file
@@ -0,0 +1,123 @@
+//
+#ifndef BAULK_ARCHIVE_MSIDB_HPP
+#define BAULK_ARCHIVE_MSIDB_HPP
+#include <bela/base.hpp>
+#include <bela/io.hpp>
+#include <functional>
+#include <vector>
+#include <baulk/archive.hpp>
+#include <baulk/archive/cab.hpp>
+
+// In-process reader of Windows Installer packages, an OLE compound file holding the installer database as
+// tables and the files in embedded cabinets
+namespace baulk::archive::msi {
+// https://learn.microsoft.com/en-us/openspecs/windows_protocols/ms-cfb/53989ce4-7b05-4f8d-829b-d08d6148375b
+constexpr uint32_t noStream = 0xFFFFFFFFU;
+enum entry_type_t : uint8_t {
+  EntryUnknown = 0,
+  EntryStorage = 1,
+  EntryStream = 2,
+  EntryRoot = 5,
+};
+
+struct DirEntry {
+  std::wstring name; // raw UTF-16 name, database streams use the packed MSI encoding
+  uint64_t size{0};
+  uint32_t start{0};
+  uint32_t left{noStream};
+  uint32_t right{noStream};
+  uint32_t child{noStream};
+  entry_type_t type{EntryUnknown};
+};
+
+// Stream is a stream of a compound file, small streams live in the mini stream and are kept in memory
+class Stream {
+public:
+  Stream() = default;
+  [[nodiscard]] uint64_t Size() const { return size; }
+  // ReadAt reads len bytes at offset of the stream, contiguous sectors are read with one positional read
+  bool ReadAt(void *buffer, size_t len, int64_t offset, bela::error_code &ec) const;
+
+private:
+  friend class CompoundFile;
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  uint64_t size{0};
+  uint32_t sectorShift{9};
+  std::vector<uint32_t> sectors;
+  std::vector<uint8_t> data;
+};
+
+class CompoundFile {
+public:
+  CompoundFile() = default;
+  CompoundFile(const CompoundFile &) = delete;
+  CompoundFile &operator=(const CompoundFile &) = delete;
+  bool OpenReader(HANDLE nfd, int64_t size_, bela::error_code &ec);
+  [[nodiscard]] const auto &Entries() const { return entries; }
+  // Children lists the entries directly under a storage, 0 is the root storage
+  [[nodiscard]] std::vector<uint32_t> Children(uint32_t storage) const;
+  bool OpenStream(uint32_t index, Stream &s, bela::error_code &ec) const;
+  bool ReadStream(uint32_t index, std::vector<uint8_t> &out, bela::error_code &ec) const;
+
+private:
+  bool chain(uint32_t start, const std::vector<uint32_t> &table, std::vector<uint32_t> &sectors,
+             bela::error_code &ec) const;
+  bool readSectors(const std::vector<uint32_t> &sectors, std::vector<uint8_t> &out, bela::error_code &ec) const;
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t size{0};
+  uint32_t sectorShift{9};
+  uint32_t miniSectorShift{6};
+  uint32_t miniStreamCutoff{4096};
+  std::vector<uint32_t> fat;
+  std::vector<uint32_t> miniFat;
+  std::vector<uint32_t> miniStreamSectors;
+  std::vector<DirEntry> entries;
+};
+
+// msidbFileAttributes
+constexpr uint16_t fileAttributeReadOnly = 0x0001;
+constexpr uint16_t fileAttributeNoncompressed = 0x2000;
+constexpr uint16_t fileAttributeCompressed = 0x4000;
+
+// Disk is a row of the Media table, files with a sequence up to last_sequence live in its cabinet
+struct Disk {
+  std::string cabinet; /* '#' prefixed cabinets are streams of the package, others are files next to it */
+  uint32_t disk_id{0};
+  uint32_t last_sequence{0};
+};
+
+struct File {
+  std::string key;        /* File table key, the name of the file inside its cabinet */
+  std::string name;       /* relative path in the administrative image, UTF-8 */
+  uint32_t size{0};       /* uncompressed size */
+  uint32_t sequence{0};   /* position in the media */
+  uint32_t disk{0};       /* index in Disks(), the disk whose sequence range covers the file */
+  uint16_t attributes{0}; /* msidbFileAttributes */
+  bool compressed{false}; /* stored in a cabinet rather than next to the package */
+};
+
+class Package {
+public:
+  Package() = default;
+  Package(const Package &) = delete;
+  Package &operator=(const Package &) = delete;
+  bool OpenReader(std::wstring_view file, bela::error_code &ec);
+  [[nodiscard]] const auto &Files() const { return files; }
+  [[nodiscard]] const auto &Disks() const { return disks; }
+  [[nodiscard]] uint64_t UncompressedSize() const { return uncompressedSize; }
+  // OpenCabinet opens the cabinet of disk index, embedded cabinets are read from the package in place
+  bool OpenCabinet(size_t index, cab::Reader &r, bela::error_code &ec) const;
+
+private:
+  bool Initialize(bela::error_code &ec);
+  std::wstring path;
+  bela::io::FD fd;
+  CompoundFile cf;
+  std::vector<Disk> disks;
+  std::vector<File> files;
+  std::vector<std::pair<std::string, uint32_t>> streams; // decoded root stream names
+  uint64_t uncompressedSize{0};
+};
+} // namespace baulk::archive::msi
+
+#endif
@@ -4,12 +4,27 @@
 #include <bela/io.hpp>
 #include <bela/time.hpp>
 #include <gtl/phmap.hpp>
+#include <baulk/allocate.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
 #include "format.hpp"
 
+namespace baulk::archive {
+class File;
+}
+
 namespace baulk::archive::tar {
 constexpr long ErrNotTarFile = 754320;
 constexpr long ErrNoFilter = 754321;
+constexpr long ErrIndexMismatch = 754322;
 using bela::ssize_t;
 
 enum tar_format_t : int {
@@ -179,8 +194,9 @@ struct Header {
   std::string LinkName;
   std::string Uname;
   std::string Gname;
-  int64_t Size{0};
-  int64_t SparseSize{0};
+  int64_t Size{0};       // bytes stored in the archive
+  int64_t SparseSize{0}; // size of a sparse file, SparseMap lists its data fragments and the rest are holes
+  sparseDatas SparseMap;
   int64_t Mode{0};
   bela::Time ModTime;
   bela::Time AccessTime;
@@ -194,8 +210,10 @@ struct Header {
   int Format{0};
   char Typeflag{0};
   bool IsDir() const { return Typeflag == TypeDir; }
-  bool IsRegular() const { return Typeflag == TypeReg || Typeflag == TypeRegA; }
+  bool IsRegular() const { return Typeflag == TypeReg || Typeflag == TypeRegA || Typeflag == TypeGNUSparse; }
+  bool IsSparse() const { return SparseSize != 0 || !SparseMap.empty(); }
   bool IsSymlink() const { return Typeflag == TypeSymlink; }
+  bool IsHardLink() const { return Typeflag == TypeLink; }
   bela::os::FileMode FileMode() const {
     using I = std::underlying_type_t<bela::os::FileMode>;
     auto mode = static_cast<I>(Mode) & bela::os::ModePerm;
@@ -255,12 +273,47 @@ struct Header {
     return static_cast<bela::os::FileMode>(mode);
   }
 };
+
+// HeaderView is a header block parsed in place, its strings borrow from the block and nothing is allocated
+struct HeaderView {
+  std::string_view Name;
+  std::string_view Prefix; // ustar and star, joined to Name with '/'
+  std::string_view LinkName;
+  std::string_view Uname;
+  std::string_view Gname;
+  int64_t Size{0};
+  int64_t Mode{0};
+  bela::Time ModTime;
+  bela::Time AccessTime;
+  bela::Time ChangeTime;
+  int64_t Devmajor{0};
+  int64_t Devminor{0};
+  int UID{0};
+  int GID{0};
+  int Format{0};
+  char Typeflag{0};
+};
+
+// ParseHeaderView parses a 512-byte header block, it returns false when the checksum does not match
+bool ParseHeaderView(const ustar_header &block, HeaderView &hv);
+
 using Writer = std::function<bool(const void *data, size_t len, bela::error_code &ec)>;
 struct ExtractReader {
   virtual ssize_t Read(void *buffer, size_t len, bela::error_code &ec) = 0;
   virtual bool Discard(int64_t len, bela::error_code &ec) = 0;
   // Avoid multiple memory copies
   virtual bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) = 0;
+  // Peek borrows up to len bytes at the read position from the output buffer of a decoder without consuming them, the
+  // span is valid until the next call on the reader. Readers without an output buffer return an empty span
+  virtual std::span<const uint8_t> Peek(size_t len, bela::error_code &ec) { return {}; }
+  // Consume moves the read position past n bytes returned by Peek
+  virtual void Consume(size_t n) {}
+  // CopyTo copies filesize bytes at the read position into out without handing them to a Writer. Only a reader of
+  // the archive file itself can, the others fail with ErrUnimplemented and consume nothing
+  virtual bool CopyTo(File &out, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+    ec = bela::make_error_code(bela::ErrUnimplemented, L"copy range unsupported");
+    return false;
+  }
 };
 
 class FileReader : public ExtractReader {
@@ -273,14 +326,169 @@ public:
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code &ec);
   bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  // CopyTo uses CopyRange, a file on a volume with block cloning shares the clusters of the tarball
+  bool CopyTo(File &out, int64_t filesize, int64_t &extracted, bela::error_code &ec);
   bool Seek(int64_t pos, bela::error_code &ec);
   auto Position() const { return position; }
+  HANDLE NativeFD() const { return fd.NativeFD(); }
+  int64_t Size(bela::error_code &ec) const { return fd.Size(ec); }
 
 private:
   bela::io::FD fd;
+  std::vector<uint8_t> buffer; // WriteTo reads in 1M chunks
   int64_t position{0};
 };
-std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_format_t afmt, bela::error_code &ec);
+// ReaderOptions tunes the decompressors created by MakeReader: multi-member gzip inflates members in parallel,
+// bzip2 and xz decode blocks in parallel, zstd decodes frames in parallel
+struct ReaderOptions {
+  uint32_t threads{1};  // parallel decoder threads, 0 selects the hardware concurrency
+  uint64_t memlimit{0}; // gzip, bzip2, zstd: decoded bytes held ahead of the reader, 0 selects 256 MB
+                        // xz: memory of the threaded decoder before it falls back to one thread, 0 selects
+                        // a quarter of the physical memory
+};
+std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_format_t afmt, const ReaderOptions &opts,
+                                          bela::error_code &ec);
+inline std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_format_t afmt,
+                                                 bela::error_code &ec) {
+  return MakeReader(fd, offset, afmt, ReaderOptions{}, ec);
+}
+
+// SeekableReader is a decompressor whose input is made of independent frames, Seek moves to an offset of the
+// decompressed stream and decoding restarts at the frame holding it
+class SeekableReader : public ExtractReader {
+public:
+  virtual ~SeekableReader() = default;
+  virtual bool Seek(int64_t pos, bela::error_code &ec) = 0;
+  // ContentSize is the decompressed size, -1 when a frame does not record it
+  [[nodiscard]] virtual int64_t ContentSize() const = 0;
+};
+// MakeSeekableReader opens zstd files: the seekable format, pzstd outputs and concatenated frames. Frames ahead of the
+// reader are decoded in parallel, other formats fail with ErrNoFilter
+std::shared_ptr<SeekableReader> MakeSeekableReader(FileReader &fd, int64_t offset, file_format_t afmt,
+                                                   const ReaderOptions &opts, bela::error_code &ec);
+
+// Checkpoint is where decoding of a compressed tarball restarts, out is an offset of the tar stream and in the offset
+// of the compressed data holding it. gzip checkpoints inside a member keep the last 32K of output in window and the
+// count of unread bits of the byte before in; xz checkpoints are blocks, bits is the check of their stream
+struct Checkpoint {
+  int64_t in{0};
+  int64_t out{0};
+  int bits{0};
+  std::string window;
+};
+
+// IndexEntry is a member of an indexed tarball, data is the offset of its contents in the tar stream
+struct IndexEntry {
+  std::string name;
+  std::string linkname;
+  int64_t data{0};
+  int64_t size{0};
+  int64_t mode{0};
+  int64_t sparseSize{0};
+  sparseDatas sparse;
+  bela::Time modTime;
+  char typeflag{0};
+};
+
+// Index lists the members of a tarball with decoder checkpoints: inflate windows every few MB of gzip output, the
+// blocks of xz streams and zstd frames whose sizes are known. Listing needs no decoding and a member is read by
+// decoding from the checkpoint before it, bzip2 and brotli tarballs only have the checkpoint at the start
+class Index {
+public:
+  Index() = default;
+  bool Build(FileReader &fd, int64_t offset, file_format_t afmt, const ReaderOptions &opts, bela::error_code &ec);
+  // Load reads an index written by Save, it fails with ErrIndexMismatch when fd is not the archive it was built from
+  bool Load(const std::filesystem::path &file, FileReader &fd, bela::error_code &ec);
+  bool Save(const std::filesystem::path &file, bela::error_code &ec) const;
+  // LoadOrBuild loads the sidecar index of archive, a missing or stale one is built and saved for the next caller, so
+  // only the first selective access decodes the whole tarball
+  bool LoadOrBuild(FileReader &fd, const std::filesystem::path &archive, int64_t offset, file_format_t afmt,
+                   const ReaderOptions &opts, bela::error_code &ec);
+  [[nodiscard]] const std::vector<IndexEntry> &Entries() const { return entries; }
+  [[nodiscard]] const std::vector<Checkpoint> &Checkpoints() const { return checkpoints; }
+  [[nodiscard]] const IndexEntry *Find(std::string_view name) const;
+  // Open returns the tar stream from pos, fd is read from the checkpoint before pos and must outlive the reader
+  std::shared_ptr<ExtractReader> Open(FileReader &fd, int64_t pos, bela::error_code &ec) const;
+  // Extract passes the contents of a member to w, the holes of a sparse member are passed as zeros
+  bool Extract(FileReader &fd, const IndexEntry &e, const Writer &w, bela::error_code &ec) const;
+
+private:
+  std::vector<IndexEntry> entries;
+  std::vector<Checkpoint> checkpoints;
+  int64_t offset{0};
+  int64_t archiveSize{0};
+  int64_t archiveTime{0};
+  file_format_t afmt{file_format_t::none};
+};
+
+// IndexPath is the sidecar index written next to an archive
+inline std::filesystem::path IndexPath(const std::filesystem::path &archive) {
+  auto file = archive;
+  file += L".index";
+  return file;
+}
+
+// PipelineStage is the time a stage of a pipelined extraction spent working and waiting for its neighbours
+struct PipelineStage {
+  std::chrono::nanoseconds busy{0};
+  std::chrono::nanoseconds stalled{0};
+  [[nodiscard]] double Utilization() const {
+    auto total = busy + stalled;
+    return total.count() == 0 ? 0 : static_cast<double>(busy.count()) / static_cast<double>(total.count());
+  }
+};
+
+struct PipelineStats {
+  PipelineStage decode; // decompression, stalls while every buffer is full or leased
+  PipelineStage parse;  // headers and paths, stalls waiting for decoded data or for room in the write queue
+  PipelineStage write;  // file creation and writes, stalls waiting for work
+  int64_t decoded{0};   // bytes of tar stream produced by the decoder
+};
+
+// PipeReader runs the underlying reader on its own thread and fills a bounded ring of large buffers, the decoder
+// blocks while every buffer is full or leased and resumes as the consumer drains them
+class PipeReader : public ExtractReader {
+public:
+  PipeReader(ExtractReader *r_, size_t buffers = 4, size_t bufferSize_ = 4 * 1024 * 1024);
+  PipeReader(const PipeReader &) = delete;
+  PipeReader &operator=(const PipeReader &) = delete;
+  ~PipeReader();
+  bool Initialize(bela::error_code &ec);
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
+  // Lease keeps the buffer holding the data last passed to a Writer from being refilled, so the data may be used
+  // after the Writer returns. Leases must be dropped before the reader is destroyed
+  [[nodiscard]] std::shared_ptr<const void> Lease() const { return current; }
+  // Close stops the decoder and waits for it, later reads fail with ErrCanceled
+  void Close();
+  // DecodeStage and Decoded are complete once Close returns, Starved is the time the consumer waited for data
+  [[nodiscard]] const PipelineStage &DecodeStage() const { return decode; }
+  [[nodiscard]] int64_t Decoded() const { return decoded; }
+  [[nodiscard]] std::chrono::nanoseconds Starved() const { return starved; }
+
+private:
+  bool acquire(bela::error_code &ec);
+  void release(size_t index);
+  void decompress();
+  ExtractReader *r{nullptr};
+  std::vector<baulk::mem::Buffer> ring;
+  std::deque<size_t> freeSlots;
+  std::deque<size_t> filledSlots;
+  std::shared_ptr<baulk::mem::Buffer> current;
+  std::mutex mu;
+  std::condition_variable cv;
+  std::thread decoder;
+  bela::error_code decodeEc;
+  PipelineStage decode;
+  std::chrono::nanoseconds starved{0};
+  int64_t decoded{0};
+  size_t bufferSize{0};
+  bool ended{false};
+  std::atomic_bool stopped{false};
+};
 
 class Reader {
 public:
@@ -288,21 +496,29 @@ public:
   Reader(const Reader &) = delete;
   Reader &operator=(const Reader &) = delete;
   std::optional<Header> Next(bela::error_code &ec);
+  // Next reads the next entry into h, the strings and maps of h are reused so a loop over small entries does not
+  // allocate
+  bool Next(Header &h, bela::error_code &ec);
   bela::ssize_t Read(void *buffer, size_t size, bela::error_code &ec);
   bool ReadFull(void *buffer, size_t size, bela::error_code &ec);
   bool WriteTo(const Writer &w, int64_t filesize, bela::error_code &ec);
+  // CopyTo writes filesize bytes of the entry into out through ExtractReader::CopyTo, ErrUnimplemented leaves the
+  // entry unread
+  bool CopyTo(File &out, int64_t filesize, bela::error_code &ec);
   int Index() const { return index; }
 
 private:
   bela::ssize_t readInternal(void *buffer, size_t size, bela::error_code &ec);
   bool discard(int64_t bytes, bela::error_code &ec);
-  bool readHeader(Header &h, bela::error_code &ec);
+  std::span<const uint8_t> borrow(size_t n, bela::error_code &ec);
+  bool readHeader(Header &h, const ustar_header *&hdr, bela::error_code &ec);
   bool parsePAX(int64_t paxSize, pax_records_t &paxHdrs, bela::error_code &ec);
   bool handleSparseFile(Header &h, const gnutar_header *th, bela::error_code &ec);
   bool readOldGNUSparseMap(Header &h, sparseDatas &spd, const gnutar_header *th, bela::error_code &ec);
   bool readGNUSparsePAXHeaders(Header &h, sparseDatas &spd, bela::error_code &ec);
   bool readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec);
   ExtractReader *r{nullptr};
+  ustar_header block;
   int64_t remainingSize{0};
   int64_t paddingSize{0};
   int index{0};
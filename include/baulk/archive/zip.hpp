@@ -5,6 +5,14 @@
 #include <bela/io.hpp>
 #include <bela/time.hpp>
 #include <functional>
+#include <mutex>
+#include <gtl/phmap.hpp>
+#include <baulk/archive.hpp>
+#include <baulk/allocate.hpp>
+
+namespace baulk::archive::tar {
+struct ExtractReader;
+}
 
 namespace baulk::archive::zip {
 using bela::os::FileMode;
@@ -58,10 +66,11 @@ struct directoryEnd {
 // FileMode to string
 std::string String(FileMode m);
 
+// File name, comment and linkname refer to the central directory buffer owned by the Reader
 struct File {
-  std::string name;              /* filename */
-  std::string comment;           /* comment */
-  std::string linkname;          /* linkname */
+  std::string_view name;         /* filename */
+  std::string_view comment;      /* comment */
+  std::string_view linkname;     /* linkname */
   uint64_t compressed_size{0};   /* compressed size */
   uint64_t uncompressed_size{0}; /* uncompressed size */
   uint64_t position{0};          /* file position */
@@ -86,6 +95,42 @@ struct File {
 
 constexpr static auto size_max = (std::numeric_limits<std::size_t>::max)();
 
+// directory_mode_t: streaming readers keep only the raw central directory, Files() stays empty and entries are
+// decoded on demand by DirectoryIterator
+enum class directory_mode_t : uint8_t { materialized, streaming };
+
+// DirectoryIterator decodes central directory records one by one
+class DirectoryIterator {
+public:
+  DirectoryIterator(const uint8_t *data_, size_t size_, uint64_t records_)
+      : data(data_), size(size_), remaining(records_) {}
+  // Next decodes the next record into file, at the end of the directory it returns false and ec is empty
+  bool Next(File &file, bela::error_code &ec);
+
+private:
+  const uint8_t *data{nullptr};
+  size_t size{0};
+  uint64_t remaining{0};
+};
+
+// DirectoryIndex holds the lookup tables of a Reader, each table is built on first use
+struct DirectoryIndex {
+  std::once_flag exact_once;
+  std::once_flag folded_once;
+  std::once_flag sorted_once;
+  gtl::flat_hash_map<std::string_view, size_t> exact;
+  gtl::flat_hash_map<std::string, size_t> folded; // ascii lowercase name
+  std::vector<size_t> sorted;                      // Files() indices in name order
+};
+
+// DecoderOptions: xz (method 95) entries of at least 1 MB decode their blocks on several threads, zstd (method 93)
+// entries of several frames decode their frames on several threads
+struct DecoderOptions {
+  uint32_t threads{1};  // 0 selects the hardware concurrency
+  uint64_t memlimit{0}; // xz: memory of the threaded decoder before it falls back to one thread, 0 selects a quarter
+                        // of the physical memory; zstd: decoded bytes held ahead of the writer, 0 selects 256 MB
+};
+
 using Writer = std::function<bool(const void *data, size_t len)>;
 class Reader {
 private:
@@ -97,12 +142,23 @@ private:
     r.uncompressed_size = 0;
     compressed_size = r.compressed_size;
     r.compressed_size = 0;
+    baseOffset = r.baseOffset;
+    r.baseOffset = 0;
     comment = std::move(r.comment);
+    directory = std::move(r.directory);
+    records = r.records;
+    r.records = 0;
+    mode = r.mode;
     files = std::move(r.files);
+    index = std::move(r.index);
+    view = std::move(r.view);
+    decoderOptions = r.decoderOptions;
+    charset = std::move(r.charset);
   }
 
 public:
   Reader() = default;
+  explicit Reader(directory_mode_t mode_) : mode(mode_) {}
   Reader(Reader &&r) noexcept { MoveFrom(std::move(r)); }
   Reader &operator=(Reader &&r) noexcept {
     MoveFrom(std::move(r));
@@ -113,12 +169,31 @@ public:
   bool OpenReader(HANDLE nfd, int64_t size_, int64_t offset_, bela::error_code &ec);
   std::string_view Comment() const { return comment; }
   const auto &Files() const { return files; }
+  // Find returns the entry named name or nullptr, ignore_case folds ascii letters.
+  // Lookups use Files(), a streaming reader finds nothing
+  const File *Find(std::string_view name, bool ignore_case = false) const;
+  // List returns the entries whose name starts with prefix, e.g. "bin/", in name order
+  std::vector<const File *> List(std::string_view prefix) const;
+  // Iterator walks the central directory without Files(), works in both directory modes
+  DirectoryIterator Iterator() const { return DirectoryIterator(directory.data(), directory.size(), records); }
+  // NameCharset is the codepage detected from all names without the UTF-8 flag when the reader was opened
+  const Charset &NameCharset() const { return charset; }
   int64_t CompressedSize() const { return compressed_size; }
   int64_t UncompressedSize() const { return uncompressed_size; }
+  // EnableMapping maps the archive read-only, Decompress then reads entries from the view.
+  // On failure the reader keeps using positional reads. A read error under the view is an EXCEPTION_IN_PAGE_ERROR
+  // that nothing handles, map only local archives that stay in place.
+  bool EnableMapping(bela::error_code &ec);
+  bool Mapped() const { return static_cast<bool>(view); }
+  void SetDecoderOptions(const DecoderOptions &opts) { decoderOptions = opts; }
+  // Decompress uses positional reads only, it is safe to decompress different entries concurrently
   bool Decompress(const File &file, const Writer &w, bela::error_code &ec) const;
+  // CopyStored writes a ZIP_STORE entry to out with CopyRange, which clones the clusters where the volume allows.
+  // The CRC-32 is summed as the data is copied, only cloned clusters are read again for it
+  bool CopyStored(const File &file, baulk::archive::File &out, bela::error_code &ec) const;
   std::string ResolveLinkName(const File &file, bela::error_code &ec) const {
     if (!file.linkname.empty()) {
-      return file.linkname;
+      return std::string(file.linkname);
     }
     std::string linkname;
     if (!Decompress(
@@ -140,19 +215,72 @@ private:
   int64_t uncompressed_size{0};
   int64_t compressed_size{0};
   std::string comment;
+  baulk::mem::Buffer directory;
+  uint64_t records{0};
+  directory_mode_t mode{directory_mode_t::materialized};
   std::vector<File> files;
+  std::unique_ptr<DirectoryIndex> index{std::make_unique<DirectoryIndex>()};
+  MappedView view;
+  DecoderOptions decoderOptions;
+  Charset charset;
   bool Initialize(bela::error_code &ec);
+  int64_t dataPosition(const File &file, bela::error_code &ec) const;
   bool readDirectoryEnd(directoryEnd &d, bela::error_code &ec);
   bool readDirectory64End(int64_t offset, directoryEnd &d, bela::error_code &ec);
   int64_t findDirectory64End(int64_t directoryEndOffset, bela::error_code &ec);
-  bool decompressDeflate(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressDeflate64(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressZstd(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressBz2(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressXz(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressLZMA(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressPpmd(const File &file, const Writer &w, bela::error_code &ec) const;
-  bool decompressBrotli(const File &file, const Writer &w, bela::error_code &ec) const;
+};
+
+// DecoderStatistics counts the decoder contexts and I/O buffers Decompress used on all threads,
+// once every worker thread is warmed up extracting more entries only increments the reused counters
+struct DecoderStatistics {
+  uint64_t contexts_created{0};
+  uint64_t contexts_reused{0};
+  uint64_t buffers_allocated{0};
+  uint64_t buffers_reused{0};
+};
+DecoderStatistics DecoderStats();
+
+class StreamSource;
+// StreamReader reads a zip archive front to back from a forward-only source such as a download in progress.
+// Entries come from local file headers, entries whose size is only recorded in a data descriptor after the
+// payload must be deflated. Finish reads the trailing central directory and checks it against the entries seen.
+class StreamReader {
+public:
+  StreamReader(tar::ExtractReader *r);
+  StreamReader(const StreamReader &) = delete;
+  StreamReader &operator=(const StreamReader &) = delete;
+  ~StreamReader();
+  // Next returns the next entry, the payload of the previous entry is skipped when it was not decompressed.
+  // File views stay valid until the next call. At the central directory it returns nullopt and ErrEnded
+  std::optional<File> Next(bela::error_code &ec);
+  // Decompress decodes the payload of the entry last returned by Next
+  bool Decompress(const File &file, const Writer &w, bela::error_code &ec);
+  // Finish reads the central directory, Files() then holds the complete entries (file modes, symlinks)
+  bool Finish(bela::error_code &ec);
+  const auto &Files() const { return files; }
+  std::string_view Comment() const { return comment; }
+
+private:
+  struct streamed_entry {
+    std::string name;
+    uint64_t position{0};
+    uint64_t compressed_size{0};
+    uint64_t uncompressed_size{0};
+    uint32_t crc32_value{0};
+  };
+  std::unique_ptr<StreamSource> source;
+  std::string header;   // name and extra of the current local header
+  File current;
+  bool pending{false};  // current payload not consumed yet
+  bool descriptor{false};
+  bool zip64{false};
+  bool ended{false};    // central directory reached
+  std::vector<streamed_entry> entries;
+  baulk::mem::Buffer directory;
+  std::vector<File> files;
+  std::string comment;
+  bool skipPayload(bela::error_code &ec);
+  bool readDescriptor(int64_t consumed, std::optional<uint32_t> crc32_value, bela::error_code &ec);
 };
 
 // NewReader
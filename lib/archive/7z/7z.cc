@@ -0,0 +1,773 @@
+//
+#include <bela/endian.hpp>
+#include "7zinternal.hpp"
+
+namespace baulk::archive::n7z {
+constexpr uint64_t maxHeaderSize = 256ULL * 1024 * 1024;
+constexpr uint32_t maxFolderCoders = 64;
+// maxHeaderItems bounds the folders, streams and files of a header, an encoded header can decode to far more bytes
+// than the archive holds. Archives with more are left to 7z.exe
+constexpr size_t maxHeaderItems = 4 * 1024 * 1024;
+
+inline bela::error_code header_corrupt() { return bela::make_error_code(ErrGeneral, L"7z: archive header is corrupt"); }
+
+namespace {
+// header_reader decodes header properties, reading past the end sets a sticky error and returns zeros
+class header_reader {
+public:
+  header_reader(std::span<const uint8_t> data_) : data(data_) {}
+  [[nodiscard]] bool Bad() const { return bad; }
+  [[nodiscard]] size_t Remaining() const { return data.size() - pos; }
+  uint8_t Byte() {
+    if (pos >= data.size()) {
+      bad = true;
+      return 0;
+    }
+    return data[pos++];
+  }
+  // Number: the leading one bits of the first byte count the extra little-endian bytes
+  uint64_t Number() {
+    auto first = Byte();
+    uint8_t mask = 0x80;
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+      if ((first & mask) == 0) {
+        uint64_t high = first & (mask - 1);
+        value |= high << (8 * i);
+        return value;
+      }
+      value |= static_cast<uint64_t>(Byte()) << (8 * i);
+      mask >>= 1;
+    }
+    return value;
+  }
+  // Count reads a number of items, every item takes at least one of the bytes that follow so larger counts are corrupt
+  size_t Count() {
+    auto n = Number();
+    if (n > Remaining() || n > maxHeaderItems) {
+      bad = true;
+      return 0;
+    }
+    return static_cast<size_t>(n);
+  }
+  uint32_t UInt32() {
+    auto b = Bytes(4);
+    return b.size() == 4 ? bela::cast_fromle<uint32_t>(b.data()) : 0;
+  }
+  uint64_t UInt64() {
+    auto b = Bytes(8);
+    return b.size() == 8 ? bela::cast_fromle<uint64_t>(b.data()) : 0;
+  }
+  std::span<const uint8_t> Bytes(uint64_t n) {
+    if (n > Remaining()) {
+      bad = true;
+      pos = data.size();
+      return {};
+    }
+    auto b = data.subspan(pos, static_cast<size_t>(n));
+    pos += static_cast<size_t>(n);
+    return b;
+  }
+  std::vector<bool> BitVector(size_t n) {
+    std::vector<bool> v(n, false);
+    uint8_t b = 0;
+    uint8_t mask = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (mask == 0) {
+        b = Byte();
+        mask = 0x80;
+      }
+      v[i] = (b & mask) != 0;
+      mask >>= 1;
+    }
+    return v;
+  }
+  // Defined reads the all-defined byte and the bit vector that follows when it is zero
+  std::vector<bool> Defined(size_t n) {
+    if (Byte() != 0) {
+      return std::vector<bool>(n, true);
+    }
+    return BitVector(n);
+  }
+
+private:
+  std::span<const uint8_t> data;
+  size_t pos{0};
+  bool bad{false};
+};
+
+struct digests {
+  std::vector<bool> defined;
+  std::vector<uint32_t> values;
+};
+
+void readDigests(header_reader &r, size_t n, digests &d) {
+  d.defined = r.Defined(n);
+  d.values.assign(n, 0);
+  for (size_t i = 0; i < n; i++) {
+    if (d.defined[i]) {
+      d.values[i] = r.UInt32();
+    }
+  }
+}
+
+struct streams_info {
+  uint64_t pack_position{0};
+  std::vector<uint64_t> pack_sizes;
+  std::vector<Folder> folders;
+  std::vector<uint32_t> substream_counts; // per folder
+  std::vector<uint64_t> substream_sizes;  // per unpacked stream
+  digests substream_digests;
+  bool has_substreams{false};
+};
+
+bool readPackInfo(header_reader &r, streams_info &si, bela::error_code &ec) {
+  si.pack_position = r.Number();
+  auto n = r.Count();
+  for (;;) {
+    auto id = r.Number();
+    if (r.Bad()) {
+      ec = header_corrupt();
+      return false;
+    }
+    if (id == kEnd) {
+      break;
+    }
+    if (id == kSize) {
+      si.pack_sizes.resize(n);
+      for (auto &s : si.pack_sizes) {
+        s = r.Number();
+      }
+      continue;
+    }
+    if (id == kCRC) {
+      digests d;
+      readDigests(r, n, d);
+      continue;
+    }
+    r.Bytes(r.Number());
+  }
+  if (si.pack_sizes.size() != n) {
+    ec = header_corrupt();
+    return false;
+  }
+  return true;
+}
+
+bool readFolder(header_reader &r, Folder &folder, bela::error_code &ec) {
+  auto numCoders = r.Count();
+  if (numCoders == 0 || numCoders > maxFolderCoders) {
+    ec = header_corrupt();
+    return false;
+  }
+  uint32_t numIn = 0;
+  uint32_t numOut = 0;
+  for (size_t i = 0; i < numCoders; i++) {
+    auto flag = r.Byte();
+    if ((flag & 0x80) != 0) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: alternative coder methods are not supported");
+      return false;
+    }
+    auto idSize = static_cast<size_t>(flag & 0xF);
+    if (idSize > 8) {
+      ec = header_corrupt();
+      return false;
+    }
+    auto &c = folder.coders.emplace_back();
+    for (const auto b : r.Bytes(idSize)) {
+      c.method = (c.method << 8) | b;
+    }
+    if ((flag & 0x10) != 0) {
+      c.num_in_streams = static_cast<uint32_t>(r.Count());
+      c.num_out_streams = static_cast<uint32_t>(r.Count());
+    }
+    if ((flag & 0x20) != 0) {
+      auto props = r.Bytes(r.Number());
+      c.props.assign(props.begin(), props.end());
+    }
+    numIn += c.num_in_streams;
+    numOut += c.num_out_streams;
+    if (r.Bad() || numIn > maxFolderCoders || numOut > maxFolderCoders || numOut == 0) {
+      ec = header_corrupt();
+      return false;
+    }
+  }
+  auto numBindPairs = numOut - 1;
+  if (numIn < numBindPairs) {
+    ec = header_corrupt();
+    return false;
+  }
+  for (uint32_t i = 0; i < numBindPairs; i++) {
+    auto &bp = folder.bind_pairs.emplace_back();
+    bp.in_index = static_cast<uint32_t>(r.Number());
+    bp.out_index = static_cast<uint32_t>(r.Number());
+    if (bp.in_index >= numIn || bp.out_index >= numOut) {
+      ec = header_corrupt();
+      return false;
+    }
+  }
+  auto numPacked = numIn - numBindPairs;
+  if (numPacked == 1) {
+    for (uint32_t i = 0; i < numIn; i++) {
+      if (!std::ranges::any_of(folder.bind_pairs, [i](const BindPair &bp) { return bp.in_index == i; })) {
+        folder.packed_streams.emplace_back(i);
+        break;
+      }
+    }
+  } else {
+    for (uint32_t i = 0; i < numPacked; i++) {
+      auto index = static_cast<uint32_t>(r.Number());
+      if (index >= numIn) {
+        ec = header_corrupt();
+        return false;
+      }
+      folder.packed_streams.emplace_back(index);
+    }
+  }
+  if (r.Bad() || folder.packed_streams.size() != numPacked) {
+    ec = header_corrupt();
+    return false;
+  }
+  return true;
+}
+
+bool readUnpackInfo(header_reader &r, streams_info &si, bela::error_code &ec) {
+  if (r.Number() != kFolder) {
+    ec = header_corrupt();
+    return false;
+  }
+  auto numFolders = r.Count();
+  if (r.Byte() != 0) {
+    ec = bela::make_error_code(ErrUnimplemented, L"7z: external folders are not supported");
+    return false;
+  }
+  // folders are added as they are read, a corrupt count fails before it is allocated
+  uint32_t packIndex = 0;
+  for (size_t i = 0; i < numFolders; i++) {
+    auto &folder = si.folders.emplace_back();
+    if (!readFolder(r, folder, ec)) {
+      return false;
+    }
+    folder.first_pack_stream = packIndex;
+    packIndex += static_cast<uint32_t>(folder.packed_streams.size());
+  }
+  if (r.Number() != kCodersUnPackSize) {
+    ec = header_corrupt();
+    return false;
+  }
+  for (auto &folder : si.folders) {
+    uint32_t numOut = 0;
+    for (const auto &c : folder.coders) {
+      numOut += c.num_out_streams;
+    }
+    folder.unpack_sizes.resize(numOut);
+    for (auto &s : folder.unpack_sizes) {
+      s = r.Number();
+    }
+  }
+  for (;;) {
+    auto id = r.Number();
+    if (r.Bad()) {
+      ec = header_corrupt();
+      return false;
+    }
+    if (id == kEnd) {
+      return true;
+    }
+    if (id == kCRC) {
+      digests d;
+      readDigests(r, numFolders, d);
+      for (size_t i = 0; i < numFolders; i++) {
+        si.folders[i].has_crc = d.defined[i];
+        si.folders[i].crc32_value = d.values[i];
+      }
+      continue;
+    }
+    r.Bytes(r.Number());
+  }
+}
+
+bool readSubStreamsInfo(header_reader &r, streams_info &si, bela::error_code &ec) {
+  si.has_substreams = true;
+  si.substream_counts.assign(si.folders.size(), 1);
+  auto id = r.Number();
+  if (id == kNumUnPackStream) {
+    size_t total = 0;
+    for (auto &n : si.substream_counts) {
+      n = static_cast<uint32_t>(r.Count());
+      total += n;
+    }
+    if (r.Bad() || total > maxHeaderItems) {
+      ec = header_corrupt();
+      return false;
+    }
+    id = r.Number();
+  }
+  for (size_t i = 0; i < si.folders.size(); i++) {
+    auto n = si.substream_counts[i];
+    if (n == 0) {
+      continue;
+    }
+    // the sizes of all but the last stream are listed, without them a folder holds a single stream
+    if (n > 1 && id != kSize) {
+      ec = header_corrupt();
+      return false;
+    }
+    auto unpackSize = si.folders[i].UnpackSize();
+    uint64_t sum = 0;
+    for (uint32_t j = 1; j < n; j++) {
+      auto s = r.Number();
+      if (r.Bad() || s > unpackSize - sum) {
+        ec = header_corrupt();
+        return false;
+      }
+      si.substream_sizes.emplace_back(s);
+      sum += s;
+    }
+    si.substream_sizes.emplace_back(unpackSize - sum);
+  }
+  if (id == kSize) {
+    id = r.Number();
+  }
+  size_t numUnknown = 0;
+  for (size_t i = 0; i < si.folders.size(); i++) {
+    if (si.substream_counts[i] != 1 || !si.folders[i].has_crc) {
+      numUnknown += si.substream_counts[i];
+    }
+  }
+  digests unknown;
+  for (; id != kEnd; id = r.Number()) {
+    if (r.Bad()) {
+      ec = header_corrupt();
+      return false;
+    }
+    if (id == kCRC) {
+      readDigests(r, numUnknown, unknown);
+      continue;
+    }
+    r.Bytes(r.Number());
+  }
+  // folders holding a single stream with a folder crc32 reuse it, the others take the listed digests in order
+  auto &d = si.substream_digests;
+  size_t k = 0;
+  for (size_t i = 0; i < si.folders.size(); i++) {
+    const auto &folder = si.folders[i];
+    if (si.substream_counts[i] == 1 && folder.has_crc) {
+      d.defined.emplace_back(true);
+      d.values.emplace_back(folder.crc32_value);
+      continue;
+    }
+    for (uint32_t j = 0; j < si.substream_counts[i]; j++, k++) {
+      auto defined = k < unknown.defined.size() && unknown.defined[k];
+      d.defined.emplace_back(defined);
+      d.values.emplace_back(defined ? unknown.values[k] : 0);
+    }
+  }
+  return !r.Bad();
+}
+
+bool readStreamsInfo(header_reader &r, streams_info &si, bela::error_code &ec) {
+  for (;;) {
+    auto id = r.Number();
+    if (r.Bad()) {
+      ec = header_corrupt();
+      return false;
+    }
+    switch (id) {
+    case kEnd:
+      if (!si.has_substreams) {
+        // one stream per folder
+        si.substream_counts.assign(si.folders.size(), 1);
+        for (const auto &folder : si.folders) {
+          si.substream_sizes.emplace_back(folder.UnpackSize());
+          si.substream_digests.defined.emplace_back(folder.has_crc);
+          si.substream_digests.values.emplace_back(folder.crc32_value);
+        }
+      }
+      return true;
+    case kPackInfo:
+      if (!readPackInfo(r, si, ec)) {
+        return false;
+      }
+      break;
+    case kUnPackInfo:
+      if (!readUnpackInfo(r, si, ec)) {
+        return false;
+      }
+      break;
+    case kSubStreamsInfo:
+      if (!readSubStreamsInfo(r, si, ec)) {
+        return false;
+      }
+      break;
+    default:
+      ec = header_corrupt();
+      return false;
+    }
+  }
+}
+
+FileMode resolveFileMode(const File &file, bool attributesDefined) {
+  if (attributesDefined && (file.attributes & attributeUnixExtension) != 0) {
+    auto m = file.attributes >> 16;
+    uint32_t mode = m & 0777;
+    switch (m & 0xF000) {
+    case 0x4000:
+      mode |= FileMode::ModeDir;
+      break;
+    case 0xA000:
+      mode |= FileMode::ModeSymlink;
+      break;
+    default:
+      break;
+    }
+    return static_cast<FileMode>(mode);
+  }
+  if ((file.attributes & attributeDirectory) != 0) {
+    return static_cast<FileMode>(FileMode::ModeDir | 0777);
+  }
+  uint32_t mode = 0666;
+  if ((file.attributes & attributeReadOnly) != 0) {
+    mode &= ~0222;
+  }
+  return static_cast<FileMode>(mode);
+}
+
+bool readFilesInfo(header_reader &r, std::vector<File> &files, std::vector<bool> &emptyStream,
+                   std::vector<bool> &emptyFile, std::vector<bool> &attributesDefined, bela::error_code &ec) {
+  auto numFiles = r.Count();
+  if (r.Bad()) {
+    ec = header_corrupt();
+    return false;
+  }
+  files.resize(numFiles);
+  emptyStream.assign(numFiles, false);
+  attributesDefined.assign(numFiles, false);
+  size_t numEmpty = 0;
+  std::vector<bool> anti;
+  for (;;) {
+    auto type = r.Number();
+    if (type == kEnd) {
+      break;
+    }
+    header_reader sub(r.Bytes(r.Number()));
+    if (r.Bad()) {
+      ec = header_corrupt();
+      return false;
+    }
+    switch (type) {
+    case kEmptyStream:
+      emptyStream = sub.BitVector(numFiles);
+      numEmpty = static_cast<size_t>(std::ranges::count(emptyStream, true));
+      emptyFile.assign(numEmpty, false);
+      anti.assign(numEmpty, false);
+      break;
+    case kEmptyFile:
+      emptyFile = sub.BitVector(numEmpty);
+      break;
+    case kAnti:
+      anti = sub.BitVector(numEmpty);
+      break;
+    case kName: {
+      if (sub.Byte() != 0) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: external file names are not supported");
+        return false;
+      }
+      std::wstring name;
+      for (auto &file : files) {
+        name.clear();
+        for (;;) {
+          auto b = sub.Bytes(2);
+          if (b.size() != 2) {
+            ec = header_corrupt();
+            return false;
+          }
+          auto ch = static_cast<wchar_t>(bela::cast_fromle<uint16_t>(b.data()));
+          if (ch == 0) {
+            break;
+          }
+          name.push_back(ch);
+        }
+        file.name = bela::encode_into<wchar_t, char>(name);
+      }
+      break;
+    }
+    case kMTime: {
+      auto defined = sub.Defined(numFiles);
+      if (sub.Byte() != 0) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: external file times are not supported");
+        return false;
+      }
+      for (size_t i = 0; i < numFiles; i++) {
+        if (defined[i]) {
+          files[i].time = bela::FromWindowsPreciseTime(sub.UInt64());
+        }
+      }
+      break;
+    }
+    case kWinAttributes: {
+      attributesDefined = sub.Defined(numFiles);
+      if (sub.Byte() != 0) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: external attributes are not supported");
+        return false;
+      }
+      for (size_t i = 0; i < numFiles; i++) {
+        if (attributesDefined[i]) {
+          files[i].attributes = sub.UInt32();
+        }
+      }
+      break;
+    }
+    default:
+      // kCTime, kATime, kStartPos, kDummy and unknown properties
+      break;
+    }
+    if (sub.Bad()) {
+      ec = header_corrupt();
+      return false;
+    }
+  }
+  size_t emptyIndex = 0;
+  for (size_t i = 0; i < numFiles; i++) {
+    if (!emptyStream[i]) {
+      continue;
+    }
+    files[i].is_anti = anti[emptyIndex];
+    // an empty stream that is not an empty file is a directory
+    if (!emptyFile[emptyIndex]) {
+      files[i].attributes |= attributeDirectory;
+    }
+    emptyIndex++;
+  }
+  return !r.Bad();
+}
+} // namespace
+
+bool Reader::OpenReader(std::wstring_view file, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  auto fd_ = bela::io::NewFile(file, ec);
+  if (!fd_) {
+    return false;
+  }
+  fd = std::move(*fd_);
+  if (size = fd.Size(ec); size == bela::SizeUnInitialized) {
+    return false;
+  }
+  // self-extracting archives keep the 7z data after the executable
+  file_format_t afmt{file_format_t::none};
+  if (!CheckFormat(fd, afmt, startPosition, ec)) {
+    return false;
+  }
+  if (afmt != file_format_t::_7z) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: not a valid 7z file");
+    return false;
+  }
+  return Initialize(ec);
+}
+
+bool Reader::OpenReader(HANDLE nfd, int64_t size_, int64_t offset_, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  fd.Assgin(nfd, false);
+  size = size_;
+  startPosition = offset_;
+  if (size == bela::SizeUnInitialized) {
+    if (size = fd.Size(ec); size == bela::SizeUnInitialized) {
+      return false;
+    }
+  }
+  return Initialize(ec);
+}
+
+// readPackedHeader decodes a kEncodedHeader, the real header is stored compressed in its own folder
+bool Reader::readPackedHeader(std::vector<uint8_t> &header, bela::error_code &ec) {
+  // the kEncodedHeader id is skipped
+  header_reader r(std::span<const uint8_t>(header).subspan(1));
+  streams_info si;
+  if (!readStreamsInfo(r, si, ec)) {
+    return false;
+  }
+  if (si.folders.empty()) {
+    ec = header_corrupt();
+    return false;
+  }
+  std::vector<int64_t> positions;
+  auto position = startPosition + static_cast<int64_t>(signatureHeaderSize + si.pack_position);
+  for (const auto s : si.pack_sizes) {
+    positions.emplace_back(position);
+    position += static_cast<int64_t>(s);
+  }
+  const auto &folder = si.folders.front();
+  auto unpackSize = folder.UnpackSize();
+  if (unpackSize > maxHeaderSize || position > size) {
+    ec = header_corrupt();
+    return false;
+  }
+  auto s = NewFolderStream(fd.NativeFD(), folder, positions, si.pack_sizes, ec);
+  if (!s) {
+    return false;
+  }
+  std::vector<uint8_t> decoded(static_cast<size_t>(unpackSize));
+  if (!ReadFull(*s, decoded.data(), decoded.size(), ec)) {
+    return false;
+  }
+  if (folder.has_crc && Crc32(decoded.data(), decoded.size()) != folder.crc32_value) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: encoded header crc32 mismatch");
+    return false;
+  }
+  header = std::move(decoded);
+  return true;
+}
+
+/*
+  SignatureHeader
+    BYTE kSignature[6] = {'7', 'z', 0xBC, 0xAF, 0x27, 0x1C};
+    ArchiveVersion { BYTE Major; BYTE Minor; };
+    UINT32 StartHeaderCRC;
+    StartHeader { REAL_UINT64 NextHeaderOffset; REAL_UINT64 NextHeaderSize; UINT32 NextHeaderCRC; }
+*/
+bool Reader::Initialize(bela::error_code &ec) {
+  uint8_t sh[signatureHeaderSize];
+  if (size < static_cast<int64_t>(signatureHeaderSize) + startPosition) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: not a valid 7z file");
+    return false;
+  }
+  if (!ReadAt(fd.NativeFD(), sh, sizeof(sh), startPosition, ec)) {
+    return false;
+  }
+  if (memcmp(sh, signature, sizeof(signature)) != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: not a valid 7z file");
+    return false;
+  }
+  if (sh[6] != majorVersion) {
+    ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported format version ", static_cast<int>(sh[6]));
+    return false;
+  }
+  if (Crc32(sh + 12, 20) != bela::cast_fromle<uint32_t>(sh + 8)) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: start header crc32 mismatch");
+    return false;
+  }
+  auto nextHeaderOffset = bela::cast_fromle<uint64_t>(sh + 12);
+  auto nextHeaderSize = bela::cast_fromle<uint64_t>(sh + 20);
+  auto nextHeaderCRC = bela::cast_fromle<uint32_t>(sh + 28);
+  if (nextHeaderSize == 0) {
+    // empty archive
+    return true;
+  }
+  auto headerPosition = startPosition + static_cast<int64_t>(signatureHeaderSize);
+  if (nextHeaderSize > maxHeaderSize || nextHeaderOffset > static_cast<uint64_t>(size) ||
+      static_cast<uint64_t>(headerPosition) + nextHeaderOffset + nextHeaderSize > static_cast<uint64_t>(size)) {
+    ec = header_corrupt();
+    return false;
+  }
+  std::vector<uint8_t> header(static_cast<size_t>(nextHeaderSize));
+  if (!ReadAt(fd.NativeFD(), header.data(), header.size(), headerPosition + static_cast<int64_t>(nextHeaderOffset),
+              ec)) {
+    return false;
+  }
+  if (Crc32(header.data(), header.size()) != nextHeaderCRC) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: next header crc32 mismatch");
+    return false;
+  }
+  // like 7-Zip only one level of encoding is accepted, an encoded header that decodes to another one is corrupt
+  if (header[0] == kEncodedHeader && !readPackedHeader(header, ec)) {
+    return false;
+  }
+  header_reader r(header);
+  if (r.Number() != kHeader) {
+    ec = header_corrupt();
+    return false;
+  }
+  streams_info si;
+  std::vector<bool> emptyStream;
+  std::vector<bool> emptyFile;
+  std::vector<bool> attributesDefined;
+  for (;;) {
+    auto id = r.Number();
+    if (r.Bad()) {
+      ec = header_corrupt();
+      return false;
+    }
+    if (id == kEnd) {
+      break;
+    }
+    if (id == kArchiveProperties) {
+      for (auto type = r.Number(); type != kEnd && !r.Bad(); type = r.Number()) {
+        r.Bytes(r.Number());
+      }
+      continue;
+    }
+    if (id == kAdditionalStreamsInfo) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: additional streams are not supported");
+      return false;
+    }
+    if (id == kMainStreamsInfo) {
+      if (!readStreamsInfo(r, si, ec)) {
+        return false;
+      }
+      continue;
+    }
+    if (id == kFilesInfo) {
+      if (!readFilesInfo(r, files, emptyStream, emptyFile, attributesDefined, ec)) {
+        return false;
+      }
+      continue;
+    }
+    ec = header_corrupt();
+    return false;
+  }
+  auto position = headerPosition + static_cast<int64_t>(si.pack_position);
+  for (const auto s : si.pack_sizes) {
+    packPositions.emplace_back(position);
+    position += static_cast<int64_t>(s);
+    compressedSize += s;
+  }
+  if (position > size) {
+    ec = header_corrupt();
+    return false;
+  }
+  packSizes = std::move(si.pack_sizes);
+  folders = std::move(si.folders);
+  // files with data take the unpacked streams in order, folders without streams are skipped
+  size_t folderIndex = 0;
+  size_t streamIndex = 0;
+  uint32_t indexInFolder = 0;
+  uint64_t offset = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    auto &file = files[i];
+    file.has_stream = !emptyStream[i];
+    file.mode = resolveFileMode(file, attributesDefined[i]);
+    if (!file.has_stream) {
+      continue;
+    }
+    while (indexInFolder == 0 && folderIndex < folders.size() && si.substream_counts[folderIndex] == 0) {
+      folderIndex++;
+    }
+    if (folderIndex >= folders.size() || streamIndex >= si.substream_sizes.size()) {
+      ec = header_corrupt();
+      return false;
+    }
+    file.folder = static_cast<uint32_t>(folderIndex);
+    file.size = si.substream_sizes[streamIndex];
+    file.offset = offset;
+    file.has_crc = si.substream_digests.defined[streamIndex];
+    file.crc32_value = si.substream_digests.values[streamIndex];
+    folders[folderIndex].entries.emplace_back(static_cast<uint32_t>(i));
+    uncompressedSize += file.size;
+    offset += file.size;
+    streamIndex++;
+    if (++indexInFolder >= si.substream_counts[folderIndex]) {
+      folderIndex++;
+      indexInFolder = 0;
+      offset = 0;
+    }
+  }
+  return true;
+}
+
+} // namespace baulk::archive::n7z
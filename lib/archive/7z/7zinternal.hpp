@@ -0,0 +1,172 @@
+//
+#ifndef BAULK_7Z_INTERNAL_HPP
+#define BAULK_7Z_INTERNAL_HPP
+#include <bela/types.hpp>
+#include <baulk/archive/7z.hpp>
+#include <baulk/archive/crc32.hpp>
+#include <baulk/allocate.hpp>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace baulk::archive::n7z {
+using baulk::mem::Buffer;
+using bela::ssize_t;
+constexpr uint8_t signature[] = {'7', 'z', 0xBC, 0xAF, 0x27, 0x1C};
+constexpr size_t signatureHeaderSize = 32;
+constexpr uint8_t majorVersion = 0;
+
+// property ids of the header database
+enum property_id : uint8_t {
+  kEnd = 0x00,
+  kHeader = 0x01,
+  kArchiveProperties = 0x02,
+  kAdditionalStreamsInfo = 0x03,
+  kMainStreamsInfo = 0x04,
+  kFilesInfo = 0x05,
+  kPackInfo = 0x06,
+  kUnPackInfo = 0x07,
+  kSubStreamsInfo = 0x08,
+  kSize = 0x09,
+  kCRC = 0x0A,
+  kFolder = 0x0B,
+  kCodersUnPackSize = 0x0C,
+  kNumUnPackStream = 0x0D,
+  kEmptyStream = 0x0E,
+  kEmptyFile = 0x0F,
+  kAnti = 0x10,
+  kName = 0x11,
+  kCTime = 0x12,
+  kATime = 0x13,
+  kMTime = 0x14,
+  kWinAttributes = 0x15,
+  kComment = 0x16,
+  kEncodedHeader = 0x17,
+  kStartPos = 0x18,
+  kDummy = 0x19,
+};
+
+// 7-Zip and p7zip keep the unix mode in the high 16 bits of the attributes
+constexpr uint32_t attributeUnixExtension = 0x8000;
+constexpr uint32_t attributeDirectory = 0x10;
+constexpr uint32_t attributeReadOnly = 0x01;
+
+// MethodString formats a coder method id the way 7-Zip lists it, 030101 for LZMA
+inline std::wstring MethodString(uint64_t method) {
+  constexpr wchar_t digits[] = L"0123456789ABCDEF";
+  std::wstring s;
+  do {
+    s.insert(s.begin(), digits[method & 0xF]);
+    method >>= 4;
+  } while (method != 0);
+  if (s.size() % 2 != 0) {
+    s.insert(s.begin(), L'0');
+  }
+  return s;
+}
+
+// IsLzmaFilter reports the methods liblzma decodes, branch converters and delta can only precede LZMA or LZMA2
+inline bool IsLzmaFilter(uint64_t method) {
+  switch (method) {
+  case METHOD_DELTA:
+  case METHOD_X86:
+  case METHOD_PPC:
+  case METHOD_IA64:
+  case METHOD_ARM:
+  case METHOD_ARMT:
+  case METHOD_SPARC:
+  case METHOD_ARM64:
+  case METHOD_RISCV:
+    return true;
+  default:
+    break;
+  }
+  return false;
+}
+
+// Stream is one decoded coder output, Read returns 0 at its end and -1 on error
+class Stream {
+public:
+  virtual ~Stream() = default;
+  virtual ssize_t Read(void *buffer, size_t len, bela::error_code &ec) = 0;
+};
+using stream_ptr = std::unique_ptr<Stream>;
+
+// PackStream reads a pack stream with positional reads, folders decoded on several threads share the handle
+class PackStream final : public Stream {
+public:
+  PackStream(HANDLE fd_, int64_t position_, uint64_t size_) : fd(fd_), position(position_), remaining(size_) {}
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto n = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(len)));
+    if (n == 0) {
+      return 0;
+    }
+    if (!ReadAt(fd, buffer, n, position, ec)) {
+      return -1;
+    }
+    position += static_cast<int64_t>(n);
+    remaining -= n;
+    return static_cast<ssize_t>(n);
+  }
+
+private:
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t position{0};
+  uint64_t remaining{0};
+};
+
+// ByteSource buffers an input stream for decoders that consume it byte by byte
+class ByteSource {
+public:
+  ByteSource(stream_ptr in_, size_t capacity = 64 * 1024) : in(std::move(in_)) { buffer.grow(capacity); }
+  // Next returns -1 at the end of the input or on error, ec tells them apart
+  int Next(bela::error_code &ec) {
+    if (buffer.pos() == buffer.size() && !fill(ec)) {
+      return -1;
+    }
+    return buffer.data()[buffer.pos()++];
+  }
+  // Chunk exposes the buffered bytes, refilling when they were all consumed; empty at the end of the input
+  std::span<const uint8_t> Chunk(bela::error_code &ec) {
+    if (buffer.pos() == buffer.size() && !fill(ec)) {
+      return {};
+    }
+    return {buffer.data() + buffer.pos(), buffer.size() - buffer.pos()};
+  }
+  void Consume(size_t n) { buffer.pos() += n; }
+
+private:
+  bool fill(bela::error_code &ec) {
+    auto n = in->Read(buffer.data(), buffer.capacity(), ec);
+    if (n <= 0) {
+      return false;
+    }
+    buffer.pos() = 0;
+    buffer.size() = static_cast<size_t>(n);
+    return true;
+  }
+  stream_ptr in;
+  Buffer buffer;
+};
+
+// coders.cc, every coder stops after producing size bytes
+stream_ptr NewCopyStream(stream_ptr in, uint64_t size);
+// chain lists the filters folded into one liblzma raw decoder, outermost first, LZMA or LZMA2 last,
+// lzmaSize is the output size of that last coder
+stream_ptr NewLzmaStream(stream_ptr in, std::span<const Coder *const> chain, uint64_t lzmaSize, uint64_t size,
+                         bela::error_code &ec);
+stream_ptr NewPpmdStream(stream_ptr in, const Coder &coder, uint64_t size, bela::error_code &ec);
+stream_ptr NewBzip2Stream(stream_ptr in, uint64_t size, bela::error_code &ec);
+stream_ptr NewDeflateStream(stream_ptr in, uint64_t size, bela::error_code &ec);
+stream_ptr NewZstdStream(stream_ptr in, uint64_t size, bela::error_code &ec);
+// bcj2.cc, inputs are the main, call, jump and range coder streams
+stream_ptr NewBcj2Stream(std::vector<stream_ptr> &&inputs, uint64_t size, bela::error_code &ec);
+// decode.cc
+// the filters liblzma folds into one raw decoder, LZMA_FILTERS_MAX
+constexpr size_t maxFilterChain = 4;
+stream_ptr NewFolderStream(HANDLE fd, const Folder &folder, std::span<const int64_t> positions,
+                           std::span<const uint64_t> sizes, bela::error_code &ec);
+bool ReadFull(Stream &s, void *buffer, size_t len, bela::error_code &ec);
+} // namespace baulk::archive::n7z
+
+#endif
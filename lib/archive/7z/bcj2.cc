@@ -0,0 +1,145 @@
+//
+#include "7zinternal.hpp"
+#include <array>
+
+namespace baulk::archive::n7z {
+// BCJ2 splits x86 CALL (E8) and JMP (E9, 0F 8x) targets out of the code stream, a range coder decides which
+// opcodes were converted, their absolute targets live in the call and jump streams as big-endian uint32
+constexpr uint32_t kNumBitModelTotalBits = 11;
+constexpr uint32_t kBitModelTotal = 1 << kNumBitModelTotalBits;
+constexpr uint32_t kNumMoveBits = 5;
+constexpr uint32_t kTopValue = 1 << 24;
+
+inline bool IsJ(uint8_t b0, uint8_t b1) { return (b1 & 0xFE) == 0xE8 || (b0 == 0x0F && (b1 & 0xF0) == 0x80); }
+
+class Bcj2Stream final : public Stream {
+public:
+  Bcj2Stream(std::vector<stream_ptr> &&inputs, uint64_t size)
+      : mainSource(std::move(inputs[0])), callSource(std::move(inputs[1]), 16 * 1024),
+        jumpSource(std::move(inputs[2]), 16 * 1024), rcSource(std::move(inputs[3]), 16 * 1024), remaining(size) {
+    for (auto &p : probs) {
+      p = kBitModelTotal >> 1;
+    }
+  }
+  bool Initialize(bela::error_code &ec) {
+    for (int i = 0; i < 5; i++) {
+      auto b = rcSource.Next(ec);
+      if (b < 0) {
+        if (!ec) {
+          ec = bela::make_error_code(ErrGeneral, L"7z: BCJ2 range coder stream is truncated");
+        }
+        return false;
+      }
+      code = (code << 8) | static_cast<uint32_t>(b);
+    }
+    return true;
+  }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto want = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(len)));
+    auto out = reinterpret_cast<uint8_t *>(buffer);
+    size_t n = 0;
+    while (n < want) {
+      if (pendingPos < pending.size()) {
+        out[n++] = pending[pendingPos++];
+        outPos++;
+        continue;
+      }
+      auto c = mainSource.Next(ec);
+      if (c < 0) {
+        if (!ec) {
+          ec = bela::make_error_code(ErrGeneral, L"7z: BCJ2 main stream is truncated");
+        }
+        return -1;
+      }
+      auto b = static_cast<uint8_t>(c);
+      out[n++] = b;
+      outPos++;
+      if (!IsJ(prevByte, b) || n == remaining) {
+        prevByte = b;
+        continue;
+      }
+      auto &prob = b == 0xE8 ? probs[prevByte] : (b == 0xE9 ? probs[256] : probs[257]);
+      if (!decodeBit(prob, ec)) {
+        return -1;
+      }
+      if (!bit) {
+        prevByte = b;
+        continue;
+      }
+      auto &source = b == 0xE8 ? callSource : jumpSource;
+      uint32_t src = 0;
+      for (int i = 0; i < 4; i++) {
+        auto v = source.Next(ec);
+        if (v < 0) {
+          if (!ec) {
+            ec = bela::make_error_code(ErrGeneral, L"7z: BCJ2 ", b == 0xE8 ? L"call" : L"jump",
+                                       L" stream is truncated");
+          }
+          return -1;
+        }
+        src = (src << 8) | static_cast<uint32_t>(v);
+      }
+      auto dest = src - static_cast<uint32_t>(outPos + 4);
+      pending[0] = static_cast<uint8_t>(dest);
+      pending[1] = static_cast<uint8_t>(dest >> 8);
+      pending[2] = static_cast<uint8_t>(dest >> 16);
+      pending[3] = static_cast<uint8_t>(dest >> 24);
+      pendingPos = 0;
+      prevByte = pending[3];
+    }
+    remaining -= n;
+    return static_cast<ssize_t>(n);
+  }
+
+private:
+  bool decodeBit(uint16_t &prob, bela::error_code &ec) {
+    auto bound = (range >> kNumBitModelTotalBits) * prob;
+    if (code < bound) {
+      range = bound;
+      prob = static_cast<uint16_t>(prob + ((kBitModelTotal - prob) >> kNumMoveBits));
+      bit = false;
+    } else {
+      range -= bound;
+      code -= bound;
+      prob = static_cast<uint16_t>(prob - (prob >> kNumMoveBits));
+      bit = true;
+    }
+    if (range < kTopValue) {
+      auto v = rcSource.Next(ec);
+      if (v < 0 && ec) {
+        return false;
+      }
+      // the encoder flushes five bytes, a missing tail byte reads as zero and the crc32 decides
+      range <<= 8;
+      code = (code << 8) | static_cast<uint32_t>(v < 0 ? 0 : v);
+    }
+    return true;
+  }
+  ByteSource mainSource;
+  ByteSource callSource;
+  ByteSource jumpSource;
+  ByteSource rcSource;
+  uint16_t probs[2 + 256];
+  std::array<uint8_t, 4> pending;
+  size_t pendingPos{4};
+  uint64_t remaining{0};
+  uint64_t outPos{0};
+  uint32_t range{0xFFFFFFFF};
+  uint32_t code{0};
+  uint8_t prevByte{0};
+  bool bit{false};
+};
+
+stream_ptr NewBcj2Stream(std::vector<stream_ptr> &&inputs, uint64_t size, bela::error_code &ec) {
+  if (inputs.size() != 4) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: BCJ2 requires four input streams");
+    return nullptr;
+  }
+  auto s = std::make_unique<Bcj2Stream>(std::move(inputs), size);
+  if (!s->Initialize(ec)) {
+    return nullptr;
+  }
+  return s;
+}
+
+} // namespace baulk::archive::n7z
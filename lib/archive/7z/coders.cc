@@ -0,0 +1,493 @@
+//
+#ifndef LZMA_API_STATIC
+#define LZMA_API_STATIC 1
+#endif
+#include <bela/endian.hpp>
+#include "7zinternal.hpp"
+#include <lzma.h>
+#include <bzlib.h>
+#include <zlib-ng.h>
+#include <zstd.h>
+#include "../ppmd/Ppmd7.h"
+
+namespace baulk::archive::n7z {
+static_assert(maxFilterChain == LZMA_FILTERS_MAX);
+// LZMA allocator
+static lzma_allocator allocator{                                  // allocator
+                                .alloc = baulk::mem::allocate_xz, //
+                                .free = baulk::mem::deallocate_simple,
+                                .opaque = nullptr};
+
+inline bela::error_code ended_early() { return bela::make_error_code(ErrGeneral, L"7z: unexpected end of data"); }
+
+class CopyStream final : public Stream {
+public:
+  CopyStream(stream_ptr in_, uint64_t size) : in(std::move(in_)), remaining(size) {}
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto n = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(len)));
+    if (n == 0) {
+      return 0;
+    }
+    auto rn = in->Read(buffer, n, ec);
+    if (rn == 0) {
+      ec = ended_early();
+      return -1;
+    }
+    if (rn > 0) {
+      remaining -= static_cast<uint64_t>(rn);
+    }
+    return rn;
+  }
+
+private:
+  stream_ptr in;
+  uint64_t remaining{0};
+};
+
+stream_ptr NewCopyStream(stream_ptr in, uint64_t size) { return std::make_unique<CopyStream>(std::move(in), size); }
+
+inline lzma_vli lzma_filter_id(uint64_t method) {
+  switch (method) {
+  case METHOD_LZMA:
+    // LZMA1EXT knows the uncompressed size, 7z streams usually have no end marker
+    return LZMA_FILTER_LZMA1EXT;
+  case METHOD_LZMA2:
+    return LZMA_FILTER_LZMA2;
+  case METHOD_DELTA:
+    return LZMA_FILTER_DELTA;
+  case METHOD_X86:
+    return LZMA_FILTER_X86;
+  case METHOD_PPC:
+    return LZMA_FILTER_POWERPC;
+  case METHOD_IA64:
+    return LZMA_FILTER_IA64;
+  case METHOD_ARM:
+    return LZMA_FILTER_ARM;
+  case METHOD_ARMT:
+    return LZMA_FILTER_ARMTHUMB;
+  case METHOD_SPARC:
+    return LZMA_FILTER_SPARC;
+  case METHOD_ARM64:
+    return LZMA_FILTER_ARM64;
+  case METHOD_RISCV:
+    return LZMA_FILTER_RISCV;
+  default:
+    break;
+  }
+  return LZMA_VLI_UNKNOWN;
+}
+
+inline bela::error_code lzma_error_code(lzma_ret ret) {
+  switch (ret) {
+  case LZMA_MEM_ERROR:
+    return bela::make_error_code(ErrGeneral, L"7z: lzma memory error");
+  case LZMA_OPTIONS_ERROR:
+    return bela::make_error_code(ErrGeneral, L"7z: unsupported lzma options");
+  case LZMA_DATA_ERROR:
+    return bela::make_error_code(ErrGeneral, L"7z: lzma data is corrupt");
+  case LZMA_BUF_ERROR:
+    return bela::make_error_code(ErrGeneral, L"7z: unexpected end of lzma data");
+  default:
+    break;
+  }
+  return bela::make_error_code(ErrGeneral, L"7z: lzma internal error ret=", static_cast<int>(ret));
+}
+
+class LzmaStream final : public Stream {
+public:
+  LzmaStream(stream_ptr in, uint64_t size) : source(std::move(in)), remaining(size) { zs.allocator = &allocator; }
+  LzmaStream(const LzmaStream &) = delete;
+  LzmaStream &operator=(const LzmaStream &) = delete;
+  ~LzmaStream() { lzma_end(&zs); }
+  bool Initialize(std::span<const Coder *const> chain, uint64_t lzmaSize, bela::error_code &ec) {
+    if (chain.empty() || chain.size() > LZMA_FILTERS_MAX) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported filter chain length ", chain.size());
+      return false;
+    }
+    lzma_filter filters[LZMA_FILTERS_MAX + 1];
+    size_t n = 0;
+    auto closer = bela::finally([&] {
+      for (size_t i = 0; i < n; i++) {
+        // lzma_free is internal to liblzma, the options came from this allocator
+        allocator.free(allocator.opaque, filters[i].options);
+      }
+    });
+    for (const auto *c : chain) {
+      auto &f = filters[n];
+      f.id = lzma_filter_id(c->method);
+      f.options = nullptr;
+      if (f.id == LZMA_VLI_UNKNOWN) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported filter ", MethodString(c->method));
+        return false;
+      }
+      if (auto ret = lzma_properties_decode(&f, &allocator, c->props.data(), c->props.size()); ret != LZMA_OK) {
+        ec = lzma_error_code(ret);
+        return false;
+      }
+      n++;
+      if (f.id == LZMA_FILTER_LZMA1EXT) {
+        auto opt = reinterpret_cast<lzma_options_lzma *>(f.options);
+        opt->ext_flags = LZMA_LZMA1EXT_ALLOW_EOPM;
+        opt->ext_size_low = static_cast<uint32_t>(lzmaSize);
+        opt->ext_size_high = static_cast<uint32_t>(lzmaSize >> 32);
+      }
+    }
+    filters[n].id = LZMA_VLI_UNKNOWN;
+    filters[n].options = nullptr;
+    if (auto ret = lzma_raw_decoder(&zs, filters); ret != LZMA_OK) {
+      ec = lzma_error_code(ret);
+      return false;
+    }
+    return true;
+  }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto want = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(len)));
+    if (want == 0 || ended) {
+      return 0;
+    }
+    zs.next_out = reinterpret_cast<uint8_t *>(buffer);
+    zs.avail_out = want;
+    while (zs.avail_out == want) {
+      auto chunk = source.Chunk(ec);
+      if (chunk.empty() && ec) {
+        return -1;
+      }
+      zs.next_in = chunk.data();
+      zs.avail_in = chunk.size();
+      auto ret = lzma_code(&zs, chunk.empty() ? LZMA_FINISH : LZMA_RUN);
+      source.Consume(chunk.size() - zs.avail_in);
+      if (ret == LZMA_STREAM_END) {
+        ended = true;
+        break;
+      }
+      if (ret != LZMA_OK) {
+        ec = lzma_error_code(ret);
+        return -1;
+      }
+      if (chunk.empty() && zs.avail_out == want) {
+        ec = ended_early();
+        return -1;
+      }
+    }
+    auto n = want - zs.avail_out;
+    remaining -= n;
+    return static_cast<ssize_t>(n);
+  }
+
+private:
+  ByteSource source;
+  lzma_stream zs = LZMA_STREAM_INIT;
+  uint64_t remaining{0};
+  bool ended{false};
+};
+
+stream_ptr NewLzmaStream(stream_ptr in, std::span<const Coder *const> chain, uint64_t lzmaSize, uint64_t size,
+                         bela::error_code &ec) {
+  auto s = std::make_unique<LzmaStream>(std::move(in), size);
+  if (!s->Initialize(chain, lzmaSize, ec)) {
+    return nullptr;
+  }
+  return s;
+}
+
+// PPMd variant H with the 7z range coder, props are the model order and the memory size
+struct ppmd_byte_in {
+  IByteIn vt;
+  ByteSource *source{nullptr};
+  bela::error_code *ec{nullptr};
+};
+
+static Byte ppmd_read(const IByteIn *pp) {
+  auto p = Z7_CONTAINER_FROM_VTBL(pp, ppmd_byte_in, vt);
+  auto b = p->source->Next(*p->ec);
+  if (b < 0) {
+    // past the end the model decodes garbage, the crc32 of the entry catches it
+    return 0;
+  }
+  return static_cast<Byte>(b);
+}
+
+static void *SzBigAlloc(ISzAllocPtr p, size_t size) {
+  (void)p;
+  return mi_malloc(size);
+}
+static void SzBigFree(ISzAllocPtr p, void *address) {
+  (void)p;
+  mi_free(address);
+}
+static const ISzAlloc ppmdAlloc = {SzBigAlloc, SzBigFree};
+
+class PpmdStream final : public Stream {
+public:
+  PpmdStream(stream_ptr in, uint64_t size) : source(std::move(in)), remaining(size) {
+    Ppmd7_Construct(&ppmd);
+    byteIn.vt.Read = ppmd_read;
+    byteIn.source = &source;
+    byteIn.ec = &readEc;
+  }
+  PpmdStream(const PpmdStream &) = delete;
+  PpmdStream &operator=(const PpmdStream &) = delete;
+  ~PpmdStream() { Ppmd7_Free(&ppmd, &ppmdAlloc); }
+  bool Initialize(const Coder &coder, bela::error_code &ec) {
+    if (coder.props.size() != 5) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: invalid PPMd properties");
+      return false;
+    }
+    auto order = static_cast<unsigned>(coder.props[0]);
+    auto mem = bela::cast_fromle<uint32_t>(coder.props.data() + 1);
+    if (order < PPMD7_MIN_ORDER || order > PPMD7_MAX_ORDER || mem < PPMD7_MIN_MEM_SIZE || mem > PPMD7_MAX_MEM_SIZE) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: unsupported PPMd order ", order, L" memory ", mem);
+      return false;
+    }
+    if (Ppmd7_Alloc(&ppmd, mem, &ppmdAlloc) == 0) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: PPMd allocate memory failed");
+      return false;
+    }
+    ppmd.rc.dec.Stream = &byteIn.vt;
+    if (Ppmd7z_RangeDec_Init(&ppmd.rc.dec) == 0) {
+      ec = readEc ? readEc : bela::make_error_code(ErrGeneral, L"7z: PPMd data is corrupt");
+      return false;
+    }
+    Ppmd7_Init(&ppmd, order);
+    return true;
+  }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto want = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(len)));
+    auto p = reinterpret_cast<uint8_t *>(buffer);
+    for (size_t i = 0; i < want; i++) {
+      auto sym = Ppmd7z_DecodeSymbol(&ppmd);
+      if (sym < 0) {
+        ec = readEc ? std::move(readEc) : bela::make_error_code(ErrGeneral, L"7z: PPMd data is corrupt");
+        return -1;
+      }
+      p[i] = static_cast<uint8_t>(sym);
+    }
+    remaining -= want;
+    return static_cast<ssize_t>(want);
+  }
+
+private:
+  ByteSource source;
+  ppmd_byte_in byteIn;
+  bela::error_code readEc;
+  CPpmd7 ppmd;
+  uint64_t remaining{0};
+};
+
+stream_ptr NewPpmdStream(stream_ptr in, const Coder &coder, uint64_t size, bela::error_code &ec) {
+  auto s = std::make_unique<PpmdStream>(std::move(in), size);
+  if (!s->Initialize(coder, ec)) {
+    return nullptr;
+  }
+  return s;
+}
+
+// bzip2 streams written by several encoder threads are concatenated, decoding restarts at each stream end
+class Bzip2Stream final : public Stream {
+public:
+  Bzip2Stream(stream_ptr in, uint64_t size) : source(std::move(in)), remaining(size) {
+    memset(&bzs, 0, sizeof(bzs));
+    bzs.bzalloc = baulk::mem::allocate_bz;
+    bzs.bzfree = baulk::mem::deallocate_simple;
+  }
+  Bzip2Stream(const Bzip2Stream &) = delete;
+  Bzip2Stream &operator=(const Bzip2Stream &) = delete;
+  ~Bzip2Stream() {
+    if (initialized) {
+      BZ2_bzDecompressEnd(&bzs);
+    }
+  }
+  bool Initialize(bela::error_code &ec) {
+    if (auto ret = BZ2_bzDecompressInit(&bzs, 0, 0); ret != BZ_OK) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: BZ2_bzDecompressInit error ", ret);
+      return false;
+    }
+    initialized = true;
+    return true;
+  }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto want = static_cast<size_t>((std::min)({remaining, static_cast<uint64_t>(len), uint64_t{UINT32_MAX}}));
+    if (want == 0) {
+      return 0;
+    }
+    bzs.next_out = reinterpret_cast<char *>(buffer);
+    bzs.avail_out = static_cast<unsigned int>(want);
+    while (bzs.avail_out == want) {
+      auto chunk = source.Chunk(ec);
+      if (chunk.empty()) {
+        if (!ec) {
+          ec = ended_early();
+        }
+        return -1;
+      }
+      bzs.next_in = const_cast<char *>(reinterpret_cast<const char *>(chunk.data()));
+      bzs.avail_in = static_cast<unsigned int>((std::min)(chunk.size(), size_t{UINT32_MAX}));
+      auto avail = bzs.avail_in;
+      auto ret = BZ2_bzDecompress(&bzs);
+      source.Consume(avail - bzs.avail_in);
+      if (ret == BZ_STREAM_END) {
+        BZ2_bzDecompressEnd(&bzs);
+        initialized = false;
+        if (!Initialize(ec)) {
+          return -1;
+        }
+        continue;
+      }
+      if (ret != BZ_OK) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: bzlib error ", ret);
+        return -1;
+      }
+    }
+    auto n = want - bzs.avail_out;
+    remaining -= n;
+    return static_cast<ssize_t>(n);
+  }
+
+private:
+  ByteSource source;
+  bz_stream bzs;
+  uint64_t remaining{0};
+  bool initialized{false};
+};
+
+stream_ptr NewBzip2Stream(stream_ptr in, uint64_t size, bela::error_code &ec) {
+  auto s = std::make_unique<Bzip2Stream>(std::move(in), size);
+  if (!s->Initialize(ec)) {
+    return nullptr;
+  }
+  return s;
+}
+
+class DeflateStream final : public Stream {
+public:
+  DeflateStream(stream_ptr in, uint64_t size) : source(std::move(in)), remaining(size) {
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = baulk::mem::allocate_zlib;
+    zs.zfree = baulk::mem::deallocate_simple;
+  }
+  DeflateStream(const DeflateStream &) = delete;
+  DeflateStream &operator=(const DeflateStream &) = delete;
+  ~DeflateStream() {
+    if (initialized) {
+      zng_inflateEnd(&zs);
+    }
+  }
+  bool Initialize(bela::error_code &ec) {
+    if (auto zerr = zng_inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: zng_inflateInit2 error ", zerr);
+      return false;
+    }
+    initialized = true;
+    return true;
+  }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto want = static_cast<size_t>((std::min)({remaining, static_cast<uint64_t>(len), uint64_t{UINT32_MAX}}));
+    if (want == 0 || ended) {
+      return 0;
+    }
+    zs.next_out = reinterpret_cast<uint8_t *>(buffer);
+    zs.avail_out = static_cast<uint32_t>(want);
+    while (zs.avail_out == want) {
+      auto chunk = source.Chunk(ec);
+      if (chunk.empty()) {
+        if (!ec) {
+          ec = ended_early();
+        }
+        return -1;
+      }
+      zs.next_in = chunk.data();
+      zs.avail_in = static_cast<uint32_t>((std::min)(chunk.size(), size_t{UINT32_MAX}));
+      auto avail = zs.avail_in;
+      auto ret = zng_inflate(&zs, Z_NO_FLUSH);
+      source.Consume(avail - zs.avail_in);
+      if (ret == Z_STREAM_END) {
+        ended = true;
+        break;
+      }
+      if (ret != Z_OK) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: inflate error ", ret);
+        return -1;
+      }
+    }
+    auto n = want - zs.avail_out;
+    remaining -= n;
+    return static_cast<ssize_t>(n);
+  }
+
+private:
+  ByteSource source;
+  zng_stream zs;
+  uint64_t remaining{0};
+  bool initialized{false};
+  bool ended{false};
+};
+
+stream_ptr NewDeflateStream(stream_ptr in, uint64_t size, bela::error_code &ec) {
+  auto s = std::make_unique<DeflateStream>(std::move(in), size);
+  if (!s->Initialize(ec)) {
+    return nullptr;
+  }
+  return s;
+}
+
+class ZstdStream final : public Stream {
+public:
+  ZstdStream(stream_ptr in, uint64_t size) : source(std::move(in)), remaining(size) {}
+  ZstdStream(const ZstdStream &) = delete;
+  ZstdStream &operator=(const ZstdStream &) = delete;
+  ~ZstdStream() {
+    if (zds != nullptr) {
+      ZSTD_freeDCtx(zds);
+    }
+  }
+  bool Initialize(bela::error_code &ec) {
+    zds = ZSTD_createDCtx_advanced(ZSTD_customMem{
+        .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+    if (zds == nullptr) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: ZSTD_createDCtx() out of memory");
+      return false;
+    }
+    return true;
+  }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto want = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(len)));
+    if (want == 0) {
+      return 0;
+    }
+    ZSTD_outBuffer out{buffer, want, 0};
+    while (out.pos == 0) {
+      auto chunk = source.Chunk(ec);
+      if (chunk.empty()) {
+        if (!ec) {
+          ec = ended_early();
+        }
+        return -1;
+      }
+      ZSTD_inBuffer in{chunk.data(), chunk.size(), 0};
+      auto result = ZSTD_decompressStream(zds, &out, &in);
+      source.Consume(in.pos);
+      if (ZSTD_isError(result) != 0) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: ZSTD_decompressStream: ",
+                                   bela::encode_into<char, wchar_t>(ZSTD_getErrorName(result)));
+        return -1;
+      }
+    }
+    remaining -= out.pos;
+    return static_cast<ssize_t>(out.pos);
+  }
+
+private:
+  ByteSource source;
+  ZSTD_DCtx *zds{nullptr};
+  uint64_t remaining{0};
+};
+
+stream_ptr NewZstdStream(stream_ptr in, uint64_t size, bela::error_code &ec) {
+  auto s = std::make_unique<ZstdStream>(std::move(in), size);
+  if (!s->Initialize(ec)) {
+    return nullptr;
+  }
+  return s;
+}
+
+} // namespace baulk::archive::n7z
@@ -0,0 +1,345 @@
+//
+#include "7zinternal.hpp"
+
+namespace baulk::archive::n7z {
+constexpr size_t decodeBufferSize = 1024 * 1024;
+
+bool ReadFull(Stream &s, void *buffer, size_t len, bela::error_code &ec) {
+  auto p = reinterpret_cast<uint8_t *>(buffer);
+  while (len != 0) {
+    auto n = s.Read(p, len, ec);
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      ec = bela::make_error_code(ERROR_HANDLE_EOF, L"7z: unexpected end of folder data");
+      return false;
+    }
+    p += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+namespace {
+// coder_graph turns the bind pairs of a folder into a tree of streams rooted at the main out stream
+class coder_graph {
+public:
+  coder_graph(HANDLE fd_, const Folder &folder_, std::span<const int64_t> positions_, std::span<const uint64_t> sizes_)
+      : fd(fd_), folder(folder_), positions(positions_), sizes(sizes_) {
+    uint32_t in = 0;
+    uint32_t out = 0;
+    for (const auto &c : folder.coders) {
+      inBase.emplace_back(in);
+      outBase.emplace_back(out);
+      in += c.num_in_streams;
+      out += c.num_out_streams;
+    }
+  }
+  stream_ptr Out(uint32_t outIndex, bela::error_code &ec) {
+    if (++depth > folder.coders.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: folder coders form a cycle");
+      return nullptr;
+    }
+    auto ci = coder_of_out(outIndex);
+    if (ci < 0 || outIndex >= folder.unpack_sizes.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: invalid folder out stream ", outIndex);
+      return nullptr;
+    }
+    const auto &c = folder.coders[ci];
+    auto size = folder.unpack_sizes[outIndex];
+    if (c.num_out_streams != 1) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: coder ", MethodString(c.method), L" has ", c.num_out_streams,
+                                 L" out streams");
+      return nullptr;
+    }
+    switch (c.method) {
+    case METHOD_COPY:
+      if (auto in = In(inBase[ci], ec); in) {
+        return NewCopyStream(std::move(in), size);
+      }
+      return nullptr;
+    case METHOD_LZMA:
+      [[fallthrough]];
+    case METHOD_LZMA2:
+      return lzma_chain(ci, size, ec);
+    case METHOD_BCJ2: {
+      std::vector<stream_ptr> inputs;
+      for (uint32_t i = 0; i < c.num_in_streams; i++) {
+        auto in = In(inBase[ci] + i, ec);
+        if (!in) {
+          return nullptr;
+        }
+        inputs.emplace_back(std::move(in));
+      }
+      return NewBcj2Stream(std::move(inputs), size, ec);
+    }
+    case METHOD_PPMD:
+      if (auto in = In(inBase[ci], ec); in) {
+        return NewPpmdStream(std::move(in), c, size, ec);
+      }
+      return nullptr;
+    case METHOD_BZIP2:
+      if (auto in = In(inBase[ci], ec); in) {
+        return NewBzip2Stream(std::move(in), size, ec);
+      }
+      return nullptr;
+    case METHOD_DEFLATE:
+      if (auto in = In(inBase[ci], ec); in) {
+        return NewDeflateStream(std::move(in), size, ec);
+      }
+      return nullptr;
+    case METHOD_ZSTD:
+      if (auto in = In(inBase[ci], ec); in) {
+        return NewZstdStream(std::move(in), size, ec);
+      }
+      return nullptr;
+    case METHOD_AES:
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: encrypted archives are not supported");
+      return nullptr;
+    default:
+      break;
+    }
+    if (IsLzmaFilter(c.method)) {
+      return lzma_chain(ci, size, ec);
+    }
+    ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported method ", MethodString(c.method));
+    return nullptr;
+  }
+
+  // Check walks the graph like Out without opening a stream, it fails where Out would stop at a coder that is not
+  // implemented here or at a graph Out cannot follow
+  bool Check(uint32_t outIndex, bela::error_code &ec) {
+    if (++depth > folder.coders.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: folder coders form a cycle");
+      return false;
+    }
+    auto ci = coder_of_out(outIndex);
+    if (ci < 0 || outIndex >= folder.unpack_sizes.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: invalid folder out stream ", outIndex);
+      return false;
+    }
+    const auto &c = folder.coders[ci];
+    if (c.num_out_streams != 1) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: coder ", MethodString(c.method), L" has ", c.num_out_streams,
+                                 L" out streams");
+      return false;
+    }
+    switch (c.method) {
+    case METHOD_COPY:
+      [[fallthrough]];
+    case METHOD_PPMD:
+      [[fallthrough]];
+    case METHOD_BZIP2:
+      [[fallthrough]];
+    case METHOD_DEFLATE:
+      [[fallthrough]];
+    case METHOD_ZSTD:
+      return check_in(inBase[ci], ec);
+    case METHOD_LZMA:
+      [[fallthrough]];
+    case METHOD_LZMA2:
+      return check_chain(ci, ec);
+    case METHOD_BCJ2:
+      for (uint32_t i = 0; i < c.num_in_streams; i++) {
+        if (!check_in(inBase[ci] + i, ec)) {
+          return false;
+        }
+      }
+      return true;
+    case METHOD_AES:
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: encrypted archives are not supported");
+      return false;
+    default:
+      break;
+    }
+    if (IsLzmaFilter(c.method)) {
+      return check_chain(ci, ec);
+    }
+    ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported method ", MethodString(c.method));
+    return false;
+  }
+
+private:
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  const Folder &folder;
+  std::span<const int64_t> positions;
+  std::span<const uint64_t> sizes;
+  std::vector<uint32_t> inBase;
+  std::vector<uint32_t> outBase;
+  size_t depth{0};
+
+  int coder_of_out(uint32_t outIndex) const {
+    for (size_t i = 0; i < folder.coders.size(); i++) {
+      if (outIndex >= outBase[i] && outIndex < outBase[i] + folder.coders[i].num_out_streams) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+  // bound_out returns the out stream feeding the in stream, -1 when a pack stream feeds it
+  int64_t bound_out(uint32_t inIndex) const {
+    for (const auto &bp : folder.bind_pairs) {
+      if (bp.in_index == inIndex) {
+        return bp.out_index;
+      }
+    }
+    return -1;
+  }
+  stream_ptr In(uint32_t inIndex, bela::error_code &ec) {
+    if (auto out = bound_out(inIndex); out >= 0) {
+      return Out(static_cast<uint32_t>(out), ec);
+    }
+    for (size_t i = 0; i < folder.packed_streams.size(); i++) {
+      if (folder.packed_streams[i] != inIndex) {
+        continue;
+      }
+      auto pack = folder.first_pack_stream + i;
+      if (pack >= positions.size() || pack >= sizes.size()) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: pack stream ", pack, L" out of range");
+        return nullptr;
+      }
+      return std::make_unique<PackStream>(fd, positions[pack], sizes[pack]);
+    }
+    ec = bela::make_error_code(ErrGeneral, L"7z: in stream ", inIndex, L" is not bound");
+    return nullptr;
+  }
+  bool check_in(uint32_t inIndex, bela::error_code &ec) {
+    if (auto out = bound_out(inIndex); out >= 0) {
+      return Check(static_cast<uint32_t>(out), ec);
+    }
+    for (size_t i = 0; i < folder.packed_streams.size(); i++) {
+      if (folder.packed_streams[i] != inIndex) {
+        continue;
+      }
+      if (auto pack = folder.first_pack_stream + i; pack >= positions.size() || pack >= sizes.size()) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: pack stream ", pack, L" out of range");
+        return false;
+      }
+      return true;
+    }
+    ec = bela::make_error_code(ErrGeneral, L"7z: in stream ", inIndex, L" is not bound");
+    return false;
+  }
+  bool check_chain(int ci, bela::error_code &ec) {
+    size_t length = 0;
+    for (auto cur = ci;;) {
+      const auto &c = folder.coders[cur];
+      if (++length > maxFilterChain) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported filter chain length ", length);
+        return false;
+      }
+      if (c.method == METHOD_LZMA || c.method == METHOD_LZMA2) {
+        return check_in(inBase[cur], ec);
+      }
+      auto out = bound_out(inBase[cur]);
+      auto next = out < 0 ? -1 : coder_of_out(static_cast<uint32_t>(out));
+      if (!IsLzmaFilter(c.method) || next < 0) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: filter ", MethodString(c.method),
+                                   L" is only supported in front of LZMA or LZMA2");
+        return false;
+      }
+      cur = next;
+    }
+  }
+  // lzma_chain folds branch converters and delta into the liblzma decoder of the LZMA/LZMA2 coder below them
+  stream_ptr lzma_chain(int ci, uint64_t size, bela::error_code &ec) {
+    std::vector<const Coder *> chain;
+    for (auto cur = ci;;) {
+      const auto &c = folder.coders[cur];
+      chain.emplace_back(&c);
+      if (c.method == METHOD_LZMA || c.method == METHOD_LZMA2) {
+        if (auto in = In(inBase[cur], ec); in) {
+          return NewLzmaStream(std::move(in), chain, folder.unpack_sizes[outBase[cur]], size, ec);
+        }
+        return nullptr;
+      }
+      auto out = bound_out(inBase[cur]);
+      auto next = out < 0 ? -1 : coder_of_out(static_cast<uint32_t>(out));
+      if (!IsLzmaFilter(c.method) || next < 0 || chain.size() > folder.coders.size()) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: filter ", MethodString(c.method),
+                                   L" is only supported in front of LZMA or LZMA2");
+        return nullptr;
+      }
+      cur = next;
+    }
+  }
+};
+} // namespace
+
+stream_ptr NewFolderStream(HANDLE fd, const Folder &folder, std::span<const int64_t> positions,
+                           std::span<const uint64_t> sizes, bela::error_code &ec) {
+  if (folder.coders.empty()) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: folder without coders");
+    return nullptr;
+  }
+  coder_graph g(fd, folder, positions, sizes);
+  return g.Out(folder.MainOutStream(), ec);
+}
+
+bool CheckFolder(const Folder &folder, std::span<const int64_t> positions, std::span<const uint64_t> sizes,
+                 bela::error_code &ec) {
+  if (folder.coders.empty()) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: folder without coders");
+    return false;
+  }
+  coder_graph g(INVALID_HANDLE_VALUE, folder, positions, sizes);
+  return g.Check(folder.MainOutStream(), ec);
+}
+
+bool Reader::CheckFolders(bela::error_code &ec) const {
+  for (const auto &folder : folders) {
+    if (!CheckFolder(folder, packPositions, packSizes, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Reader::Decompress(size_t index, const OpenWriter &open, bela::error_code &ec) const {
+  if (index >= folders.size()) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: folder index ", index, L" out of range");
+    return false;
+  }
+  const auto &folder = folders[index];
+  auto s = NewFolderStream(fd.NativeFD(), folder, packPositions, packSizes, ec);
+  if (!s) {
+    return false;
+  }
+  Buffer out(decodeBufferSize);
+  for (const auto i : folder.entries) {
+    const auto &file = files[i];
+    Writer w;
+    if (!open(file, w, ec)) {
+      return false;
+    }
+    uint32_t crc32_value = 0;
+    for (auto remaining = file.size; remaining != 0;) {
+      auto n = s->Read(out.data(), static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(out.capacity()))),
+                       ec);
+      if (n < 0) {
+        return false;
+      }
+      if (n == 0) {
+        ec = bela::make_error_code(ERROR_HANDLE_EOF, L"7z: unexpected end of folder data");
+        return false;
+      }
+      if (file.has_crc) {
+        crc32_value = Crc32(out.data(), static_cast<size_t>(n), crc32_value);
+      }
+      if (w && !w(out.data(), static_cast<size_t>(n))) {
+        ec = bela::make_error_code(ErrCanceled, L"canceled");
+        return false;
+      }
+      remaining -= static_cast<uint64_t>(n);
+    }
+    if (file.has_crc && crc32_value != file.crc32_value) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: '", bela::encode_into<char, wchar_t>(file.name), L"' crc32 want ",
+                                 file.crc32_value, L" got ", crc32_value, L" not match");
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace baulk::archive::n7z
@@ -0,0 +1,117 @@
+///
+#include <baulk/archive/extractor.hpp>
+
+namespace baulk::archive::n7z {
+
+bool Extractor::Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
+  if (!reader.CheckFolders(ec)) {
+    return false;
+  }
+  std::error_code e;
+  if (fs::create_directories(destination, e); e) {
+    ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", destination, L"' "));
+    return false;
+  }
+  const auto &files = reader.Files();
+  targets.assign(files.size(), std::nullopt);
+  links.assign(files.size(), std::string());
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!prepare_entry(files[i], filter, targets[i], ec)) {
+      if (ec.code == bela::ErrCanceled || opts.ignore_error == false) {
+        return false;
+      }
+    }
+  }
+  std::vector<size_t> order;
+  for (size_t i = 0; i < reader.Folders().size(); i++) {
+    const auto &entries = reader.Folders()[i].entries;
+    if (std::ranges::any_of(entries, [&](uint32_t index) { return targets[index].has_value(); })) {
+      order.emplace_back(i);
+    }
+  }
+  std::ranges::stable_sort(order, std::ranges::greater{}, [&](size_t i) { return reader.Folders()[i].UnpackSize(); });
+  if (!extract_folders(order, progress, ec)) {
+    return false;
+  }
+  // link targets are the contents of symlink entries, create them once every folder is decoded
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!targets[i] || !files[i].IsSymlink()) {
+      continue;
+    }
+    if (!NewSymlinkBelow(destination, *targets[i], EncodeToNativePath(links[i], true), opts.overwrite_mode, ec) &&
+        !opts.ignore_error) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Extractor::prepare_entry(const File &file, const Filter &filter, std::optional<fs::path> &out,
+                              bela::error_code &ec) {
+  if (file.is_anti) {
+    return true;
+  }
+  std::wstring encoded_path;
+  auto target = baulk::archive::JoinSanitizeFsPath(destination, file.name, true, encoded_path);
+  if (!target) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", bela::encode_into<char, wchar_t>(file.name));
+    return false;
+  }
+  if (filter && !filter(file, encoded_path)) {
+    ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+    return false;
+  }
+  if (file.IsDir()) {
+    return MakeDirectories(*target, file.time, ec);
+  }
+  if (!file.has_stream) {
+    return baulk::archive::File::NewFile(*target, file.time, opts.overwrite_mode, ec).has_value();
+  }
+  out = std::move(target);
+  return true;
+}
+
+bool Extractor::open_entry(const File &file, const OnProgress &progress, Writer &w, bela::error_code &ec) {
+  auto index = static_cast<size_t>(&file - reader.Files().data());
+  if (!targets[index]) {
+    return true;
+  }
+  if (file.IsSymlink()) {
+    auto &link = links[index];
+    w = [&link](const void *data, size_t len) {
+      link.append(reinterpret_cast<const char *>(data), len);
+      return true;
+    };
+    return true;
+  }
+  auto fd = baulk::archive::File::NewFile(*targets[index], file.time, opts.overwrite_mode, ec);
+  if (!fd) {
+    return false;
+  }
+  // the writer owns the file, it is closed when the next entry of the folder is opened
+  w = [fd = std::make_shared<baulk::archive::File>(std::move(*fd)), &progress](const void *data, size_t len) {
+    if (progress && !progress(len)) {
+      // canceled
+      return false;
+    }
+    bela::error_code writeEc;
+    return fd->WriteFull(data, len, writeEc);
+  };
+  return true;
+}
+
+bool Extractor::extract_folders(const std::vector<size_t> &order, const OnProgress &progress, bela::error_code &ec) {
+  return RunWorkers(
+      Concurrency(opts.threads), order.size(), opts.ignore_error, progress,
+      [&](size_t i, const OnProgress &lockedProgress, bela::error_code &e) {
+        return reader.Decompress(
+            order[i],
+            [&](const File &file, Writer &w, bela::error_code &openEc) {
+              return open_entry(file, lockedProgress, w, openEc);
+            },
+            e);
+      },
+      ec);
+}
+
+} // namespace baulk::archive::n7z
@@ -1,7 +1,9 @@
 #include <bela/match.hpp>
 #include <bela/path.hpp>
 #include <baulk/archive.hpp>
+#include <winioctl.h>
 #include <filesystem>
+#include <limits>
 
 namespace baulk::archive {
 inline void close_file(HANDLE &hFile) {
@@ -86,6 +88,125 @@ bool File::WriteFull(const void *data, size_t bytes, bela::error_code &ec) {
   return true;
 }
 
+// the file is created empty, so setting its size after FSCTL_SET_SPARSE leaves the whole range unallocated
+bool File::Sparse(int64_t size, bela::error_code &ec) {
+  DWORD dwBytes = 0;
+  // FAT and exFAT have no sparse files, the size is still set below
+  DeviceIoControl(fd, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &dwBytes, nullptr);
+  return Truncate(size, ec);
+}
+
+bool File::Truncate(int64_t size, bela::error_code &ec) {
+  FILE_END_OF_FILE_INFO info;
+  info.EndOfFile.QuadPart = size;
+  if (SetFileInformationByHandle(fd, FileEndOfFileInfo, &info, sizeof(info)) != TRUE) {
+    ec = bela::make_system_error_code(L"SetFileInformationByHandle() ");
+    return false;
+  }
+  return true;
+}
+
+bool File::Preallocate(int64_t size, bela::error_code &ec) {
+  FILE_ALLOCATION_INFO info;
+  info.AllocationSize.QuadPart = size;
+  if (SetFileInformationByHandle(fd, FileAllocationInfo, &info, sizeof(info)) != TRUE) {
+    ec = bela::make_system_error_code(L"SetFileInformationByHandle() ");
+    return false;
+  }
+  return Truncate(size, ec);
+}
+
+bool File::Seek(int64_t pos, bela::error_code &ec) {
+  LARGE_INTEGER li;
+  li.QuadPart = pos;
+  if (SetFilePointerEx(fd, li, nullptr, FILE_BEGIN) != TRUE) {
+    ec = bela::make_system_error_code(L"SetFilePointerEx() ");
+    return false;
+  }
+  return true;
+}
+
+constexpr size_t largeFileGather = 1024 * 1024;
+
+void LargeFile::Initialize(int64_t size_, bool mapped) {
+  size = size_;
+  bela::error_code ec;
+  // an entry may claim more than the volume holds, it is then written as it comes
+  if (size <= 0 || !file.Preallocate(size, ec)) {
+    buffer.reserve(largeFileGather);
+    return;
+  }
+  if (mapped && static_cast<uint64_t>(size) <= (std::numeric_limits<size_t>::max)()) {
+    LARGE_INTEGER li;
+    li.QuadPart = size;
+    if (mapping = CreateFileMappingW(file.NativeFD(), nullptr, PAGE_READWRITE, li.HighPart, li.LowPart, nullptr);
+        mapping != nullptr) {
+      view = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, static_cast<size_t>(size)));
+    }
+    if (view != nullptr) {
+      mapped_once = true;
+      return;
+    }
+    unmap();
+  }
+  buffer.reserve(largeFileGather);
+}
+
+void LargeFile::unmap() {
+  if (view != nullptr) {
+    UnmapViewOfFile(view);
+    view = nullptr;
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+}
+
+bool LargeFile::Write(const void *data, size_t len, bela::error_code &ec) {
+  if (view != nullptr) {
+    if (written + static_cast<int64_t>(len) <= size) {
+      memcpy(view + written, data, len);
+      written += static_cast<int64_t>(len);
+      return true;
+    }
+    // more data than the entry claimed, the rest is written after what is mapped
+    unmap();
+    buffer.reserve(largeFileGather);
+    if (!file.Seek(written, ec)) {
+      return false;
+    }
+  }
+  auto p = static_cast<const uint8_t *>(data);
+  if (buffer.size() + len > largeFileGather && !buffer.empty()) {
+    if (!file.WriteFull(buffer.data(), buffer.size(), ec)) {
+      return false;
+    }
+    buffer.clear();
+  }
+  written += static_cast<int64_t>(len);
+  if (len >= largeFileGather) {
+    return file.WriteFull(p, len, ec);
+  }
+  buffer.insert(buffer.end(), p, p + len);
+  return true;
+}
+
+bool LargeFile::Finish(bela::Time modified, bela::error_code &ec) {
+  unmap();
+  if (!buffer.empty()) {
+    if (!file.WriteFull(buffer.data(), buffer.size(), ec)) {
+      return false;
+    }
+    buffer.clear();
+  }
+  if (written != size && !file.Truncate(written, ec)) {
+    return false;
+  }
+  // pages written through the mapping update the last write time when they are flushed
+  return !mapped_once || file.Chtimes(modified, ec);
+}
+
 std::optional<File> File::NewFile(const fs::path &path, bela::Time modified, bool overwrite_mode,
                                   bela::error_code &ec) {
   std::error_code e;
@@ -100,9 +221,19 @@ std::optional<File> File::NewFile(const fs::path &path, bela::Time modified, boo
       return std::nullopt;
     }
   }
+  return Create(path, modified, true, ec);
+}
+
+std::optional<File> File::Create(const fs::path &path, bela::Time modified, bool overwrite_mode,
+                                 bela::error_code &ec) {
   auto fd = CreateFileW(path.c_str(), FILE_GENERIC_READ | FILE_GENERIC_WRITE | GENERIC_READ | GENERIC_WRITE | DELETE,
-                        FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+                        FILE_SHARE_READ, nullptr, overwrite_mode ? CREATE_ALWAYS : CREATE_NEW, FILE_ATTRIBUTE_NORMAL,
+                        nullptr);
   if (fd == INVALID_HANDLE_VALUE) {
+    if (GetLastError() == ERROR_FILE_EXISTS) {
+      ec = bela::make_error_code(ErrGeneral, L"file '", path.native(), L"' exists");
+      return std::nullopt;
+    }
     ec = bela::make_system_error_code(L"CreateFileW ");
     return std::nullopt;
   }
@@ -113,6 +244,154 @@ std::optional<File> File::NewFile(const fs::path &path, bela::Time modified, boo
   return std::make_optional<File>(fd);
 }
 
+void MappedView::Free() {
+  if (base != nullptr) {
+    UnmapViewOfFile(base);
+    base = nullptr;
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+  length = 0;
+}
+MappedView::~MappedView() { Free(); }
+MappedView::MappedView(MappedView &&o) noexcept {
+  mapping = std::exchange(o.mapping, nullptr);
+  base = std::exchange(o.base, nullptr);
+  length = std::exchange(o.length, 0);
+}
+MappedView &MappedView::operator=(MappedView &&o) noexcept {
+  Free();
+  mapping = std::exchange(o.mapping, nullptr);
+  base = std::exchange(o.base, nullptr);
+  length = std::exchange(o.length, 0);
+  return *this;
+}
+
+std::optional<MappedView> MappedView::Map(HANDLE fd, int64_t size, bela::error_code &ec) {
+  if (size <= 0 || static_cast<uint64_t>(size) > (std::numeric_limits<size_t>::max)()) {
+    ec = bela::make_error_code(ErrGeneral, L"unable map file size ", size);
+    return std::nullopt;
+  }
+  MappedView view;
+  if (view.mapping = CreateFileMappingW(fd, nullptr, PAGE_READONLY, 0, 0, nullptr); view.mapping == nullptr) {
+    ec = bela::make_system_error_code(L"CreateFileMappingW() ");
+    return std::nullopt;
+  }
+  auto p = MapViewOfFile(view.mapping, FILE_MAP_READ, 0, 0, static_cast<size_t>(size));
+  if (p == nullptr) {
+    ec = bela::make_system_error_code(L"MapViewOfFile() ");
+    return std::nullopt;
+  }
+  view.base = reinterpret_cast<const uint8_t *>(p);
+  view.length = size;
+  return std::make_optional(std::move(view));
+}
+
+// https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-readfile
+// When lpOverlapped is not NULL on a synchronous handle, the read starts at the offset specified in the OVERLAPPED
+// structure, so concurrent readers do not race on the shared file pointer.
+bool ReadAt(HANDLE fd, void *buffer, size_t len, int64_t pos, bela::error_code &ec) {
+  auto p = reinterpret_cast<uint8_t *>(buffer);
+  while (len != 0) {
+    auto minsize = static_cast<DWORD>((std::min)(len, static_cast<size_t>(1) << 30));
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(pos);
+    ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+    DWORD dwSize = 0;
+    if (::ReadFile(fd, p, minsize, &dwSize, &ov) != TRUE) {
+      ec = bela::make_system_error_code(L"ReadFile: ");
+      return false;
+    }
+    if (dwSize == 0) {
+      ec = bela::make_error_code(ERROR_HANDLE_EOF, L"unexpected EOF");
+      return false;
+    }
+    p += dwSize;
+    pos += dwSize;
+    len -= dwSize;
+  }
+  return true;
+}
+
+// https://learn.microsoft.com/en-us/windows/win32/fileio/block-cloning
+// FSCTL_DUPLICATE_EXTENTS_TO_FILE needs both files on one volume and cluster aligned ranges, the target must already
+// be large enough. The source range is rounded up to a cluster when that stays inside the source file, the target is
+// truncated to len afterwards; an unaligned tail is copied
+inline int64_t clone_range(HANDLE src, int64_t pos, File &dst, int64_t len) {
+  DWORD flags = 0;
+  if (GetVolumeInformationByHandleW(dst.NativeFD(), nullptr, 0, nullptr, nullptr, &flags, nullptr, 0) != TRUE ||
+      (flags & FILE_SUPPORTS_BLOCK_REFCOUNTING) == 0) {
+    return 0;
+  }
+  FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity{};
+  DWORD dwBytes = 0;
+  if (DeviceIoControl(src, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0, &integrity, sizeof(integrity), &dwBytes,
+                      nullptr) != TRUE ||
+      integrity.ClusterSizeInBytes == 0) {
+    return 0;
+  }
+  int64_t cluster = integrity.ClusterSizeInBytes;
+  LARGE_INTEGER srcSize;
+  if (pos % cluster != 0 || GetFileSizeEx(src, &srcSize) != TRUE) {
+    return 0;
+  }
+  auto cloned = (std::min)((len + cluster - 1) / cluster * cluster, (srcSize.QuadPart - pos) / cluster * cluster);
+  bela::error_code ec;
+  if (cloned <= 0 || !dst.Truncate(cloned, ec)) {
+    return 0;
+  }
+  // a single call clones less than 4 GiB
+  constexpr int64_t cloneChunk = 1LL << 30;
+  for (int64_t offset = 0; offset < cloned; offset += cloneChunk) {
+    DUPLICATE_EXTENTS_DATA dup{};
+    dup.FileHandle = src;
+    dup.SourceFileOffset.QuadPart = pos + offset;
+    dup.TargetFileOffset.QuadPart = offset;
+    dup.ByteCount.QuadPart = (std::min)(cloneChunk, cloned - offset);
+    if (DeviceIoControl(dst.NativeFD(), FSCTL_DUPLICATE_EXTENTS_TO_FILE, &dup, sizeof(dup), nullptr, 0, &dwBytes,
+                        nullptr) != TRUE) {
+      // what was cloned is copied over again
+      return 0;
+    }
+  }
+  return (std::min)(cloned, len);
+}
+
+bool CopyRange(HANDLE src, int64_t pos, File &dst, int64_t len, const CopyObserver &observer, int64_t &cloned,
+               bela::error_code &ec) {
+  cloned = clone_range(src, pos, dst, len);
+  if (cloned == 0) {
+    // preallocation only keeps the file in one piece, copying works without it
+    bela::error_code preallocEc;
+    dst.Preallocate(len, preallocEc);
+  } else if (!dst.Seek(cloned, ec)) {
+    return false;
+  }
+  constexpr int64_t copyChunk = 1024 * 1024;
+  std::vector<uint8_t> buffer(static_cast<size_t>((std::min)(len - cloned, copyChunk)));
+  for (auto offset = cloned; offset < len;) {
+    auto n = static_cast<size_t>((std::min)(len - offset, copyChunk));
+    if (!ReadAt(src, buffer.data(), n, pos + offset, ec) || !dst.WriteFull(buffer.data(), n, ec)) {
+      return false;
+    }
+    if (observer) {
+      observer(buffer.data(), n);
+    }
+    offset += static_cast<int64_t>(n);
+  }
+  return dst.Truncate(len, ec);
+}
+
+bool NewDirectory(const fs::path &path, bela::error_code &ec) {
+  if (CreateDirectoryW(path.c_str(), nullptr) != TRUE && GetLastError() != ERROR_ALREADY_EXISTS) {
+    ec = bela::make_system_error_code(L"CreateDirectoryW() ");
+    return false;
+  }
+  return true;
+}
+
 bool NewSymlink(const fs::path &path, const fs::path &source, bool overwrite_mode, bela::error_code &ec) {
   std::error_code e;
   if (fs::exists(path, e)) {
@@ -134,6 +413,110 @@ bool NewSymlink(const fs::path &path, const fs::path &source, bool overwrite_mod
   return true;
 }
 
+bool NewSymlinkBelow(const fs::path &root, const fs::path &path, const std::wstring &linkname, bool overwrite_mode,
+                     bela::error_code &ec) {
+  std::error_code e;
+  auto linkPath = fs::absolute(path.parent_path() / linkname, e);
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"absolute() ");
+    return false;
+  }
+  auto relativePath = fs::relative(linkPath, root, e);
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"relative() ");
+    return false;
+  }
+  if (bela::StrContains(relativePath.c_str(), L"..\\")) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", linkname);
+    return false;
+  }
+  return NewSymlink(path, linkname, overwrite_mode, ec);
+}
+
+bool NewHardLink(const fs::path &path, const fs::path &source, bool overwrite_mode, bela::error_code &ec) {
+  std::error_code e;
+  auto exists = fs::exists(path, e);
+  if (exists && !overwrite_mode) {
+    ec = bela::make_error_code(ErrGeneral, L"file '", path.native(), L"' exists");
+    return false;
+  }
+  if (!exists) {
+    if (fs::create_directories(path.parent_path(), e); e) {
+      ec = bela::make_error_code_from_std(e, L"create_directories() ");
+      return false;
+    }
+  }
+  auto target = exists ? bela::StringCat(path.native(), L".baulk-link") : path.native();
+  if (CreateHardLinkW(target.data(), source.c_str(), nullptr) != TRUE) {
+    if (auto le = GetLastError(); le != ERROR_NOT_SAME_DEVICE && le != ERROR_TOO_MANY_LINKS) {
+      ec = bela::make_system_error_code(L"CreateHardLinkW() ");
+      return false;
+    }
+    if (CopyFileW(source.c_str(), target.data(), FALSE) != TRUE) {
+      ec = bela::make_system_error_code(L"CopyFileW() ");
+      return false;
+    }
+  }
+  if (exists && MoveFileExW(target.data(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != TRUE) {
+    ec = bela::make_system_error_code(L"MoveFileExW() ");
+    DeleteFileW(target.data());
+    return false;
+  }
+  return true;
+}
+
+bool RunWorkers(uint32_t threads, size_t count, bool ignore_error, const WorkerProgress &progress,
+                const WorkerTask &task, bela::error_code &ec) {
+  std::mutex mu; // serializes progress callbacks and guards the first error
+  std::atomic_bool stopped{false};
+  std::atomic_size_t next{0};
+  bela::error_code firstEc;
+  WorkerProgress lockedProgress = [&](size_t bytes) -> bool {
+    if (stopped) {
+      return false;
+    }
+    if (!progress) {
+      return true;
+    }
+    std::scoped_lock lock(mu);
+    return progress(bytes);
+  };
+  auto worker = [&]() {
+    for (;;) {
+      if (stopped) {
+        return;
+      }
+      auto i = next.fetch_add(1);
+      if (i >= count) {
+        return;
+      }
+      bela::error_code e;
+      if (task(i, lockedProgress, e)) {
+        continue;
+      }
+      if (e.code == bela::ErrCanceled || !ignore_error) {
+        std::scoped_lock lock(mu);
+        if (!stopped.exchange(true)) {
+          firstEc = std::move(e);
+        }
+      }
+    }
+  };
+  {
+    auto n = (std::min)(static_cast<size_t>(threads), count);
+    std::vector<std::jthread> workers;
+    for (size_t i = 1; i < n; i++) {
+      workers.emplace_back(worker);
+    }
+    worker();
+  }
+  if (stopped) {
+    ec = std::move(firstEc);
+    return false;
+  }
+  return true;
+}
+
 bool Chtimes(const fs::path &file, bela::Time t, bela::error_code &ec) {
   auto fd =
       CreateFileW(file.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
@@ -169,4 +552,65 @@ std::wstring_view PathStripExtension(std::wstring_view p) {
   return p;
 }
 
+size_t Flattener::Add(std::string_view name, bool directory) {
+  auto is_separator = [](char c) { return c == '/' || c == '\\'; };
+  auto limit = closed ? depth : chain.max_size();
+  size_t matched = 0;
+  bool named = false;
+  bool stopped = false;
+  while (matched < limit) {
+    while (!name.empty() && is_separator(name.front())) {
+      name.remove_prefix(1);
+    }
+    if (name.empty()) {
+      break;
+    }
+    auto pos = name.find_first_of("/\\");
+    auto component = name.substr(0, pos);
+    name = pos == std::string_view::npos ? std::string_view{} : name.substr(pos);
+    if (component == ".") {
+      continue;
+    }
+    named = true;
+    // a folder holding a file, a folder named bin or a second folder is where flattening stops
+    if (!directory && name.find_first_not_of("/\\") == std::string_view::npos) {
+      stopped = true;
+      break;
+    }
+    if (matched == chain.size()) {
+      if (bela::EqualsIgnoreCase(component, "bin")) {
+        stopped = true;
+        break;
+      }
+      chain.emplace_back(component);
+    } else if (!bela::EqualsIgnoreCase(chain[matched], component)) {
+      stopped = true;
+      break;
+    }
+    matched++;
+  }
+  if (!named) {
+    return depth;
+  }
+  if (stopped) {
+    closed = true;
+    depth = matched;
+  } else if (!closed) {
+    // every entry so far is a folder of the chain, nothing outside it was seen yet
+    depth = chain.size();
+  }
+  return depth;
+}
+
+std::string Flattener::Folders(size_t from, size_t to) const {
+  std::string folders;
+  for (auto i = from; i < to && i < chain.size(); i++) {
+    if (!folders.empty()) {
+      folders.push_back('/');
+    }
+    folders.append(chain[i]);
+  }
+  return folders;
+}
+
 } // namespace baulk::archive
\ No newline at end of file
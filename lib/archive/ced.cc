@@ -5,7 +5,10 @@
 #include <bela/str_replace.hpp>
 #include <baulk/archive.hpp>
 #include <compact_enc_det/compact_enc_det.h>
+#include <array>
 #include <filesystem>
+#include <mutex>
+#include <unordered_map>
 
 namespace baulk::archive {
 // https://codereview.chromium.org/2081653007/
@@ -43,7 +46,7 @@ uint32_t codePageSearch(Encoding e) {
       {.e = ISO_8859_15, .codePage = 28605},      // ISO 8859-15 Latin 9
       {.e = MSFT_CP1254, .codePage = 1254},       //
       {.e = MSFT_CP1257, .codePage = 1257},       //
-      {.e = MSFT_CP874, .codePage = 847},         //
+      {.e = MSFT_CP874, .codePage = 874},         //
       {.e = MSFT_CP1256, .codePage = 1256},       //
       {.e = MSFT_CP1255, .codePage = 1255},       //
       {.e = ISO_8859_8_I, .codePage = 38598},     // ISO 8859-8 Hebrew; Hebrew (ISO-Logical)
@@ -85,6 +88,174 @@ std::wstring EncodeToNativePath(std::string_view filename, bool always_utf8) {
   return encode_into_native(filename, always_utf8);
 }
 
+// table: single maps the bytes that are not lead bytes, pairs maps lead << 8 | trail. 0 marks a byte or a pair the
+// codepage does not define
+struct Charset::table {
+  std::array<wchar_t, 256> single{};
+  std::array<bool, 256> lead{};
+  std::vector<wchar_t> pairs;
+};
+
+// https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-multibytetowidechar
+// these codepages reject MB_ERR_INVALID_CHARS
+constexpr DWORD strict_flags(uint32_t codePage) {
+  if ((codePage >= 50220 && codePage <= 50229) || codePage == 52936 || codePage == 54936 ||
+      (codePage >= 57002 && codePage <= 57011) || codePage == 65000 || codePage == 42) {
+    return 0;
+  }
+  return MB_ERR_INVALID_CHARS;
+}
+
+// ISO-2022, HZ, GB18030 and UTF-8 are stateful or longer than two bytes, MultiByteToWideChar decodes them
+constexpr bool table_driven(uint32_t codePage) { return codePage < 50000 && strict_flags(codePage) != 0; }
+
+inline wchar_t decode_one(uint32_t codePage, const char *bytes, int len) {
+  wchar_t w[2];
+  if (MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, bytes, len, w, 2) != 1) {
+    return 0;
+  }
+  return w[0];
+}
+
+// lookup builds the tables of a codepage once per process
+std::shared_ptr<const Charset::table> Charset::lookup(uint32_t codePage) {
+  static std::mutex mu;
+  static std::unordered_map<uint32_t, std::shared_ptr<const table>> tables;
+  std::scoped_lock lock(mu);
+  if (auto it = tables.find(codePage); it != tables.end()) {
+    return it->second;
+  }
+  auto &t = tables[codePage];
+  CPINFO info;
+  if (!table_driven(codePage) || GetCPInfo(codePage, &info) != TRUE || info.MaxCharSize > 2) {
+    return t;
+  }
+  auto tb = std::make_shared<table>();
+  for (size_t i = 0; i + 1 < MAX_LEADBYTES && info.LeadByte[i] != 0; i += 2) {
+    for (auto b = static_cast<size_t>(info.LeadByte[i]); b <= info.LeadByte[i + 1]; b++) {
+      tb->lead[b] = true;
+    }
+  }
+  for (size_t b = 0; b < 256; b++) {
+    char c = static_cast<char>(b);
+    if (!tb->lead[b]) {
+      tb->single[b] = decode_one(codePage, &c, 1);
+      continue;
+    }
+    if (tb->pairs.empty()) {
+      tb->pairs.resize(256 * 256);
+    }
+    for (size_t trail = 0; trail < 256; trail++) {
+      const char pair[2] = {c, static_cast<char>(trail)};
+      tb->pairs[b << 8 | trail] = decode_one(codePage, pair, 2);
+    }
+  }
+  t = std::move(tb);
+  return t;
+}
+
+constexpr bool is_ascii(std::string_view name) {
+  for (auto c : name) {
+    if (static_cast<uint8_t>(c) >= 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Charset Charset::Detect(const std::vector<std::string_view> &names) {
+  // short names on their own say little about their charset, joined they are detected like a text
+  constexpr size_t sampleLimit = 256 * 1024;
+  std::string sample;
+  std::vector<std::string_view> sampled;
+  for (auto name : names) {
+    if (is_ascii(name)) {
+      continue;
+    }
+    sampled.emplace_back(name);
+    if (sample.size() + name.size() < sampleLimit) {
+      sample.append(name).push_back('\n');
+    }
+  }
+  if (sampled.empty()) {
+    return Charset{};
+  }
+  bool is_reliable = false;
+  int bytes_consumed = 0;
+  auto e = CompactEncDet::DetectEncoding(sample.data(), static_cast<int>(sample.size()), nullptr, nullptr, nullptr,
+                                         UNKNOWN_ENCODING, UNKNOWN_LANGUAGE, CompactEncDet::WEB_CORPUS, false,
+                                         &bytes_consumed, &is_reliable);
+  Charset charset;
+  // names written as UTF-8 without the flag are common
+  charset.codePage = e == UTF8 ? CP_UTF8 : codePageSearch(e);
+  if (charset.codePage == CP_ACP) {
+    return Charset{};
+  }
+  charset.decoder = lookup(charset.codePage);
+  size_t conflicts = 0;
+  std::wstring out;
+  for (auto name : sampled) {
+    if (!charset.decode(name, out)) {
+      conflicts++;
+    }
+  }
+  if (conflicts * 10 > sampled.size()) {
+    return Charset{};
+  }
+  return charset;
+}
+
+bool Charset::decode(std::string_view name, std::wstring &out) const {
+  out.clear();
+  if (!decoder) {
+    auto flags = strict_flags(codePage);
+    auto sz = MultiByteToWideChar(codePage, flags, name.data(), static_cast<int>(name.size()), nullptr, 0);
+    if (sz <= 0) {
+      return false;
+    }
+    out.resize(sz);
+    MultiByteToWideChar(codePage, flags, name.data(), static_cast<int>(name.size()), out.data(), sz);
+    return true;
+  }
+  out.reserve(name.size());
+  for (size_t i = 0; i < name.size(); i++) {
+    auto b = static_cast<uint8_t>(name[i]);
+    if (!decoder->lead[b]) {
+      if (auto w = decoder->single[b]; w != 0 || b == 0) {
+        out.push_back(w);
+        continue;
+      }
+      return false;
+    }
+    if (++i == name.size()) {
+      return false;
+    }
+    auto w = decoder->pairs[static_cast<size_t>(b) << 8 | static_cast<uint8_t>(name[i])];
+    if (w == 0) {
+      return false;
+    }
+    out.push_back(w);
+  }
+  return true;
+}
+
+std::wstring Charset::Decode(std::string_view name) const {
+  if (is_ascii(name)) {
+    return std::wstring(name.begin(), name.end());
+  }
+  if (std::wstring out; codePage != 0 && decode(name, out)) {
+    return out;
+  }
+  return encode_into_native(name, false);
+}
+
+std::wstring EncodeToNativePath(std::string_view filename, bool always_utf8, const Charset &charset) {
+  if (always_utf8) {
+    return bela::encode_into<char, wchar_t>(filename);
+  }
+  return charset.Decode(filename);
+}
+
 constexpr bool IsDangerousPath(std::wstring_view p) {
   constexpr std::wstring_view dangerousPaths[] = {L":$i30:$bitmap", L"$mft"};
   for (const auto d : dangerousPaths) {
@@ -136,12 +307,7 @@ inline bool is_harmful_path(std::string_view child_path) {
 }
 bool IsHarmfulPath(std::string_view child_path) { return is_harmful_path(child_path); }
 
-std::optional<std::filesystem::path> JoinSanitizeFsPath(const std::filesystem::path &root, std::string_view child_path,
-                                                        bool always_utf8, std::wstring &encoded_path) {
-  if (is_harmful_path(child_path)) {
-    return std::nullopt;
-  }
-  encoded_path = encode_into_native(child_path, always_utf8);
+inline std::filesystem::path sanitize_fs_path(const std::filesystem::path &root, std::wstring &encoded_path) {
   constexpr std::wstring_view excludeChars = L"\r\n<>:\"|*?";
   if (encoded_path.find_first_of(excludeChars) != std::wstring::npos) {
     bela::StrReplaceAll(
@@ -159,7 +325,26 @@ std::optional<std::filesystem::path> JoinSanitizeFsPath(const std::filesystem::p
         },
         &encoded_path);
   }
-  return std::make_optional(root / encoded_path);
+  return root / encoded_path;
+}
+
+std::optional<std::filesystem::path> JoinSanitizeFsPath(const std::filesystem::path &root, std::string_view child_path,
+                                                        bool always_utf8, std::wstring &encoded_path) {
+  if (is_harmful_path(child_path)) {
+    return std::nullopt;
+  }
+  encoded_path = encode_into_native(child_path, always_utf8);
+  return std::make_optional(sanitize_fs_path(root, encoded_path));
+}
+
+std::optional<std::filesystem::path> JoinSanitizeFsPath(const std::filesystem::path &root, std::string_view child_path,
+                                                        bool always_utf8, const Charset &charset,
+                                                        std::wstring &encoded_path) {
+  if (is_harmful_path(child_path)) {
+    return std::nullopt;
+  }
+  encoded_path = EncodeToNativePath(child_path, always_utf8, charset);
+  return std::make_optional(sanitize_fs_path(root, encoded_path));
 }
 
 } // namespace baulk::archive
\ No newline at end of file
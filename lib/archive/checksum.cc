@@ -0,0 +1,15 @@
+///
+#include <baulk/archive/crc32.hpp>
+#include <zlib-ng.h>
+
+namespace baulk::archive {
+
+uint32_t Crc32(const void *data, size_t bytes, uint32_t previous) {
+  return zng_crc32_z(previous, reinterpret_cast<const uint8_t *>(data), bytes);
+}
+
+uint32_t Crc32Combine(uint32_t crcA, uint32_t crcB, uint64_t bytesB) {
+  return zng_crc32_combine(crcA, crcB, static_cast<z_off64_t>(bytesB));
+}
+
+} // namespace baulk::archive
@@ -0,0 +1,136 @@
+///
+#include <baulk/archive.hpp>
+
+namespace baulk::archive {
+
+FilePool::FilePool(uint32_t threads, size_t limit_) : limit(limit_), started(std::chrono::steady_clock::now()) {
+  threads = (std::max)(threads, 1U);
+  for (uint32_t i = 0; i < threads; i++) {
+    lanes.emplace_back(std::make_unique<lane>());
+  }
+  for (auto &ln : lanes) {
+    workers.emplace_back([this, &l = *ln] { work(l); });
+  }
+}
+
+FilePool::~FilePool() {
+  {
+    std::scoped_lock lock(mu);
+    closed = true;
+  }
+  for (auto &l : lanes) {
+    l->cv.notify_all();
+  }
+  // queued jobs still run, the files were handed over as finished
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+std::wstring FilePool::fold(const fs::path &path) {
+  std::wstring folded(path.native());
+  CharUpperBuffW(folded.data(), static_cast<DWORD>(folded.size()));
+  return folded;
+}
+
+// push keeps the jobs of a path on one thread so that they run in order
+void FilePool::push(job &&j) {
+  j.key = fold(j.path);
+  auto &l = *lanes[std::hash<std::wstring>{}(j.key) % lanes.size()];
+  {
+    std::unique_lock lock(mu);
+    // a single job larger than limit is let through once nothing else is queued
+    room.wait(lock, [&] { return queued == 0 || queued + j.data.size() <= limit; });
+    queued += j.data.size();
+    pending++;
+    inflight[j.key]++;
+    l.jobs.emplace_back(std::move(j));
+  }
+  l.cv.notify_one();
+}
+
+void FilePool::Write(fs::path &&path, std::vector<uint8_t> &&data, bela::Time modified, bool overwrite_mode,
+                     bool parents) {
+  push(job{.path = std::move(path),
+           .data = std::move(data),
+           .modified = modified,
+           .overwrite_mode = overwrite_mode,
+           .parents = parents});
+}
+
+void FilePool::Close(const fs::path &path, File &&file) { push(job{.path = path, .file = std::move(file)}); }
+
+void FilePool::Flush(const fs::path &path) {
+  auto key = fold(path);
+  std::unique_lock lock(mu);
+  idle.wait(lock, [&] { return !inflight.contains(key); });
+}
+
+bool FilePool::Wait(bela::error_code &ec) {
+  std::unique_lock lock(mu);
+  idle.wait(lock, [&] { return pending == 0; });
+  if (firstEc) {
+    ec = std::move(firstEc);
+    firstEc.clear();
+    return false;
+  }
+  return true;
+}
+
+double FilePool::FilesPerSecond() const {
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  return elapsed > 0 ? static_cast<double>(files) / elapsed : 0;
+}
+
+bool FilePool::run(job &j, bela::error_code &ec) {
+  if (j.file) {
+    j.file.reset();
+    files++;
+    return true;
+  }
+  auto fd = j.parents ? File::NewFile(j.path, j.modified, j.overwrite_mode, ec)
+                      : File::Create(j.path, j.modified, j.overwrite_mode, ec);
+  if (!fd) {
+    return false;
+  }
+  if (!j.data.empty() && !fd->WriteFull(j.data.data(), j.data.size(), ec)) {
+    fd->Discard();
+    return false;
+  }
+  fd.reset();
+  files++;
+  bytes += j.data.size();
+  return true;
+}
+
+void FilePool::work(lane &l) {
+  for (;;) {
+    job j;
+    {
+      std::unique_lock lock(mu);
+      l.cv.wait(lock, [&] { return closed || !l.jobs.empty(); });
+      if (l.jobs.empty()) {
+        return;
+      }
+      j = std::move(l.jobs.front());
+      l.jobs.pop_front();
+    }
+    bela::error_code ec;
+    auto ok = run(j, ec);
+    {
+      std::scoped_lock lock(mu);
+      queued -= j.data.size();
+      pending--;
+      if (auto it = inflight.find(j.key); it != inflight.end() && --it->second == 0) {
+        inflight.erase(it);
+      }
+      if (!ok && !firstEc) {
+        firstEc = std::move(ec);
+      }
+    }
+    room.notify_all();
+    idle.notify_all();
+  }
+}
+
+} // namespace baulk::archive
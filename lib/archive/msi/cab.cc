@@ -0,0 +1,331 @@
+//
+#include "msiinternal.hpp"
+#include <bela/endian.hpp>
+#include <zlib-ng.h>
+
+namespace baulk::archive::cab {
+inline bela::error_code cab_corrupt() { return bela::make_error_code(ErrGeneral, L"cab: cabinet is corrupt"); }
+
+bool Reader::OpenReader(std::wstring_view file, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  auto fd_ = bela::io::NewFile(file, ec);
+  if (!fd_) {
+    return false;
+  }
+  fd = std::move(*fd_);
+  if (size = fd.Size(ec); size == bela::SizeUnInitialized) {
+    return false;
+  }
+  source = [nfd = fd.NativeFD()](void *buffer, size_t len, int64_t offset, bela::error_code &readEc) {
+    return baulk::archive::ReadAt(nfd, buffer, len, offset, readEc);
+  };
+  return Initialize(ec);
+}
+
+bool Reader::OpenReader(Source &&source_, int64_t size_, bela::error_code &ec) {
+  source = std::move(source_);
+  size = size_;
+  return Initialize(ec);
+}
+
+/*
+CFHEADER
+  signature, reserved, cbCabinet, reserved, coffFiles, reserved   (4 bytes each)
+  versionMinor, versionMajor                                      (1 byte each)
+  cFolders, cFiles, flags, setID, iCabinet                        (2 bytes each)
+  cbCFHeader (2), cbCFFolder (1), cbCFData (1), abReserve         (only with cabFlagReservePresent)
+  szCabinetPrev, szDiskPrev                                       (only with cabFlagPrevCabinet)
+  szCabinetNext, szDiskNext                                       (only with cabFlagNextCabinet)
+CFFOLDER: coffCabStart (4), cCFData (2), typeCompress (2), abReserve
+CFFILE:   cbFile (4), uoffFolderStart (4), iFolder (2), date (2), time (2), attribs (2), szName
+*/
+bool Reader::Initialize(bela::error_code &ec) {
+  uint8_t header[cabHeaderSize];
+  if (size < static_cast<int64_t>(cabHeaderSize) || !source(header, cabHeaderSize, 0, ec)) {
+    if (!ec) {
+      ec = cab_corrupt();
+    }
+    return false;
+  }
+  if (memcmp(header, cabSignature, sizeof(cabSignature)) != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: not a valid cabinet");
+    return false;
+  }
+  bela::endian::LittenEndian b(header + 16, cabHeaderSize - 16);
+  auto filesOffset = b.Read<uint32_t>();
+  b.Read<uint32_t>();
+  b.Read<uint8_t>(); // minor version
+  if (auto major = b.Read<uint8_t>(); major != 1) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: unsupported cabinet version ", major);
+    return false;
+  }
+  auto numFolders = b.Read<uint16_t>();
+  auto numFiles = b.Read<uint16_t>();
+  auto flags = b.Read<uint16_t>();
+  if ((flags & (cabFlagPrevCabinet | cabFlagNextCabinet)) != 0) {
+    ec = bela::make_error_code(ErrUnimplemented, L"cab: multi-volume cabinets are not supported");
+    return false;
+  }
+  // the folder table sits between the header and the file table
+  if (filesOffset < cabHeaderSize || filesOffset > size) {
+    ec = cab_corrupt();
+    return false;
+  }
+  std::vector<uint8_t> buffer(filesOffset);
+  if (!source(buffer.data(), buffer.size(), 0, ec)) {
+    return false;
+  }
+  size_t pos = cabHeaderSize;
+  uint8_t folderReserved = 0;
+  if ((flags & cabFlagReservePresent) != 0) {
+    if (pos + 4 > buffer.size()) {
+      ec = cab_corrupt();
+      return false;
+    }
+    auto headerReserved = bela::cast_fromle<uint16_t>(buffer.data() + pos);
+    folderReserved = buffer[pos + 2];
+    dataReserved = buffer[pos + 3];
+    pos += 4 + headerReserved;
+  }
+  for (uint16_t i = 0; i < numFolders; i++) {
+    if (pos + cabFolderSize + folderReserved > buffer.size()) {
+      ec = cab_corrupt();
+      return false;
+    }
+    bela::endian::LittenEndian f(buffer.data() + pos, cabFolderSize);
+    auto &folder = folders.emplace_back();
+    folder.offset = f.Read<uint32_t>();
+    folder.blocks = f.Read<uint16_t>();
+    folder.compression = f.Read<uint16_t>();
+    pos += cabFolderSize + folderReserved;
+  }
+  // the file table ends where the data of the first folder begins, names are at most 256 bytes
+  auto filesEnd = (std::min)(size, static_cast<int64_t>(filesOffset + numFiles * (cabFileSize + 256)));
+  for (const auto &folder : folders) {
+    if (folder.offset > filesOffset) {
+      filesEnd = (std::min)(filesEnd, static_cast<int64_t>(folder.offset));
+    }
+  }
+  buffer.resize(static_cast<size_t>(filesEnd - filesOffset));
+  if (!source(buffer.data(), buffer.size(), filesOffset, ec)) {
+    return false;
+  }
+  pos = 0;
+  for (uint16_t i = 0; i < numFiles; i++) {
+    if (pos + cabFileSize > buffer.size()) {
+      ec = cab_corrupt();
+      return false;
+    }
+    bela::endian::LittenEndian f(buffer.data() + pos, cabFileSize);
+    auto &file = files.emplace_back();
+    file.size = f.Read<uint32_t>();
+    file.offset = f.Read<uint32_t>();
+    file.folder = f.Read<uint16_t>();
+    auto date = f.Read<uint16_t>();
+    auto time = f.Read<uint16_t>();
+    file.time = bela::FromDosDateTime(date, time);
+    file.attributes = f.Read<uint16_t>();
+    pos += cabFileSize;
+    auto end = std::find(buffer.begin() + static_cast<std::ptrdiff_t>(pos), buffer.end(), 0);
+    if (end == buffer.end()) {
+      ec = cab_corrupt();
+      return false;
+    }
+    file.name.assign(reinterpret_cast<const char *>(buffer.data()) + pos,
+                     static_cast<size_t>(end - buffer.begin()) - pos);
+    pos += file.name.size() + 1;
+    if (file.folder >= cabFolderContinued) {
+      ec = bela::make_error_code(ErrUnimplemented, L"cab: files spanning cabinets are not supported");
+      return false;
+    }
+    if (file.folder >= folders.size()) {
+      ec = cab_corrupt();
+      return false;
+    }
+    auto &folder = folders[file.folder];
+    folder.entries.emplace_back(i);
+    folder.unpack_size = (std::max)(folder.unpack_size, static_cast<uint64_t>(file.offset) + file.size);
+    uncompressedSize += file.size;
+  }
+  for (auto &folder : folders) {
+    std::ranges::stable_sort(folder.entries, {}, [&](uint32_t i) { return files[i].offset; });
+  }
+  return true;
+}
+
+uint32_t Checksum(const uint8_t *data, size_t len, uint32_t seed) {
+  auto sum = seed;
+  for (; len >= 4; len -= 4, data += 4) {
+    sum ^= bela::cast_fromle<uint32_t>(data);
+  }
+  uint32_t tail = 0;
+  switch (len) {
+  case 3:
+    tail |= static_cast<uint32_t>(*data++) << 16;
+    [[fallthrough]];
+  case 2:
+    tail |= static_cast<uint32_t>(*data++) << 8;
+    [[fallthrough]];
+  case 1:
+    tail |= *data;
+    break;
+  default:
+    break;
+  }
+  return sum ^ tail;
+}
+
+namespace {
+// MSZIP blocks are raw deflate streams behind a 'CK' mark, each may reference the previous 32K of output
+class mszip_decoder {
+public:
+  mszip_decoder() = default;
+  mszip_decoder(const mszip_decoder &) = delete;
+  mszip_decoder &operator=(const mszip_decoder &) = delete;
+  ~mszip_decoder() {
+    if (initialized) {
+      zng_inflateEnd(&zs);
+    }
+  }
+  bool Initialize(bela::error_code &ec) {
+    memset(&zs, 0, sizeof(zs));
+    if (auto zerr = zng_inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: zng_inflateInit2 error ", zerr);
+      return false;
+    }
+    initialized = true;
+    return true;
+  }
+  bool Decode(std::span<const uint8_t> in, uint8_t *out, size_t outLen, bela::error_code &ec) {
+    if (in.size() < 2 || in[0] != 'C' || in[1] != 'K') {
+      ec = bela::make_error_code(ErrGeneral, L"cab: bad MSZIP block signature");
+      return false;
+    }
+    zng_inflateReset(&zs);
+    if (history != 0) {
+      zng_inflateSetDictionary(&zs, out, static_cast<uint32_t>(history));
+    }
+    zs.next_in = in.data() + 2;
+    zs.avail_in = static_cast<uint32_t>(in.size() - 2);
+    zs.next_out = out;
+    zs.avail_out = static_cast<uint32_t>(outLen);
+    auto zerr = zng_inflate(&zs, Z_FINISH);
+    if (zerr != Z_STREAM_END || zs.avail_out != 0) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: MSZIP block decode error ", zerr);
+      return false;
+    }
+    history = outLen;
+    return true;
+  }
+
+private:
+  zng_stream zs;
+  size_t history{0}; // bytes of the previous block still in the output buffer
+  bool initialized{false};
+};
+} // namespace
+
+bool Reader::Decompress(size_t index, const OpenWriter &open, bela::error_code &ec) const {
+  if (index >= folders.size()) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: folder index ", index, L" out of range");
+    return false;
+  }
+  const auto &folder = folders[index];
+  auto method = folder.Method();
+  if (method != METHOD_NONE && method != METHOD_MSZIP) {
+    ec = bela::make_error_code(ErrUnimplemented, L"cab: unsupported compression method ", folder.compression);
+    return false;
+  }
+  mszip_decoder mszip;
+  if (method == METHOD_MSZIP && !mszip.Initialize(ec)) {
+    return false;
+  }
+  std::vector<uint8_t> packed(cabDataSize + dataReserved + cabMaxBlockSize);
+  std::vector<uint8_t> block(cabMaxUnpackBlockSize);
+  size_t blockSize = 0; // decoded bytes in block
+  size_t blockPos = 0;  // consumed bytes of block
+  uint64_t folderPos = 0;
+  auto position = static_cast<int64_t>(folder.offset);
+  uint16_t remainingBlocks = folder.blocks;
+  // next_block reads and decodes one CFDATA block, the previous block stays in place as the MSZIP dictionary
+  auto next_block = [&]() -> bool {
+    if (remainingBlocks == 0) {
+      ec = bela::make_error_code(ERROR_HANDLE_EOF, L"cab: unexpected end of folder data");
+      return false;
+    }
+    remainingBlocks--;
+    auto headerSize = cabDataSize + dataReserved;
+    if (position + static_cast<int64_t>(headerSize) > size || !source(packed.data(), headerSize, position, ec)) {
+      if (!ec) {
+        ec = cab_corrupt();
+      }
+      return false;
+    }
+    auto checksum = bela::cast_fromle<uint32_t>(packed.data());
+    auto packedSize = bela::cast_fromle<uint16_t>(packed.data() + 4);
+    auto unpackSize = bela::cast_fromle<uint16_t>(packed.data() + 6);
+    auto data = packed.data() + headerSize;
+    if (packedSize > cabMaxBlockSize || unpackSize > cabMaxUnpackBlockSize || unpackSize == 0 ||
+        position + static_cast<int64_t>(headerSize + packedSize) > size ||
+        !source(data, packedSize, position + static_cast<int64_t>(headerSize), ec)) {
+      if (!ec) {
+        ec = cab_corrupt();
+      }
+      return false;
+    }
+    position += static_cast<int64_t>(headerSize + packedSize);
+    if (checksum != 0 && Checksum(packed.data() + 4, 4, Checksum(data, packedSize, 0)) != checksum) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: CFDATA checksum mismatch");
+      return false;
+    }
+    if (method == METHOD_NONE) {
+      if (packedSize != unpackSize) {
+        ec = cab_corrupt();
+        return false;
+      }
+      memcpy(block.data(), data, unpackSize);
+    } else if (!mszip.Decode({data, packedSize}, block.data(), unpackSize, ec)) {
+      return false;
+    }
+    blockSize = unpackSize;
+    blockPos = 0;
+    return true;
+  };
+  // advance hands n decoded bytes to w, w may be empty for skipped data
+  auto advance = [&](uint64_t n, const Writer &w) -> bool {
+    while (n != 0) {
+      if (blockPos == blockSize && !next_block()) {
+        return false;
+      }
+      auto chunk = static_cast<size_t>((std::min)(n, static_cast<uint64_t>(blockSize - blockPos)));
+      if (w && !w(block.data() + blockPos, chunk)) {
+        ec = bela::make_error_code(ErrCanceled, L"canceled");
+        return false;
+      }
+      blockPos += chunk;
+      folderPos += chunk;
+      n -= chunk;
+    }
+    return true;
+  };
+  for (const auto i : folder.entries) {
+    const auto &file = files[i];
+    if (file.offset < folderPos) {
+      ec = bela::make_error_code(ErrUnimplemented, L"cab: overlapping files are not supported");
+      return false;
+    }
+    Writer w;
+    if (!open(file, w, ec)) {
+      return false;
+    }
+    if (!advance(file.offset - folderPos, nullptr) || !advance(file.size, w)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace baulk::archive::cab
@@ -0,0 +1,284 @@
+//
+#include "msiinternal.hpp"
+#include <bela/endian.hpp>
+
+namespace baulk::archive::msi {
+inline bela::error_code cfb_corrupt() { return bela::make_error_code(ErrGeneral, L"msi: compound file is corrupt"); }
+
+bool Stream::ReadAt(void *buffer, size_t len, int64_t offset, bela::error_code &ec) const {
+  if (offset < 0 || static_cast<uint64_t>(offset) + len > size) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: read beyond the end of stream");
+    return false;
+  }
+  if (!data.empty()) {
+    memcpy(buffer, data.data() + offset, len);
+    return true;
+  }
+  auto p = reinterpret_cast<uint8_t *>(buffer);
+  auto pos = static_cast<uint64_t>(offset);
+  const auto sectorSize = static_cast<uint64_t>(1) << sectorShift;
+  while (len != 0) {
+    auto index = static_cast<size_t>(pos >> sectorShift);
+    auto within = pos & (sectorSize - 1);
+    // extend the run while the following sectors are adjacent in the file
+    auto last = index;
+    while (last + 1 < sectors.size() && sectors[last + 1] == sectors[last] + 1 &&
+           ((last + 1 - index) << sectorShift) < within + len) {
+      last++;
+    }
+    auto runBytes = ((last - index + 1) << sectorShift) - within;
+    auto n = static_cast<size_t>((std::min)(static_cast<uint64_t>(len), runBytes));
+    auto position = (static_cast<int64_t>(sectors[index]) + 1) * static_cast<int64_t>(sectorSize) +
+                    static_cast<int64_t>(within);
+    if (!baulk::archive::ReadAt(fd, p, n, position, ec)) {
+      return false;
+    }
+    p += n;
+    pos += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool CompoundFile::chain(uint32_t start, const std::vector<uint32_t> &table, std::vector<uint32_t> &sectors,
+                         bela::error_code &ec) const {
+  sectors.clear();
+  for (auto sector = start; sector != endOfChain;) {
+    if (sector >= table.size() || sectors.size() >= table.size()) {
+      ec = cfb_corrupt();
+      return false;
+    }
+    sectors.emplace_back(sector);
+    sector = table[sector];
+  }
+  return true;
+}
+
+bool CompoundFile::readSectors(const std::vector<uint32_t> &sectors, std::vector<uint8_t> &out,
+                               bela::error_code &ec) const {
+  const size_t sectorSize = static_cast<size_t>(1) << sectorShift;
+  out.resize(sectors.size() * sectorSize);
+  for (size_t i = 0; i < sectors.size();) {
+    auto j = i + 1;
+    while (j < sectors.size() && sectors[j] == sectors[j - 1] + 1) {
+      j++;
+    }
+    auto position = (static_cast<int64_t>(sectors[i]) + 1) * static_cast<int64_t>(sectorSize);
+    if (sectors[i] > maxRegularSector || position + static_cast<int64_t>((j - i) * sectorSize) > size) {
+      ec = cfb_corrupt();
+      return false;
+    }
+    if (!baulk::archive::ReadAt(fd, out.data() + i * sectorSize, (j - i) * sectorSize, position, ec)) {
+      return false;
+    }
+    i = j;
+  }
+  return true;
+}
+
+inline void append_table(std::vector<uint32_t> &table, std::span<const uint8_t> data) {
+  for (size_t i = 0; i + 4 <= data.size(); i += 4) {
+    table.emplace_back(bela::cast_fromle<uint32_t>(data.data() + i));
+  }
+}
+
+bool CompoundFile::OpenReader(HANDLE nfd, int64_t size_, bela::error_code &ec) {
+  fd = nfd;
+  size = size_;
+  uint8_t header[cfbHeaderSize];
+  if (size < static_cast<int64_t>(cfbHeaderSize)) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: not a compound file");
+    return false;
+  }
+  if (!baulk::archive::ReadAt(fd, header, sizeof(header), 0, ec)) {
+    return false;
+  }
+  if (memcmp(header, cfbSignature, sizeof(cfbSignature)) != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: not a compound file");
+    return false;
+  }
+  bela::endian::LittenEndian b(header + 24, cfbHeaderSize - 24);
+  b.Read<uint16_t>(); // minor version
+  auto majorVersion = b.Read<uint16_t>();
+  if (b.Read<uint16_t>() != 0xFFFE) {
+    ec = cfb_corrupt();
+    return false;
+  }
+  sectorShift = b.Read<uint16_t>();
+  miniSectorShift = b.Read<uint16_t>();
+  if ((majorVersion != 3 || sectorShift != 9) && (majorVersion != 4 || sectorShift != 12)) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: unsupported compound file version ", majorVersion);
+    return false;
+  }
+  if (miniSectorShift != 6) {
+    ec = cfb_corrupt();
+    return false;
+  }
+  b.Discard(6);
+  b.Read<uint32_t>(); // directory sectors, zero in version 3
+  auto numFatSectors = b.Read<uint32_t>();
+  auto firstDirSector = b.Read<uint32_t>();
+  b.Read<uint32_t>(); // transaction signature
+  miniStreamCutoff = b.Read<uint32_t>();
+  auto firstMiniFatSector = b.Read<uint32_t>();
+  b.Read<uint32_t>(); // mini FAT sectors
+  auto firstDifatSector = b.Read<uint32_t>();
+  auto numDifatSectors = b.Read<uint32_t>();
+  const size_t sectorSize = static_cast<size_t>(1) << sectorShift;
+  const auto maxSectors = static_cast<uint64_t>(size) >> sectorShift;
+  if (numFatSectors > maxSectors || numDifatSectors > maxSectors) {
+    ec = cfb_corrupt();
+    return false;
+  }
+  // the header lists the first 109 FAT sectors, the DIFAT chain the rest
+  std::vector<uint32_t> fatSectors;
+  for (size_t i = 0; i < cfbHeaderDifatEntries && fatSectors.size() < numFatSectors; i++) {
+    fatSectors.emplace_back(b.Read<uint32_t>());
+  }
+  std::vector<uint8_t> buffer(sectorSize);
+  for (uint32_t sector = firstDifatSector, n = 0; fatSectors.size() < numFatSectors; n++) {
+    if (sector > maxRegularSector || n >= numDifatSectors) {
+      ec = cfb_corrupt();
+      return false;
+    }
+    if (!readSectors({sector}, buffer, ec)) {
+      return false;
+    }
+    for (size_t i = 0; i + 4 < sectorSize && fatSectors.size() < numFatSectors; i += 4) {
+      fatSectors.emplace_back(bela::cast_fromle<uint32_t>(buffer.data() + i));
+    }
+    sector = bela::cast_fromle<uint32_t>(buffer.data() + sectorSize - 4);
+  }
+  if (!readSectors(fatSectors, buffer, ec)) {
+    return false;
+  }
+  fat.clear();
+  append_table(fat, buffer);
+  std::vector<uint32_t> sectors;
+  if (firstMiniFatSector != endOfChain) {
+    if (!chain(firstMiniFatSector, fat, sectors, ec) || !readSectors(sectors, buffer, ec)) {
+      return false;
+    }
+    miniFat.clear();
+    append_table(miniFat, buffer);
+  }
+  if (!chain(firstDirSector, fat, sectors, ec) || !readSectors(sectors, buffer, ec)) {
+    return false;
+  }
+  entries.clear();
+  for (size_t i = 0; i + cfbDirEntrySize <= buffer.size(); i += cfbDirEntrySize) {
+    bela::endian::LittenEndian d(buffer.data() + i + 64, cfbDirEntrySize - 64);
+    auto &e = entries.emplace_back();
+    // the name length counts bytes including the terminating null
+    auto nameLen = d.Read<uint16_t>();
+    auto chars = nameLen >= 2 ? (std::min)(static_cast<size_t>(nameLen / 2 - 1), static_cast<size_t>(31)) : 0;
+    for (size_t k = 0; k < chars; k++) {
+      e.name.push_back(static_cast<wchar_t>(bela::cast_fromle<uint16_t>(buffer.data() + i + k * 2)));
+    }
+    e.type = static_cast<entry_type_t>(d.Read<uint8_t>());
+    d.Read<uint8_t>(); // color
+    e.left = d.Read<uint32_t>();
+    e.right = d.Read<uint32_t>();
+    e.child = d.Read<uint32_t>();
+    d.Discard(16 + 4 + 8 + 8); // clsid, state bits, creation and modified time
+    e.start = d.Read<uint32_t>();
+    e.size = d.Read<uint64_t>();
+    if (majorVersion == 3) {
+      // version 3 writers may leave garbage in the high part
+      e.size &= 0xFFFFFFFFULL;
+    }
+  }
+  if (entries.empty() || entries[0].type != EntryRoot) {
+    ec = cfb_corrupt();
+    return false;
+  }
+  if (entries[0].size != 0 && !chain(entries[0].start, fat, miniStreamSectors, ec)) {
+    return false;
+  }
+  return true;
+}
+
+std::vector<uint32_t> CompoundFile::Children(uint32_t storage) const {
+  std::vector<uint32_t> children;
+  if (storage >= entries.size()) {
+    return children;
+  }
+  // siblings form a red-black tree, walk it without trusting it to be acyclic
+  std::vector<uint32_t> pending{entries[storage].child};
+  while (!pending.empty() && children.size() < entries.size()) {
+    auto i = pending.back();
+    pending.pop_back();
+    if (i >= entries.size()) {
+      continue;
+    }
+    children.emplace_back(i);
+    pending.emplace_back(entries[i].left);
+    pending.emplace_back(entries[i].right);
+  }
+  return children;
+}
+
+bool CompoundFile::OpenStream(uint32_t index, Stream &s, bela::error_code &ec) const {
+  if (index >= entries.size() || entries[index].type != EntryStream) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: entry ", index, L" is not a stream");
+    return false;
+  }
+  const auto &e = entries[index];
+  s.fd = fd;
+  s.size = e.size;
+  s.sectorShift = sectorShift;
+  s.sectors.clear();
+  s.data.clear();
+  if (e.size == 0) {
+    return true;
+  }
+  if (e.size >= miniStreamCutoff) {
+    if (!chain(e.start, fat, s.sectors, ec)) {
+      return false;
+    }
+    if ((static_cast<uint64_t>(s.sectors.size()) << sectorShift) < e.size) {
+      ec = cfb_corrupt();
+      return false;
+    }
+    return true;
+  }
+  // mini streams are short, gather their 64 byte sectors from the mini stream
+  std::vector<uint32_t> miniSectors;
+  if (!chain(e.start, miniFat, miniSectors, ec)) {
+    return false;
+  }
+  if ((static_cast<uint64_t>(miniSectors.size()) << miniSectorShift) < e.size) {
+    ec = cfb_corrupt();
+    return false;
+  }
+  Stream ministream;
+  ministream.fd = fd;
+  ministream.size = entries[0].size;
+  ministream.sectorShift = sectorShift;
+  ministream.sectors = miniStreamSectors;
+  s.data.resize(static_cast<size_t>(e.size));
+  const size_t miniSectorSize = static_cast<size_t>(1) << miniSectorShift;
+  for (size_t i = 0; i < miniSectors.size(); i++) {
+    auto offset = i * miniSectorSize;
+    auto n = (std::min)(miniSectorSize, s.data.size() - offset);
+    if (!ministream.ReadAt(s.data.data() + offset, n, static_cast<int64_t>(miniSectors[i]) << miniSectorShift, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CompoundFile::ReadStream(uint32_t index, std::vector<uint8_t> &out, bela::error_code &ec) const {
+  Stream s;
+  if (!OpenStream(index, s, ec)) {
+    return false;
+  }
+  if (!s.data.empty()) {
+    out = std::move(s.data);
+    return true;
+  }
+  out.resize(static_cast<size_t>(s.size));
+  return s.ReadAt(out.data(), out.size(), 0, ec);
+}
+
+} // namespace baulk::archive::msi
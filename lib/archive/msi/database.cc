@@ -0,0 +1,475 @@
+//
+#include "msiinternal.hpp"
+#include <bela/endian.hpp>
+#include <bela/str_split.hpp>
+#include <bela/path.hpp>
+#include <algorithm>
+#include <unordered_map>
+
+namespace baulk::archive::msi {
+// https://learn.microsoft.com/en-us/windows/win32/msi/installer-database
+inline bela::error_code database_corrupt() {
+  return bela::make_error_code(ErrGeneral, L"msi: installer database is corrupt");
+}
+
+inline char mime_char(uint32_t x) {
+  if (x < 10) {
+    return static_cast<char>('0' + x);
+  }
+  if (x < 36) {
+    return static_cast<char>('A' + x - 10);
+  }
+  if (x < 62) {
+    return static_cast<char>('a' + x - 36);
+  }
+  return x == 62 ? '.' : '_';
+}
+
+std::string DecodeStreamName(std::wstring_view name) {
+  std::string s;
+  for (const auto c : name) {
+    if (c >= 0x3800 && c < 0x4800) {
+      s.push_back(mime_char((c - 0x3800) & 0x3F));
+      s.push_back(mime_char(((c - 0x3800) >> 6) & 0x3F));
+      continue;
+    }
+    if (c >= 0x4800 && c < 0x4840) {
+      s.push_back(mime_char(c - 0x4800));
+      continue;
+    }
+    if (c == 0x4840) {
+      s.push_back('!');
+      continue;
+    }
+    s.append(bela::encode_into<wchar_t, char>(std::wstring_view(&c, 1)));
+  }
+  return s;
+}
+
+bool Table::Parse(std::vector<Column> &&columns_, std::vector<uint8_t> &&data_, size_t refSize, bela::error_code &ec) {
+  columns = std::move(columns_);
+  data = std::move(data_);
+  size_t rowSize = 0;
+  for (auto &c : columns) {
+    if ((c.type & columnTypeTemporary) != 0) {
+      c.width = 0;
+    } else if ((c.type & ~columnTypeNullable) == (columnTypeString | columnTypeValid)) {
+      c.width = 2; // binary columns reference streams by a short string id
+    } else if ((c.type & columnTypeString) != 0) {
+      c.width = refSize;
+    } else {
+      c.width = (c.type & 0xFF) <= 2 ? 2 : 4;
+    }
+    rowSize += c.width;
+  }
+  rows = rowSize == 0 ? 0 : data.size() / rowSize;
+  if (rowSize != 0 && data.size() % rowSize != 0) {
+    ec = database_corrupt();
+    return false;
+  }
+  size_t offset = 0;
+  for (auto &c : columns) {
+    c.offset = offset;
+    offset += c.width * rows;
+  }
+  return true;
+}
+
+int Table::Lookup(std::string_view name) const {
+  for (size_t i = 0; i < columns.size(); i++) {
+    if (columns[i].name == name) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+uint32_t Table::Value(size_t row, int column) const {
+  if (column < 0 || row >= rows) {
+    return 0;
+  }
+  const auto &c = columns[column];
+  auto p = data.data() + c.offset + row * c.width;
+  switch (c.width) {
+  case 2:
+    return bela::cast_fromle<uint16_t>(p);
+  case 3:
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16);
+  case 4:
+    return bela::cast_fromle<uint32_t>(p);
+  default:
+    break;
+  }
+  return 0;
+}
+
+int32_t Table::Integer(size_t row, int column) const {
+  auto v = Value(row, column);
+  if (v == 0 || column < 0) {
+    return 0;
+  }
+  if (columns[column].width == 2) {
+    return static_cast<int16_t>(v ^ 0x8000);
+  }
+  return static_cast<int32_t>(v ^ 0x80000000U);
+}
+
+namespace {
+// DefaultDir and FileName hold "short|long" names, DefaultDir may add ":source" names for the source image
+std::string_view long_name(std::string_view name) {
+  if (auto pos = name.find('|'); pos != std::string_view::npos) {
+    return name.substr(pos + 1);
+  }
+  return name;
+}
+
+std::string_view source_name(std::string_view defaultDir) {
+  if (auto pos = defaultDir.find(':'); pos != std::string_view::npos) {
+    return long_name(defaultDir.substr(pos + 1));
+  }
+  return long_name(defaultDir);
+}
+
+class database {
+public:
+  database(const CompoundFile &cf_, const std::vector<std::pair<std::string, uint32_t>> &streams_)
+      : cf(cf_), streams(streams_) {}
+  bool Initialize(bela::error_code &ec) {
+    std::vector<uint8_t> pool;
+    std::vector<uint8_t> stringData;
+    if (!read_stream("!_StringPool", pool, ec) || !read_stream("!_StringData", stringData, ec)) {
+      return false;
+    }
+    if (pool.size() < 4) {
+      ec = database_corrupt();
+      return false;
+    }
+    auto flags = bela::cast_fromle<uint16_t>(pool.data() + 2);
+    codepage = bela::cast_fromle<uint16_t>(pool.data()) | (static_cast<uint32_t>(flags & 0x7FFF) << 16);
+    refSize = (flags & 0x8000) != 0 ? 3 : 2;
+    // entries are (length, refcount) pairs, string ids start at 1. A string over 64K stores a zero length with a
+    // non-zero refcount and the full length in the following entry
+    strings.emplace_back();
+    size_t offset = 0;
+    const auto count = pool.size() / 4;
+    for (size_t i = 1; i < count;) {
+      auto len = static_cast<size_t>(bela::cast_fromle<uint16_t>(pool.data() + i * 4));
+      auto refs = bela::cast_fromle<uint16_t>(pool.data() + i * 4 + 2);
+      if (len == 0 && refs == 0) {
+        strings.emplace_back();
+        i++;
+        continue;
+      }
+      if (len == 0) {
+        if (i + 1 >= count) {
+          ec = database_corrupt();
+          return false;
+        }
+        len = static_cast<size_t>(bela::cast_fromle<uint16_t>(pool.data() + i * 4 + 4)) |
+              (static_cast<size_t>(bela::cast_fromle<uint16_t>(pool.data() + i * 4 + 6)) << 16);
+        i += 2;
+      } else {
+        i++;
+      }
+      if (offset + len > stringData.size()) {
+        ec = database_corrupt();
+        return false;
+      }
+      strings.emplace_back(reinterpret_cast<const char *>(stringData.data()) + offset, len);
+      offset += len;
+    }
+    return load_columns(ec);
+  }
+  [[nodiscard]] uint32_t Codepage() const { return codepage; }
+  [[nodiscard]] std::string_view String(uint32_t id) const {
+    return id < strings.size() ? std::string_view{strings[id]} : std::string_view{};
+  }
+  // Open loads a table, a table absent from the database has no rows
+  bool Open(std::string_view name, Table &table, bela::error_code &ec) {
+    auto it = schema.find(std::string(name));
+    if (it == schema.end()) {
+      return table.Parse({}, {}, refSize, ec);
+    }
+    std::vector<uint8_t> data;
+    if (auto index = lookup(bela::StringCat("!", name)); index != noStream && !cf.ReadStream(index, data, ec)) {
+      return false;
+    }
+    auto columns = it->second;
+    return table.Parse(std::move(columns), std::move(data), refSize, ec);
+  }
+
+private:
+  const CompoundFile &cf;
+  const std::vector<std::pair<std::string, uint32_t>> &streams;
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, std::vector<Table::Column>> schema;
+  uint32_t codepage{0};
+  size_t refSize{2};
+
+  uint32_t lookup(std::string_view name) const {
+    for (const auto &[n, index] : streams) {
+      if (n == name) {
+        return index;
+      }
+    }
+    return noStream;
+  }
+  bool read_stream(std::string_view name, std::vector<uint8_t> &data, bela::error_code &ec) const {
+    auto index = lookup(name);
+    if (index == noStream) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: missing database stream ", bela::encode_into<char, wchar_t>(name));
+      return false;
+    }
+    return cf.ReadStream(index, data, ec);
+  }
+  // _Columns describes every table: Table (string), Number (i2), Name (string), Type (i2)
+  bool load_columns(bela::error_code &ec) {
+    std::vector<uint8_t> data;
+    if (!read_stream("!_Columns", data, ec)) {
+      return false;
+    }
+    constexpr uint16_t stringType = columnTypeValid | columnTypeString | 64;
+    constexpr uint16_t shortType = columnTypeValid | 2;
+    Table columns;
+    if (!columns.Parse({{"Table", stringType}, {"Number", shortType}, {"Name", stringType}, {"Type", shortType}},
+                       std::move(data), refSize, ec)) {
+      return false;
+    }
+    std::unordered_map<std::string, std::vector<std::pair<int32_t, Table::Column>>> numbered;
+    for (size_t i = 0; i < columns.Rows(); i++) {
+      auto table = String(columns.Value(i, 0));
+      numbered[std::string(table)].emplace_back(
+          columns.Integer(i, 1),
+          Table::Column{std::string(String(columns.Value(i, 2))), static_cast<uint16_t>(columns.Integer(i, 3))});
+    }
+    for (auto &[table, cols] : numbered) {
+      std::ranges::sort(cols, {}, [](const auto &c) { return c.first; });
+      auto &target = schema[table];
+      for (auto &c : cols) {
+        target.emplace_back(std::move(c.second));
+      }
+    }
+    return true;
+  }
+};
+
+// to_utf8 converts a name stored in the database codepage, neutral databases use the system codepage
+std::string to_utf8(std::string_view s, uint32_t codepage) {
+  if (codepage == CP_UTF8 || std::ranges::all_of(s, [](char c) { return static_cast<uint8_t>(c) < 0x80; })) {
+    return std::string(s);
+  }
+  auto cp = codepage == 0 ? CP_ACP : codepage;
+  auto n = MultiByteToWideChar(cp, 0, s.data(), static_cast<int>(s.size()), nullptr, 0);
+  if (n <= 0) {
+    return std::string(s);
+  }
+  std::wstring w(static_cast<size_t>(n), L'\0');
+  MultiByteToWideChar(cp, 0, s.data(), static_cast<int>(s.size()), w.data(), n);
+  return bela::encode_into<wchar_t, char>(w);
+}
+
+// word_count reads PID_WORDCOUNT of the summary information, bit 1 marks compressed packages
+bool word_count(std::span<const uint8_t> si, uint32_t &value) {
+  // header: byte order, version, system, clsid, section count, then (fmtid, offset) pairs
+  if (si.size() < 48) {
+    return false;
+  }
+  auto section = bela::cast_fromle<uint32_t>(si.data() + 44);
+  if (section + 8 > si.size()) {
+    return false;
+  }
+  auto count = bela::cast_fromle<uint32_t>(si.data() + section + 4);
+  for (uint32_t i = 0; i < count; i++) {
+    auto entry = static_cast<size_t>(section) + 8 + static_cast<size_t>(i) * 8;
+    if (entry + 8 > si.size()) {
+      return false;
+    }
+    if (bela::cast_fromle<uint32_t>(si.data() + entry) != summaryPidWordCount) {
+      continue;
+    }
+    auto pos = static_cast<size_t>(section) + bela::cast_fromle<uint32_t>(si.data() + entry + 4);
+    if (pos + 8 > si.size()) {
+      return false;
+    }
+    value = bela::cast_fromle<uint32_t>(si.data() + pos + 4);
+    return true;
+  }
+  return false;
+}
+} // namespace
+
+bool Package::OpenReader(std::wstring_view file, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  auto fd_ = bela::io::NewFile(file, ec);
+  if (!fd_) {
+    return false;
+  }
+  fd = std::move(*fd_);
+  path = file;
+  auto size = fd.Size(ec);
+  if (size == bela::SizeUnInitialized) {
+    return false;
+  }
+  if (!cf.OpenReader(fd.NativeFD(), size, ec)) {
+    return false;
+  }
+  return Initialize(ec);
+}
+
+bool Package::Initialize(bela::error_code &ec) {
+  for (const auto i : cf.Children(0)) {
+    if (cf.Entries()[i].type == EntryStream) {
+      streams.emplace_back(DecodeStreamName(cf.Entries()[i].name), i);
+    }
+  }
+  database db(cf, streams);
+  if (!db.Initialize(ec)) {
+    return false;
+  }
+  uint32_t wordCount = 0;
+  for (const auto &[name, index] : streams) {
+    if (name == "\x05SummaryInformation") {
+      std::vector<uint8_t> si;
+      if (cf.ReadStream(index, si, ec)) {
+        word_count(si, wordCount);
+      }
+      break;
+    }
+  }
+  Table directory;
+  Table component;
+  Table file;
+  Table media;
+  if (!db.Open("Directory", directory, ec) || !db.Open("Component", component, ec) || !db.Open("File", file, ec) ||
+      !db.Open("Media", media, ec)) {
+    return false;
+  }
+  // resolve directories to their paths in the administrative image, the root (TARGETDIR) is the destination
+  std::unordered_map<std::string_view, size_t> directoryIndex;
+  auto dirKey = directory.Lookup("Directory");
+  auto dirParent = directory.Lookup("Directory_Parent");
+  auto dirDefault = directory.Lookup("DefaultDir");
+  for (size_t i = 0; i < directory.Rows(); i++) {
+    directoryIndex.emplace(db.String(directory.Value(i, dirKey)), i);
+  }
+  std::vector<std::optional<std::string>> dirPaths(directory.Rows());
+  std::function<const std::string *(size_t, size_t)> resolve = [&](size_t i, size_t depth) -> const std::string * {
+    if (dirPaths[i]) {
+      return &*dirPaths[i];
+    }
+    if (depth > directory.Rows()) {
+      return nullptr; // cycle
+    }
+    auto parentKey = db.String(directory.Value(i, dirParent));
+    auto name = source_name(db.String(directory.Value(i, dirDefault)));
+    auto it = directoryIndex.find(parentKey);
+    if (parentKey.empty() || it == directoryIndex.end() || it->second == i) {
+      dirPaths[i] = std::string();
+      return &*dirPaths[i];
+    }
+    auto parent = resolve(it->second, depth + 1);
+    if (parent == nullptr) {
+      return nullptr;
+    }
+    if (name.empty() || name == ".") {
+      dirPaths[i] = *parent;
+    } else if (parent->empty()) {
+      dirPaths[i] = std::string(name);
+    } else {
+      dirPaths[i] = bela::StringCat(*parent, "/", name);
+    }
+    return &*dirPaths[i];
+  };
+  std::unordered_map<std::string_view, std::string_view> componentDirectory;
+  auto compKey = component.Lookup("Component");
+  auto compDirectory = component.Lookup("Directory_");
+  for (size_t i = 0; i < component.Rows(); i++) {
+    componentDirectory.emplace(db.String(component.Value(i, compKey)), db.String(component.Value(i, compDirectory)));
+  }
+  auto mediaDisk = media.Lookup("DiskId");
+  auto mediaLast = media.Lookup("LastSequence");
+  auto mediaCabinet = media.Lookup("Cabinet");
+  for (size_t i = 0; i < media.Rows(); i++) {
+    disks.emplace_back(Disk{.cabinet = to_utf8(db.String(media.Value(i, mediaCabinet)), db.Codepage()),
+                            .disk_id = static_cast<uint32_t>(media.Integer(i, mediaDisk)),
+                            .last_sequence = static_cast<uint32_t>(media.Integer(i, mediaLast))});
+  }
+  std::ranges::sort(disks, {}, [](const Disk &d) { return d.last_sequence; });
+  auto fileKey = file.Lookup("File");
+  auto fileComponent = file.Lookup("Component_");
+  auto fileName = file.Lookup("FileName");
+  auto fileSize = file.Lookup("FileSize");
+  auto fileAttributes = file.Lookup("Attributes");
+  auto fileSequence = file.Lookup("Sequence");
+  if (fileKey < 0 || fileComponent < 0 || fileName < 0 || fileSequence < 0 || dirKey < 0 || dirDefault < 0 ||
+      compKey < 0 || compDirectory < 0) {
+    ec = database_corrupt();
+    return false;
+  }
+  files.reserve(file.Rows());
+  for (size_t i = 0; i < file.Rows(); i++) {
+    File f;
+    f.key = db.String(file.Value(i, fileKey));
+    f.size = static_cast<uint32_t>(file.Integer(i, fileSize));
+    f.sequence = static_cast<uint32_t>(file.Integer(i, fileSequence));
+    f.attributes = static_cast<uint16_t>(file.Integer(i, fileAttributes));
+    if ((f.attributes & fileAttributeNoncompressed) != 0) {
+      f.compressed = false;
+    } else if ((f.attributes & fileAttributeCompressed) != 0) {
+      f.compressed = true;
+    } else {
+      f.compressed = (wordCount & summaryWordCountCompressed) != 0;
+    }
+    auto cit = componentDirectory.find(db.String(file.Value(i, fileComponent)));
+    auto dit = cit == componentDirectory.end() ? directoryIndex.end() : directoryIndex.find(cit->second);
+    const std::string *dir = dit == directoryIndex.end() ? nullptr : resolve(dit->second, 0);
+    if (dir == nullptr) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: unable resolve directory of '",
+                                 bela::encode_into<char, wchar_t>(f.key), L"'");
+      return false;
+    }
+    auto name = long_name(db.String(file.Value(i, fileName)));
+    f.name = to_utf8(dir->empty() ? std::string(name) : bela::StringCat(*dir, "/", name), db.Codepage());
+    auto dk = std::ranges::lower_bound(disks, f.sequence, {}, [](const Disk &d) { return d.last_sequence; });
+    f.disk = static_cast<uint32_t>(dk - disks.begin());
+    uncompressedSize += f.size;
+    files.emplace_back(std::move(f));
+  }
+  return true;
+}
+
+bool Package::OpenCabinet(size_t index, cab::Reader &r, bela::error_code &ec) const {
+  if (index >= disks.size() || disks[index].cabinet.empty()) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: disk ", index, L" has no cabinet");
+    return false;
+  }
+  const auto &cabinet = disks[index].cabinet;
+  if (cabinet.front() != '#') {
+    auto external = bela::StringCat(bela::DirName(path), L"\\", bela::encode_into<char, wchar_t>(cabinet));
+    return r.OpenReader(external, ec);
+  }
+  auto name = std::string_view(cabinet).substr(1);
+  for (const auto &[n, i] : streams) {
+    if (n != name) {
+      continue;
+    }
+    auto s = std::make_shared<Stream>();
+    if (!cf.OpenStream(i, *s, ec)) {
+      return false;
+    }
+    auto size = static_cast<int64_t>(s->Size());
+    return r.OpenReader(
+        [s](void *buffer, size_t len, int64_t offset, bela::error_code &readEc) {
+          return s->ReadAt(buffer, len, offset, readEc);
+        },
+        size, ec);
+  }
+  ec = bela::make_error_code(ErrGeneral, L"msi: cabinet stream '", bela::encode_into<char, wchar_t>(name),
+                             L"' not found");
+  return false;
+}
+
+} // namespace baulk::archive::msi
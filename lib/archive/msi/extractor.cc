@@ -0,0 +1,145 @@
+///
+#include <baulk/archive/extractor.hpp>
+
+namespace baulk::archive::msi {
+
+bool PackageExtractor::Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
+  const auto &files = package.Files();
+  const auto &disks = package.Disks();
+  cabinets.clear();
+  cabinets.resize(disks.size());
+  keys.assign(disks.size(), {});
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto &file = files[i];
+    if (!file.compressed || file.disk >= disks.size() || disks[file.disk].cabinet.empty()) {
+      ec = bela::make_error_code(bela::ErrUnimplemented, L"msi: '", bela::encode_into<char, wchar_t>(file.key),
+                                 L"' is not stored in a cabinet");
+      return false;
+    }
+    if (!cabinets[file.disk]) {
+      cabinets[file.disk] = std::make_unique<cab::Reader>();
+      if (!package.OpenCabinet(file.disk, *cabinets[file.disk], ec)) {
+        return false;
+      }
+      for (const auto &folder : cabinets[file.disk]->Folders()) {
+        if (auto m = folder.Method(); m != cab::METHOD_NONE && m != cab::METHOD_MSZIP) {
+          ec = bela::make_error_code(bela::ErrUnimplemented, L"msi: cabinet '",
+                                     bela::encode_into<char, wchar_t>(disks[file.disk].cabinet),
+                                     L"' uses unsupported compression ", folder.compression);
+          return false;
+        }
+      }
+    }
+    keys[file.disk].emplace(file.key, i);
+  }
+  std::error_code e;
+  if (fs::create_directories(destination, e); e) {
+    ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", destination, L"' "));
+    return false;
+  }
+  targets.assign(files.size(), std::nullopt);
+  written.assign(files.size(), 0);
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!prepare_entry(files[i], filter, targets[i], ec)) {
+      if (ec.code == bela::ErrCanceled || opts.ignore_error == false) {
+        return false;
+      }
+    }
+  }
+  std::vector<std::pair<size_t, size_t>> order; // (disk, folder)
+  for (size_t d = 0; d < cabinets.size(); d++) {
+    if (!cabinets[d]) {
+      continue;
+    }
+    for (size_t f = 0; f < cabinets[d]->Folders().size(); f++) {
+      order.emplace_back(d, f);
+    }
+  }
+  std::ranges::stable_sort(order, std::ranges::greater{},
+                           [&](const auto &o) { return cabinets[o.first]->Folders()[o.second].unpack_size; });
+  if (!extract_folders(order, progress, ec)) {
+    return false;
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    if (targets[i] && written[i] == 0 && !opts.ignore_error) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"msi: '", bela::encode_into<char, wchar_t>(files[i].key),
+                                 L"' not found in cabinet '",
+                                 bela::encode_into<char, wchar_t>(disks[files[i].disk].cabinet), L"'");
+      return false;
+    }
+  }
+  return true;
+}
+
+// strip_system_folder drops the program files folder of the administrative image, its children become top level
+std::string_view PackageExtractor::strip_system_folder(std::string_view name) {
+  constexpr std::string_view systemFolders[] = {"Program Files", "ProgramFiles64", "PFiles", "Files"};
+  auto pos = name.find('/');
+  if (pos == std::string_view::npos) {
+    return name;
+  }
+  auto first = name.substr(0, pos);
+  for (const auto s : systemFolders) {
+    if (bela::EqualsIgnoreCase(first, s)) {
+      return name.substr(pos + 1);
+    }
+  }
+  return name;
+}
+
+bool PackageExtractor::prepare_entry(const File &file, const Filter &filter, std::optional<fs::path> &out,
+                                     bela::error_code &ec) {
+  std::wstring encoded_path;
+  auto target = baulk::archive::JoinSanitizeFsPath(destination, strip_system_folder(file.name), true, encoded_path);
+  if (!target) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", bela::encode_into<char, wchar_t>(file.name));
+    return false;
+  }
+  if (filter && !filter(file, encoded_path)) {
+    ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+    return false;
+  }
+  out = std::move(target);
+  return true;
+}
+
+bool PackageExtractor::open_entry(size_t disk, const cab::File &cf, const OnProgress &progress, cab::Writer &w,
+                                  bela::error_code &ec) {
+  auto it = keys[disk].find(cf.name);
+  if (it == keys[disk].end() || !targets[it->second]) {
+    return true;
+  }
+  auto index = it->second;
+  auto fd = baulk::archive::File::NewFile(*targets[index], cf.time, opts.overwrite_mode, ec);
+  if (!fd) {
+    return false;
+  }
+  written[index] = 1;
+  w = [fd = std::make_shared<baulk::archive::File>(std::move(*fd)), &progress](const void *data, size_t len) {
+    if (progress && !progress(len)) {
+      // canceled
+      return false;
+    }
+    bela::error_code writeEc;
+    return fd->WriteFull(data, len, writeEc);
+  };
+  return true;
+}
+
+bool PackageExtractor::extract_folders(const std::vector<std::pair<size_t, size_t>> &order, const OnProgress &progress,
+                                       bela::error_code &ec) {
+  return RunWorkers(
+      Concurrency(opts.threads), order.size(), opts.ignore_error, progress,
+      [&](size_t i, const OnProgress &lockedProgress, bela::error_code &e) {
+        auto [disk, folder] = order[i];
+        return cabinets[disk]->Decompress(
+            folder,
+            [&, disk = disk](const cab::File &file, cab::Writer &w, bela::error_code &openEc) {
+              return open_entry(disk, file, lockedProgress, w, openEc);
+            },
+            e);
+      },
+      ec);
+}
+
+} // namespace baulk::archive::msi
@@ -0,0 +1,74 @@
+//
+#ifndef BAULK_MSI_INTERNAL_HPP
+#define BAULK_MSI_INTERNAL_HPP
+#include <bela/types.hpp>
+#include <baulk/archive/msidb.hpp>
+#include <baulk/archive/cab.hpp>
+#include <span>
+#include <string>
+
+namespace baulk::archive::msi {
+// compound file
+constexpr uint8_t cfbSignature[] = {0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1};
+constexpr size_t cfbHeaderSize = 512;
+constexpr size_t cfbDirEntrySize = 128;
+constexpr size_t cfbHeaderDifatEntries = 109;
+constexpr uint32_t maxRegularSector = 0xFFFFFFFAU;
+constexpr uint32_t endOfChain = 0xFFFFFFFEU;
+
+// database
+constexpr uint16_t columnTypeValid = 0x0100;
+constexpr uint16_t columnTypeString = 0x0800;
+constexpr uint16_t columnTypeNullable = 0x1000;
+constexpr uint16_t columnTypeTemporary = 0x4000;
+constexpr uint32_t summaryWordCountCompressed = 0x02;
+constexpr uint32_t summaryPidWordCount = 15;
+
+// DecodeStreamName unpacks the names of database streams, two name characters are folded into one UTF-16 unit
+// in 0x3800..0x47FF, a single one in 0x4800..0x483F, and 0x4840 marks a table
+std::string DecodeStreamName(std::wstring_view name);
+
+// Table is a database table, values are stored column by column
+class Table {
+public:
+  struct Column {
+    std::string name;
+    uint16_t type{0};
+    size_t width{0};
+    size_t offset{0}; // of the column data in the table stream
+  };
+  bool Parse(std::vector<Column> &&columns_, std::vector<uint8_t> &&data_, size_t refSize, bela::error_code &ec);
+  [[nodiscard]] size_t Rows() const { return rows; }
+  // Lookup returns the column index or -1
+  [[nodiscard]] int Lookup(std::string_view name) const;
+  // Value returns the raw stored value, 0 is null, strings are string pool ids
+  [[nodiscard]] uint32_t Value(size_t row, int column) const;
+  // Integer returns the value of an integer column, the store biases them by 0x8000 or 0x80000000
+  [[nodiscard]] int32_t Integer(size_t row, int column) const;
+
+private:
+  std::vector<Column> columns;
+  std::vector<uint8_t> data;
+  size_t rows{0};
+};
+
+} // namespace baulk::archive::msi
+
+namespace baulk::archive::cab {
+constexpr uint8_t cabSignature[] = {'M', 'S', 'C', 'F'};
+constexpr size_t cabHeaderSize = 36;
+constexpr size_t cabFolderSize = 8;
+constexpr size_t cabFileSize = 16;
+constexpr size_t cabDataSize = 8;
+constexpr uint16_t cabFlagPrevCabinet = 0x0001;
+constexpr uint16_t cabFlagNextCabinet = 0x0002;
+constexpr uint16_t cabFlagReservePresent = 0x0004;
+constexpr uint16_t cabFolderContinued = 0xFFFD; // iFolder values of files spanning cabinets start here
+constexpr size_t cabMaxBlockSize = 32768 + 6144;
+constexpr size_t cabMaxUnpackBlockSize = 32768;
+
+// Checksum is the CFDATA checksum, the data is summed first and seeds the sum of the size fields
+uint32_t Checksum(const uint8_t *data, size_t len, uint32_t seed);
+} // namespace baulk::archive::cab
+
+#endif
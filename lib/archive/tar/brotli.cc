@@ -96,4 +96,13 @@ bool Reader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela
   return true;
 }
 
+std::span<const uint8_t> Reader::Peek(size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size() && !decompress(ec)) {
+    return {};
+  }
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void Reader::Consume(size_t n) { out.pos() += n; }
+
 } // namespace baulk::archive::tar::brotli
\ No newline at end of file
@@ -15,6 +15,8 @@ public:
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code &ec);
   bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
 
 private:
   bool decompress(bela::error_code &ec);
@@ -1,5 +1,6 @@
 //
 #include "bzip.hpp"
+#include <bela/endian.hpp>
 
 namespace baulk::archive::tar::bzip {
 Reader::~Reader() {
@@ -106,4 +107,424 @@ bool Reader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela
   return true;
 }
 
-} // namespace baulk::archive::tar::bzip
\ No newline at end of file
+std::span<const uint8_t> Reader::Peek(size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size() && !decompress(ec)) {
+    return {};
+  }
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void Reader::Consume(size_t n) { out.pos() += n; }
+
+constexpr uint64_t blockMagic = 0x314159265359ULL; // BCD pi
+constexpr uint64_t eosMagic = 0x177245385090ULL;   // BCD sqrt(pi)
+constexpr uint64_t magicMask = 0xFFFFFFFFFFFFULL;
+constexpr int64_t maxBlockSize = 2 * 1024 * 1024; // a block of 900k compresses to a little more in the worst case
+constexpr size_t scanChunkSize = 4 * 1024 * 1024;
+constexpr size_t streamChunkSize = 4 * 1024 * 1024;
+
+inline bool isStreamHeader(const uint8_t *p) { return p[0] == 'B' && p[1] == 'Z' && p[2] == 'h' && p[3] >= '1' && p[3] <= '9'; }
+
+// appendBits writes the count low bits of v most significant first at bit offset bits of p
+inline void appendBits(uint8_t *p, size_t &bits, uint64_t v, int count) {
+  for (auto i = count - 1; i >= 0; i--, bits++) {
+    auto mask = static_cast<uint8_t>(0x80 >> (bits % 8));
+    if (((v >> i) & 1) != 0) {
+      p[bits / 8] |= mask;
+      continue;
+    }
+    p[bits / 8] &= ~mask;
+  }
+}
+
+struct ParallelReader::block {
+  enum state_t : uint8_t { Pending, Finished, Partial, Failed };
+  ~block() { release(); }
+  void release() {
+    if (bzs != nullptr) {
+      BZ2_bzDecompressEnd(bzs);
+      baulk::mem::deallocate(bzs);
+      bzs = nullptr;
+    }
+  }
+  int64_t start{0}; // bit offset of the block magic
+  int64_t end{0};   // bit offset of the next candidate
+  size_t next{0};   // index of the candidate at end
+  uint32_t crc{0};  // block CRC from the block header
+  bz_stream *bzs{nullptr};
+  Buffer in;
+  Buffer out;
+  bela::error_code ec;
+  std::atomic_bool canceled{false};
+  state_t state{Pending};
+  bool finished{false};
+};
+
+ParallelReader::ParallelReader(FileReader *fr_, const ReaderOptions &opts) : fr(fr_) {
+  concurrency = opts.threads != 0 ? opts.threads : (std::max)(std::thread::hardware_concurrency(), 1U);
+  auto memlimit = opts.memlimit != 0 ? opts.memlimit : parallelMemlimit;
+  // at most two blocks per thread are decoded ahead of the reader
+  blockLimit = (std::max)(static_cast<size_t>(memlimit / (concurrency * 2)), static_cast<size_t>(1024 * 1024));
+}
+
+ParallelReader::~ParallelReader() {
+  {
+    std::scoped_lock lock(mu);
+    stopped = true;
+    for (auto &b : window) {
+      b->canceled = true;
+    }
+  }
+  cv.notify_all();
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+bool ParallelReader::Initialize(int64_t offset, bela::error_code &ec) {
+  if (size = fr->Size(ec); size == bela::SizeUnInitialized) {
+    return false;
+  }
+  fd = fr->NativeFD();
+  uint8_t header[4];
+  if (size - offset < static_cast<int64_t>(sizeof(header)) ||
+      !baulk::archive::ReadAt(fd, header, sizeof(header), offset, ec)) {
+    return false;
+  }
+  if (!isStreamHeader(header)) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"bzip2: bad stream header");
+    return false;
+  }
+  position = (offset + 4) * 8;
+  scanned = offset;
+  for (size_t i = 0; i < concurrency; i++) {
+    workers.emplace_back([this] { work(); });
+  }
+  return true;
+}
+
+// scan records every bit offset of the next chunk holding a block or end of stream magic, compressed data may contain
+// false positives
+bool ParallelReader::scan(bela::error_code &ec) {
+  Buffer chunk(scanChunkSize);
+  auto n = static_cast<size_t>((std::min)(static_cast<int64_t>(scanChunkSize), size - scanned));
+  if (!baulk::archive::ReadAt(fd, chunk.data(), n, scanned, ec)) {
+    return false;
+  }
+  const auto *p = chunk.data();
+  for (size_t i = 0; i < n; i++) {
+    shifted = (shifted << 8) | p[i];
+    auto bits = (scanned + static_cast<int64_t>(i) + 1) * 8;
+    for (auto s = 7; s >= 0; s--) {
+      auto v = (shifted >> s) & magicMask;
+      if (v == blockMagic || v == eosMagic) {
+        marks.emplace_back(mark{.bit = bits - s - 48, .eos = v == eosMagic});
+      }
+    }
+  }
+  scanned += static_cast<int64_t>(n);
+  return true;
+}
+
+// readBits copies len bytes starting at a bit offset, bytes after the end of the file read as zero
+bool ParallelReader::readBits(int64_t bit, uint8_t *out, size_t len, bela::error_code &ec) const {
+  auto first = bit / 8;
+  auto shift = static_cast<int>(bit % 8);
+  auto avail = static_cast<size_t>((std::clamp)(size - first, static_cast<int64_t>(0), static_cast<int64_t>(len)));
+  memset(out + avail, 0, len - avail);
+  if (avail != 0 && !baulk::archive::ReadAt(fd, out, avail, first, ec)) {
+    return false;
+  }
+  if (shift == 0) {
+    return true;
+  }
+  uint8_t last = 0;
+  if (first + static_cast<int64_t>(len) < size &&
+      !baulk::archive::ReadAt(fd, &last, 1, first + static_cast<int64_t>(len), ec)) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    auto following = i + 1 < len ? out[i + 1] : last;
+    out[i] = static_cast<uint8_t>((out[i] << shift) | (following >> (8 - shift)));
+  }
+  return true;
+}
+
+// decodeBlock appends the output of a block until it ends or holds limit bytes. The block is copied behind a stream
+// header and followed by an end of stream marker whose CRC is the block CRC, so libbzip2 checks the block on its own
+bool ParallelReader::decodeBlock(block &b, size_t limit, bela::error_code &ec) const {
+  if (b.bzs == nullptr) {
+    auto nbits = b.end - b.start;
+    if (nbits < 80) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"bzip2: truncated block");
+      return false;
+    }
+    auto nbytes = static_cast<size_t>((nbits + 7) / 8);
+    b.in.grow(4 + nbytes + 11);
+    // the largest block size only raises the limits libbzip2 checks the block against
+    memcpy(b.in.data(), "BZh9", 4);
+    if (!readBits(b.start, b.in.data() + 4, nbytes, ec)) {
+      return false;
+    }
+    b.crc = bela::cast_frombe<uint32_t>(b.in.data() + 10);
+    memset(b.in.data() + 4 + nbytes, 0, 11);
+    auto bits = static_cast<size_t>(32 + nbits);
+    appendBits(b.in.data(), bits, eosMagic, 48);
+    appendBits(b.in.data(), bits, b.crc, 32);
+    b.in.size() = (bits + 7) / 8;
+    b.bzs = baulk::mem::allocate<bz_stream>();
+    memset(b.bzs, 0, sizeof(bz_stream));
+    b.bzs->bzalloc = baulk::mem::allocate_bz;
+    b.bzs->bzfree = baulk::mem::deallocate_simple;
+    if (auto bzerr = BZ2_bzDecompressInit(b.bzs, 0, 0); bzerr != BZ_OK) {
+      baulk::mem::deallocate(b.bzs);
+      b.bzs = nullptr;
+      ec = bela::make_error_code(ErrExtractGeneral, L"BZ2_bzDecompressInit error");
+      return false;
+    }
+    b.bzs->next_in = reinterpret_cast<char *>(b.in.data());
+    b.bzs->avail_in = static_cast<uint32_t>(b.in.size());
+  }
+  auto bzs = b.bzs;
+  while (b.out.size() < limit) {
+    if (b.canceled) {
+      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+      return false;
+    }
+    if (b.out.size() == b.out.capacity()) {
+      b.out.grow((std::min)(limit, (std::max)(b.out.capacity() * 2, outsize)));
+    }
+    auto avail = (std::min)(b.out.capacity(), limit) - b.out.size();
+    bzs->next_out = reinterpret_cast<char *>(b.out.data() + b.out.size());
+    bzs->avail_out = static_cast<uint32_t>(avail);
+    auto ret = BZ2_bzDecompress(bzs);
+    b.out.size() += avail - bzs->avail_out;
+    if (ret == BZ_STREAM_END) {
+      b.finished = true;
+      b.release();
+      return true;
+    }
+    if (ret != BZ_OK) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"bzlib error ", ret);
+      return false;
+    }
+    if (bzs->avail_in == 0 && bzs->avail_out != 0) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"bzip2: truncated block");
+      return false;
+    }
+  }
+  return true;
+}
+
+// retryBlock extends a block that failed to decode to the following candidates, the candidates it spans were bytes
+// of the block that looked like a magic
+bool ParallelReader::retryBlock(block &b, bela::error_code &ec) {
+  auto err = std::move(b.ec);
+  for (auto i = b.next + 1; b.end < size * 8; i++) {
+    while (i >= marks.size() && scanned < size) {
+      if (!scan(ec)) {
+        return false;
+      }
+    }
+    auto end = i < marks.size() ? marks[i].bit : size * 8;
+    if (end - b.start > maxBlockSize * 8) {
+      break;
+    }
+    b.release();
+    b.out.pos() = 0;
+    b.out.size() = 0;
+    b.end = end;
+    b.next = i;
+    if (decodeBlock(b, blockLimit, ec)) {
+      return true;
+    }
+    err = std::move(ec);
+    ec.clear();
+  }
+  ec = std::move(err);
+  return false;
+}
+
+// endStream checks the combined CRC after the end of stream magic, another stream may follow at the next byte
+bool ParallelReader::endStream(bela::error_code &ec) {
+  uint8_t trailer[10];
+  if (!readBits(position, trailer, sizeof(trailer), ec)) {
+    return false;
+  }
+  if (bela::cast_frombe<uint32_t>(trailer + 6) != streamCRC) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"bzip2: stream CRC mismatch");
+    return false;
+  }
+  streamCRC = 0;
+  auto next = (position + 80 + 7) / 8;
+  uint8_t header[4];
+  if (size - next < static_cast<int64_t>(sizeof(header))) {
+    ended = true;
+    return true;
+  }
+  if (!baulk::archive::ReadAt(fd, header, sizeof(header), next, ec)) {
+    return false;
+  }
+  if (!isStreamHeader(header)) {
+    // like bzip2, bytes after the last stream are ignored
+    ended = true;
+    return true;
+  }
+  position = (next + 4) * 8;
+  return true;
+}
+
+void ParallelReader::work() {
+  for (;;) {
+    std::shared_ptr<block> b;
+    {
+      std::unique_lock lock(mu);
+      cv.wait(lock, [&] { return stopped || !tasks.empty(); });
+      if (stopped) {
+        return;
+      }
+      b = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    bela::error_code ec;
+    auto ok = decodeBlock(*b, blockLimit, ec);
+    {
+      std::scoped_lock lock(mu);
+      b->state = ok ? (b->finished ? block::Finished : block::Partial) : block::Failed;
+      b->ec = std::move(ec);
+    }
+    cv.notify_all();
+  }
+}
+
+// next makes current a block with unread output, at the end of the data it returns false and leaves ec empty
+bool ParallelReader::next(bela::error_code &ec) {
+  for (;;) {
+    if (current && current->out.pos() < current->out.size()) {
+      return true;
+    }
+    if (current && !current->finished) {
+      // the block outgrew its limit, decode the rest of it here
+      current->out.pos() = 0;
+      current->out.size() = 0;
+      if (!decodeBlock(*current, streamChunkSize, ec)) {
+        return false;
+      }
+      continue;
+    }
+    current.reset();
+    if (ended) {
+      return false;
+    }
+    while (cursor < marks.size() && marks[cursor].bit < position) {
+      cursor++;
+    }
+    // the block at cursor and the ones scheduled behind it need the candidate after them as their end
+    while (scanned < size && marks.size() < cursor + concurrency * 2 + 2) {
+      if (!scan(ec)) {
+        return false;
+      }
+    }
+    if (cursor == marks.size() || marks[cursor].bit != position) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"bzip2: block magic not found");
+      return false;
+    }
+    if (marks[cursor].eos) {
+      if (!endStream(ec)) {
+        return false;
+      }
+      continue;
+    }
+    scheduled = (std::max)(scheduled, cursor);
+    std::unique_lock lock(mu);
+    // candidates inside the blocks already returned were not magics
+    while (!window.empty() && window.front()->start < position) {
+      window.front()->canceled = true;
+      window.pop_front();
+    }
+    while (scheduled < marks.size() && window.size() < concurrency * 2) {
+      if (scheduled + 1 == marks.size() && scanned < size) {
+        break;
+      }
+      auto i = scheduled++;
+      if (marks[i].eos) {
+        continue;
+      }
+      auto b = std::make_shared<block>();
+      b->start = marks[i].bit;
+      b->next = i + 1;
+      b->end = i + 1 < marks.size() ? marks[i + 1].bit : size * 8;
+      window.emplace_back(b);
+      tasks.emplace_back(std::move(b));
+    }
+    cv.notify_all();
+    if (window.empty() || window.front()->start != position) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"bzip2: block magic not found");
+      return false;
+    }
+    auto b = std::move(window.front());
+    window.pop_front();
+    cv.wait(lock, [&] { return b->state != block::Pending; });
+    lock.unlock();
+    if (b->state == block::Failed && !retryBlock(*b, ec)) {
+      return false;
+    }
+    position = b->end;
+    streamCRC = ((streamCRC << 1) | (streamCRC >> 31)) ^ b->crc;
+    current = std::move(b);
+  }
+}
+
+ssize_t ParallelReader::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (!next(ec)) {
+    return ec ? -1 : 0;
+  }
+  auto &out = current->out;
+  auto minsize = (std::min)(len, out.size() - out.pos());
+  memcpy(buffer, out.data() + out.pos(), minsize);
+  out.pos() += minsize;
+  return static_cast<ssize_t>(minsize);
+}
+
+bool ParallelReader::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (!next(ec)) {
+      return false;
+    }
+    auto &out = current->out;
+    auto minsize = (std::min)(static_cast<size_t>(len), out.size() - out.pos());
+    out.pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+bool ParallelReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (!next(ec)) {
+      return false;
+    }
+    auto &out = current->out;
+    auto minsize = (std::min)(static_cast<size_t>(filesize), out.size() - out.pos());
+    auto p = out.data() + out.pos();
+    out.pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const uint8_t> ParallelReader::Peek(size_t len, bela::error_code &ec) {
+  if (!next(ec)) {
+    return {};
+  }
+  const auto &out = current->out;
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void ParallelReader::Consume(size_t n) { current->out.pos() += n; }
+
+} // namespace baulk::archive::tar::bzip
@@ -15,6 +15,8 @@ public:
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code &ec);
   bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
 
 private:
   bool decompress(bela::error_code &ec);
@@ -25,6 +27,57 @@ private:
   int64_t pickBytes{0};
   int ret{BZ_OK};
 };
+
+// ParallelReader decodes the blocks of bzip2 streams on a worker pool and returns their data in order. Blocks are not
+// byte aligned, they are found by scanning every bit offset for the block and end of stream magics, and each one is
+// rewrapped into a stream of its own so libbzip2 checks its CRC; the stream CRC is combined from the block CRCs here
+class ParallelReader : public ExtractReader {
+public:
+  ParallelReader(FileReader *fr_, const ReaderOptions &opts);
+  ParallelReader(const ParallelReader &) = delete;
+  ParallelReader &operator=(const ParallelReader &) = delete;
+  ~ParallelReader();
+  bool Initialize(int64_t offset, bela::error_code &ec);
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
+
+private:
+  struct mark {
+    int64_t bit{0}; // offset of the magic in bits
+    bool eos{false};
+  };
+  struct block;
+  bool scan(bela::error_code &ec);
+  bool readBits(int64_t bit, uint8_t *out, size_t len, bela::error_code &ec) const;
+  bool decodeBlock(block &b, size_t limit, bela::error_code &ec) const;
+  bool retryBlock(block &b, bela::error_code &ec);
+  bool endStream(bela::error_code &ec);
+  bool next(bela::error_code &ec);
+  void work();
+  FileReader *fr{nullptr};
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t size{0};
+  int64_t position{0}; // bit offset of the next magic to return
+  std::vector<mark> marks; // candidate magics, ascending
+  size_t cursor{0};        // first candidate at or after position
+  size_t scheduled{0};     // candidates handed to the pool
+  int64_t scanned{0};      // bytes scanned for candidates
+  uint64_t shifted{0};     // last bytes scanned
+  uint32_t streamCRC{0};   // combined CRC of the blocks returned from the current stream
+  std::deque<std::shared_ptr<block>> window; // scheduled blocks not yet returned, in file order
+  std::deque<std::shared_ptr<block>> tasks;
+  std::shared_ptr<block> current; // block whose output is being read
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<std::thread> workers;
+  size_t concurrency{1};
+  size_t blockLimit{0}; // output one block may hold before the reader streams the rest of it
+  bool stopped{false};
+  bool ended{false};
+};
 } // namespace baulk::archive::tar::bzip
 
 #endif
\ No newline at end of file
@@ -9,7 +9,31 @@
 
 namespace baulk::archive::tar {
 
-std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_format_t afmt, bela::error_code &ec) {
+std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_format_t afmt, const ReaderOptions &opts,
+                                          bela::error_code &ec) {
+  if (afmt == file_format_t::gz && opts.threads != 1) {
+    // multi-member files are inflated in parallel, a single member is inflated on the reading thread
+    if (auto r = std::make_shared<gzip::ParallelReader>(&fd, opts); r->Initialize(offset, ec)) {
+      return r;
+    }
+    ec.clear();
+  }
+  if (afmt == file_format_t::bz2 && opts.threads != 1) {
+    if (auto r = std::make_shared<bzip::ParallelReader>(&fd, opts); r->Initialize(offset, ec)) {
+      return r;
+    }
+    ec.clear();
+  }
+  if (afmt == file_format_t::zstd && opts.threads != 1) {
+    // zstd -T writes a single frame, only pzstd, seekable and concatenated outputs are decoded in parallel
+    if (auto size = fd.Size(ec); size != bela::SizeUnInitialized) {
+      if (auto r = std::make_shared<zstd::FrameReader>(fd.NativeFD(), size, opts);
+          r->Initialize(offset, ec) && r->Frames() > 1) {
+        return r;
+      }
+    }
+    ec.clear();
+  }
   if (!fd.Seek(offset, ec)) {
     return nullptr;
   }
@@ -30,7 +54,7 @@ std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_f
     }
     break;
   case file_format_t::xz:
-    if (auto r = std::make_shared<xz::Reader>(&fd); r->Initialize(ec)) {
+    if (auto r = std::make_shared<xz::Reader>(&fd, opts); r->Initialize(ec)) {
       return r;
     }
     break;
@@ -45,4 +69,22 @@ std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_f
   ec.code = ErrNoFilter;
   return nullptr;
 }
+
+std::shared_ptr<SeekableReader> MakeSeekableReader(FileReader &fd, int64_t offset, file_format_t afmt,
+                                                   const ReaderOptions &opts, bela::error_code &ec) {
+  if (afmt != file_format_t::zstd) {
+    ec = bela::make_error_code(ErrNoFilter, L"only zstd streams are seekable");
+    return nullptr;
+  }
+  auto size = fd.Size(ec);
+  if (size == bela::SizeUnInitialized) {
+    return nullptr;
+  }
+  // seeking and ContentSize need every frame
+  if (auto r = std::make_shared<zstd::FrameReader>(fd.NativeFD(), size, opts);
+      r->Initialize(offset, ec) && r->Walk(ec)) {
+    return r;
+  }
+  return nullptr;
+}
 } // namespace baulk::archive::tar
@@ -1,9 +1,34 @@
 ///
+#include <bit>
 #include <charconv>
 #include <utility>
 #include "tarinternal.hpp"
 
 namespace baulk::archive::tar {
+// headerSums sums the bytes of a header block as unsigned and as signed values with the checksum field counted as
+// spaces. The block is summed eight bytes at a time in 16-bit lanes, 64 words cannot overflow them, and the signed sum
+// is derived from the number of bytes with the high bit set
+inline void headerSums(const ustar_header &hdr, int64_t &check, int64_t &scheck) {
+  constexpr uint64_t lowBytes = 0x00ff00ff00ff00ffULL;
+  constexpr uint64_t highBits = 0x8080808080808080ULL;
+  auto p = reinterpret_cast<const uint8_t *>(&hdr);
+  uint64_t lanes = 0;
+  int negatives = 0;
+  for (size_t i = 0; i < sizeof(hdr); i += sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, p + i, sizeof(w));
+    lanes += (w & lowBytes) + ((w >> 8) & lowBytes);
+    negatives += std::popcount(w & highBits);
+  }
+  uint64_t field;
+  memcpy(&field, hdr.chksum, sizeof(field));
+  lanes -= (field & lowBytes) + ((field >> 8) & lowBytes);
+  negatives -= std::popcount(field & highBits);
+  lanes = (lanes & 0x0000ffff0000ffffULL) + ((lanes >> 16) & 0x0000ffff0000ffffULL);
+  check = static_cast<int64_t>((lanes & 0xffffffffULL) + (lanes >> 32)) + ' ' * sizeof(hdr.chksum);
+  scheck = check - 256 * static_cast<int64_t>(negatives);
+}
+
 inline bool IsChecksumEqual(const ustar_header &hdr) {
   /* Checksum field must hold an octal number */
   for (const auto c : hdr.chksum) {
@@ -18,15 +43,7 @@ inline bool IsChecksumEqual(const ustar_header &hdr) {
   auto sum = parseNumeric(hdr.chksum);
   int64_t check = 0;
   int64_t scheck = 0;
-  auto p = reinterpret_cast<const int8_t *>(&hdr);
-  for (int i = 0; i < 512; i++) {
-    auto c = p[i];
-    if (148 <= i && i < 156) {
-      c = ' '; // Treat the checksum field itself as all spaces.
-    }
-    check += static_cast<uint8_t>(c);
-    scheck += c;
-  }
+  headerSums(hdr, check, scheck);
   return (check == sum || scheck == sum);
 }
 
@@ -46,6 +63,45 @@ tar_format_t getFormat(const ustar_header &hdr) {
   }
   return FormatV7;
 }
+bool ParseHeaderView(const ustar_header &hdr, HeaderView &hv) {
+  hv = HeaderView{};
+  if (hv.Format = getFormat(hdr); hv.Format == FormatUnknown) {
+    return false;
+  }
+  hv.Typeflag = hdr.typeflag;
+  hv.Name = parseStringView(hdr.name);
+  hv.LinkName = parseStringView(hdr.linkname);
+  hv.Size = parseNumeric(hdr.size);
+  hv.Mode = parseNumeric(hdr.mode);
+  hv.UID = static_cast<int>(parseNumeric(hdr.uid));
+  hv.GID = static_cast<int>(parseNumeric(hdr.gid));
+  hv.ModTime = bela::FromUnix(parseNumeric(hdr.mtime), 0);
+  if (hv.Format <= FormatV7) {
+    return true;
+  }
+  hv.Uname = parseStringView(hdr.uname);
+  hv.Gname = parseStringView(hdr.gname);
+  hv.Devmajor = parseNumeric(hdr.devmajor);
+  hv.Devminor = parseNumeric(hdr.devminor);
+  if ((hv.Format & (FormatUSTAR | FormatPAX)) != 0) {
+    hv.Prefix = parseStringView(hdr.prefix);
+  } else if ((hv.Format & FormatSTAR) != 0) {
+    auto star = reinterpret_cast<const star_header *>(&hdr);
+    hv.Prefix = parseStringView(star->prefix);
+    hv.AccessTime = bela::FromUnix(parseNumeric(star->atime), 0);
+    hv.ChangeTime = bela::FromUnix(parseNumeric(star->ctime), 0);
+  } else if ((hv.Format & FormatGNU) != 0) {
+    auto gnu = reinterpret_cast<const gnutar_header *>(&hdr);
+    if (gnu->atime[0] != 0) {
+      hv.AccessTime = bela::FromUnix(parseNumeric(gnu->atime), 0);
+    }
+    if (gnu->ctime[0] != 0) {
+      hv.ChangeTime = bela::FromUnix(parseNumeric(gnu->ctime), 0);
+    }
+  }
+  return true;
+}
+
 /*
  * Parse a base-256 integer.  This is just a variable-length
  * twos-complement signed binary value in big-endian order, except
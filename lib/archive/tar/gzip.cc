@@ -1,5 +1,6 @@
 //
 #include "gzip.hpp"
+#include <bela/endian.hpp>
 
 namespace baulk::archive::tar::gzip {
 
@@ -25,7 +26,8 @@ bool Reader::Initialize(bela::error_code &ec) {
 
 bool Reader::decompress(bela::error_code &ec) {
   for (;;) {
-    if (zs->avail_out != 0 || pickBytes == 0) {
+    // input left over after the end of a member belongs to the next one
+    if (zs->avail_in == 0 && (zs->avail_out != 0 || pickBytes == 0)) {
       auto n = r->Read(in.data(), in.capacity(), ec);
       if (n <= 0) {
         return false;
@@ -46,6 +48,10 @@ bool Reader::decompress(bela::error_code &ec) {
     case Z_MEM_ERROR:
       ec = bela::make_error_code(ErrExtractGeneral, bela::encode_into<char, wchar_t>(zng_zError(ret)));
       return false;
+    case Z_STREAM_END:
+      // concatenated members form a single stream (RFC 1952 2.2)
+      zng_inflateReset(zs);
+      break;
     default:
       break;
     }
@@ -107,4 +113,351 @@ bool Reader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela
   return true;
 }
 
-} // namespace baulk::archive::tar::gzip
\ No newline at end of file
+std::span<const uint8_t> Reader::Peek(size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size() && !decompress(ec)) {
+    return {};
+  }
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void Reader::Consume(size_t n) { out.pos() += n; }
+
+constexpr uint8_t gzipMagic[] = {0x1f, 0x8b, 0x08};
+constexpr uint8_t gzipFlagExtra = 0x04;
+constexpr uint8_t gzipFlagReserved = 0xE0;
+constexpr size_t bgzfHeaderSize = 18;
+constexpr size_t scanChunkSize = 4 * 1024 * 1024;
+constexpr size_t streamChunkSize = 4 * 1024 * 1024;
+
+// BGZF members carry their compressed size in a 'BC' extra subfield, see the SAM/BAM specification 4.1
+inline bool isBGZF(const uint8_t *header) {
+  return memcmp(header, gzipMagic, sizeof(gzipMagic)) == 0 && (header[3] & gzipFlagExtra) != 0 &&
+         bela::cast_fromle<uint16_t>(header + 10) == 6 && header[12] == 'B' && header[13] == 'C' &&
+         bela::cast_fromle<uint16_t>(header + 14) == 2;
+}
+
+struct ParallelReader::member {
+  enum state_t : uint8_t { Pending, Finished, Partial, Failed };
+  ~member() {
+    if (zs != nullptr) {
+      zng_inflateEnd(zs);
+      baulk::mem::deallocate(zs);
+    }
+  }
+  int64_t start{0};
+  int64_t end{0};   // offset after the trailer
+  int64_t inpos{0}; // next compressed byte to read
+  zng_stream *zs{nullptr};
+  Buffer in;
+  Buffer out;
+  bela::error_code ec;
+  std::atomic_bool canceled{false};
+  state_t state{Pending};
+  bool finished{false};
+};
+
+ParallelReader::ParallelReader(FileReader *fr_, const ReaderOptions &opts) : fr(fr_) {
+  concurrency = opts.threads != 0 ? opts.threads : (std::max)(std::thread::hardware_concurrency(), 1U);
+  auto memlimit = opts.memlimit != 0 ? opts.memlimit : parallelMemlimit;
+  // at most two members per thread are decoded ahead of the reader
+  memberLimit = (std::max)(static_cast<size_t>(memlimit / (concurrency * 2)), static_cast<size_t>(1024 * 1024));
+}
+
+ParallelReader::~ParallelReader() {
+  {
+    std::scoped_lock lock(mu);
+    stopped = true;
+    for (auto &m : window) {
+      m->canceled = true;
+    }
+  }
+  cv.notify_all();
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+// scan records the next member offsets. BGZF blocks are followed by their sizes, otherwise every offset of the next
+// chunk that looks like a member header is recorded, compressed data may contain false positives
+bool ParallelReader::scan(bela::error_code &ec) {
+  if (bgzf) {
+    uint8_t header[bgzfHeaderSize];
+    if (size - scanned >= static_cast<int64_t>(bgzfHeaderSize)) {
+      if (!baulk::archive::ReadAt(fd, header, sizeof(header), scanned, ec)) {
+        return false;
+      }
+      if (isBGZF(header)) {
+        starts.emplace_back(scanned);
+        scanned += static_cast<int64_t>(bela::cast_fromle<uint16_t>(header + 16)) + 1;
+        return true;
+      }
+    }
+    // not a BGZF block, members appended by other tools are looked for by their headers
+    bgzf = false;
+  }
+  Buffer chunk(scanChunkSize);
+  auto n = static_cast<size_t>((std::min)(static_cast<int64_t>(scanChunkSize), size - scanned));
+  if (!baulk::archive::ReadAt(fd, chunk.data(), n, scanned, ec)) {
+    return false;
+  }
+  const auto *p = chunk.data();
+  for (size_t i = 0; i + sizeof(gzipMagic) < n;) {
+    auto q = reinterpret_cast<const uint8_t *>(memchr(p + i, gzipMagic[0], n - sizeof(gzipMagic) - i));
+    if (q == nullptr) {
+      break;
+    }
+    i = static_cast<size_t>(q - p);
+    if (q[1] == gzipMagic[1] && q[2] == gzipMagic[2] && (q[3] & gzipFlagReserved) == 0) {
+      starts.emplace_back(scanned + static_cast<int64_t>(i));
+    }
+    i++;
+  }
+  if (scanned + static_cast<int64_t>(n) == size) {
+    scanned = size;
+    return true;
+  }
+  // the last bytes of the chunk are scanned again as the start of the next one
+  scanned += static_cast<int64_t>(n - sizeof(gzipMagic));
+  return true;
+}
+
+bool ParallelReader::Initialize(int64_t offset, bela::error_code &ec) {
+  if (size = fr->Size(ec); size == bela::SizeUnInitialized) {
+    return false;
+  }
+  fd = fr->NativeFD();
+  uint8_t header[bgzfHeaderSize];
+  if (size - offset < static_cast<int64_t>(sizeof(header)) ||
+      !baulk::archive::ReadAt(fd, header, sizeof(header), offset, ec) ||
+      memcmp(header, gzipMagic, sizeof(gzipMagic)) != 0) {
+    return false;
+  }
+  bgzf = isBGZF(header);
+  // the first member is inflated on the reading thread, later members are only looked for and handed to the pool
+  // once it ends before the end of the file
+  current = std::make_shared<member>();
+  current->start = offset;
+  position = offset;
+  scanned = offset;
+  return true;
+}
+
+// inflateMember appends the output of a member until it ends or holds limit bytes, the gzip wrapper of zlib-ng
+// checks the CRC-32 and ISIZE of the trailer
+bool ParallelReader::inflateMember(member &m, size_t limit, bela::error_code &ec) const {
+  if (m.zs == nullptr) {
+    m.zs = baulk::mem::allocate<zng_stream>();
+    memset(m.zs, 0, sizeof(zng_stream));
+    m.zs->zalloc = baulk::mem::allocate_zlib;
+    m.zs->zfree = baulk::mem::deallocate_simple;
+    if (auto zerr = zng_inflateInit2(m.zs, MAX_WBITS + 16); zerr != Z_OK) {
+      baulk::mem::deallocate(m.zs);
+      m.zs = nullptr;
+      ec = bela::make_error_code(ErrExtractGeneral, bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+      return false;
+    }
+    m.in.grow(insize * 8);
+    m.inpos = m.start;
+  }
+  auto zs = m.zs;
+  while (m.out.size() < limit) {
+    if (m.canceled) {
+      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+      return false;
+    }
+    if (m.out.size() == m.out.capacity()) {
+      m.out.grow((std::min)(limit, (std::max)(m.out.capacity() * 2, outsize)));
+    }
+    if (zs->avail_in == 0) {
+      if (m.inpos >= size) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"gzip: unexpected end of member");
+        return false;
+      }
+      auto n = static_cast<size_t>((std::min)(static_cast<int64_t>(m.in.capacity()), size - m.inpos));
+      if (!baulk::archive::ReadAt(fd, m.in.data(), n, m.inpos, ec)) {
+        return false;
+      }
+      m.inpos += static_cast<int64_t>(n);
+      zs->next_in = m.in.data();
+      zs->avail_in = static_cast<uint32_t>(n);
+    }
+    auto avail = (std::min)(m.out.capacity(), limit) - m.out.size();
+    zs->next_out = m.out.data() + m.out.size();
+    zs->avail_out = static_cast<uint32_t>(avail);
+    auto ret = ::zng_inflate(zs, Z_NO_FLUSH);
+    m.out.size() += avail - zs->avail_out;
+    switch (ret) {
+    case Z_STREAM_END:
+      m.end = m.inpos - static_cast<int64_t>(zs->avail_in);
+      m.finished = true;
+      return true;
+    case Z_NEED_DICT:
+      ret = Z_DATA_ERROR;
+      [[fallthrough]];
+    case Z_DATA_ERROR:
+      [[fallthrough]];
+    case Z_MEM_ERROR:
+      ec = bela::make_error_code(ErrExtractGeneral, bela::encode_into<char, wchar_t>(zng_zError(ret)));
+      return false;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+void ParallelReader::work() {
+  for (;;) {
+    std::shared_ptr<member> m;
+    {
+      std::unique_lock lock(mu);
+      cv.wait(lock, [&] { return stopped || !tasks.empty(); });
+      if (stopped) {
+        return;
+      }
+      m = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    bela::error_code ec;
+    auto ok = inflateMember(*m, memberLimit, ec);
+    {
+      std::scoped_lock lock(mu);
+      m->state = ok ? (m->finished ? member::Finished : member::Partial) : member::Failed;
+      m->ec = std::move(ec);
+    }
+    cv.notify_all();
+  }
+}
+
+// next makes current a member with unread output, at the end of the stream it returns false and leaves ec empty
+bool ParallelReader::next(bela::error_code &ec) {
+  for (;;) {
+    if (current && current->out.pos() < current->out.size()) {
+      return true;
+    }
+    if (current && !current->finished) {
+      // the first member, or one that outgrew its limit, is inflated here
+      current->out.pos() = 0;
+      current->out.size() = 0;
+      if (!inflateMember(*current, streamChunkSize, ec)) {
+        return false;
+      }
+      if (current->finished) {
+        position = current->end;
+      }
+      continue;
+    }
+    current.reset();
+    if (position >= size) {
+      return false;
+    }
+    while (scheduled < starts.size() && starts[scheduled] < position) {
+      scheduled++;
+    }
+    if (scheduled == starts.size() && scanned <= position) {
+      // like gzip, bytes after the last member are ignored, they are not scanned either
+      uint8_t magic[sizeof(gzipMagic)];
+      if (size - position < static_cast<int64_t>(sizeof(magic))) {
+        return false;
+      }
+      if (!baulk::archive::ReadAt(fd, magic, sizeof(magic), position, ec)) {
+        return false;
+      }
+      if (memcmp(magic, gzipMagic, sizeof(magic)) != 0) {
+        return false;
+      }
+      scanned = position;
+    }
+    while (scanned < size && starts.size() < scheduled + concurrency * 2) {
+      if (!scan(ec)) {
+        return false;
+      }
+    }
+    if (workers.empty()) {
+      for (size_t i = 0; i < concurrency; i++) {
+        workers.emplace_back([this] { work(); });
+      }
+    }
+    std::unique_lock lock(mu);
+    // candidates inside the members already returned were not headers
+    while (!window.empty() && window.front()->start < position) {
+      window.front()->canceled = true;
+      window.pop_front();
+    }
+    while (scheduled < starts.size() && window.size() < concurrency * 2) {
+      auto m = std::make_shared<member>();
+      m->start = starts[scheduled++];
+      window.emplace_back(m);
+      tasks.emplace_back(std::move(m));
+    }
+    cv.notify_all();
+    if (window.empty() || window.front()->start != position) {
+      return false;
+    }
+    auto m = std::move(window.front());
+    window.pop_front();
+    cv.wait(lock, [&] { return m->state != member::Pending; });
+    if (m->state == member::Failed) {
+      ec = m->ec;
+      return false;
+    }
+    if (m->finished) {
+      position = m->end;
+    }
+    current = std::move(m);
+  }
+}
+
+ssize_t ParallelReader::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (!next(ec)) {
+    return ec ? -1 : 0;
+  }
+  auto &out = current->out;
+  auto minsize = (std::min)(len, out.size() - out.pos());
+  memcpy(buffer, out.data() + out.pos(), minsize);
+  out.pos() += minsize;
+  return static_cast<ssize_t>(minsize);
+}
+
+bool ParallelReader::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (!next(ec)) {
+      return false;
+    }
+    auto &out = current->out;
+    auto minsize = (std::min)(static_cast<size_t>(len), out.size() - out.pos());
+    out.pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+bool ParallelReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (!next(ec)) {
+      return false;
+    }
+    auto &out = current->out;
+    auto minsize = (std::min)(static_cast<size_t>(filesize), out.size() - out.pos());
+    auto p = out.data() + out.pos();
+    out.pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const uint8_t> ParallelReader::Peek(size_t len, bela::error_code &ec) {
+  if (!next(ec)) {
+    return {};
+  }
+  const auto &out = current->out;
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void ParallelReader::Consume(size_t n) { current->out.pos() += n; }
+
+} // namespace baulk::archive::tar::gzip
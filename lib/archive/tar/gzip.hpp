@@ -14,7 +14,9 @@ public:
   bool Initialize(bela::error_code &ec);
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code &ec);
-  bool WriteTo(const Writer &w, int64_t filesize,int64_t &extracted,  bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
 
 private:
   bool decompress(bela::error_code &ec);
@@ -24,6 +26,49 @@ private:
   Buffer in;
   int64_t pickBytes{0};
 };
+
+// ParallelReader inflates the members of a multi-member gzip file (bgzip, pigz outputs joined by release scripts) on
+// a worker pool and returns their data in order. The first member is inflated on the reading thread, a file made of
+// one member never starts the pool. Later members are found from BGZF block sizes, or by decoding the offsets that
+// look like member headers speculatively; only members starting where the previous one ended are used
+class ParallelReader : public ExtractReader {
+public:
+  ParallelReader(FileReader *fr_, const ReaderOptions &opts);
+  ParallelReader(const ParallelReader &) = delete;
+  ParallelReader &operator=(const ParallelReader &) = delete;
+  ~ParallelReader();
+  // Initialize checks the header of the first member, it returns false when offset does not hold one
+  bool Initialize(int64_t offset, bela::error_code &ec);
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
+
+private:
+  struct member;
+  bool scan(bela::error_code &ec);
+  bool inflateMember(member &m, size_t limit, bela::error_code &ec) const;
+  bool next(bela::error_code &ec);
+  void work();
+  FileReader *fr{nullptr};
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t size{0};
+  int64_t position{0};           // compressed offset of the next member to return
+  int64_t scanned{0};            // offset where scan resumes
+  std::vector<int64_t> starts;   // candidate member offsets, ascending
+  size_t scheduled{0};           // candidates handed to the pool
+  std::deque<std::shared_ptr<member>> window; // scheduled candidates not yet returned, in file order
+  std::deque<std::shared_ptr<member>> tasks;
+  std::shared_ptr<member> current; // member whose output is being read
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<std::thread> workers;
+  size_t concurrency{1};
+  size_t memberLimit{0}; // output one speculative member may hold before the reader streams the rest of it
+  bool bgzf{false}; // members are BGZF blocks, scan follows their sizes
+  bool stopped{false};
+};
 } // namespace baulk::archive::tar::gzip
 
 #endif
\ No newline at end of file
@@ -0,0 +1,828 @@
+//
+#ifndef LZMA_API_STATIC
+#define LZMA_API_STATIC 1
+#endif
+#include "tarinternal.hpp"
+#include <bela/endian.hpp>
+#include "gzip.hpp"
+#include "xz.hpp"
+#include "zstd.hpp"
+
+namespace baulk::archive::tar {
+constexpr uint32_t indexMagic = 0x58444954; // TIDX
+constexpr uint32_t indexVersion = 2;
+constexpr uint64_t indexMaxSize = 1024ULL * 1024 * 1024;
+constexpr int64_t inflateSpan = 4 * 1024 * 1024; // output between two gzip checkpoints
+constexpr size_t inflateWindow = 32768;
+constexpr size_t xzinsize = 256 * 1024;
+constexpr size_t xzoutsize = 256 * 1024;
+
+static lzma_allocator allocator{                                  // allocator
+                                .alloc = baulk::mem::allocate_xz, //
+                                .free = baulk::mem::deallocate_simple,
+                                .opaque = nullptr};
+
+// counter passes the tar stream through and counts the bytes consumed
+class counter : public ExtractReader {
+public:
+  counter(ExtractReader *r_) : r(r_) {}
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) {
+    auto n = r->Read(buffer, len, ec);
+    if (n > 0) {
+      position += n;
+    }
+    return n;
+  }
+  bool Discard(int64_t len, bela::error_code &ec) {
+    if (!r->Discard(len, ec)) {
+      return false;
+    }
+    position += len;
+    return true;
+  }
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+    int64_t n = 0;
+    auto ok = r->WriteTo(w, filesize, n, ec);
+    position += n;
+    extracted += n;
+    return ok;
+  }
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec) { return r->Peek(len, ec); }
+  void Consume(size_t n) {
+    r->Consume(n);
+    position += static_cast<int64_t>(n);
+  }
+  [[nodiscard]] int64_t Position() const { return position; }
+
+private:
+  ExtractReader *r{nullptr};
+  int64_t position{0};
+};
+
+// inflateReader inflates gzip members from a checkpoint, a checkpoint inside a member restarts a raw deflate stream
+// primed with its bits and window. When points is set the reader stops at every deflate block and records a
+// checkpoint once inflateSpan bytes were produced since the last one
+class inflateReader : public ExtractReader {
+public:
+  inflateReader(FileReader *fd_, std::vector<Checkpoint> *points_) : fd(fd_), points(points_) {}
+  inflateReader(const inflateReader &) = delete;
+  inflateReader &operator=(const inflateReader &) = delete;
+  ~inflateReader() {
+    if (zs != nullptr) {
+      zng_inflateEnd(zs);
+      baulk::mem::deallocate(zs);
+    }
+  }
+  bool Initialize(const Checkpoint &cp, bela::error_code &ec);
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
+
+private:
+  bool decompress(bela::error_code &ec);
+  void checkpoint();
+  FileReader *fd{nullptr};
+  std::vector<Checkpoint> *points{nullptr};
+  zng_stream *zs{nullptr};
+  Buffer out;
+  Buffer in;
+  int64_t produced{0}; // tar stream offset of the end of out
+  int64_t trailer{0};  // trailer bytes of the member left to skip after a raw stream
+  bool raw{false};
+};
+
+bool inflateReader::Initialize(const Checkpoint &cp, bela::error_code &ec) {
+  zs = baulk::mem::allocate<zng_stream>();
+  memset(zs, 0, sizeof(zng_stream));
+  zs->zalloc = baulk::mem::allocate_zlib;
+  zs->zfree = baulk::mem::deallocate_simple;
+  raw = cp.out != 0;
+  if (auto zerr = zng_inflateInit2(zs, raw ? -MAX_WBITS : MAX_WBITS + 16); zerr != Z_OK) {
+    ec = bela::make_error_code(ErrExtractGeneral, bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+    return false;
+  }
+  out.grow(outsize);
+  in.grow(insize);
+  produced = cp.out;
+  if (!fd->Seek(cp.bits != 0 ? cp.in - 1 : cp.in, ec)) {
+    return false;
+  }
+  if (!raw) {
+    return true;
+  }
+  if (cp.bits != 0) {
+    uint8_t c = 0;
+    if (fd->Read(&c, 1, ec) != 1) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"gzip checkpoint beyond the end of file");
+      return false;
+    }
+    zng_inflatePrime(zs, cp.bits, c >> (8 - cp.bits));
+  }
+  if (auto zerr = zng_inflateSetDictionary(zs, reinterpret_cast<const uint8_t *>(cp.window.data()),
+                                           static_cast<uint32_t>(cp.window.size()));
+      zerr != Z_OK) {
+    ec = bela::make_error_code(ErrExtractGeneral, bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+    return false;
+  }
+  return true;
+}
+
+// checkpoint records where the next deflate block starts, data_type holds the unread bits of the last byte read
+void inflateReader::checkpoint() {
+  if (points->empty() || produced - points->back().out < inflateSpan) {
+    return;
+  }
+  Checkpoint cp{.in = fd->Position() - zs->avail_in, .out = produced, .bits = zs->data_type & 7};
+  cp.window.resize(inflateWindow);
+  uint32_t len = static_cast<uint32_t>(inflateWindow);
+  zng_inflateGetDictionary(zs, reinterpret_cast<uint8_t *>(cp.window.data()), &len);
+  cp.window.resize(len);
+  points->emplace_back(std::move(cp));
+}
+
+bool inflateReader::decompress(bela::error_code &ec) {
+  for (;;) {
+    if (zs->avail_in == 0) {
+      auto n = fd->Read(in.data(), in.capacity(), ec);
+      if (n <= 0) {
+        return false;
+      }
+      zs->next_in = in.data();
+      zs->avail_in = static_cast<uint32_t>(n);
+    }
+    if (trailer != 0) {
+      auto n = (std::min)(trailer, static_cast<int64_t>(zs->avail_in));
+      zs->next_in += n;
+      zs->avail_in -= static_cast<uint32_t>(n);
+      if (trailer -= n; trailer == 0) {
+        // the next member starts with a gzip header again
+        zng_inflateReset2(zs, MAX_WBITS + 16);
+        raw = false;
+      }
+      continue;
+    }
+    zs->avail_out = static_cast<uint32_t>(outsize);
+    zs->next_out = out.data();
+    auto ret = ::zng_inflate(zs, points != nullptr ? Z_BLOCK : Z_NO_FLUSH);
+    switch (ret) {
+    case Z_NEED_DICT:
+      ret = Z_DATA_ERROR;
+      [[fallthrough]];
+    case Z_DATA_ERROR:
+      [[fallthrough]];
+    case Z_MEM_ERROR:
+      ec = bela::make_error_code(ErrExtractGeneral, bela::encode_into<char, wchar_t>(zng_zError(ret)));
+      return false;
+    default:
+      break;
+    }
+    auto have = outsize - zs->avail_out;
+    produced += static_cast<int64_t>(have);
+    if (ret == Z_STREAM_END) {
+      if (raw) {
+        trailer = 8;
+      } else {
+        zng_inflateReset(zs);
+      }
+    } else if (points != nullptr && (zs->data_type & 0xC0) == 0x80) {
+      // end of a block which is not the last one of the member
+      checkpoint();
+    }
+    if (have != 0) {
+      out.pos() = 0;
+      out.size() = have;
+      return true;
+    }
+  }
+}
+
+ssize_t inflateReader::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size()) {
+    if (!decompress(ec)) {
+      return -1;
+    }
+  }
+  auto minsize = (std::min)(len, out.size() - out.pos());
+  memcpy(buffer, out.data() + out.pos(), minsize);
+  out.pos() += minsize;
+  return static_cast<ssize_t>(minsize);
+}
+
+bool inflateReader::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (out.pos() == out.size()) {
+      if (!decompress(ec)) {
+        return false;
+      }
+    }
+    auto minsize = (std::min)(static_cast<size_t>(len), out.size() - out.pos());
+    out.pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+bool inflateReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (out.pos() == out.size()) {
+      if (!decompress(ec)) {
+        return false;
+      }
+    }
+    auto minsize = (std::min)(static_cast<size_t>(filesize), out.size() - out.pos());
+    auto p = out.data() + out.pos();
+    out.pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const uint8_t> inflateReader::Peek(size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size() && !decompress(ec)) {
+    return {};
+  }
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void inflateReader::Consume(size_t n) { out.pos() += n; }
+
+// blockReader decodes xz blocks from the checkpoint of a block to the end of the file, a block ends where the next
+// checkpoint starts so the indexes and stream headers between them are never parsed
+class blockReader : public ExtractReader {
+public:
+  blockReader(FileReader *fd_, const std::vector<Checkpoint> &points_, size_t block_)
+      : fd(fd_), points(points_), block(block_) {}
+  blockReader(const blockReader &) = delete;
+  blockReader &operator=(const blockReader &) = delete;
+  ~blockReader() {
+    if (xzs != nullptr) {
+      lzma_end(xzs);
+      baulk::mem::deallocate(xzs);
+    }
+  }
+  bool Initialize(bela::error_code &ec);
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
+
+private:
+  bool startBlock(bela::error_code &ec);
+  bool decompress(bela::error_code &ec);
+  FileReader *fd{nullptr};
+  const std::vector<Checkpoint> &points;
+  size_t block{0};
+  lzma_stream *xzs{nullptr};
+  Buffer out;
+  Buffer in;
+  bool started{false};
+};
+
+bool blockReader::Initialize(bela::error_code &ec) {
+  xzs = baulk::mem::allocate<lzma_stream>();
+  memset(xzs, 0, sizeof(lzma_stream));
+  xzs->allocator = &allocator;
+  out.grow(xzoutsize);
+  in.grow(xzinsize);
+  return true;
+}
+
+bool blockReader::startBlock(bela::error_code &ec) {
+  const auto &cp = points[block];
+  if (!fd->Seek(cp.in, ec)) {
+    return false;
+  }
+  uint8_t header[LZMA_BLOCK_HEADER_SIZE_MAX];
+  if (fd->Read(header, 1, ec) != 1 || header[0] == 0) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"xz checkpoint is not a block header");
+    return false;
+  }
+  lzma_filter filters[LZMA_FILTERS_MAX + 1];
+  lzma_block b{};
+  b.version = 1;
+  b.check = static_cast<lzma_check>(cp.bits);
+  b.header_size = lzma_block_header_size_decode(header[0]);
+  b.filters = filters;
+  size_t got = 1;
+  while (got < b.header_size) {
+    auto n = fd->Read(header + got, b.header_size - got, ec);
+    if (n <= 0) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"xz block header truncated");
+      return false;
+    }
+    got += static_cast<size_t>(n);
+  }
+  if (auto ret = lzma_block_header_decode(&b, &allocator, header); ret != LZMA_OK) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"lzma_block_header_decode error ", static_cast<int>(ret));
+    return false;
+  }
+  // the decoder copies the filter options it needs
+  auto ret = lzma_block_decoder(xzs, &b);
+  lzma_filters_free(filters, &allocator);
+  if (ret != LZMA_OK) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"lzma_block_decoder error ", static_cast<int>(ret));
+    return false;
+  }
+  xzs->avail_in = 0;
+  started = true;
+  return true;
+}
+
+bool blockReader::decompress(bela::error_code &ec) {
+  for (;;) {
+    if (!started) {
+      if (block == points.size()) {
+        return false;
+      }
+      if (!startBlock(ec)) {
+        return false;
+      }
+    }
+    if (xzs->avail_in == 0) {
+      auto n = fd->Read(in.data(), in.capacity(), ec);
+      if (n <= 0) {
+        if (n == 0) {
+          ec = bela::make_error_code(ErrExtractGeneral, L"xz block truncated");
+        }
+        return false;
+      }
+      xzs->next_in = in.data();
+      xzs->avail_in = static_cast<size_t>(n);
+    }
+    xzs->next_out = out.data();
+    xzs->avail_out = xzoutsize;
+    auto ret = lzma_code(xzs, LZMA_RUN);
+    if (ret == LZMA_STREAM_END) {
+      block++;
+      started = false;
+    } else if (ret != LZMA_OK) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"xz block decode error ", static_cast<int>(ret));
+      return false;
+    }
+    if (auto have = xzoutsize - xzs->avail_out; have != 0) {
+      out.pos() = 0;
+      out.size() = have;
+      return true;
+    }
+  }
+}
+
+ssize_t blockReader::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size()) {
+    if (!decompress(ec)) {
+      return -1;
+    }
+  }
+  auto minsize = (std::min)(len, out.size() - out.pos());
+  memcpy(buffer, out.data() + out.pos(), minsize);
+  out.pos() += minsize;
+  return static_cast<ssize_t>(minsize);
+}
+
+bool blockReader::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (out.pos() == out.size()) {
+      if (!decompress(ec)) {
+        return false;
+      }
+    }
+    auto minsize = (std::min)(static_cast<size_t>(len), out.size() - out.pos());
+    out.pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+bool blockReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (out.pos() == out.size()) {
+      if (!decompress(ec)) {
+        return false;
+      }
+    }
+    auto minsize = (std::min)(static_cast<size_t>(filesize), out.size() - out.pos());
+    auto p = out.data() + out.pos();
+    out.pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const uint8_t> blockReader::Peek(size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size() && !decompress(ec)) {
+    return {};
+  }
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void blockReader::Consume(size_t n) { out.pos() += n; }
+
+// xzBlocks reads the indexes of the xz streams in [offset, size) and adds a checkpoint for every block
+bool xzBlocks(FileReader &fd, int64_t offset, int64_t size, std::vector<Checkpoint> &points, bela::error_code &ec) {
+  lzma_stream xzs = LZMA_STREAM_INIT;
+  xzs.allocator = &allocator;
+  lzma_index *idx = nullptr;
+  auto closer = bela::finally([&] {
+    lzma_end(&xzs);
+    if (idx != nullptr) {
+      lzma_index_end(idx, &allocator);
+    }
+  });
+  if (auto ret = lzma_file_info_decoder(&xzs, &idx, UINT64_MAX, static_cast<uint64_t>(size - offset));
+      ret != LZMA_OK) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"lzma_file_info_decoder error ", static_cast<int>(ret));
+    return false;
+  }
+  Buffer buffer(xzinsize);
+  auto pos = offset;
+  for (;;) {
+    if (xzs.avail_in == 0) {
+      auto n = (std::min)(static_cast<int64_t>(buffer.capacity()), size - pos);
+      if (!ReadAt(fd.NativeFD(), buffer.data(), static_cast<size_t>(n), pos, ec)) {
+        return false;
+      }
+      pos += n;
+      xzs.next_in = buffer.data();
+      xzs.avail_in = static_cast<size_t>(n);
+    }
+    auto ret = lzma_code(&xzs, LZMA_RUN);
+    if (ret == LZMA_STREAM_END) {
+      break;
+    }
+    if (ret == LZMA_SEEK_NEEDED) {
+      pos = offset + static_cast<int64_t>(xzs.seek_pos);
+      xzs.avail_in = 0;
+      continue;
+    }
+    if (ret != LZMA_OK) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"xz file info error ", static_cast<int>(ret));
+      return false;
+    }
+  }
+  lzma_index_iter iter;
+  lzma_index_iter_init(&iter, idx);
+  while (!lzma_index_iter_next(&iter, LZMA_INDEX_ITER_NONEMPTY_BLOCK)) {
+    points.emplace_back(Checkpoint{.in = offset + static_cast<int64_t>(iter.block.compressed_file_offset),
+                                   .out = static_cast<int64_t>(iter.block.uncompressed_file_offset),
+                                   .bits = static_cast<int>(iter.stream.flags->check)});
+  }
+  return true;
+}
+
+inline std::shared_ptr<ExtractReader> borrowReader(FileReader &fd) {
+  return std::shared_ptr<ExtractReader>(&fd, [](ExtractReader *) {});
+}
+
+inline bool archiveStamp(FileReader &fd, int64_t &size, int64_t &mtime, bela::error_code &ec) {
+  if (size = fd.Size(ec); size == bela::SizeUnInitialized) {
+    return false;
+  }
+  FILETIME ft;
+  if (GetFileTime(fd.NativeFD(), nullptr, nullptr, &ft) != TRUE) {
+    ec = bela::make_system_error_code(L"GetFileTime() ");
+    return false;
+  }
+  mtime = static_cast<int64_t>((static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime);
+  return true;
+}
+
+bool Index::Build(FileReader &fd, int64_t offset_, file_format_t afmt_, const ReaderOptions &opts,
+                  bela::error_code &ec) {
+  entries.clear();
+  checkpoints.clear();
+  offset = offset_;
+  afmt = afmt_;
+  if (!archiveStamp(fd, archiveSize, archiveTime, ec)) {
+    return false;
+  }
+  // the first checkpoint is the start of the tar stream
+  std::shared_ptr<ExtractReader> r;
+  switch (afmt) {
+  case file_format_t::gz:
+    checkpoints.emplace_back(Checkpoint{.in = offset});
+    if (auto ir = std::make_shared<inflateReader>(&fd, &checkpoints); ir->Initialize(checkpoints.front(), ec)) {
+      r = std::move(ir);
+      break;
+    }
+    return false;
+  case file_format_t::xz:
+    // streams with trailing garbage or without an index are decoded from the start
+    if (!xzBlocks(fd, offset, archiveSize, checkpoints, ec)) {
+      checkpoints.clear();
+      ec.clear();
+    }
+    break;
+  case file_format_t::zstd:
+    if (auto fr = std::make_shared<zstd::FrameReader>(fd.NativeFD(), archiveSize, opts);
+        fr->Initialize(offset, ec) && fr->Walk(ec)) {
+      for (const auto &f : fr->Layout()) {
+        if (f.contentOffset >= 0) {
+          checkpoints.emplace_back(Checkpoint{.in = f.offset, .out = f.contentOffset});
+        }
+      }
+    }
+    ec.clear();
+    break;
+  default:
+    break;
+  }
+  if (checkpoints.empty() || checkpoints.front().out != 0) {
+    checkpoints.insert(checkpoints.begin(), Checkpoint{.in = offset});
+  }
+  if (!r) {
+    if (r = MakeReader(fd, offset, afmt, opts, ec); !r) {
+      if (ec.code != ErrNoFilter || !fd.Seek(offset, ec)) {
+        return false;
+      }
+      ec.clear();
+      r = borrowReader(fd);
+    }
+  }
+  counter c(r.get());
+  Reader tr(&c);
+  Header h;
+  for (;;) {
+    if (!tr.Next(h, ec)) {
+      if (ec && ec != bela::ErrEnded) {
+        return false;
+      }
+      ec.clear();
+      break;
+    }
+    if (h.Typeflag == TypeXGlobalHeader) {
+      continue;
+    }
+    entries.emplace_back(IndexEntry{.name = h.Name,
+                                    .linkname = h.LinkName,
+                                    .data = c.Position(),
+                                    .size = h.Size,
+                                    .mode = h.Mode,
+                                    .sparseSize = h.SparseSize,
+                                    .sparse = h.SparseMap,
+                                    .modTime = h.ModTime,
+                                    .typeflag = h.Typeflag});
+  }
+  return true;
+}
+
+const IndexEntry *Index::Find(std::string_view name) const {
+  for (const auto &e : entries) {
+    if (e.name == name) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<ExtractReader> Index::Open(FileReader &fd, int64_t pos, bela::error_code &ec) const {
+  if (checkpoints.empty()) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"tar index not built");
+    return nullptr;
+  }
+  auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), pos,
+                             [](int64_t p, const Checkpoint &cp) { return p < cp.out; });
+  const auto &cp = *(it - 1);
+  std::shared_ptr<ExtractReader> r;
+  if (cp.in == offset) {
+    if (r = MakeReader(fd, offset, afmt, ReaderOptions{}, ec); !r) {
+      if (ec.code != ErrNoFilter) {
+        return nullptr;
+      }
+      ec.clear();
+      // a plain tar file seeks to the offset directly
+      if (!fd.Seek(offset + pos, ec)) {
+        return nullptr;
+      }
+      return borrowReader(fd);
+    }
+  } else {
+    switch (afmt) {
+    case file_format_t::gz:
+      if (auto ir = std::make_shared<inflateReader>(&fd, nullptr); ir->Initialize(cp, ec)) {
+        r = std::move(ir);
+        break;
+      }
+      return nullptr;
+    case file_format_t::xz:
+      if (auto br = std::make_shared<blockReader>(&fd, checkpoints, static_cast<size_t>(it - 1 - checkpoints.begin()));
+          br->Initialize(ec)) {
+        r = std::move(br);
+        break;
+      }
+      return nullptr;
+    case file_format_t::zstd:
+      if (!fd.Seek(cp.in, ec)) {
+        return nullptr;
+      }
+      if (auto zr = std::make_shared<zstd::Reader>(&fd); zr->Initialize(ec)) {
+        r = std::move(zr);
+        break;
+      }
+      return nullptr;
+    default:
+      ec = bela::make_error_code(ErrExtractGeneral, L"tar index checkpoint of an unsupported format");
+      return nullptr;
+    }
+  }
+  if (!r->Discard(pos - cp.out, ec)) {
+    return nullptr;
+  }
+  return r;
+}
+
+bool Index::Extract(FileReader &fd, const IndexEntry &e, const Writer &w, bela::error_code &ec) const {
+  auto r = Open(fd, e.data, ec);
+  if (!r) {
+    return false;
+  }
+  auto copyN = [&](int64_t size) {
+    int64_t extracted = 0;
+    if (!r->WriteTo(w, size, extracted, ec)) {
+      return false;
+    }
+    if (extracted != size) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"tar member '", bela::encode_into<char, wchar_t>(e.name),
+                                 L"' truncated");
+      return false;
+    }
+    return true;
+  };
+  if (e.sparseSize == 0 && e.sparse.empty()) {
+    return copyN(e.size);
+  }
+  static constexpr uint8_t zeros[4096]{};
+  auto zeroN = [&](int64_t size) {
+    for (; size > 0;) {
+      auto n = static_cast<size_t>((std::min)(size, static_cast<int64_t>(sizeof(zeros))));
+      if (!w(zeros, n, ec)) {
+        return false;
+      }
+      size -= static_cast<int64_t>(n);
+    }
+    return true;
+  };
+  int64_t pos = 0;
+  for (const auto &sp : e.sparse) {
+    if (!zeroN(sp.Offset - pos) || !copyN(sp.Length)) {
+      return false;
+    }
+    pos = sp.endOffset();
+  }
+  return zeroN(e.sparseSize - pos);
+}
+
+// index file: little-endian header, checkpoints and entries, strings are prefixed with their 32-bit length
+template <typename T> inline void putLE(std::string &b, T v) {
+  v = bela::fromle(v);
+  b.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+inline void putString(std::string &b, std::string_view s) {
+  putLE(b, static_cast<uint32_t>(s.size()));
+  b.append(s);
+}
+
+bool Index::Save(const std::filesystem::path &file, bela::error_code &ec) const {
+  std::string b;
+  putLE(b, indexMagic);
+  putLE(b, indexVersion);
+  putLE(b, static_cast<uint32_t>(afmt));
+  putLE(b, offset);
+  putLE(b, archiveSize);
+  putLE(b, archiveTime);
+  putLE(b, static_cast<uint64_t>(checkpoints.size()));
+  for (const auto &cp : checkpoints) {
+    putLE(b, cp.in);
+    putLE(b, cp.out);
+    putLE(b, static_cast<int32_t>(cp.bits));
+    putString(b, cp.window);
+  }
+  putLE(b, static_cast<uint64_t>(entries.size()));
+  for (const auto &e : entries) {
+    putLE(b, e.data);
+    putLE(b, e.size);
+    putLE(b, e.mode);
+    putLE(b, bela::ToUnixNanos(e.modTime));
+    b.push_back(e.typeflag);
+    putString(b, e.name);
+    putString(b, e.linkname);
+    putLE(b, e.sparseSize);
+    putLE(b, static_cast<uint32_t>(e.sparse.size()));
+    for (const auto &sp : e.sparse) {
+      putLE(b, sp.Offset);
+      putLE(b, sp.Length);
+    }
+  }
+  return bela::io::AtomicWriteText(file.native(), {reinterpret_cast<const uint8_t *>(b.data()), b.size()}, ec);
+}
+
+bool Index::Load(const std::filesystem::path &file, FileReader &fd, bela::error_code &ec) {
+  std::string b;
+  if (!bela::io::ReadFile(file.native(), b, ec, indexMaxSize)) {
+    return false;
+  }
+  bela::endian::LittenEndian r(b.data(), b.size());
+  auto corrupted = [&]() {
+    entries.clear();
+    checkpoints.clear();
+    ec = bela::make_error_code(ErrIndexMismatch, L"tar index '", file.filename(), L"' corrupted");
+    return false;
+  };
+  auto getString = [&](std::string &s) {
+    if (r.Size() < 4) {
+      return false;
+    }
+    auto n = r.Read<uint32_t>();
+    if (r.Size() < n) {
+      return false;
+    }
+    s.assign(r.Sub(static_cast<int>(n)).Data(), n);
+    return true;
+  };
+  constexpr size_t headerSize = 4 * 3 + 8 * 4;
+  if (r.Size() < headerSize || r.Read<uint32_t>() != indexMagic || r.Read<uint32_t>() != indexVersion) {
+    return corrupted();
+  }
+  afmt = static_cast<file_format_t>(r.Read<uint32_t>());
+  offset = r.Read<int64_t>();
+  archiveSize = r.Read<int64_t>();
+  archiveTime = r.Read<int64_t>();
+  int64_t size = 0;
+  int64_t mtime = 0;
+  if (!archiveStamp(fd, size, mtime, ec)) {
+    return false;
+  }
+  if (size != archiveSize || mtime != archiveTime) {
+    ec = bela::make_error_code(ErrIndexMismatch, L"tar index '", file.filename(), L"' is out of date");
+    return false;
+  }
+  auto points = r.Read<uint64_t>();
+  checkpoints.clear();
+  for (uint64_t i = 0; i < points; i++) {
+    if (r.Size() < 20) {
+      return corrupted();
+    }
+    Checkpoint cp{.in = r.Read<int64_t>(), .out = r.Read<int64_t>(), .bits = r.Read<int32_t>()};
+    if (!getString(cp.window)) {
+      return corrupted();
+    }
+    checkpoints.emplace_back(std::move(cp));
+  }
+  if (checkpoints.empty() || checkpoints.front().out != 0 || r.Size() < 8) {
+    return corrupted();
+  }
+  auto count = r.Read<uint64_t>();
+  entries.clear();
+  for (uint64_t i = 0; i < count; i++) {
+    if (r.Size() < 33) {
+      return corrupted();
+    }
+    IndexEntry e{.data = r.Read<int64_t>(), .size = r.Read<int64_t>(), .mode = r.Read<int64_t>()};
+    e.modTime = bela::FromUnixNanos(r.Read<int64_t>());
+    e.typeflag = static_cast<char>(r.Pick());
+    if (!getString(e.name) || !getString(e.linkname) || r.Size() < 12) {
+      return corrupted();
+    }
+    e.sparseSize = r.Read<int64_t>();
+    auto fragments = r.Read<uint32_t>();
+    if (r.Size() / 16 < fragments) {
+      return corrupted();
+    }
+    e.sparse.resize(fragments);
+    for (auto &sp : e.sparse) {
+      sp.Offset = r.Read<int64_t>();
+      sp.Length = r.Read<int64_t>();
+    }
+    entries.emplace_back(std::move(e));
+  }
+  return true;
+}
+
+bool Index::LoadOrBuild(FileReader &fd, const std::filesystem::path &archive, int64_t offset_, file_format_t afmt_,
+                        const ReaderOptions &opts, bela::error_code &ec) {
+  auto file = IndexPath(archive);
+  if (Load(file, fd, ec)) {
+    return true;
+  }
+  ec.clear();
+  if (!Build(fd, offset_, afmt_, opts, ec)) {
+    return false;
+  }
+  // the index is usable without its sidecar, a read-only directory only costs the next caller a rebuild
+  bela::error_code saveEc;
+  Save(file, saveEc);
+  return true;
+}
+
+} // namespace baulk::archive::tar
@@ -0,0 +1,172 @@
+//
+#include "tarinternal.hpp"
+
+namespace baulk::archive::tar {
+using clock_t = std::chrono::steady_clock;
+
+PipeReader::PipeReader(ExtractReader *r_, size_t buffers, size_t bufferSize_) : r(r_), bufferSize(bufferSize_) {
+  // one buffer is read by the consumer while the decoder fills another
+  ring.resize((std::max)(buffers, static_cast<size_t>(2)));
+}
+
+PipeReader::~PipeReader() { Close(); }
+
+bool PipeReader::Initialize(bela::error_code &ec) {
+  if (r == nullptr) {
+    ec = bela::make_error_code(ErrNotTarFile, L"underlying reader is null");
+    return false;
+  }
+  for (size_t i = 0; i < ring.size(); i++) {
+    ring[i].grow(bufferSize);
+    freeSlots.emplace_back(i);
+  }
+  decoder = std::thread([this] { decompress(); });
+  return true;
+}
+
+void PipeReader::Close() {
+  {
+    std::scoped_lock lock(mu);
+    stopped = true;
+  }
+  cv.notify_all();
+  if (decoder.joinable()) {
+    decoder.join();
+  }
+  current.reset();
+}
+
+// decompress runs on the decoder thread until the stream ends, fails or the reader is closed
+void PipeReader::decompress() {
+  for (;;) {
+    size_t index = 0;
+    {
+      auto begin = clock_t::now();
+      std::unique_lock lock(mu);
+      cv.wait(lock, [&] { return stopped || !freeSlots.empty(); });
+      decode.stalled += clock_t::now() - begin;
+      if (stopped) {
+        return;
+      }
+      index = freeSlots.front();
+      freeSlots.pop_front();
+    }
+    auto &b = ring[index];
+    b.pos() = 0;
+    b.size() = 0;
+    bela::error_code ec;
+    auto more = true;
+    auto begin = clock_t::now();
+    while (b.size() < b.capacity() && !stopped) {
+      auto n = r->Read(b.data() + b.size(), b.capacity() - b.size(), ec);
+      if (n <= 0) {
+        more = false;
+        break;
+      }
+      b.size() += static_cast<size_t>(n);
+    }
+    decode.busy += clock_t::now() - begin;
+    {
+      std::scoped_lock lock(mu);
+      decoded += static_cast<int64_t>(b.size());
+      if (b.size() != 0) {
+        filledSlots.emplace_back(index);
+      } else {
+        freeSlots.emplace_back(index);
+      }
+      if (!more) {
+        ended = true;
+        decodeEc = std::move(ec);
+      }
+    }
+    cv.notify_all();
+    if (!more) {
+      return;
+    }
+  }
+}
+
+void PipeReader::release(size_t index) {
+  {
+    std::scoped_lock lock(mu);
+    freeSlots.emplace_back(index);
+  }
+  cv.notify_all();
+}
+
+// acquire makes current a buffer with unread data, at the end of the stream it returns false and leaves ec empty
+bool PipeReader::acquire(bela::error_code &ec) {
+  if (current && current->pos() < current->size()) {
+    return true;
+  }
+  // the buffer returns to the ring once the writers holding a lease on it are done
+  current.reset();
+  auto begin = clock_t::now();
+  std::unique_lock lock(mu);
+  cv.wait(lock, [&] { return stopped || ended || !filledSlots.empty(); });
+  starved += clock_t::now() - begin;
+  if (stopped) {
+    ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+    return false;
+  }
+  if (filledSlots.empty()) {
+    if (decodeEc) {
+      ec = decodeEc;
+    }
+    return false;
+  }
+  auto index = filledSlots.front();
+  filledSlots.pop_front();
+  current = std::shared_ptr<baulk::mem::Buffer>(&ring[index], [this, index](baulk::mem::Buffer *) { release(index); });
+  return true;
+}
+
+ssize_t PipeReader::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (!acquire(ec)) {
+    return ec ? -1 : 0;
+  }
+  auto minsize = (std::min)(len, current->size() - current->pos());
+  memcpy(buffer, current->data() + current->pos(), minsize);
+  current->pos() += minsize;
+  return static_cast<ssize_t>(minsize);
+}
+
+bool PipeReader::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (!acquire(ec)) {
+      return false;
+    }
+    auto minsize = (std::min)(static_cast<size_t>(len), current->size() - current->pos());
+    current->pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+bool PipeReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (!acquire(ec)) {
+      return false;
+    }
+    auto minsize = (std::min)(static_cast<size_t>(filesize), current->size() - current->pos());
+    auto p = current->data() + current->pos();
+    current->pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const uint8_t> PipeReader::Peek(size_t len, bela::error_code &ec) {
+  if (!acquire(ec)) {
+    return {};
+  }
+  return {current->data() + current->pos(), (std::min)(len, current->size() - current->pos())};
+}
+
+void PipeReader::Consume(size_t n) { current->pos() += n; }
+
+} // namespace baulk::archive::tar
@@ -38,25 +38,40 @@ bool FileReader::Discard(int64_t len, bela::error_code &ec) {
 }
 
 bool FileReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
-  constexpr int64_t bufferSize = 8192;
-  char buffer[bufferSize];
+  constexpr int64_t bufferSize = 1024 * 1024;
+  if (filesize > 0 && buffer.empty()) {
+    buffer.resize(bufferSize);
+  }
   while (filesize > 0) {
     auto minsize = (std::min)(bufferSize, filesize);
     DWORD drSize = {0};
-    if (::ReadFile(fd.NativeFD(), buffer, static_cast<DWORD>(minsize), &drSize, nullptr) != TRUE) {
+    if (::ReadFile(fd.NativeFD(), buffer.data(), static_cast<DWORD>(minsize), &drSize, nullptr) != TRUE) {
       ec = bela::make_system_error_code(L"ReadFile: ");
       return false;
     }
+    if (drSize == 0) {
+      ec = bela::make_error_code(ERROR_HANDLE_EOF, L"tar: unexpected EOF");
+      return false;
+    }
     filesize -= drSize;
     extracted += drSize;
     position += static_cast<int64_t>(drSize);
-    if (!w(buffer, drSize, ec)) {
+    if (!w(buffer.data(), drSize, ec)) {
       return false;
     }
   }
   return true;
 }
 
+bool FileReader::CopyTo(File &out, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  // CopyRange reads at offsets, the file pointer is set past the entry afterwards
+  if (!CopyRange(fd.NativeFD(), position, out, filesize, ec) || !Seek(position + filesize, ec)) {
+    return false;
+  }
+  extracted += filesize;
+  return true;
+}
+
 inline bool isZeroBlock(const ustar_header &th) {
   static ustar_header zeroth = {0};
   return memcmp(&th, &zeroth, sizeof(ustar_header)) == 0;
@@ -126,12 +141,34 @@ bool Reader::ReadFull(void *buffer, size_t size, bela::error_code &ec) {
   return true;
 }
 
+// borrow consumes n bytes the decoder holds contiguously and returns them without a copy, it returns an empty span
+// when they are not available that way and callers read the bytes instead
+std::span<const uint8_t> Reader::borrow(size_t n, bela::error_code &ec) {
+  if (r == nullptr || n == 0) {
+    return {};
+  }
+  auto b = r->Peek(n, ec);
+  if (b.size() != n) {
+    return {};
+  }
+  r->Consume(n);
+  return b;
+}
+
 bool Reader::parsePAX(int64_t paxSize, pax_records_t &paxHdrs, bela::error_code &ec) {
-  Buffer buf(paxSize);
-  if (!ReadFull(buf.data(), paxSize, ec)) {
-    return false;
+  Buffer buf;
+  auto b = borrow(static_cast<size_t>(paxSize), ec);
+  if (b.empty()) {
+    if (ec) {
+      return false;
+    }
+    buf.grow(paxSize);
+    if (!ReadFull(buf.data(), paxSize, ec)) {
+      return false;
+    }
+    b = {buf.data(), static_cast<size_t>(paxSize)};
   }
-  std::string_view sv{reinterpret_cast<const char *>(buf.data()), static_cast<size_t>(paxSize)};
+  std::string_view sv{reinterpret_cast<const char *>(b.data()), b.size()};
   std::vector<std::string_view> sparseMap;
   while (!sv.empty()) {
     std::string_view k;
@@ -156,68 +193,103 @@ bool Reader::parsePAX(int64_t paxSize, pax_records_t &paxHdrs, bela::error_code
   return true;
 }
 
-bool Reader::readHeader(Header &h, bela::error_code &ec) {
-  ustar_header hdr{0};
-  if (!ReadFull(&hdr, sizeof(hdr), ec)) {
+// resetHeader clears h for the next entry and keeps the storage of its strings
+inline void resetHeader(Header &h) {
+  h.SparseSize = 0;
+  h.SparseMap.clear();
+  if (!h.Xattrs.empty()) {
+    h.Xattrs.clear();
+  }
+  if (!h.PAXRecords.empty()) {
+    h.PAXRecords.clear();
+  }
+}
+
+// readHeader parses the next header block in place when the decoder holds all of it, hdr points to the block and
+// stays valid until the next read
+bool Reader::readHeader(Header &h, const ustar_header *&hdr, bela::error_code &ec) {
+  auto readBlock = [&]() {
+    if (auto b = borrow(sizeof(ustar_header), ec); !b.empty()) {
+      hdr = reinterpret_cast<const ustar_header *>(b.data());
+      return true;
+    }
+    hdr = &block;
+    return !ec && ReadFull(&block, sizeof(block), ec);
+  };
+  if (!readBlock()) {
     return false;
   }
-  if (isZeroBlock(hdr)) {
-    if (!ReadFull(&hdr, sizeof(hdr), ec)) {
+  if (isZeroBlock(*hdr)) {
+    if (!readBlock()) {
       return false;
     }
-    if (isZeroBlock(hdr)) {
+    if (isZeroBlock(*hdr)) {
       ec = bela::make_error_code(bela::ErrEnded, L"tar stream end");
       return false;
     }
     ec = bela::make_error_code(ErrNotTarFile, L"invalid tar header");
     return false;
   }
-  if (h.Format = getFormat(hdr); h.Format == FormatUnknown) {
+  HeaderView hv;
+  if (!ParseHeaderView(*hdr, hv)) {
     ec = bela::make_error_code(ErrNotTarFile, L"invalid tar header");
     return false;
   }
-  h.Typeflag = hdr.typeflag;
-  h.Name = parseString(hdr.name);
-  h.LinkName = parseString(hdr.linkname);
-  h.Size = parseNumeric(hdr.size);
-  h.Mode = parseNumeric(hdr.mode);
-  h.UID = static_cast<int>(parseNumeric(hdr.uid));
-  h.GID = static_cast<int>(parseNumeric(hdr.gid));
-  h.ModTime = bela::FromUnix(parseNumeric(hdr.mtime), 0);
-  if (h.Format > FormatV7) {
-    h.Uname = parseString(hdr.uname);
-    h.Gname = parseString(hdr.gname);
-    h.Devmajor = parseNumeric(hdr.devmajor);
-    h.Devminor = parseNumeric(hdr.devminor);
-    std::string prefix;
-    if ((h.Format & (FormatUSTAR | FormatPAX)) != 0) {
-      prefix = parseString(hdr.prefix);
-    } else if ((h.Format & FormatSTAR) != 0) {
-      auto star = reinterpret_cast<const star_header *>(&hdr);
-      prefix = parseString(star->prefix);
-      h.AccessTime = bela::FromUnix(parseNumeric(star->atime), 0);
-      h.ChangeTime = bela::FromUnix(parseNumeric(star->ctime), 0);
-    } else if ((h.Format & FormatGNU) != 0) {
-      auto gnu = reinterpret_cast<const gnutar_header *>(&hdr);
-      if (gnu->atime[0] != 0) {
-        h.AccessTime = bela::FromUnix(parseNumeric(gnu->atime), 0);
-      }
-      if (gnu->ctime[0] != 0) {
-        h.ChangeTime = bela::FromUnix(parseNumeric(gnu->ctime), 0);
+  resetHeader(h);
+  h.Format = hv.Format;
+  h.Typeflag = hv.Typeflag;
+  if (hv.Prefix.empty()) {
+    h.Name.assign(hv.Name);
+  } else {
+    h.Name.assign(hv.Prefix).append(1, '/').append(hv.Name);
+  }
+  h.LinkName.assign(hv.LinkName);
+  h.Uname.assign(hv.Uname);
+  h.Gname.assign(hv.Gname);
+  h.Size = hv.Size;
+  h.Mode = hv.Mode;
+  h.UID = hv.UID;
+  h.GID = hv.GID;
+  h.ModTime = hv.ModTime;
+  h.AccessTime = hv.AccessTime;
+  h.ChangeTime = hv.ChangeTime;
+  h.Devmajor = hv.Devmajor;
+  h.Devminor = hv.Devminor;
+  return true;
+}
+
+// readOldGNUSparseMap reads the map of a GNU sparse entry, the header holds four fragments and extension blocks
+// following it hold 21 more each. th may borrow from the decoder output, it is not used once they are read
+bool Reader::readOldGNUSparseMap(Header &h, sparseDatas &spd, const gnutar_header *th, bela::error_code &ec) {
+  if ((h.Format & FormatGNU) == 0) {
+    ec = bela::make_error_code(ErrNotTarFile, L"tar: GNU sparse entry in a non GNU header");
+    return false;
+  }
+  h.Format = FormatGNU;
+  h.SparseSize = parseNumeric(th->realsize);
+  auto parseEntries = [&](const gnu_sparse *entries, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      // same termination as GNU and BSD tar
+      if (entries[i].offset[0] == 0) {
+        break;
       }
+      spd.emplace_back(
+          sparseEntry{.Offset = parseNumeric(entries[i].offset), .Length = parseNumeric(entries[i].numbytes)});
     }
-    if (!prefix.empty()) {
-      h.Name = bela::StringNarrowCat(prefix, "/", h.Name);
+  };
+  parseEntries(th->sparse, std::size(th->sparse));
+  auto extended = th->isextended[0] != 0;
+  while (extended) {
+    gnu_sparse_header sh;
+    if (!ReadFull(&sh, sizeof(sh), ec)) {
+      return false;
     }
+    parseEntries(sh.sparse, std::size(sh.sparse));
+    extended = sh.isextended[0] != 0;
   }
   return true;
 }
 
-bool Reader::readOldGNUSparseMap(Header &h, sparseDatas &spd, const gnutar_header *th, bela::error_code &ec) {
-  ec = bela::make_error_code(ErrExtractGeneral, L"tar: GNU old sparse file extraction is not implemented");
-  return false;
-}
-
 bool readGNUSparseMap0x1(pax_records_t &paxrs, sparseDatas &spd, bela::error_code &ec) {
   auto it = paxrs.find(paxGNUSparseNumBlocks);
   if (it == paxrs.end()) {
@@ -262,9 +334,15 @@ bool Reader::readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec) {
   std::string::size_type offset{0};
   auto feedTokens = [&](int64_t n, bela::error_code &e) -> bool {
     while (cntNewline < n) {
+      // the map is stored at the start of the entry data
+      if (remainingSize < static_cast<int64_t>(sizeof(block))) {
+        ec = bela::make_error_code(ErrNotTarFile, L"tar: sparse map exceeds the entry data");
+        return false;
+      }
       if (!ReadFull(block, sizeof(block), ec)) {
         return false;
       }
+      remainingSize -= sizeof(block);
       buf.append(block, sizeof(block));
       for (auto c : block) {
         if (c == '\n') {
@@ -278,7 +356,7 @@ bool Reader::readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec) {
     cntNewline--;
     auto pos = buf.find('\n', offset);
     if (pos != std::string::npos) {
-      std::string_view sv{buf.data() + offset, pos};
+      std::string_view sv{buf.data() + offset, pos - offset};
       offset = pos + 1;
       return sv;
     }
@@ -307,25 +385,27 @@ bool Reader::readGNUSparseMap1x0(sparseDatas &spd, bela::error_code &ec) {
   return true;
 }
 
+// readGNUSparsePAXHeaders reads the map of a PAX sparse entry, formats 0.0 and 0.1 keep it in the records and 1.0 at
+// the start of the entry data. spd is left empty for other entries
 bool Reader::readGNUSparsePAXHeaders(Header &h, sparseDatas &spd, bela::error_code &ec) {
   bool is1x0 = false;
-  auto mit = h.PAXRecords.find(paxGNUSparseMajor);
-  if (mit == h.PAXRecords.end()) {
-    return true;
+  std::string_view major;
+  std::string_view minor;
+  if (auto it = h.PAXRecords.find(paxGNUSparseMajor); it != h.PAXRecords.end()) {
+    major = it->second;
   }
-  std::string_view major = mit->second;
-  auto it = h.PAXRecords.find(paxGNUSparseMinor);
-  if (it == h.PAXRecords.end()) {
-    return false;
+  if (auto it = h.PAXRecords.find(paxGNUSparseMinor); it != h.PAXRecords.end()) {
+    minor = it->second;
   }
-  std::string_view minor = it->second;
   if (major == "0" && (minor == "0" || minor == "1")) {
     is1x0 = false;
   } else if (major == "1" && minor == "0") {
     is1x0 = true;
-  } else if (major.empty() || minor.empty()) {
+  } else if (!major.empty() || !minor.empty()) {
+    // unknown version
     return true;
-  } else if (auto kit = h.PAXRecords.find(paxGNUSparseMap); kit != h.PAXRecords.end() && !kit->second.empty()) {
+  } else if (auto it = h.PAXRecords.find(paxGNUSparseMap); it != h.PAXRecords.end() && !it->second.empty()) {
+    // 0.0 and 0.1 have no version records
     is1x0 = false;
   } else {
     return true;
@@ -334,11 +414,14 @@ bool Reader::readGNUSparsePAXHeaders(Header &h, sparseDatas &spd, bela::error_co
   if (auto it = h.PAXRecords.find(paxGNUSparseName); it != h.PAXRecords.end() && !it->second.empty()) {
     h.Name = it->second;
   }
-  if (auto it = h.PAXRecords.find(paxGNUSparseSize); it != h.PAXRecords.end() && !it->second.empty()) {
-    int64_t n = 0;
-    if (auto res = std::from_chars(it->second.data(), it->second.data() + it->second.size(), n);
-        res.ec == std::errc{}) {
-      h.SparseSize = n;
+  h.SparseSize = h.Size;
+  auto it = h.PAXRecords.find(paxGNUSparseSize);
+  if (it == h.PAXRecords.end() || it->second.empty()) {
+    it = h.PAXRecords.find(paxGNUSparseRealSize);
+  }
+  if (it != h.PAXRecords.end() && !it->second.empty()) {
+    if (!bela::SimpleAtoi(it->second, &h.SparseSize) || h.SparseSize < 0) {
+      ec = bela::make_error_code(ErrNotTarFile, L"tar: pax sparse invalid size");
       return false;
     }
   }
@@ -348,48 +431,69 @@ bool Reader::readGNUSparsePAXHeaders(Header &h, sparseDatas &spd, bela::error_co
   return readGNUSparseMap0x1(h.PAXRecords, spd, ec);
 }
 
-// handleSparseFile tar support sparse file
-// https://www.gnu.org/software/tar/manual/html_node/sparse.html
+// handleSparseFile reads the map of GNU and PAX sparse entries, Size becomes the data stored after the map and
+// SparseSize the size of the file
+// https://www.gnu.org/software/tar/manual/html_node/Sparse-Formats.html
 bool Reader::handleSparseFile(Header &h, const gnutar_header *th, bela::error_code &ec) {
-  std::vector<sparseEntry> spd;
-  bool ret = false;
+  sparseDatas spd;
   if (h.Typeflag == TypeGNUSparse) {
-    ret = readOldGNUSparseMap(h, spd, th, ec);
-  } else {
-    ret = readGNUSparsePAXHeaders(h, spd, ec);
-  }
-  if (ret && !spd.empty()) {
-    if (isHeaderOnlyType(h.Typeflag) || !validateSparseEntries(spd, h.Size)) {
-      ec = bela::make_error_code(ErrNotTarFile, L"invalid tar header");
+    if (!readOldGNUSparseMap(h, spd, th, ec)) {
       return false;
     }
+  } else if (!readGNUSparsePAXHeaders(h, spd, ec)) {
+    return false;
+  }
+  if (spd.empty() && h.SparseSize == 0) {
+    return true;
+  }
+  if (isHeaderOnlyType(h.Typeflag) || !validateSparseEntries(spd, h.SparseSize)) {
+    ec = bela::make_error_code(ErrNotTarFile, L"invalid tar header");
+    return false;
   }
+  int64_t stored = 0;
+  for (const auto &e : spd) {
+    stored += e.Length;
+  }
+  if (stored != remainingSize) {
+    ec = bela::make_error_code(ErrNotTarFile, L"tar: sparse map does not match the entry data");
+    return false;
+  }
+  h.Size = remainingSize;
+  h.SparseMap = std::move(spd);
   return true;
 }
 
 std::optional<Header> Reader::Next(bela::error_code &ec) {
+  Header h;
+  if (!Next(h, ec)) {
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(h));
+}
+
+bool Reader::Next(Header &h, bela::error_code &ec) {
+  const ustar_header *hdr{nullptr};
   pax_records_t paxHdrs;
   std::string gnuLongName;
   std::string gnuLongLink;
   // read next entry
   for (;;) {
-    if (!discard(remainingSize, ec)) {
-      return std::nullopt;
-    }
-    if (!discard(paddingSize, ec)) {
-      return std::nullopt;
+    if (!discard(remainingSize + paddingSize, ec)) {
+      return false;
     }
-    Header h;
-    if (!readHeader(h, ec)) {
-      return std::nullopt;
+    // extended headers loop back here, their data has been read
+    remainingSize = 0;
+    paddingSize = 0;
+    if (!readHeader(h, hdr, ec)) {
+      return false;
     }
     if (!handleRegularFile(h, paddingSize, ec)) {
-      return std::nullopt;
+      return false;
     }
     if (h.Typeflag == TypeXHeader || h.Typeflag == TypeXGlobalHeader) {
       h.Format &= FormatPAX;
       if (!parsePAX(h.Size, paxHdrs, ec)) {
-        return std::nullopt;
+        return false;
       }
       if (h.Typeflag == TypeXGlobalHeader) {
         mergePAX(h, paxHdrs, ec);
@@ -402,11 +506,12 @@ std::optional<Header> Reader::Next(bela::error_code &ec) {
         // it is not possible to mix designated and non-designated initialization
         // designators of the same data member cannot appear multiple times
         // designators cannot be nested
-        return std::make_optional(Header{.Name = h.Name,
-                                         .Xattrs = h.Xattrs,
-                                         .PAXRecords = h.PAXRecords,
-                                         .Format = h.Format,
-                                         .Typeflag = h.Typeflag});
+        h = Header{.Name = std::move(h.Name),
+                   .Xattrs = std::move(h.Xattrs),
+                   .PAXRecords = std::move(h.PAXRecords),
+                   .Format = h.Format,
+                   .Typeflag = h.Typeflag};
+        return true;
       }
       continue;
     }
@@ -414,7 +519,7 @@ std::optional<Header> Reader::Next(bela::error_code &ec) {
       h.Format = FormatGNU;
       Buffer realname(h.Size);
       if (!ReadFull(realname.data(), h.Size, ec)) {
-        return std::nullopt;
+        return false;
       }
       if (h.Typeflag == TypeGNULongName) {
         gnuLongName = parseString(realname.data(), h.Size);
@@ -423,8 +528,9 @@ std::optional<Header> Reader::Next(bela::error_code &ec) {
       gnuLongLink = parseString(realname.data(), h.Size);
       continue;
     }
-    if (!mergePAX(h, paxHdrs, ec)) {
-      return std::nullopt;
+    // records are only merged when the entry has an extended header
+    if (!paxHdrs.empty() && !mergePAX(h, paxHdrs, ec)) {
+      return false;
     }
     if (!gnuLongName.empty()) {
       h.Name = std::move(gnuLongName);
@@ -436,17 +542,19 @@ std::optional<Header> Reader::Next(bela::error_code &ec) {
       h.Typeflag = h.Name.ends_with('/') ? TypeDir : TypeReg;
     }
     if (!handleRegularFile(h, paddingSize, ec)) {
-      return std::nullopt;
+      return false;
+    }
+    remainingSize = h.Size;
+    if (!handleSparseFile(h, reinterpret_cast<const gnutar_header *>(hdr), ec)) {
+      return false;
     }
-    // TODO support tar sparse feature
     if ((h.Format & (FormatUSTAR | FormatPAX)) != 0) {
       h.Format = FormatUSTAR;
     }
-    remainingSize = h.Size;
     index++;
-    return std::make_optional(std::move(h));
+    return true;
   }
-  return std::nullopt;
+  return false;
 }
 
 bool Reader::WriteTo(const Writer &w, int64_t filesize, bela::error_code &ec) {
@@ -459,4 +567,14 @@ bool Reader::WriteTo(const Writer &w, int64_t filesize, bela::error_code &ec) {
   return ret;
 }
 
+bool Reader::CopyTo(File &out, int64_t filesize, bela::error_code &ec) {
+  ec.clear();
+  int64_t extracted{0};
+  auto ret = r->CopyTo(out, filesize, extracted, ec);
+  if (remainingSize > 0) {
+    remainingSize -= extracted;
+  }
+  return ret;
+}
+
 } // namespace baulk::archive::tar
\ No newline at end of file
@@ -19,6 +19,8 @@ constexpr size_t nameSize = 100;   // Max length of the name field in USTAR form
 constexpr size_t prefixSize = 155; // Max length of the prefix field in USTAR format
 constexpr size_t outsize = 64 * 1024;
 constexpr size_t insize = 32 * 1024;
+// decoded bytes the parallel gzip, bzip2 and zstd readers hold ahead of the reader when ReaderOptions::memlimit is 0
+constexpr uint64_t parallelMemlimit = 256 * 1024 * 1024;
 
 struct tar_v7_header {
   char name[100];
@@ -53,6 +55,13 @@ struct star_header {
   char trailer[4];
 };
 
+// extension block of a GNU sparse header, it follows the header while isextended is set
+struct gnu_sparse_header {
+  gnu_sparse sparse[21];
+  char isextended[1];
+  char padding[7];
+};
+
 constexpr std::string_view paxNone = ""; // Indicates that no PAX key is suitable
 constexpr std::string_view paxPath = "path";
 constexpr std::string_view paxLinkpath = "linkpath";
@@ -97,6 +106,14 @@ inline std::string parseString(const void *data, size_t N) {
 
 template <size_t N> std::string parseString(const char (&aArr)[N]) { return parseString(aArr, N); }
 
+template <size_t N> std::string_view parseStringView(const char (&aArr)[N]) {
+  auto pos = memchr(aArr, 0, N);
+  if (pos == nullptr) {
+    return std::string_view(aArr, N);
+  }
+  return std::string_view(aArr, reinterpret_cast<const char *>(pos) - aArr);
+}
+
 inline int64_t parseNumeric8(const char *p, size_t char_cnt) {
   int64_t val = 0;
   auto res = std::from_chars(p, p + char_cnt, val, 8);
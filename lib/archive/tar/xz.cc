@@ -7,6 +7,7 @@
 namespace baulk::archive::tar::xz {
 constexpr size_t xzoutsize = 256 * 1024;
 constexpr size_t xzinsize = 256 * 1024;
+constexpr uint64_t xzMinThreadingMemory = 256 * 1024 * 1024;
 
 // LZMA allocator
 static lzma_allocator allocator{                                  // allocator
@@ -15,14 +16,31 @@ static lzma_allocator allocator{                                  // allocator
                                 .opaque = nullptr};
 Reader::~Reader() {
   if (xzs != nullptr) {
+    // stops the threads of the threaded decoder
+    lzma_end(xzs);
     baulk::mem::deallocate(xzs);
   }
 }
+
+// initializeThreaded: blocks whose sizes are recorded in their headers (xz -T, xz --block-size) are decoded in
+// parallel, other streams and streams exceeding memlimit_threading are decoded on one thread
+inline lzma_ret initializeThreaded(lzma_stream *xzs, const ReaderOptions &opts) {
+  lzma_mt mt{};
+  mt.flags = LZMA_CONCATENATED;
+  mt.threads = opts.threads != 0 ? opts.threads : (std::max)(std::thread::hardware_concurrency(), 1U);
+  mt.timeout = 0;
+  // same default as xz(1): a quarter of the physical memory
+  mt.memlimit_threading = opts.memlimit != 0 ? opts.memlimit : (std::max)(lzma_physmem() / 4, xzMinThreadingMemory);
+  mt.memlimit_stop = UINT64_MAX;
+  return lzma_stream_decoder_mt(xzs, &mt);
+}
+
 bool Reader::Initialize(bela::error_code &ec) {
   xzs = baulk::mem::allocate<lzma_stream>();
   memset(xzs, 0, sizeof(lzma_stream));
   xzs->allocator = &allocator;
-  auto ret = lzma_stream_decoder(xzs, UINT64_MAX, LZMA_CONCATENATED);
+  auto ret =
+      opts.threads != 1 ? initializeThreaded(xzs, opts) : lzma_stream_decoder(xzs, UINT64_MAX, LZMA_CONCATENATED);
   if (ret != LZMA_OK) {
     ec = bela::make_error_code(ErrExtractGeneral, L"lzma_stream_decoder error ", ret);
     return false;
@@ -147,4 +165,13 @@ bool Reader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela
   return true;
 }
 
+std::span<const uint8_t> Reader::Peek(size_t len, bela::error_code &ec) {
+  if (out.pos() == out.size() && !decompress(ec)) {
+    return {};
+  }
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void Reader::Consume(size_t n) { out.pos() += n; }
+
 } // namespace baulk::archive::tar::xz
\ No newline at end of file
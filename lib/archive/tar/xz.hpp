@@ -7,7 +7,7 @@
 namespace baulk::archive::tar::xz {
 class Reader : public ExtractReader {
 public:
-  Reader(ExtractReader *lr) : r(lr) {}
+  Reader(ExtractReader *lr, const ReaderOptions &opts_ = {}) : r(lr), opts(opts_) {}
   Reader(const Reader &) = delete;
   Reader &operator=(const Reader &) = delete;
   ~Reader();
@@ -15,11 +15,14 @@ public:
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code &ec);
   bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
 
 private:
   bool decompress(bela::error_code &ec);
   bela::ssize_t ReadAtLeast(void *buffer, size_t size, bela::error_code &ec);
   ExtractReader *r{nullptr};
+  ReaderOptions opts;
   lzma_stream *xzs{nullptr};
   Buffer in;
   Buffer out;
@@ -1,5 +1,6 @@
 //
 #include "zstd.hpp"
+#include <bela/endian.hpp>
 
 namespace baulk::archive::tar::zstd {
 Reader::~Reader() {
@@ -98,4 +99,454 @@ bool Reader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela
   return true;
 }
 
-} // namespace baulk::archive::tar::zstd
\ No newline at end of file
+std::span<const uint8_t> Reader::Peek(size_t len, bela::error_code &ec) {
+  if (outb.pos() == outb.size() && !decompress(ec)) {
+    return {};
+  }
+  return {outb.data() + outb.pos(), (std::min)(len, outb.size() - outb.pos())};
+}
+
+void Reader::Consume(size_t n) { outb.pos() += n; }
+
+// https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+constexpr uint32_t seekableMagic = 0x8F92EAB1;
+constexpr uint32_t seekTableMagic = ZSTD_MAGIC_SKIPPABLE_START | 0xE;
+constexpr size_t seekTableFooterSize = 9;
+constexpr size_t skippableHeaderSize = 8;
+constexpr uint8_t seekTableChecksumFlag = 0x80;
+constexpr uint8_t seekTableReserved = 0x7C;
+constexpr size_t blockHeaderSize = 3;
+constexpr uint32_t blockTypeRLE = 1;
+constexpr uint32_t blockTypeReserved = 3;
+constexpr size_t streamChunkSize = 4 * 1024 * 1024;
+
+inline ZSTD_DCtx *createDCtx() {
+  return ZSTD_createDCtx_advanced(ZSTD_customMem{
+      .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+}
+
+struct FrameReader::job {
+  enum state_t : uint8_t { Pending, Finished, Partial, Failed };
+  ~job() {
+    if (zds != nullptr) {
+      ZSTD_freeDCtx(zds);
+    }
+  }
+  int64_t inpos{0}; // next compressed byte to read
+  int64_t inend{0};
+  int64_t contentSize{-1};
+  int64_t produced{0};
+  ZSTD_DCtx *zds{nullptr}; // context of a frame that outgrew its limit
+  Buffer in;
+  ZSTD_inBuffer zin{nullptr, 0, 0};
+  Buffer out;
+  bela::error_code ec;
+  std::atomic_bool canceled{false};
+  state_t state{Pending};
+  bool finished{false};
+};
+
+FrameReader::FrameReader(HANDLE fd_, int64_t end_, const ReaderOptions &opts) : fd(fd_), end(end_) {
+  concurrency = opts.threads != 0 ? opts.threads : (std::max)(std::thread::hardware_concurrency(), 1U);
+  auto memlimit = opts.memlimit != 0 ? opts.memlimit : parallelMemlimit;
+  // at most two frames per thread are decoded ahead of the reader
+  frameLimit = (std::max)(static_cast<size_t>(memlimit / (concurrency * 2)), static_cast<size_t>(1024 * 1024));
+}
+
+FrameReader::~FrameReader() {
+  {
+    std::scoped_lock lock(mu);
+    stopped = true;
+    for (auto &j : window) {
+      j->canceled = true;
+    }
+  }
+  cv.notify_all();
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+// readSeekTable returns false and leaves ec empty when the stream does not end with a seek table
+bool FrameReader::readSeekTable(int64_t begin, bela::error_code &ec) {
+  uint8_t footer[seekTableFooterSize];
+  if (end - begin < static_cast<int64_t>(skippableHeaderSize + seekTableFooterSize) ||
+      !baulk::archive::ReadAt(fd, footer, sizeof(footer), end - static_cast<int64_t>(sizeof(footer)), ec)) {
+    return false;
+  }
+  if (bela::cast_fromle<uint32_t>(footer + 5) != seekableMagic) {
+    return false;
+  }
+  if ((footer[4] & seekTableReserved) != 0) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"zstd: bad seek table descriptor");
+    return false;
+  }
+  auto numFrames = static_cast<uint64_t>(bela::cast_fromle<uint32_t>(footer));
+  auto entrySize = static_cast<uint64_t>((footer[4] & seekTableChecksumFlag) != 0 ? 12 : 8);
+  auto tableSize = skippableHeaderSize + numFrames * entrySize + seekTableFooterSize;
+  if (tableSize > static_cast<uint64_t>(end - begin)) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"zstd: seek table larger than the stream");
+    return false;
+  }
+  auto tableStart = end - static_cast<int64_t>(tableSize);
+  Buffer table(static_cast<size_t>(tableSize));
+  if (!baulk::archive::ReadAt(fd, table.data(), static_cast<size_t>(tableSize), tableStart, ec)) {
+    return false;
+  }
+  if (bela::cast_fromle<uint32_t>(table.data()) != seekTableMagic ||
+      bela::cast_fromle<uint32_t>(table.data() + 4) != tableSize - skippableHeaderSize) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"zstd: bad seek table frame");
+    return false;
+  }
+  frames.reserve(static_cast<size_t>(numFrames));
+  auto pos = begin;
+  for (uint64_t i = 0; i < numFrames; i++) {
+    const auto *e = table.data() + skippableHeaderSize + i * entrySize;
+    auto compressed = static_cast<int64_t>(bela::cast_fromle<uint32_t>(e));
+    frames.emplace_back(frame{.offset = pos,
+                              .compressed = compressed,
+                              .contentSize = static_cast<int64_t>(bela::cast_fromle<uint32_t>(e + 4))});
+    pos += compressed;
+  }
+  if (pos != tableStart) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"zstd: seek table does not match the frames");
+    return false;
+  }
+  return true;
+}
+
+// walkFrame follows the block headers of the next frame to its end, skippable frames are ignored
+bool FrameReader::walkFrame(bela::error_code &ec) {
+  while (walked < end) {
+    auto pos = walked;
+    uint8_t header[ZSTD_FRAMEHEADERSIZE_MAX];
+    auto n = static_cast<size_t>((std::min)(static_cast<int64_t>(sizeof(header)), end - pos));
+    if (!baulk::archive::ReadAt(fd, header, n, pos, ec)) {
+      return false;
+    }
+    ZSTD_FrameHeader fh;
+    if (auto result = ZSTD_getFrameHeader(&fh, header, n); result != 0) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"zstd: bad frame header at ", pos);
+      return false;
+    }
+    if (fh.frameType == ZSTD_skippableFrame) {
+      walked += fh.headerSize + static_cast<int64_t>(fh.frameContentSize);
+      continue;
+    }
+    auto p = pos + fh.headerSize;
+    for (;;) {
+      uint8_t bh[blockHeaderSize];
+      if (end - p < static_cast<int64_t>(blockHeaderSize)) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"zstd: truncated frame at ", pos);
+        return false;
+      }
+      if (!baulk::archive::ReadAt(fd, bh, sizeof(bh), p, ec)) {
+        return false;
+      }
+      auto v = static_cast<uint32_t>(bh[0]) | (static_cast<uint32_t>(bh[1]) << 8) | (static_cast<uint32_t>(bh[2]) << 16);
+      auto type = (v >> 1) & 3;
+      if (type == blockTypeReserved) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"zstd: reserved block type at ", p);
+        return false;
+      }
+      // RLE blocks store the repeated byte only
+      p += static_cast<int64_t>(blockHeaderSize) + (type == blockTypeRLE ? 1 : static_cast<int64_t>(v >> 3));
+      if ((v & 1) != 0) {
+        break;
+      }
+    }
+    if (fh.checksumFlag != 0) {
+      p += 4;
+    }
+    if (p > end) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"zstd: truncated frame at ", pos);
+      return false;
+    }
+    auto &f = frames.emplace_back(frame{.offset = pos,
+                                        .compressed = p - pos,
+                                        .contentOffset = contentSize,
+                                        .contentSize = fh.frameContentSize == ZSTD_CONTENTSIZE_UNKNOWN
+                                                           ? -1
+                                                           : static_cast<int64_t>(fh.frameContentSize)});
+    if (contentSize >= 0) {
+      contentSize = f.contentSize < 0 ? -1 : contentSize + f.contentSize;
+    }
+    walked = p;
+    break;
+  }
+  walkedAll = walked >= end;
+  return true;
+}
+
+bool FrameReader::Walk(bela::error_code &ec) {
+  while (!walkedAll) {
+    if (!walkFrame(ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FrameReader::Initialize(int64_t begin, bela::error_code &ec) {
+  contentSize = 0;
+  if (readSeekTable(begin, ec)) {
+    for (auto &f : frames) {
+      f.contentOffset = contentSize;
+      if (contentSize >= 0) {
+        contentSize = f.contentSize < 0 ? -1 : contentSize + f.contentSize;
+      }
+    }
+    walkedAll = true;
+  } else {
+    if (ec) {
+      return false;
+    }
+    // the other frames are walked as the reader reaches them, a stream of one frame is walked once
+    walked = begin;
+    while (!walkedAll && frames.size() < 2) {
+      if (!walkFrame(ec)) {
+        return false;
+      }
+    }
+  }
+  if (frames.empty()) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"zstd: no frames");
+    return false;
+  }
+  return true;
+}
+
+// decodeFrame appends the output of a frame until it ends or holds limit bytes, zds is created when it is null
+bool FrameReader::decodeFrame(job &j, ZSTD_DCtx *&zds, size_t limit, bela::error_code &ec) const {
+  if (zds == nullptr && (zds = createDCtx()) == nullptr) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"ZSTD_createDStream() out of memory");
+    return false;
+  }
+  if (j.in.capacity() == 0) {
+    // a session reset keeps the window and tables of the previous frame
+    ZSTD_DCtx_reset(zds, ZSTD_reset_session_only);
+    j.in.grow(ZSTD_DStreamInSize());
+    if (j.contentSize > 0) {
+      j.out.grow(static_cast<size_t>((std::min)(static_cast<uint64_t>(limit), static_cast<uint64_t>(j.contentSize))));
+    }
+  }
+  while (j.out.size() < limit) {
+    if (j.canceled) {
+      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+      return false;
+    }
+    if (j.out.size() == j.out.capacity()) {
+      j.out.grow((std::min)(limit, (std::max)(j.out.capacity() * 2, outsize)));
+    }
+    if (j.zin.pos == j.zin.size) {
+      if (j.inpos >= j.inend) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"zstd: truncated frame");
+        return false;
+      }
+      auto n = static_cast<size_t>((std::min)(static_cast<int64_t>(j.in.capacity()), j.inend - j.inpos));
+      if (!baulk::archive::ReadAt(fd, j.in.data(), n, j.inpos, ec)) {
+        return false;
+      }
+      j.inpos += static_cast<int64_t>(n);
+      j.zin = ZSTD_inBuffer{j.in.data(), n, 0};
+    }
+    ZSTD_outBuffer out{j.out.data() + j.out.size(), (std::min)(j.out.capacity(), limit) - j.out.size(), 0};
+    auto result = ZSTD_decompressStream(zds, &out, &j.zin);
+    if (ZSTD_isError(result) != 0) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"ZSTD_decompressStream: ",
+                                 bela::encode_into<char, wchar_t>(ZSTD_getErrorName(result)));
+      return false;
+    }
+    j.out.size() += out.pos;
+    j.produced += static_cast<int64_t>(out.pos);
+    if (result == 0) {
+      // zstd checks the size in the frame header, sizes from a seek table are checked here
+      if (j.contentSize >= 0 && j.produced != j.contentSize) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"zstd: frame size ", j.produced, L" want ", j.contentSize);
+        return false;
+      }
+      j.finished = true;
+      return true;
+    }
+  }
+  return true;
+}
+
+void FrameReader::work() {
+  ZSTD_DCtx *zds{nullptr};
+  auto closer = bela::finally([&] { ZSTD_freeDCtx(zds); });
+  for (;;) {
+    std::shared_ptr<job> j;
+    {
+      std::unique_lock lock(mu);
+      cv.wait(lock, [&] { return stopped || !tasks.empty(); });
+      if (stopped) {
+        return;
+      }
+      j = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    bela::error_code ec;
+    auto ok = decodeFrame(*j, zds, frameLimit, ec);
+    if (ok && !j->finished) {
+      // the reader decodes the rest of the frame with this context
+      j->zds = zds;
+      zds = nullptr;
+    }
+    {
+      std::scoped_lock lock(mu);
+      j->state = ok ? (j->finished ? job::Finished : job::Partial) : job::Failed;
+      j->ec = std::move(ec);
+    }
+    cv.notify_all();
+  }
+}
+
+void FrameReader::cancel() {
+  std::scoped_lock lock(mu);
+  for (auto &j : window) {
+    j->canceled = true;
+  }
+  window.clear();
+  tasks.clear();
+}
+
+bool FrameReader::Seek(int64_t pos, bela::error_code &ec) {
+  while (!walkedAll && frames.back().contentOffset >= 0 && frames.back().contentSize >= 0 &&
+         pos >= frames.back().contentOffset + frames.back().contentSize) {
+    if (!walkFrame(ec)) {
+      return false;
+    }
+  }
+  // frames with a known content offset come first
+  auto it = std::upper_bound(frames.begin(), frames.end(), pos, [](int64_t p, const frame &f) {
+    return f.contentOffset < 0 || p < f.contentOffset;
+  });
+  if (pos < 0 || it == frames.begin()) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"zstd: seek to invalid position ", pos);
+    return false;
+  }
+  const auto &f = *(it - 1);
+  if (pos != f.contentOffset && (f.contentSize < 0 || pos > f.contentOffset + f.contentSize)) {
+    ec = bela::make_error_code(bela::ErrUnimplemented, L"zstd: frames before ", pos, L" do not record their size");
+    return false;
+  }
+  cancel();
+  current.reset();
+  position = static_cast<size_t>(it - 1 - frames.begin());
+  scheduled = position;
+  skip = pos - f.contentOffset;
+  return true;
+}
+
+// next makes current a frame with unread output, at the end of the stream it returns false and leaves ec empty
+bool FrameReader::next(bela::error_code &ec) {
+  for (;;) {
+    if (current && skip > 0) {
+      auto n = (std::min)(static_cast<size_t>(skip), current->out.size() - current->out.pos());
+      current->out.pos() += n;
+      skip -= static_cast<int64_t>(n);
+    }
+    if (current && current->out.pos() < current->out.size()) {
+      return true;
+    }
+    if (current && !current->finished) {
+      // the frame outgrew its limit, decode the rest of it here
+      current->out.pos() = 0;
+      current->out.size() = 0;
+      if (!decodeFrame(*current, current->zds, streamChunkSize, ec)) {
+        return false;
+      }
+      continue;
+    }
+    current.reset();
+    while (!walkedAll && frames.size() < (std::max)(scheduled, position) + concurrency * 2) {
+      if (!walkFrame(ec)) {
+        return false;
+      }
+    }
+    if (position == frames.size()) {
+      return false;
+    }
+    std::unique_lock lock(mu);
+    if (workers.empty()) {
+      for (size_t i = 0; i < concurrency; i++) {
+        workers.emplace_back([this] { work(); });
+      }
+    }
+    scheduled = (std::max)(scheduled, position);
+    while (scheduled < frames.size() && window.size() < concurrency * 2) {
+      const auto &f = frames[scheduled++];
+      auto j = std::make_shared<job>();
+      j->inpos = f.offset;
+      j->inend = f.offset + f.compressed;
+      j->contentSize = f.contentSize;
+      window.emplace_back(j);
+      tasks.emplace_back(std::move(j));
+    }
+    cv.notify_all();
+    auto j = std::move(window.front());
+    window.pop_front();
+    cv.wait(lock, [&] { return j->state != job::Pending; });
+    if (j->state == job::Failed) {
+      ec = j->ec;
+      return false;
+    }
+    position++;
+    current = std::move(j);
+  }
+}
+
+ssize_t FrameReader::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (!next(ec)) {
+    return ec ? -1 : 0;
+  }
+  auto &out = current->out;
+  auto minsize = (std::min)(len, out.size() - out.pos());
+  memcpy(buffer, out.data() + out.pos(), minsize);
+  out.pos() += minsize;
+  return static_cast<ssize_t>(minsize);
+}
+
+bool FrameReader::Discard(int64_t len, bela::error_code &ec) {
+  while (len > 0) {
+    if (!next(ec)) {
+      return false;
+    }
+    auto &out = current->out;
+    auto minsize = (std::min)(static_cast<size_t>(len), out.size() - out.pos());
+    out.pos() += minsize;
+    len -= minsize;
+  }
+  return true;
+}
+
+bool FrameReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) {
+  while (filesize > 0) {
+    if (!next(ec)) {
+      return false;
+    }
+    auto &out = current->out;
+    auto minsize = (std::min)(static_cast<size_t>(filesize), out.size() - out.pos());
+    auto p = out.data() + out.pos();
+    out.pos() += minsize;
+    filesize -= minsize;
+    extracted += minsize;
+    if (!w(p, minsize, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const uint8_t> FrameReader::Peek(size_t len, bela::error_code &ec) {
+  if (!next(ec)) {
+    return {};
+  }
+  const auto &out = current->out;
+  return {out.data() + out.pos(), (std::min)(len, out.size() - out.pos())};
+}
+
+void FrameReader::Consume(size_t n) { current->out.pos() += n; }
+
+} // namespace baulk::archive::tar::zstd
@@ -16,6 +16,8 @@ public:
   ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
   bool Discard(int64_t len, bela::error_code &ec);
   bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
 
 private:
   bool decompress(bela::error_code &ec);
@@ -25,6 +27,63 @@ private:
   Buffer inb;
   ZSTD_inBuffer in{0};
 };
+
+// FrameReader decodes the frames of a zstd stream stored in [begin, end) of a file on a worker pool, each worker keeps
+// its own context and the output is returned in order. Frames come from the seek table of the seekable format when
+// the stream ends with one, otherwise from walking the frame and block headers a few frames ahead of the reader
+class FrameReader : public SeekableReader {
+public:
+  FrameReader(HANDLE fd_, int64_t end_, const ReaderOptions &opts);
+  FrameReader(const FrameReader &) = delete;
+  FrameReader &operator=(const FrameReader &) = delete;
+  ~FrameReader();
+  struct frame {
+    int64_t offset{0};
+    int64_t compressed{0};
+    int64_t contentOffset{-1}; // -1 when a frame before it has no content size
+    int64_t contentSize{-1};
+  };
+  // Initialize reads the seek table, or walks frames until it has found two of them or the end of the stream
+  bool Initialize(int64_t begin, bela::error_code &ec);
+  // Walk finds the frames Initialize left for the reader, Layout and ContentSize cover the whole stream afterwards
+  bool Walk(bela::error_code &ec);
+  [[nodiscard]] size_t Frames() const { return frames.size(); }
+  [[nodiscard]] const std::vector<frame> &Layout() const { return frames; }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  bool Discard(int64_t len, bela::error_code &ec);
+  bool WriteTo(const Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec);
+  std::span<const uint8_t> Peek(size_t len, bela::error_code &ec);
+  void Consume(size_t n);
+  bool Seek(int64_t pos, bela::error_code &ec);
+  [[nodiscard]] int64_t ContentSize() const { return contentSize; }
+
+private:
+  struct job;
+  bool readSeekTable(int64_t begin, bela::error_code &ec);
+  bool walkFrame(bela::error_code &ec);
+  bool decodeFrame(job &j, ZSTD_DCtx *&zds, size_t limit, bela::error_code &ec) const;
+  bool next(bela::error_code &ec);
+  void cancel();
+  void work();
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t end{0};
+  int64_t contentSize{-1};                // content offset of the next frame walked, -1 once a frame has no size
+  int64_t walked{0};                      // offset of the next frame to walk
+  int64_t skip{0};                        // output of the current frame before the position sought
+  std::vector<frame> frames;
+  size_t position{0};                     // next frame to return
+  size_t scheduled{0};                    // frames handed to the pool
+  std::deque<std::shared_ptr<job>> window; // scheduled frames not yet returned, in order
+  std::deque<std::shared_ptr<job>> tasks;
+  std::shared_ptr<job> current; // frame whose output is being read
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<std::thread> workers;
+  size_t concurrency{1};
+  size_t frameLimit{0}; // output one frame may hold before the reader streams the rest of it
+  bool walkedAll{false};
+  bool stopped{false};
+};
 } // namespace baulk::archive::tar::zstd
 
 #endif
\ No newline at end of file
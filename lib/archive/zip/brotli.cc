@@ -6,27 +6,28 @@ namespace baulk::archive::zip {
 
 // https://github.com/google/brotli/blob/master/c/tools/brotli.c#L884
 // Brotli
-bool Reader::decompressBrotli(const File &file, const Writer &w, bela::error_code &ec) const {
+bool decompressBrotli(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec) {
   auto state = BrotliDecoderCreateInstance(baulk::mem::allocate_simple, baulk::mem::deallocate_simple, nullptr);
   if (state == nullptr) {
     ec = bela::make_error_code(L"BrotliDecoderCreateInstance failed");
     return false;
   }
+  // brotli has no reset, every entry creates a new decoder instance
+  CountDecoderEvent(decoder_event::context_created);
   auto closer = bela::finally([&] { BrotliDecoderDestroyInstance(state); });
   BrotliDecoderSetParameter(state, BROTLI_DECODER_PARAM_LARGE_WINDOW, 1U);
-  Buffer out(outsize);
-  Buffer in(insize);
-  auto csize = file.compressed_size;
+  PooledBuffer out(outsize);
+  PooledBuffer in(insize);
   BrotliDecoderResult result{};
   size_t totalout = 0;
   Summator sum(file.crc32_value);
-  while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(insize));
-    if (!fd.ReadFull({in.data(), static_cast<size_t>(minsize)}, ec)) {
+  while (er.Remaining() != 0) {
+    std::span<const uint8_t> chunk;
+    if (!er.Fetch(in.data(), insize, chunk, ec)) {
       return false;
     }
-    auto avail_in = static_cast<size_t>(minsize);
-    const unsigned char *inptr = in.data();
+    auto avail_in = chunk.size();
+    const unsigned char *inptr = chunk.data();
     for (;;) {
       auto outptr = out.data();
       auto avail_out = outsize;
@@ -50,7 +51,6 @@ bool Reader::decompressBrotli(const File &file, const Writer &w, bela::error_cod
         break;
       }
     }
-    csize -= minsize;
     if (result == BROTLI_DECODER_RESULT_SUCCESS) {
       break;
     }
@@ -4,7 +4,7 @@
 
 namespace baulk::archive::zip {
 // bzip2
-bool Reader::decompressBz2(const File &file, const Writer &w, bela::error_code &ec) const {
+bool decompressBz2(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec) {
   bz_stream bzs{nullptr};
   bzs.bzalloc = baulk::mem::allocate_bz;
   bzs.bzfree = baulk::mem::deallocate_simple;
@@ -12,20 +12,20 @@ bool Reader::decompressBz2(const File &file, const Writer &w, bela::error_code &
     ec = bela::make_error_code(ret, L"BZ2_bzDecompressInit error");
     return false;
   }
+  // libbz2 has no reset, every entry initializes a new decompressor
+  CountDecoderEvent(decoder_event::context_created);
   auto closer = bela::finally([&] { BZ2_bzDecompressEnd(&bzs); });
-  Buffer out(outsize);
-  Buffer in(insize);
-  int64_t uncsize = 0;
-  auto csize = file.compressed_size;
+  PooledBuffer out(outsize);
+  PooledBuffer in(insize);
   int ret = BZ_OK;
   Summator sum(file.crc32_value);
-  while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(insize));
-    if (!fd.ReadFull({in.data(), static_cast<size_t>(minsize)}, ec)) {
+  while (er.Remaining() != 0) {
+    std::span<const uint8_t> chunk;
+    if (!er.Fetch(in.data(), insize, chunk, ec)) {
       return false;
     }
-    bzs.avail_in = static_cast<unsigned int>(minsize);
-    bzs.next_in = reinterpret_cast<char *>(in.data());
+    bzs.avail_in = static_cast<unsigned int>(chunk.size());
+    bzs.next_in = reinterpret_cast<char *>(const_cast<uint8_t *>(chunk.data()));
     do {
       bzs.avail_out = static_cast<int>(outsize);
       bzs.next_out = reinterpret_cast<char *>(out.data());
@@ -46,7 +46,6 @@ bool Reader::decompressBz2(const File &file, const Writer &w, bela::error_code &
         return false;
       }
     } while (bzs.avail_out == 0);
-    csize -= minsize;
     if (ret == BZ_STREAM_END) {
       break;
     }
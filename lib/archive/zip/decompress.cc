@@ -3,58 +3,45 @@
 #include "zipinternal.hpp"
 
 namespace baulk::archive::zip {
+// STORE entries read from a mapping are written in 1M slices
+constexpr size_t storeMappedChunk = 1024 * 1024;
 
-bool Reader::Decompress(const File &file, const Writer &w, bela::error_code &ec) const {
-  uint8_t buf[fileHeaderLen];
-  auto realPosition = file.position + baseOffset;
-  if (!fd.ReadAt({buf, fileHeaderLen}, realPosition, ec)) {
-    return false;
-  }
-  bela::endian::LittenEndian b(buf, sizeof(buf));
-  if (auto sig = b.Read<uint32_t>(); sig != fileHeaderSignature) {
-    ec = bela::make_error_code(L"zip: not a valid zip file");
-    return false;
-  }
-  b.Discard(22);
-  auto filenameLen = static_cast<int>(b.Read<uint16_t>());
-  auto extraLen = static_cast<int>(b.Read<uint16_t>());
-  auto position = realPosition + fileHeaderLen + filenameLen + extraLen;
-  if (!fd.Seek(position, ec)) {
-    return false;
-  }
+bool decompressEntry(const File &file, EntryReader &er, const Writer &w, const DecoderOptions &opts,
+                     bela::error_code &ec) {
   switch (file.method) {
   case ZIP_STORE: {
     uint8_t buffer[4096];
-    auto csize = file.compressed_size;
-    while (csize != 0) {
-      auto minsize = (std::min)(csize, static_cast<uint64_t>(sizeof(buffer)));
-      if (!fd.ReadFull({buffer, static_cast<size_t>(minsize)}, ec)) {
+    // a mapped entry is handed to the writer in large slices without copying
+    const size_t chunkSize = er.Mapped() ? storeMappedChunk : sizeof(buffer);
+    while (er.Remaining() != 0) {
+      std::span<const uint8_t> chunk;
+      if (!er.Fetch(buffer, chunkSize, chunk, ec)) {
         return false;
       }
-      if (!w(buffer, static_cast<size_t>(minsize))) {
+      if (!w(chunk.data(), chunk.size())) {
+        ec = bela::make_error_code(ErrCanceled, L"canceled");
         return false;
       }
-      csize -= minsize;
     }
   } break;
   case ZIP_DEFLATE:
-    return decompressDeflate(file, w, ec);
+    return decompressDeflate(file, er, w, ec);
   case ZIP_DEFLATE64:
-    return decompressDeflate64(file, w, ec);
+    return decompressDeflate64(file, er, w, ec);
   case 20:
     [[fallthrough]];
   case ZIP_ZSTD:
-    return decompressZstd(file, w, ec);
+    return decompressZstd(file, er, w, opts, ec);
   case ZIP_LZMA:
-    return decompressLZMA(file, w, ec);
+    return decompressLZMA(file, er, w, ec);
   case ZIP_XZ:
-    return decompressXz(file, w, ec);
+    return decompressXz(file, er, w, opts, ec);
   case ZIP_BZIP2:
-    return decompressBz2(file, w, ec);
+    return decompressBz2(file, er, w, ec);
   case ZIP_PPMD:
-    return decompressPpmd(file, w, ec);
+    return decompressPpmd(file, er, w, ec);
   case ZIP_BROTLI:
-    return decompressBrotli(file, w, ec);
+    return decompressBrotli(file, er, w, ec);
   default:
     ec = bela::make_error_code(ErrGeneral, L"unsupported zip method ", file.method);
     return false;
@@ -62,4 +49,91 @@ bool Reader::Decompress(const File &file, const Writer &w, bela::error_code &ec)
   return true;
 }
 
+bool Reader::EnableMapping(bela::error_code &ec) {
+  if (view) {
+    return true;
+  }
+  auto fileSize = fd.Size(ec);
+  if (fileSize == bela::SizeUnInitialized) {
+    return false;
+  }
+  auto v = MappedView::Map(fd.NativeFD(), fileSize, ec);
+  if (!v) {
+    return false;
+  }
+  view = std::move(*v);
+  return true;
+}
+
+// dataPosition skips the local file header, its name and extra field may differ from the central directory
+int64_t Reader::dataPosition(const File &file, bela::error_code &ec) const {
+  uint8_t buf[fileHeaderLen];
+  auto realPosition = static_cast<int64_t>(file.position) + baseOffset;
+  std::span<const uint8_t> header;
+  if (EntryReader hr(fd.NativeFD(), realPosition, fileHeaderLen, &view); !hr.Fetch(buf, fileHeaderLen, header, ec)) {
+    return -1;
+  }
+  bela::endian::LittenEndian b(header.data(), header.size());
+  if (auto sig = b.Read<uint32_t>(); sig != fileHeaderSignature) {
+    ec = bela::make_error_code(L"zip: not a valid zip file");
+    return -1;
+  }
+  b.Discard(22);
+  auto filenameLen = static_cast<int>(b.Read<uint16_t>());
+  auto extraLen = static_cast<int>(b.Read<uint16_t>());
+  return realPosition + fileHeaderLen + filenameLen + extraLen;
+}
+
+bool Reader::Decompress(const File &file, const Writer &w, bela::error_code &ec) const {
+  auto position = dataPosition(file, ec);
+  if (position < 0) {
+    return false;
+  }
+  EntryReader er(fd.NativeFD(), position, file.compressed_size, &view);
+  return decompressEntry(file, er, w, decoderOptions, ec);
+}
+
+bool Reader::CopyStored(const File &file, baulk::archive::File &out, bela::error_code &ec) const {
+  if (file.method != ZIP_STORE || file.compressed_size != file.uncompressed_size) {
+    ec = bela::make_error_code(ErrGeneral, L"zip: ", bela::encode_into<char, wchar_t>(file.name), L" is not stored");
+    return false;
+  }
+  auto position = dataPosition(file, ec);
+  if (position < 0) {
+    return false;
+  }
+  auto length = static_cast<int64_t>(file.compressed_size);
+  // like Summator, an entry without a crc32 is not checked
+  if (file.crc32_value == 0) {
+    return CopyRange(fd.NativeFD(), position, out, length, ec);
+  }
+  // the bytes copied through the buffer are summed as they pass, cloned clusters never do and are read once more
+  uint32_t tail = 0;
+  int64_t cloned = 0;
+  if (!CopyRange(
+          fd.NativeFD(), position, out, length,
+          [&](const void *data, size_t len) { tail = Crc32(data, len, tail); }, cloned, ec)) {
+    return false;
+  }
+  auto crc = tail;
+  if (cloned != 0) {
+    uint32_t head = 0;
+    uint8_t buffer[64 * 1024];
+    EntryReader er(fd.NativeFD(), position, static_cast<uint64_t>(cloned), &view);
+    while (er.Remaining() != 0) {
+      std::span<const uint8_t> chunk;
+      if (!er.Fetch(buffer, er.Mapped() ? storeMappedChunk : sizeof(buffer), chunk, ec)) {
+        return false;
+      }
+      head = Crc32(chunk.data(), chunk.size(), head);
+    }
+    crc = Crc32Combine(head, tail, static_cast<uint64_t>(length - cloned));
+  }
+  if (crc != file.crc32_value) {
+    ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32_value, L" got ", crc, L" not match");
+    return false;
+  }
+  return true;
+}
+
 } // namespace baulk::archive::zip
\ No newline at end of file
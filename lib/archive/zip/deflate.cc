@@ -3,34 +3,68 @@
 #include <zlib-ng.h>
 
 namespace baulk::archive::zip {
+namespace {
+// inflater keeps the calling thread's zng_stream, zng_inflateReset reuses its state and window
+class inflater {
+public:
+  inflater() = default;
+  inflater(const inflater &) = delete;
+  inflater &operator=(const inflater &) = delete;
+  ~inflater() {
+    if (initialized) {
+      zng_inflateEnd(&zs);
+    }
+  }
+  zng_stream *acquire(bela::error_code &ec) {
+    if (initialized) {
+      if (zng_inflateReset(&zs) == Z_OK) {
+        CountDecoderEvent(decoder_event::context_reused);
+        return &zs;
+      }
+      zng_inflateEnd(&zs);
+      initialized = false;
+    }
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = baulk::mem::allocate_zlib;
+    zs.zfree = baulk::mem::deallocate_simple;
+    if (auto zerr = zng_inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
+      ec = bela::make_error_code(ErrGeneral, bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+      return nullptr;
+    }
+    initialized = true;
+    CountDecoderEvent(decoder_event::context_created);
+    return &zs;
+  }
+
+private:
+  zng_stream zs;
+  bool initialized{false};
+};
+thread_local inflater threadInflater;
+} // namespace
+
 // DEFLATE
 // https://github.com/madler/zlib/blob/master/examples/zpipe.c#L92
-bool Reader::decompressDeflate(const File &file, const Writer &w, bela::error_code &ec) const {
-  zng_stream zs;
-  zs.zalloc = baulk::mem::allocate_zlib;
-  zs.zfree = baulk::mem::deallocate_simple;
-  memset(&zs, 0, sizeof(zs));
-  if (auto zerr = zng_inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
-    ec = bela::make_error_code(ErrGeneral, bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+bool decompressDeflate(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec) {
+  auto zsp = threadInflater.acquire(ec);
+  if (zsp == nullptr) {
     return false;
   }
-  auto closer = bela::finally([&] { zng_inflateEnd(&zs); });
-  Buffer out(outsize);
-  Buffer in(insize);
-  int64_t uncsize = 0;
-  auto csize = file.compressed_size;
+  auto &zs = *zsp;
+  PooledBuffer out(outsize);
+  PooledBuffer in(insize);
   int ret = Z_OK;
   Summator sum(file.crc32_value);
-  while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(insize));
-    if (!fd.ReadFull({in.data(), static_cast<size_t>(minsize)}, ec)) {
+  while (er.Remaining() != 0) {
+    std::span<const uint8_t> chunk;
+    if (!er.Fetch(in.data(), insize, chunk, ec)) {
       return false;
     }
-    zs.avail_in = static_cast<int>(minsize);
+    zs.avail_in = static_cast<uint32_t>(chunk.size());
     if (zs.avail_in == 0) {
       break;
     }
-    zs.next_in = in.data();
+    zs.next_in = chunk.data();
     do {
       zs.avail_out = static_cast<int>(outsize);
       zs.next_out = out.data();
@@ -54,11 +88,16 @@ bool Reader::decompressDeflate(const File &file, const Writer &w, bela::error_co
         return false;
       }
     } while (zs.avail_out == 0);
-    csize -= minsize;
     if (ret == Z_STREAM_END) {
+      // input past the end of the deflate stream belongs to whatever follows the entry
+      er.Unread(zs.avail_in);
       break;
     }
   }
+  if (ret != Z_STREAM_END && er.Remaining() == EntryReader::unknownSize) {
+    ec = bela::make_error_code(ErrGeneral, L"zip: deflate stream truncated");
+    return false;
+  }
   if (!sum.Valid()) {
     ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32_value, L" got ", sum.Current(), L" not match");
     return false;
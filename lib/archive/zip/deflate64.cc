@@ -26,44 +26,27 @@ int put(void *out_desc, unsigned char *buf, unsigned len) {
 }
 
 struct inflate64Reader {
-  HANDLE fd{INVALID_HANDLE_VALUE};
+  EntryReader &er;
   uint8_t *buf{nullptr};
-  int64_t count{0};
-  int64_t offset{0};
-  int64_t size{0};
+  bela::error_code ec;
 };
 
 unsigned get(void *in_desc, const uint8_t **buf) {
   auto r = reinterpret_cast<inflate64Reader *>(in_desc);
-  auto next = r->buf;
-  if (buf != nullptr) {
-    *buf = next;
-  }
-  auto want = (std::min)(CHUNK, static_cast<DWORD>(r->size - r->offset));
-  if (want == 0) {
+  std::span<const uint8_t> chunk;
+  if (!r->er.Fetch(r->buf, CHUNK, chunk, r->ec)) {
     return 0;
   }
-  DWORD got = 0;
-  for (;;) {
-    if (::ReadFile(r->fd, next, want, &got, nullptr) != TRUE) {
-      return 0;
-    }
-    next += got;
-    want -= got;
-    if (got == 0 || want == 0) {
-      break;
-    }
+  if (buf != nullptr) {
+    *buf = chunk.data();
   }
-  auto len = CHUNK - want;
-  r->count += len;
-  r->offset += len;
-  return len;
+  return static_cast<unsigned>(chunk.size());
 }
 
 // DEFLATE64
-bool Reader::decompressDeflate64(const File &file, const Writer &w, bela::error_code &ec) const {
-  Buffer window(65536);
-  Buffer chunk(CHUNK);
+bool decompressDeflate64(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec) {
+  PooledBuffer window(65536);
+  PooledBuffer chunk(CHUNK);
   zng_stream zs;
   memset(&zs, 0, sizeof(zs));
   zs.zalloc = baulk::mem::allocate_zlib;
@@ -81,12 +64,16 @@ bool Reader::decompressDeflate64(const File &file, const Writer &w, bela::error_
       .count = 0,
       .canceled = false //
   };
-  inflate64Reader r{fd.NativeFD(), chunk.data(), 0, 0, static_cast<int64_t>(file.compressed_size)};
+  inflate64Reader r{.er = er, .buf = chunk.data()};
   ret = inflateBack9(&zs, get, &r, put, &iw);
   if (iw.canceled) {
     ec = bela::make_error_code(ErrCanceled, L"canceled");
     return false;
   }
+  if (r.ec) {
+    ec = std::move(r.ec);
+    return false;
+  }
   if (ret != Z_STREAM_END) {
     ec = bela::make_error_code(L"deflate64 compressed data corrupted");
     return false;
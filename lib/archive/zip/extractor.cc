@@ -0,0 +1,233 @@
+///
+#include <baulk/archive/extractor.hpp>
+
+namespace baulk::archive::zip {
+
+bool Extractor::Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
+  std::error_code e;
+  if (fs::create_directories(destination, e); e) {
+    ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", destination, L"' "));
+    return false;
+  }
+  extract_plan plan;
+  if (!make_plan(filter, plan, ec)) {
+    return false;
+  }
+  for (const auto &dir : plan.directories) {
+    if (!NewDirectory(dir, ec)) {
+      return false;
+    }
+  }
+  for (auto &t : plan.targets) {
+    if (t.file == nullptr || !t.file->IsSymlink()) {
+      continue;
+    }
+    auto linkname = EncodeToNativePath(reader.ResolveLinkName(*t.file, ec), t.file->IsFileNameUTF8(),
+                                       reader.NameCharset());
+    if (!NewSymlinkBelow(destination, t.out, linkname, opts.overwrite_mode, ec) && !opts.ignore_error) {
+      return false;
+    }
+    t.file = nullptr;
+  }
+  std::erase_if(plan.targets, [](const entry_task &t) { return t.file == nullptr; });
+  if (opts.small_file_size != 0) {
+    pool = std::make_unique<FilePool>();
+  }
+  auto closer = bela::finally([&] { pool.reset(); });
+  if (auto threads = Concurrency(opts.threads); threads > 1) {
+    if (!extract_parallel(plan.targets, progress, threads, ec)) {
+      return false;
+    }
+  } else {
+    for (const auto &t : plan.targets) {
+      if (!extract_file(*t.file, t.out, progress, ec)) {
+        if (ec.code == bela::ErrCanceled || opts.ignore_error == false) {
+          return false;
+        }
+      }
+    }
+  }
+  if (pool && !pool->Wait(ec) && !opts.ignore_error) {
+    return false;
+  }
+  // the files written into directories changed their times, children are set before their parents
+  for (auto it = plan.folders.rbegin(); it != plan.folders.rend(); it++) {
+    if (!Chtimes(it->out, it->file->time, ec) && !opts.ignore_error) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// fold_case maps paths that name the same file on a case-insensitive file system to the same key
+std::wstring Extractor::fold_case(const fs::path &p) {
+  std::wstring s(p.native());
+  CharUpperBuffW(s.data(), static_cast<DWORD>(s.size()));
+  return s;
+}
+
+bool Extractor::make_plan(const Filter &filter, extract_plan &plan, bela::error_code &ec) {
+  auto root = destination.lexically_normal();
+  auto rootSize = root.native().size();
+  if (rootSize > 0 && bela::IsPathSeparator(root.native().back())) {
+    rootSize--;
+  }
+  std::unordered_set<std::wstring> directories;
+  std::unordered_map<std::wstring, size_t> written; // folded target -> index in plan.targets
+  auto add_directories = [&](const fs::path &dir) {
+    std::vector<fs::path> chain;
+    for (auto p = dir; p.native().size() > rootSize && !directories.contains(fold_case(p)); p = p.parent_path()) {
+      chain.emplace_back(p);
+      if (p.parent_path() == p) {
+        break;
+      }
+    }
+    // a directory is only added after its parents
+    for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+      directories.emplace(fold_case(*it));
+      plan.directories.emplace_back(std::move(*it));
+    }
+  };
+  // the whole central directory is known, the folders to flatten are found before anything is written
+  auto strip = opts.strip_components;
+  if (opts.flatten) {
+    Flattener flattener;
+    for (const auto &file : reader.Files()) {
+      if (auto name = StripComponents(file.name, strip); !name.empty()) {
+        flattener.Add(name, file.IsDir());
+      }
+    }
+    strip += static_cast<uint32_t>(flattener.Depth());
+  }
+  plan.targets.reserve(reader.Files().size());
+  for (const auto &file : reader.Files()) {
+    std::string_view name = file.name;
+    if (strip != 0) {
+      if (name = StripComponents(name, strip); name.empty()) {
+        continue;
+      }
+    }
+    std::wstring encoded_path;
+    auto out = baulk::archive::JoinSanitizeFsPath(destination, name, file.IsFileNameUTF8(), reader.NameCharset(),
+                                                  encoded_path);
+    if (!out) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", bela::encode_into<char, wchar_t>(file.name));
+      if (!opts.ignore_error) {
+        return false;
+      }
+      continue;
+    }
+    if (filter && !filter(file, encoded_path)) {
+      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+      return false;
+    }
+    auto target = out->lexically_normal();
+    if (file.IsDir()) {
+      add_directories(target);
+      plan.folders.emplace_back(entry_task{.file = &file, .out = std::move(target)});
+      continue;
+    }
+    add_directories(target.parent_path());
+    // the last entry with a path wins, as when entries overwrote each other in archive order
+    if (auto [it, inserted] = written.try_emplace(fold_case(target), plan.targets.size()); !inserted) {
+      plan.targets[it->second].file = nullptr;
+      it->second = plan.targets.size();
+    }
+    plan.targets.emplace_back(entry_task{.file = &file, .out = std::move(target)});
+  }
+  for (const auto &[folded, index] : written) {
+    if (!directories.contains(folded)) {
+      continue;
+    }
+    ec = bela::make_error_code(bela::ErrGeneral, L"'", plan.targets[index].out.native(),
+                               L"' is both a file and a directory");
+    if (!opts.ignore_error) {
+      return false;
+    }
+    plan.targets[index].file = nullptr;
+  }
+  return true;
+}
+
+bool Extractor::extract_file(const File &file, const fs::path &out, const OnProgress &progress, bela::error_code &ec) {
+  if (pool && file.uncompressed_size <= opts.small_file_size) {
+    // the whole file is handed to the pool, it is created and written there with a single call
+    std::vector<uint8_t> buffer;
+    buffer.reserve(static_cast<size_t>(file.uncompressed_size));
+    if (!reader.Decompress(
+            file,
+            [&](const void *data, size_t len) {
+              if (progress && !progress(len)) {
+                // canceled
+                return false;
+              }
+              auto p = static_cast<const uint8_t *>(data);
+              buffer.insert(buffer.end(), p, p + len);
+              return true;
+            },
+            ec)) {
+      return false;
+    }
+    pool->Write(fs::path(out), std::move(buffer), file.time, opts.overwrite_mode, false);
+    return true;
+  }
+  auto fd = baulk::archive::File::Create(out, file.time, opts.overwrite_mode, ec);
+  if (!fd) {
+    return false;
+  }
+  if (file.method == ZIP_STORE && !file.IsEncrypted()) {
+    // stored entries are copied range to range, on ReFS and Dev Drive the clusters are cloned
+    if (!reader.CopyStored(file, *fd, ec)) {
+      return false;
+    }
+    if (progress && !progress(static_cast<size_t>(file.uncompressed_size))) {
+      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+      return false;
+    }
+    if (pool) {
+      pool->Close(out, std::move(*fd));
+    }
+    return true;
+  }
+  std::optional<LargeFile> large;
+  if (opts.large_file_size != 0 && file.uncompressed_size >= opts.large_file_size) {
+    large.emplace(*fd);
+    large->Initialize(static_cast<int64_t>(file.uncompressed_size), opts.mapped_writes);
+  }
+  bela::error_code writeEc;
+  if (!reader.Decompress(
+          file,
+          [&](const void *data, size_t len) {
+            if (progress && !progress(len)) {
+              // canceled
+              return false;
+            }
+            return large ? large->Write(data, len, writeEc) : fd->WriteFull(data, len, writeEc);
+          },
+          ec)) {
+    return false;
+  }
+  if (large && !large->Finish(file.time, ec)) {
+    return false;
+  }
+  if (pool) {
+    pool->Close(out, std::move(*fd));
+  }
+  return true;
+}
+
+// extract_parallel: regular files are decompressed by a worker pool, largest entries first so that one huge file
+// does not finish last
+bool Extractor::extract_parallel(std::vector<entry_task> &tasks, const OnProgress &progress, uint32_t threads,
+                                 bela::error_code &ec) {
+  std::ranges::stable_sort(tasks, std::ranges::greater{},
+                           [](const entry_task &t) { return t.file->uncompressed_size; });
+  return RunWorkers(
+      threads, tasks.size(), opts.ignore_error, progress,
+      [&](size_t i, const OnProgress &lockedProgress, bela::error_code &e) {
+        return extract_file(*tasks[i].file, tasks[i].out, lockedProgress, e);
+      },
+      ec);
+}
+
+} // namespace baulk::archive::zip
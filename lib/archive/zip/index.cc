@@ -0,0 +1,57 @@
+///
+#include <algorithm>
+#include <bela/ascii.hpp>
+#include "zipinternal.hpp"
+
+namespace baulk::archive::zip {
+
+const File *Reader::Find(std::string_view name, bool ignore_case) const {
+  if (!index) {
+    return nullptr;
+  }
+  if (!ignore_case) {
+    std::call_once(index->exact_once, [&] {
+      index->exact.reserve(files.size());
+      for (size_t i = 0; i < files.size(); i++) {
+        // duplicate names: the last entry wins, as when extracting
+        index->exact.insert_or_assign(files[i].name, i);
+      }
+    });
+    if (auto it = index->exact.find(name); it != index->exact.end()) {
+      return &files[it->second];
+    }
+    return nullptr;
+  }
+  std::call_once(index->folded_once, [&] {
+    index->folded.reserve(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+      index->folded.insert_or_assign(bela::AsciiStrToLower(files[i].name), i);
+    }
+  });
+  if (auto it = index->folded.find(bela::AsciiStrToLower(name)); it != index->folded.end()) {
+    return &files[it->second];
+  }
+  return nullptr;
+}
+
+std::vector<const File *> Reader::List(std::string_view prefix) const {
+  std::vector<const File *> entries;
+  if (!index) {
+    return entries;
+  }
+  std::call_once(index->sorted_once, [&] {
+    index->sorted.resize(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+      index->sorted[i] = i;
+    }
+    std::ranges::stable_sort(index->sorted, [&](size_t a, size_t b) { return files[a].name < files[b].name; });
+  });
+  auto first = std::ranges::lower_bound(index->sorted, prefix, std::less<>{},
+                                        [&](size_t i) { return files[i].name; });
+  for (auto it = first; it != index->sorted.end() && files[*it].name.starts_with(prefix); it++) {
+    entries.emplace_back(&files[*it]);
+  }
+  return entries;
+}
+
+} // namespace baulk::archive::zip
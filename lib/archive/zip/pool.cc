@@ -0,0 +1,53 @@
+///
+#include "zipinternal.hpp"
+#include <atomic>
+
+namespace baulk::archive::zip {
+namespace {
+// an entry holds at most an input and an output buffer (ppmd: cache and output), keep a few spare ones
+constexpr size_t pooledBuffersLimit = 6;
+std::atomic_uint64_t decoderCounters[4];
+thread_local std::vector<Buffer> pooledBuffers;
+} // namespace
+
+void CountDecoderEvent(decoder_event e) {
+  decoderCounters[static_cast<int>(e)].fetch_add(1, std::memory_order_relaxed);
+}
+
+DecoderStatistics DecoderStats() {
+  return DecoderStatistics{
+      .contexts_created = decoderCounters[static_cast<int>(decoder_event::context_created)].load(),
+      .contexts_reused = decoderCounters[static_cast<int>(decoder_event::context_reused)].load(),
+      .buffers_allocated = decoderCounters[static_cast<int>(decoder_event::buffer_allocated)].load(),
+      .buffers_reused = decoderCounters[static_cast<int>(decoder_event::buffer_reused)].load(),
+  };
+}
+
+PooledBuffer::PooledBuffer(size_t size) {
+  auto &pool = pooledBuffers;
+  // best fit: the smallest cached buffer that is large enough
+  auto best = pool.end();
+  for (auto it = pool.begin(); it != pool.end(); it++) {
+    if (it->capacity() >= size && (best == pool.end() || it->capacity() < best->capacity())) {
+      best = it;
+    }
+  }
+  if (best != pool.end()) {
+    buffer = std::move(*best);
+    pool.erase(best);
+    CountDecoderEvent(decoder_event::buffer_reused);
+    return;
+  }
+  buffer.grow(size);
+  CountDecoderEvent(decoder_event::buffer_allocated);
+}
+
+PooledBuffer::~PooledBuffer() {
+  if (buffer.capacity() == 0 || pooledBuffers.size() >= pooledBuffersLimit) {
+    return;
+  }
+  buffer.size() = 0;
+  pooledBuffers.emplace_back(std::move(buffer));
+}
+
+} // namespace baulk::archive::zip
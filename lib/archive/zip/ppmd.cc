@@ -9,46 +9,30 @@ using bela::ssize_t;
 constexpr auto BufferSize = static_cast<size_t>(1) << 20;
 class SectionReader {
 public:
-  SectionReader(HANDLE fd_, int64_t len) : fd(fd_), size(len) { cacheb.grow(32 * 1024); }
+  SectionReader(EntryReader &er_) : er(er_) {}
   SectionReader(const SectionReader &) = delete;
   SectionReader &operator=(const SectionReader &) = delete;
-  [[nodiscard]] ssize_t Buffered() const { return w - r; }
-  [[nodiscard]] int64_t AvailableBytes() const { return size - offset; }
+  [[nodiscard]] ssize_t Buffered() const { return static_cast<ssize_t>(chunk.size()); }
+  [[nodiscard]] int64_t AvailableBytes() const { return static_cast<int64_t>(er.Remaining()); }
   ssize_t Read(void *buffer, ssize_t len) {
     if (buffer == nullptr || len == 0) {
       ec = bela::make_error_code(L"buffer is nil");
       return -1;
     }
-    if (r == w) {
-      if (static_cast<size_t>(len) > cacheb.capacity()) {
-        // Large read, empty buffer.
-        // Read directly into p to avoid copy.
-        ssize_t rlen = 0;
-        if (!fsread(buffer, len, rlen, ec)) {
-          return -1;
-        }
-        return rlen;
-      }
-      w = 0;
-      r = 0;
+    if (chunk.empty()) {
       // section EOF support
-      DWORD dwRead = static_cast<DWORD>((std::min)(cacheb.capacity(), static_cast<size_t>(size - offset)));
-      if (dwRead == 0) {
+      if (er.Remaining() == 0) {
         ec = bela::make_error_code(ERROR_HANDLE_EOF, L"unexpected EOF");
         return -1;
       }
-      if (!fsread(cacheb.data(), dwRead, w, ec)) {
-        return -1;
-      }
-      if (w == 0) {
-        ec = bela::make_error_code(ERROR_HANDLE_EOF, L"unexpected EOF");
+      if (!er.Fetch(cacheb.data(), cacheb.capacity(), chunk, ec)) {
         return -1;
       }
     }
-    auto n = (std::min)(w - r, len);
-    memcpy(buffer, cacheb.data() + r, n);
-    r += n;
-    return n;
+    auto n = (std::min)(static_cast<size_t>(len), chunk.size());
+    memcpy(buffer, chunk.data(), n);
+    chunk = chunk.subspan(n);
+    return static_cast<ssize_t>(n);
   }
   ssize_t ReadFull(void *buffer, ssize_t len) {
     auto p = reinterpret_cast<uint8_t *>(buffer);
@@ -69,24 +53,10 @@ public:
   const auto &ErrorCode() { return ec; }
 
 private:
-  // reference please don't close it
-  Buffer cacheb;
-  HANDLE fd{INVALID_HANDLE_VALUE};
-  int64_t size{0};
-  int64_t offset{0};
-  ssize_t w{0};
-  ssize_t r{0};
+  PooledBuffer cacheb{32 * 1024};
+  EntryReader &er;
+  std::span<const uint8_t> chunk;
   bela::error_code ec;
-  bool fsread(void *b, ssize_t len, ssize_t &rlen, bela::error_code &ec) {
-    DWORD dwSize = {0};
-    if (ReadFile(fd, b, static_cast<DWORD>(len), &dwSize, nullptr) != TRUE) {
-      ec = bela::make_system_error_code(L"ReadFile: ");
-      return false;
-    }
-    rlen = len;
-    offset += len;
-    return true;
-  }
 };
 
 struct CByteInToLook {
@@ -119,15 +89,39 @@ static void SzBigFree(ISzAllocPtr p, void *address) {
 
 const ISzAlloc g_BigAlloc = {SzBigAlloc, SzBigFree};
 
-bool Reader::decompressPpmd(const File &file, const Writer &w, bela::error_code &ec) const {
-  SectionReader sr(fd.NativeFD(), file.compressed_size);
+namespace {
+// ppmd model memory larger than this is released after the entry instead of kept for the thread
+constexpr uint32_t ppmdCachedMemoryLimit = 32 << 20;
+// ppmdmodel keeps the calling thread's model memory, Ppmd8_Alloc reuses it when the size matches
+class ppmdmodel {
+public:
+  ppmdmodel() { Ppmd8_Construct(&ppmd); }
+  ppmdmodel(const ppmdmodel &) = delete;
+  ppmdmodel &operator=(const ppmdmodel &) = delete;
+  ~ppmdmodel() { Ppmd8_Free(&ppmd, &g_BigAlloc); }
+  CPpmd8 *acquire(uint32_t size) {
+    CountDecoderEvent((ppmd.Base != nullptr && ppmd.Size == size) ? decoder_event::context_reused
+                                                                   : decoder_event::context_created);
+    return &ppmd;
+  }
+  void release() {
+    if (ppmd.Size > ppmdCachedMemoryLimit) {
+      Ppmd8_Free(&ppmd, &g_BigAlloc);
+    }
+    ppmd.Stream.In = nullptr;
+  }
+
+private:
+  CPpmd8 ppmd = {nullptr};
+};
+thread_local ppmdmodel threadPpmdModel;
+} // namespace
+
+bool decompressPpmd(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec) {
+  SectionReader sr(er);
   CByteInToLook s;
   s.vt.Read = ppmd_read;
   s.sr = &sr;
-  CPpmd8 _ppmd = {nullptr};
-  _ppmd.Stream.In = reinterpret_cast<IByteIn *>(&s);
-  Ppmd8_Construct(&_ppmd);
-  auto closer = bela::finally([&] { Ppmd8_Free(&_ppmd, &g_BigAlloc); });
   uint8_t buf[8];
   if (sr.ReadFull(buf, 2) != 2) {
     ec = sr.ErrorCode();
@@ -141,6 +135,9 @@ bool Reader::decompressPpmd(const File &file, const Writer &w, bela::error_code
     ec = bela::make_error_code(L"PPMd compressed data corrupted");
     return false;
   }
+  auto &_ppmd = *threadPpmdModel.acquire(mem << 20);
+  auto closer = bela::finally([&] { threadPpmdModel.release(); });
+  _ppmd.Stream.In = reinterpret_cast<IByteIn *>(&s);
   if (Ppmd8_Alloc(&_ppmd, mem << 20, &g_BigAlloc) == 0) {
     ec = bela::make_error_code(L"Allocate Memory Failed");
     return false;
@@ -150,7 +147,7 @@ bool Reader::decompressPpmd(const File &file, const Writer &w, bela::error_code
     return false;
   }
   Ppmd8_Init(&_ppmd, order, restor);
-  Buffer out(BufferSize);
+  PooledBuffer out(BufferSize);
   Summator sum(file.crc32_value);
   for (;;) {
     auto ob = out.data();
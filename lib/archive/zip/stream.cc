@@ -0,0 +1,369 @@
+///
+#include <bela/endian.hpp>
+#include "zipinternal.hpp"
+
+namespace baulk::archive::zip {
+constexpr uint32_t SizeMin = 0xFFFFFFFFU;
+
+bool StreamSource::Fetch(size_t maxsize, std::span<const uint8_t> &chunk, bela::error_code &ec) {
+  auto want = (std::min)(maxsize, buffer.capacity());
+  if (buffer.size() - pos < want && !eof) {
+    // keep unread bytes, then refill behind them
+    auto buffered = buffer.size() - pos;
+    if (pos != 0) {
+      memmove(buffer.data(), buffer.data() + pos, buffered);
+      buffer.size() = buffered;
+      pos = 0;
+    }
+    while (buffer.size() < want && !eof) {
+      auto n = r->Read(buffer.data() + buffer.size(), buffer.capacity() - buffer.size(), ec);
+      if (n < 0) {
+        if (ec != bela::ErrEnded) {
+          return false;
+        }
+        ec.clear();
+        n = 0;
+      }
+      if (n == 0) {
+        eof = true;
+        break;
+      }
+      buffer.size() += static_cast<size_t>(n);
+      pulled += static_cast<uint64_t>(n);
+    }
+  }
+  auto n = (std::min)(want, buffer.size() - pos);
+  chunk = {buffer.data() + pos, n};
+  pos += n;
+  return true;
+}
+
+bool StreamSource::ReadFull(void *data, size_t len, bela::error_code &ec) {
+  // len never exceeds the buffer, a single fetch is short only at the end of input
+  std::span<const uint8_t> chunk;
+  if (!Fetch(len, chunk, ec)) {
+    return false;
+  }
+  if (chunk.size() != len) {
+    ec = bela::make_error_code(ERROR_HANDLE_EOF, L"zip: unexpected EOF");
+    return false;
+  }
+  memcpy(data, chunk.data(), len);
+  return true;
+}
+
+bool StreamSource::Discard(uint64_t len, bela::error_code &ec) {
+  while (len != 0) {
+    std::span<const uint8_t> chunk;
+    if (!Fetch(static_cast<size_t>((std::min)(len, static_cast<uint64_t>(buffer.capacity()))), chunk, ec)) {
+      return false;
+    }
+    if (chunk.empty()) {
+      ec = bela::make_error_code(ERROR_HANDLE_EOF, L"zip: unexpected EOF");
+      return false;
+    }
+    len -= chunk.size();
+  }
+  return true;
+}
+
+StreamReader::StreamReader(tar::ExtractReader *r) : source(std::make_unique<StreamSource>(r)) {}
+StreamReader::~StreamReader() = default;
+
+/*
+      local file header signature     4 bytes  (0x04034b50)
+      version needed to extract       2 bytes
+      general purpose bit flag        2 bytes
+      compression method              2 bytes
+      last mod file time              2 bytes
+      last mod file date              2 bytes
+      crc-32                          4 bytes
+      compressed size                 4 bytes
+      uncompressed size               4 bytes
+      file name length                2 bytes
+      extra field length              2 bytes
+
+      file name (variable size)
+      extra field (variable size)
+*/
+std::optional<File> StreamReader::Next(bela::error_code &ec) {
+  if (ended) {
+    ec = bela::make_error_code(bela::ErrEnded, L"zip: end of entries");
+    return std::nullopt;
+  }
+  if (pending && !skipPayload(ec)) {
+    return std::nullopt;
+  }
+  auto offset = source->Offset();
+  uint8_t buf[fileHeaderLen];
+  if (!source->ReadFull(buf, 4, ec)) {
+    return std::nullopt;
+  }
+  auto sig = bela::cast_fromle<uint32_t>(buf);
+  if (sig == directoryHeaderSignature || sig == directoryEndSignature || sig == directory64EndSignature) {
+    source->Unread(4);
+    ended = true;
+    ec = bela::make_error_code(bela::ErrEnded, L"zip: end of entries");
+    return std::nullopt;
+  }
+  if (sig != fileHeaderSignature) {
+    ec = bela::make_error_code(L"zip: not a valid zip file");
+    return std::nullopt;
+  }
+  if (!source->ReadFull(buf + 4, fileHeaderLen - 4, ec)) {
+    return std::nullopt;
+  }
+  bela::endian::LittenEndian b(buf + 4, fileHeaderLen - 4);
+  current = File{};
+  current.version_needed = b.Read<uint16_t>();
+  current.flags = b.Read<uint16_t>();
+  current.method = b.Read<uint16_t>();
+  auto dosTime = b.Read<uint16_t>();
+  auto dosDate = b.Read<uint16_t>();
+  current.crc32_value = b.Read<uint32_t>();
+  current.compressed_size = b.Read<uint32_t>();
+  current.uncompressed_size = b.Read<uint32_t>();
+  auto filenameLen = b.Read<uint16_t>();
+  auto extraLen = b.Read<uint16_t>();
+  header.resize(static_cast<size_t>(filenameLen) + extraLen);
+  if (!source->ReadFull(header.data(), header.size(), ec)) {
+    return std::nullopt;
+  }
+  current.position = offset;
+  current.name = bela::cstring_view({header.data(), filenameLen});
+  zip64 = false;
+  bela::Time modified;
+  bela::endian::LittenEndian extra(header.data() + filenameLen, extraLen);
+  for (; extra.Size() >= 4;) {
+    auto fieldTag = extra.Read<uint16_t>();
+    auto fieldSize = static_cast<int>(extra.Read<uint16_t>());
+    if (extra.Size() < static_cast<size_t>(fieldSize)) {
+      break;
+    }
+    auto fb = extra.Sub(fieldSize);
+    if (fieldTag == zip64ExtraID) {
+      // local zip64 extra: uncompressed size then compressed size, data descriptor sizes become 8 bytes
+      zip64 = true;
+      if (current.uncompressed_size == SizeMin && fb.Size() >= 8) {
+        current.uncompressed_size = fb.Read<uint64_t>();
+      }
+      if (current.compressed_size == SizeMin && fb.Size() >= 8) {
+        current.compressed_size = fb.Read<uint64_t>();
+      }
+      continue;
+    }
+    if (fieldTag == extTimeExtraID) {
+      if (fb.Size() >= 5 && (fb.Pick() & 0x1) != 0) {
+        modified = bela::FromUnixSeconds(static_cast<int64_t>(fb.Read<uint32_t>()));
+      }
+      continue;
+    }
+    if (fieldTag == infoZipUnicodePathID) {
+      if (fb.Size() < 5 || (current.flags & 0x800) != 0) {
+        continue;
+      }
+      (void)fb.Pick();
+      (void)fb.Read<uint32_t>();
+      current.flags |= 0x800;
+      current.name = bela::cstring_view({fb.Data<char>(), fb.Size()});
+      continue;
+    }
+    if (fieldTag == winzipAesExtraID) {
+      if (fb.Size() < 7) {
+        continue;
+      }
+      current.aes_version = fb.Read<uint16_t>();
+      fb.Discard(2); // VendorID 'AE'
+      current.aes_strength = fb.Pick();
+      current.method = fb.Read<uint16_t>();
+      continue;
+    }
+  }
+  current.time = bela::FromDosDateTime(dosDate, dosTime);
+  if (bela::ToUnixSeconds(modified) != 0) {
+    current.time = modified;
+  }
+  current.mode = resolveFileMode(current, 0);
+  descriptor = (current.flags & 0x8) != 0;
+  pending = true;
+  entries.emplace_back(streamed_entry{.name = std::string(current.name),
+                                      .position = offset,
+                                      .compressed_size = current.compressed_size,
+                                      .uncompressed_size = current.uncompressed_size,
+                                      .crc32_value = current.crc32_value});
+  return std::make_optional(current);
+}
+
+bool StreamReader::Decompress(const File &file, const Writer &w, bela::error_code &ec) {
+  if (!pending || file.position != current.position) {
+    ec = bela::make_error_code(ErrGeneral, L"zip: stream entry '", bela::encode_into<char, wchar_t>(file.name),
+                               L"' already passed");
+    return false;
+  }
+  pending = false;
+  // with a data descriptor the local sizes are zero, only deflate can find the end of its payload
+  auto unknownSize = descriptor && current.compressed_size == 0 && current.method != ZIP_STORE;
+  if (unknownSize && current.method != ZIP_DEFLATE) {
+    ec = bela::make_error_code(ErrUnimplemented, L"zip: streaming method ", current.method,
+                               L" without sizes is not supported");
+    return false;
+  }
+  EntryReader er(source.get(), unknownSize ? EntryReader::unknownSize : current.compressed_size);
+  if (!descriptor) {
+    return decompressEntry(current, er, w, DecoderOptions{}, ec);
+  }
+  // the crc32 follows the payload, check it against the data descriptor instead
+  auto entry = current;
+  entry.crc32_value = 0;
+  uint32_t crc32_value = 0;
+  auto summed = [&](const void *data, size_t len) -> bool {
+    crc32_value = Crc32(data, len, crc32_value);
+    return w(data, len);
+  };
+  if (!decompressEntry(entry, er, summed, DecoderOptions{}, ec)) {
+    return false;
+  }
+  return readDescriptor(er.Consumed(), crc32_value, ec);
+}
+
+bool StreamReader::skipPayload(bela::error_code &ec) {
+  if (descriptor && current.compressed_size == 0 && current.method != ZIP_STORE) {
+    return Decompress(current, [](const void *, size_t) { return true; }, ec);
+  }
+  pending = false;
+  if (!source->Discard(current.compressed_size, ec)) {
+    return false;
+  }
+  return !descriptor || readDescriptor(static_cast<int64_t>(current.compressed_size), std::nullopt, ec);
+}
+
+/*
+      [signature 0x08074b50]          4 bytes (optional)
+      crc-32                          4 bytes
+      compressed size                 4 bytes (8 bytes with zip64)
+      uncompressed size               4 bytes (8 bytes with zip64)
+*/
+bool StreamReader::readDescriptor(int64_t consumed, std::optional<uint32_t> crc32_value, bela::error_code &ec) {
+  uint8_t buf[dataDescriptor64Len];
+  if (!source->ReadFull(buf, 4, ec)) {
+    return false;
+  }
+  auto crc = bela::cast_fromle<uint32_t>(buf);
+  if (crc == dataDescriptorSignature) {
+    if (!source->ReadFull(buf, 4, ec)) {
+      return false;
+    }
+    crc = bela::cast_fromle<uint32_t>(buf);
+  }
+  auto sizeLen = zip64 ? 16 : 8;
+  if (!source->ReadFull(buf, sizeLen, ec)) {
+    return false;
+  }
+  bela::endian::LittenEndian b(buf, sizeLen);
+  auto csize = zip64 ? b.Read<uint64_t>() : b.Read<uint32_t>();
+  auto usize = zip64 ? b.Read<uint64_t>() : b.Read<uint32_t>();
+  if (crc32_value && *crc32_value != crc) {
+    ec = bela::make_error_code(ErrGeneral, L"crc32 want ", crc, L" got ", *crc32_value, L" not match");
+    return false;
+  }
+  if (csize != static_cast<uint64_t>(consumed)) {
+    ec = bela::make_error_code(ErrGeneral, L"zip: data descriptor size ", csize, L" but payload is ", consumed,
+                               L" bytes");
+    return false;
+  }
+  auto &e = entries.back();
+  e.crc32_value = crc;
+  e.compressed_size = csize;
+  e.uncompressed_size = usize;
+  return true;
+}
+
+bool StreamReader::Finish(bela::error_code &ec) {
+  while (!ended) {
+    if (!Next(ec) && ec != bela::ErrEnded) {
+      return false;
+    }
+  }
+  ec.clear();
+  uint8_t buf[directory64EndLen];
+  uint64_t records = 0;
+  directory.size() = 0;
+  for (;;) {
+    if (!source->ReadFull(buf, 4, ec)) {
+      return false;
+    }
+    if (bela::cast_fromle<uint32_t>(buf) != directoryHeaderSignature) {
+      break;
+    }
+    if (!source->ReadFull(buf + 4, directoryHeaderLen - 4, ec)) {
+      return false;
+    }
+    auto recordLen = static_cast<size_t>(directoryHeaderLen) + bela::cast_fromle<uint16_t>(buf + 28) +
+                     bela::cast_fromle<uint16_t>(buf + 30) + bela::cast_fromle<uint16_t>(buf + 32);
+    auto used = directory.size();
+    if (directory.capacity() < used + recordLen) {
+      directory.grow((std::max)(used + recordLen, directory.capacity() * 2));
+    }
+    memcpy(directory.data() + used, buf, directoryHeaderLen);
+    if (!source->ReadFull(directory.data() + used + directoryHeaderLen, recordLen - directoryHeaderLen, ec)) {
+      return false;
+    }
+    directory.size() = used + recordLen;
+    records++;
+  }
+  // zip64 end of central directory record and locator
+  if (bela::cast_fromle<uint32_t>(buf) == directory64EndSignature) {
+    if (!source->ReadFull(buf + 4, 8, ec) || !source->Discard(bela::cast_fromle<uint64_t>(buf + 4), ec)) {
+      return false;
+    }
+    if (!source->ReadFull(buf, 4, ec)) {
+      return false;
+    }
+    if (bela::cast_fromle<uint32_t>(buf) == directory64LocSignature) {
+      if (!source->Discard(directory64LocLen - 4, ec) || !source->ReadFull(buf, 4, ec)) {
+        return false;
+      }
+    }
+  }
+  if (bela::cast_fromle<uint32_t>(buf) != directoryEndSignature) {
+    ec = bela::make_error_code(L"zip: not a valid zip file");
+    return false;
+  }
+  if (!source->ReadFull(buf + 4, directoryEndLen - 4, ec)) {
+    return false;
+  }
+  comment.resize(bela::cast_fromle<uint16_t>(buf + 20));
+  if (!source->ReadFull(comment.data(), comment.size(), ec)) {
+    return false;
+  }
+  files.clear();
+  files.reserve(records);
+  DirectoryIterator it(directory.data(), directory.size(), records);
+  File file;
+  while (it.Next(file, ec)) {
+    files.emplace_back(file);
+  }
+  if (ec) {
+    return false;
+  }
+  // reconcile: same entries in the same order, local offsets may be shifted by data before the archive
+  if (files.size() != entries.size()) {
+    ec = bela::make_error_code(ErrGeneral, L"zip: central directory lists ", files.size(), L" entries but ",
+                               entries.size(), L" were streamed");
+    return false;
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto &f = files[i];
+    const auto &e = entries[i];
+    if (f.name != e.name || f.crc32_value != e.crc32_value || f.compressed_size != e.compressed_size ||
+        f.uncompressed_size != e.uncompressed_size ||
+        e.position - f.position != entries.front().position - files.front().position) {
+      ec = bela::make_error_code(ErrGeneral, L"zip: central directory disagrees with local header of '",
+                                 bela::encode_into<char, wchar_t>(e.name), L"'");
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace baulk::archive::zip
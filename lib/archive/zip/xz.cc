@@ -8,23 +8,65 @@
 namespace baulk::archive::zip {
 constexpr size_t xzoutsize = 256 * 1024;
 constexpr size_t xzinsize = 128 * 1024;
+constexpr uint64_t xzThreadedMinimum = 1024 * 1024;
+constexpr uint64_t xzMinThreadingMemory = 256 * 1024 * 1024;
 // LZMA allocator
 static lzma_allocator allocator{                                  // allocator
                                 .alloc = baulk::mem::allocate_xz, //
                                 .free = baulk::mem::deallocate_simple,
                                 .opaque = nullptr};
-// XZ
-bool Reader::decompressXz(const File &file, const Writer &w, bela::error_code &ec) const {
+namespace {
+// lzdecoder keeps the calling thread's lzma_stream, initializing the same decoder type again on it
+// reuses the coder and its dictionary instead of freeing them
+class lzdecoder {
+public:
+  lzdecoder() { zs.allocator = &allocator; }
+  lzdecoder(const lzdecoder &) = delete;
+  lzdecoder &operator=(const lzdecoder &) = delete;
+  ~lzdecoder() { lzma_end(&zs); }
+  lzma_stream *acquire() {
+    CountDecoderEvent(used ? decoder_event::context_reused : decoder_event::context_created);
+    used = true;
+    return &zs;
+  }
+
+private:
   lzma_stream zs = LZMA_STREAM_INIT;
-  zs.allocator = &allocator;
-  auto ret = lzma_stream_decoder(&zs, UINT64_MAX, LZMA_CONCATENATED);
+  bool used{false};
+};
+thread_local lzdecoder threadXzDecoder;
+thread_local lzdecoder threadAloneDecoder;
+} // namespace
+
+// initializeThreaded: blocks whose sizes are recorded in their headers are decoded in parallel, single block
+// streams and streams exceeding memlimit_threading are decoded on one thread
+inline lzma_ret initializeThreaded(lzma_stream *zs, const DecoderOptions &opts) {
+  lzma_mt mt{};
+  mt.flags = LZMA_CONCATENATED;
+  mt.threads = opts.threads != 0 ? opts.threads : (std::max)(std::thread::hardware_concurrency(), 1U);
+  mt.timeout = 0;
+  // same default as xz(1): a quarter of the physical memory
+  mt.memlimit_threading = opts.memlimit != 0 ? opts.memlimit : (std::max)(lzma_physmem() / 4, xzMinThreadingMemory);
+  mt.memlimit_stop = UINT64_MAX;
+  return lzma_stream_decoder_mt(zs, &mt);
+}
+
+// XZ
+bool decompressXz(const File &file, EntryReader &er, const Writer &w, const DecoderOptions &opts,
+                  bela::error_code &ec) {
+  // the threaded decoder owns worker threads, it is not cached on the calling thread
+  lzma_stream mtzs = LZMA_STREAM_INIT;
+  mtzs.allocator = &allocator;
+  auto closer = bela::finally([&] { lzma_end(&mtzs); });
+  auto threaded = opts.threads != 1 && file.compressed_size >= xzThreadedMinimum;
+  auto &zs = threaded ? mtzs : *threadXzDecoder.acquire();
+  auto ret = threaded ? initializeThreaded(&zs, opts) : lzma_stream_decoder(&zs, UINT64_MAX, LZMA_CONCATENATED);
   if (ret != LZMA_OK) {
     ec = bela::make_error_code(ret, L"lzma_stream_decoder error ", ret);
     return false;
   }
-  Buffer out(xzoutsize);
-  Buffer in(xzinsize);
-  auto csize = file.compressed_size;
+  PooledBuffer out(xzoutsize);
+  PooledBuffer in(xzinsize);
   lzma_action action = LZMA_RUN; // no C26812
   zs.next_in = nullptr;
   zs.avail_in = 0;
@@ -32,15 +74,14 @@ bool Reader::decompressXz(const File &file, const Writer &w, bela::error_code &e
   zs.avail_out = xzoutsize;
   Summator sum(file.crc32_value);
   for (;;) {
-    if (zs.avail_in == 0 && csize != 0) {
-      auto minsize = (std::min)(csize, static_cast<uint64_t>(xzinsize));
-      if (!fd.ReadFull({in.data(), static_cast<size_t>(minsize)}, ec)) {
+    if (zs.avail_in == 0 && er.Remaining() != 0) {
+      std::span<const uint8_t> chunk;
+      if (!er.Fetch(in.data(), xzinsize, chunk, ec)) {
         return false;
       }
-      zs.next_in = in.data();
-      zs.avail_in = minsize;
-      csize -= minsize;
-      if (csize == 0) {
+      zs.next_in = chunk.data();
+      zs.avail_in = chunk.size();
+      if (er.Remaining() == 0) {
         action = LZMA_FINISH;
       }
     }
@@ -97,30 +138,33 @@ struct alone_header {
 #pragma pack(pop)
 
 // LZMA
-bool Reader::decompressLZMA(const File &file, const Writer &w, bela::error_code &ec) const {
-  lzma_stream zs;
-  memset(&zs, 0, sizeof(zs));
+bool decompressLZMA(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec) {
+  auto &zs = *threadAloneDecoder.acquire();
   if (auto ret = lzma_alone_decoder(&zs, UINT64_MAX); ret != LZMA_OK) {
     ec = bela::make_error_code(ret, L"lzma_stream_decoder error ", ret);
     return false;
   }
-  auto closer = bela::finally([&] { lzma_end(&zs); });
   // cat /bin/ls | lzma | xxd | head -n 1
   // $ cat stream_inside_zipx | xxd | head -n 1
   // 00000000: 0914 0500 5d00 8000 0000 2814 .... ....
   uint8_t d[16] = {0};
-  if (!fd.ReadFull({d, 9}, ec)) {
+  std::span<const uint8_t> header;
+  if (!er.Fetch(d, 9, header, ec)) {
+    return false;
+  }
+  if (header.size() != 9) {
+    ec = bela::make_error_code(ErrGeneral, L"Invalid LZMA data");
     return false;
   }
-  if (d[2] != 0x05 || d[3] != 0x00) {
+  if (header[2] != 0x05 || header[3] != 0x00) {
     ec = bela::make_error_code(ErrGeneral, L"Invalid LZMA data");
     return false;
   }
   alone_header ah{0};
-  memcpy(ah.bytes, d + 4, 5);
+  memcpy(ah.bytes, header.data() + 4, 5);
   ah.uncompressed_size = UINT64_MAX;
-  Buffer out(xzoutsize);
-  Buffer in(xzinsize);
+  PooledBuffer out(xzoutsize);
+  PooledBuffer in(xzinsize);
   zs.next_in = reinterpret_cast<const uint8_t *>(&ah);
   zs.avail_in = sizeof(ah);
   zs.total_in = 0;
@@ -133,18 +177,16 @@ bool Reader::decompressLZMA(const File &file, const Writer &w, bela::error_code
     return false;
   }
   Summator sum(file.crc32_value);
-  auto csize = file.compressed_size - 9;
   lzma_action action = LZMA_RUN;
   for (;;) {
-    if (zs.avail_in == 0 && csize > 0) {
-      auto minsize = (std::min)(csize, static_cast<uint64_t>(xzinsize));
-      if (!fd.ReadFull({in.data(), static_cast<size_t>(minsize)}, ec)) {
+    if (zs.avail_in == 0 && er.Remaining() != 0) {
+      std::span<const uint8_t> chunk;
+      if (!er.Fetch(in.data(), xzinsize, chunk, ec)) {
         return false;
       }
-      zs.next_in = in.data();
-      zs.avail_in = minsize;
-      csize -= minsize;
-      if (csize == 0) {
+      zs.next_in = chunk.data();
+      zs.avail_in = chunk.size();
+      if (er.Remaining() == 0) {
         action = LZMA_FINISH;
       }
     }
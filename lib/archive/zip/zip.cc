@@ -2,7 +2,6 @@
 #include <algorithm>
 #include <bela/path.hpp>
 #include <bela/endian.hpp>
-#include <bela/bufio.hpp>
 #include <bitset>
 #include <bela/terminal.hpp>
 #include "zipinternal.hpp"
@@ -122,8 +121,6 @@ bool Reader::readDirectoryEnd(directoryEnd &d, bela::error_code &ec) {
   return true;
 }
 
-using bufioReader = bela::bufio::Reader<4096>;
-
 constexpr uint32_t SizeMin = 0xFFFFFFFFU;
 constexpr uint64_t OffsetMin = 0xFFFFFFFFULL;
 
@@ -154,16 +151,20 @@ constexpr uint64_t OffsetMin = 0xFFFFFFFFULL;
 
 */
 
-bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::error_code &ec) {
-  uint8_t buf[directoryHeaderLen];
-  if (br.ReadFull(buf, sizeof(buf), ec) != sizeof(buf)) {
+bool DirectoryIterator::Next(File &file, bela::error_code &ec) {
+  if (remaining == 0) {
+    return false;
+  }
+  if (size < directoryHeaderLen) {
+    ec = bela::make_error_code(L"zip: not a valid zip file");
     return false;
   }
-  bela::endian::LittenEndian b(buf, sizeof(buf));
+  bela::endian::LittenEndian b(data, directoryHeaderLen);
   if (auto n = static_cast<int>(b.Read<uint32_t>()); n != directoryHeaderSignature) {
     ec = bela::make_error_code(L"zip: not a valid zip file");
     return false;
   }
+  file = File{};
   file.version_madeby = b.Read<uint16_t>();
   file.version_needed = b.Read<uint16_t>();
   file.flags = b.Read<uint16_t>();
@@ -183,21 +184,25 @@ bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::erro
   b.Discard(4);
   auto externalAttrs = b.Read<uint32_t>();
   file.position = b.Read<uint32_t>();
-  auto totallen = filenameLen + extraLen + commentLen;
-  buffer.grow(totallen);
-  if (br.ReadFull(buffer.data(), totallen, ec) != totallen) {
+  auto totallen = static_cast<size_t>(filenameLen) + extraLen + commentLen;
+  if (size - directoryHeaderLen < totallen) {
+    ec = bela::make_error_code(L"zip: not a valid zip file");
     return false;
   }
-  file.name = bela::cstring_view({buffer.data(), filenameLen});
+  auto buffer = reinterpret_cast<const char *>(data + directoryHeaderLen);
+  data += directoryHeaderLen + totallen;
+  size -= directoryHeaderLen + totallen;
+  remaining--;
+  file.name = bela::cstring_view({buffer, filenameLen});
   if (commentLen != 0) {
-    file.comment = bela::cstring_view({buffer.data() + filenameLen + extraLen, commentLen});
+    file.comment = bela::cstring_view({buffer + filenameLen + extraLen, commentLen});
   }
   file.mode = resolveFileMode(file, externalAttrs);
   auto needUSize = file.uncompressed_size == SizeMin;
   auto needSize = file.compressed_size == SizeMin;
   auto needOffset = file.position == OffsetMin;
   bela::Time modified;
-  bela::endian::LittenEndian extra(buffer.data() + filenameLen, static_cast<size_t>(extraLen));
+  bela::endian::LittenEndian extra(buffer + filenameLen, static_cast<size_t>(extraLen));
   for (; extra.Size() >= 4;) {
     auto fieldTag = extra.Read<uint16_t>();
     auto fieldSize = static_cast<int>(extra.Read<uint16_t>());
@@ -290,7 +295,7 @@ bool readDirectoryHeader(bufioReader &br, Buffer &buffer, File &file, bela::erro
       file.time = bela::FromUnixSeconds(static_cast<int64_t>(fb.Read<uint32_t>()));
       fb.Discard(4); // discard uid and gid
       if (fb.Size() > 0 && fieldTag == unixExtraID) {
-        file.linkname = bela::cstring_view({fb.Data<char>() + 4, fb.Size()});
+        file.linkname = bela::cstring_view({fb.Data<char>(), fb.Size()});
       }
       continue;
     }
@@ -387,22 +392,40 @@ bool Reader::Initialize(bela::error_code &ec) {
                                L" byte zip");
     return false;
   }
-  files.reserve(d.directoryRecords);
-  if (!fd.Seek(d.directoryOffset + baseOffset, ec)) {
+  // the directory is read with a single I/O, entry names refer to it
+  if (d.directorySize > static_cast<uint64_t>(size) - d.directoryOffset ||
+      d.directorySize < d.directoryRecords * directoryHeaderLen) {
+    ec = bela::make_error_code(ErrGeneral, L"zip: invalid central directory size ", d.directorySize);
     return false;
   }
-  // 64K avoid group
-  Buffer buffer(64 * 1024);
-  bufioReader br(fd.NativeFD());
-  for (uint64_t i = 0; i < d.directoryRecords; i++) {
-    File file;
-    if (!readDirectoryHeader(br, buffer, file, ec)) {
-      return false;
-    }
+  directory.grow(static_cast<size_t>(d.directorySize));
+  if (!ReadAt(fd.NativeFD(), directory.data(), static_cast<size_t>(d.directorySize),
+              static_cast<int64_t>(d.directoryOffset) + baseOffset, ec)) {
+    return false;
+  }
+  directory.size() = static_cast<size_t>(d.directorySize);
+  records = d.directoryRecords;
+  if (mode == directory_mode_t::materialized) {
+    files.reserve(d.directoryRecords);
+  }
+  auto it = Iterator();
+  File file;
+  // names refer to the directory, they are sampled without copies
+  std::vector<std::string_view> legacyNames;
+  while (it.Next(file, ec)) {
     uncompressed_size += file.uncompressed_size;
     compressed_size += file.compressed_size;
-    files.emplace_back(std::move(file));
+    if (!file.IsFileNameUTF8()) {
+      legacyNames.emplace_back(file.name);
+    }
+    if (mode == directory_mode_t::materialized) {
+      files.emplace_back(file);
+    }
+  }
+  if (ec) {
+    return false;
   }
+  charset = Charset::Detect(legacyNames);
   return true;
 }
 
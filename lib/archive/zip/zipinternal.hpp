@@ -6,6 +6,7 @@
 #include <baulk/allocate.hpp>
 #include <baulk/archive.hpp>
 #include <baulk/archive/crc32.hpp>
+#include <baulk/archive/tar.hpp>
 
 namespace baulk::archive::zip {
 using baulk::mem::Buffer;
@@ -127,6 +128,139 @@ inline bool IsSuperficialPath(std::string_view sv) {
 constexpr size_t outsize = 64 * 1024;
 constexpr size_t insize = 16 * 1024;
 FileMode resolveFileMode(const File &file, uint32_t externalAttrs);
+
+// Decoder contexts and I/O buffers are cached per thread, see DecoderStats()
+enum class decoder_event : int { context_created = 0, context_reused, buffer_allocated, buffer_reused };
+void CountDecoderEvent(decoder_event e);
+
+// PooledBuffer borrows a buffer of at least size bytes from the calling thread's pool
+class PooledBuffer {
+public:
+  explicit PooledBuffer(size_t size);
+  PooledBuffer(const PooledBuffer &) = delete;
+  PooledBuffer &operator=(const PooledBuffer &) = delete;
+  ~PooledBuffer();
+  [[nodiscard]] uint8_t *data() { return buffer.data(); }
+  [[nodiscard]] size_t capacity() const { return buffer.capacity(); }
+
+private:
+  Buffer buffer;
+};
+
+// StreamSource buffers a forward-only tar::ExtractReader, decoders may give back bytes read past their end
+class StreamSource {
+public:
+  StreamSource(tar::ExtractReader *r_) : r(r_) { buffer.grow(streamBufferSize); }
+  StreamSource(const StreamSource &) = delete;
+  StreamSource &operator=(const StreamSource &) = delete;
+  // Fetch returns min(maxsize, buffer capacity) bytes, fewer only at the end of input
+  bool Fetch(size_t maxsize, std::span<const uint8_t> &chunk, bela::error_code &ec);
+  // Unread gives back the last n bytes returned by Fetch
+  void Unread(size_t n) { pos -= n; }
+  bool ReadFull(void *data, size_t len, bela::error_code &ec);
+  bool Discard(uint64_t len, bela::error_code &ec);
+  // Offset is the number of bytes consumed from the start of the archive
+  [[nodiscard]] uint64_t Offset() const { return pulled - (buffer.size() - pos); }
+
+private:
+  static constexpr size_t streamBufferSize = 256 * 1024;
+  tar::ExtractReader *r{nullptr};
+  Buffer buffer;
+  size_t pos{0};
+  uint64_t pulled{0};
+  bool eof{false};
+};
+
+// EntryReader reads the compressed payload of one entry
+class EntryReader {
+public:
+  // when view is mapped, chunks point into the view and nothing is copied
+  EntryReader(HANDLE fd_, int64_t position_, uint64_t size_, const MappedView *view_ = nullptr)
+      : view(view_ != nullptr && *view_ ? view_ : nullptr), fd(fd_), position(position_), remaining(size_) {}
+  // stream mode: size_ is unknownSize when only a data descriptor after the payload records it,
+  // the decoder must then find the end of its stream and Unread the excess input
+  EntryReader(StreamSource *source_, uint64_t size_) : source(source_), remaining(size_) {}
+  EntryReader(const EntryReader &) = delete;
+  EntryReader &operator=(const EntryReader &) = delete;
+  static constexpr uint64_t unknownSize = (std::numeric_limits<uint64_t>::max)();
+  [[nodiscard]] uint64_t Remaining() const { return remaining; }
+  [[nodiscard]] bool Mapped() const { return view != nullptr; }
+  // Consumed is the number of payload bytes fetched and not given back
+  [[nodiscard]] int64_t Consumed() const { return consumed; }
+  // Fetch reads min(Remaining(), maxsize) bytes, chunk refers to the bytes read
+  bool Fetch(void *buffer, size_t maxsize, std::span<const uint8_t> &chunk, bela::error_code &ec) {
+    auto minsize = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(maxsize)));
+    if (source != nullptr) {
+      if (!source->Fetch(minsize, chunk, ec)) {
+        return false;
+      }
+      if (chunk.empty() && minsize != 0) {
+        ec = bela::make_error_code(ERROR_HANDLE_EOF, L"zip: unexpected EOF");
+        return false;
+      }
+      minsize = chunk.size();
+    } else if (view != nullptr) {
+      if (position < 0 || position > view->size() || static_cast<int64_t>(minsize) > view->size() - position) {
+        ec = bela::make_error_code(ErrGeneral, L"zip: entry data out of range");
+        return false;
+      }
+      chunk = {view->data() + position, minsize};
+    } else {
+      if (!ReadAt(fd, buffer, minsize, position, ec)) {
+        return false;
+      }
+      chunk = {reinterpret_cast<const uint8_t *>(buffer), minsize};
+    }
+    position += minsize;
+    consumed += minsize;
+    if (remaining != unknownSize) {
+      remaining -= minsize;
+    }
+    return true;
+  }
+  // Range is the file and position of the unread payload, decoders reading it out of order need it;
+  // stream sources have none
+  bool Range(HANDLE &fd_, int64_t &position_) const {
+    if (source != nullptr) {
+      return false;
+    }
+    fd_ = fd;
+    position_ = position;
+    return true;
+  }
+  // Unread gives back the last n bytes of the previous Fetch, decoders call it when their stream ended early
+  void Unread(size_t n) {
+    if (source != nullptr) {
+      source->Unread(n);
+    }
+    position -= static_cast<int64_t>(n);
+    consumed -= static_cast<int64_t>(n);
+    if (remaining != unknownSize) {
+      remaining += n;
+    }
+  }
+
+private:
+  const MappedView *view{nullptr};
+  StreamSource *source{nullptr};
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t position{0};
+  int64_t consumed{0};
+  uint64_t remaining{0};
+};
+
+bool decompressEntry(const File &file, EntryReader &er, const Writer &w, const DecoderOptions &opts,
+                     bela::error_code &ec);
+bool decompressDeflate(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec);
+bool decompressDeflate64(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec);
+bool decompressZstd(const File &file, EntryReader &er, const Writer &w, const DecoderOptions &opts,
+                    bela::error_code &ec);
+bool decompressBz2(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec);
+bool decompressXz(const File &file, EntryReader &er, const Writer &w, const DecoderOptions &opts,
+                  bela::error_code &ec);
+bool decompressLZMA(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec);
+bool decompressPpmd(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec);
+bool decompressBrotli(const File &file, EntryReader &er, const Writer &w, bela::error_code &ec);
 } // namespace baulk::archive::zip
 
 #endif
\ No newline at end of file
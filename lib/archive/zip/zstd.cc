@@ -1,31 +1,120 @@
 ///
 #include "zipinternal.hpp"
-#define ZSTD_STATIC_LINKING_ONLY 1
-#include <zstd.h>
+#include "../tar/zstd.hpp"
 
 namespace baulk::archive::zip {
+namespace {
+// dstream keeps the calling thread's ZSTD_DCtx, a session reset keeps its window and tables
+class dstream {
+public:
+  dstream() = default;
+  dstream(const dstream &) = delete;
+  dstream &operator=(const dstream &) = delete;
+  ~dstream() {
+    if (zds != nullptr) {
+      ZSTD_freeDCtx(zds);
+    }
+  }
+  ZSTD_DCtx *acquire(bela::error_code &ec) {
+    if (zds != nullptr) {
+      if (ZSTD_isError(ZSTD_DCtx_reset(zds, ZSTD_reset_session_only)) == 0) {
+        CountDecoderEvent(decoder_event::context_reused);
+        return zds;
+      }
+      ZSTD_freeDCtx(zds);
+    }
+    zds = ZSTD_createDCtx_advanced(ZSTD_customMem{
+        .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+    if (zds == nullptr) {
+      ec = bela::make_error_code(L"ZSTD_createDStream() out of memory");
+      return nullptr;
+    }
+    CountDecoderEvent(decoder_event::context_created);
+    return zds;
+  }
+
+private:
+  ZSTD_DCtx *zds{nullptr};
+};
+thread_local dstream threadDStream;
+} // namespace
+
+constexpr uint64_t zstdThreadedMinimum = 1024 * 1024;
+
+// decompressFrames decodes the frames of an entry on several threads, it returns false and leaves ec empty when the
+// entry is a single frame
+bool decompressFrames(const File &file, EntryReader &er, const Writer &w, const DecoderOptions &opts,
+                      bela::error_code &ec) {
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  int64_t position{0};
+  if (!er.Range(fd, position)) {
+    return false;
+  }
+  tar::zstd::FrameReader fr(fd, position + static_cast<int64_t>(file.compressed_size),
+                            tar::ReaderOptions{.threads = opts.threads, .memlimit = opts.memlimit});
+  if (!fr.Initialize(position, ec) || fr.Frames() < 2) {
+    // a malformed entry is reported by the streaming decoder
+    ec.clear();
+    return false;
+  }
+  Summator sum(file.crc32_value);
+  int64_t extracted = 0;
+  auto ok = fr.WriteTo(
+      [&](const void *data, size_t len, bela::error_code &ec) {
+        sum.Update(data, len);
+        if (!w(data, len)) {
+          ec = bela::make_error_code(ErrCanceled, L"canceled");
+          return false;
+        }
+        return true;
+      },
+      static_cast<int64_t>(file.uncompressed_size), extracted, ec);
+  if (!ok) {
+    if (!ec) {
+      ec = bela::make_error_code(ErrGeneral, L"zstd: entry size ", extracted, L" want ", file.uncompressed_size);
+    }
+    return false;
+  }
+  if (uint8_t extra = 0; fr.Read(&extra, 1, ec) != 0) {
+    if (!ec) {
+      ec = bela::make_error_code(ErrGeneral, L"zstd: entry larger than ", file.uncompressed_size);
+    }
+    return false;
+  }
+  if (!sum.Valid()) {
+    ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32_value, L" got ", sum.Current(), L" not match");
+    return false;
+  }
+  return true;
+}
+
 // zstd
 // https://github.com/facebook/zstd/blob/dev/examples/streaming_decompression.c
-bool Reader::decompressZstd(const File &file, const Writer &w, bela::error_code &ec) const {
+bool decompressZstd(const File &file, EntryReader &er, const Writer &w, const DecoderOptions &opts,
+                    bela::error_code &ec) {
+  if (opts.threads != 1 && file.compressed_size >= zstdThreadedMinimum) {
+    if (decompressFrames(file, er, w, opts, ec)) {
+      return true;
+    }
+    if (ec) {
+      return false;
+    }
+  }
   const auto boutsize = ZSTD_DStreamOutSize();
   const auto binsize = ZSTD_DStreamInSize();
-  Buffer outbuf(boutsize);
-  Buffer inbuf(binsize);
-  auto zds = ZSTD_createDCtx_advanced(ZSTD_customMem{
-      .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+  auto zds = threadDStream.acquire(ec);
   if (zds == nullptr) {
-    ec = bela::make_error_code(L"ZSTD_createDStream() out of memory");
     return false;
   }
-  auto closer = bela::finally([&] { ZSTD_freeDCtx(zds); });
-  auto csize = file.compressed_size;
+  PooledBuffer outbuf(boutsize);
+  PooledBuffer inbuf(binsize);
   Summator sum(file.crc32_value);
-  while (csize != 0) {
-    auto minsize = (std::min)(csize, static_cast<uint64_t>(binsize));
-    if (!fd.ReadFull({inbuf.data(), static_cast<size_t>(minsize)}, ec)) {
+  while (er.Remaining() != 0) {
+    std::span<const uint8_t> chunk;
+    if (!er.Fetch(inbuf.data(), binsize, chunk, ec)) {
       return false;
     }
-    ZSTD_inBuffer in{inbuf.data(), minsize, 0};
+    ZSTD_inBuffer in{chunk.data(), chunk.size(), 0};
     while (in.pos < in.size) {
       ZSTD_outBuffer out{outbuf.data(), boutsize, 0};
       auto result = ZSTD_decompressStream(zds, &out, &in);
@@ -40,7 +129,6 @@ bool Reader::decompressZstd(const File &file, const Writer &w, bela::error_code
         return false;
       }
     }
-    csize -= minsize;
   }
   if (!sum.Valid()) {
     ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32_value, L" got ", sum.Current(), L" not match");
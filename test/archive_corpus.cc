@@ -0,0 +1,146 @@
+//
+#include <baulk/archive/extractor.hpp>
+#include <baulk/archive/crc32.hpp>
+#include <bela/terminal.hpp>
+
+// usage: archive_corpus [corpusdir]
+// extracts every archive of test/corpus (see make_corpus.py) with the native 7z and msi extractors, one and all
+// hardware threads, and checks the extracted files against the sizes and crc32 values the generator printed
+namespace {
+struct expected_entry {
+  const wchar_t *archive;
+  const wchar_t *path;
+  int64_t size; // -1: directory
+  uint32_t crc32;
+};
+
+constexpr expected_entry corpus[] = {
+    // LZMA2 solid folder, empty file, empty and nested directories
+    {L"solid.7z", L"readme.txt", 66000, 0x58f1522b},
+    {L"solid.7z", L"bin/noise.dat", 70000, 0x18e813f7},
+    {L"solid.7z", L"bin/runs.dat", 95880, 0x740f75e3},
+    {L"solid.7z", L"données/é.txt", 650, 0x94e1c402},
+    {L"solid.7z", L"empty.txt", 0, 0x00000000},
+    {L"solid.7z", L"emptydir", -1, 0},
+    {L"solid.7z", L"nested/a/b", -1, 0},
+    // BCJ2 with LZMA2 and LZMA sub streams
+    {L"bcj2.7z", L"app/code.bin", 150000, 0xff67b0a9},
+    {L"bcj2.7z", L"app/tail.bin", 4099, 0xd3761142},
+    // LZMA encoded header, LZMA2 and copy folders
+    {L"header.7z", L"docs/readme.txt", 66000, 0x58f1522b},
+    {L"header.7z", L"docs/runs.dat", 87059, 0x93251585},
+    {L"header.7z", L"raw/noise.dat", 70000, 0x6108be60},
+    // solid.7z behind a PE image
+    {L"sfx.exe", L"readme.txt", 66000, 0x58f1522b},
+    {L"sfx.exe", L"bin/noise.dat", 70000, 0x18e813f7},
+    {L"sfx.exe", L"bin/runs.dat", 95880, 0x740f75e3},
+    {L"sfx.exe", L"données/é.txt", 650, 0x94e1c402},
+    {L"sfx.exe", L"empty.txt", 0, 0x00000000},
+    {L"sfx.exe", L"emptydir", -1, 0},
+    {L"sfx.exe", L"nested/a/b", -1, 0},
+    // MSZIP and stored cabinet folders
+    {L"package.msi", L"My App/readme.txt", 66000, 0x58f1522b},
+    {L"package.msi", L"My App/bin/tool.exe", 10242, 0x3205e3d3},
+    {L"package.msi", L"My App/data.bin", 159574, 0x04f25de1},
+    {L"package.msi", L"My App/empty.txt", 0, 0x00000000},
+    {L"package.msi", L"My App/bin/zeros.dat", 70000, 0xc5614828},
+};
+
+bool file_crc32(const std::filesystem::path &file, int64_t &size, uint32_t &crc, bela::error_code &ec) {
+  auto fd = bela::io::NewFile(file.native(), ec);
+  if (!fd) {
+    return false;
+  }
+  uint8_t buffer[64 * 1024];
+  size = 0;
+  crc = 0;
+  for (;;) {
+    int64_t outlen = 0;
+    if (!fd->ReadAt(std::span<uint8_t>(buffer), size, outlen, ec)) {
+      return false;
+    }
+    if (outlen == 0) {
+      return true;
+    }
+    crc = baulk::archive::Crc32(buffer, static_cast<size_t>(outlen), crc);
+    size += outlen;
+  }
+}
+
+template <typename E>
+bool extract(const std::filesystem::path &file, const std::filesystem::path &dest, uint32_t threads) {
+  E extractor(baulk::archive::ExtractorOptions{.threads = threads});
+  bela::error_code ec;
+  if (!extractor.OpenReader(file, dest, ec)) {
+    bela::FPrintF(stderr, L"unable open %s error: %s\n", file, ec);
+    return false;
+  }
+  if (!extractor.Extract(nullptr, nullptr, ec)) {
+    bela::FPrintF(stderr, L"unable extract %s error: %s\n", file, ec);
+    return false;
+  }
+  return true;
+}
+
+int check_archive(const std::filesystem::path &corpusdir, std::wstring_view archive, uint32_t threads) {
+  auto file = corpusdir / archive;
+  std::error_code e;
+  auto dest = std::filesystem::temp_directory_path(e) / L"archive_corpus.out";
+  std::filesystem::remove_all(dest, e);
+  auto ok = archive.ends_with(L".msi") ? extract<baulk::archive::msi::PackageExtractor>(file, dest, threads)
+                                       : extract<baulk::archive::n7z::Extractor>(file, dest, threads);
+  if (!ok) {
+    return 1;
+  }
+  int failures = 0;
+  for (const auto &entry : corpus) {
+    if (archive != entry.archive) {
+      continue;
+    }
+    auto path = dest / entry.path;
+    if (entry.size < 0) {
+      if (!std::filesystem::is_directory(path, e)) {
+        bela::FPrintF(stderr, L"%s: directory %s is missing\n", archive, entry.path);
+        failures++;
+      }
+      continue;
+    }
+    int64_t size = 0;
+    uint32_t crc = 0;
+    bela::error_code ec;
+    if (!file_crc32(path, size, crc, ec)) {
+      bela::FPrintF(stderr, L"%s: unable read %s error: %s\n", archive, entry.path, ec);
+      failures++;
+      continue;
+    }
+    if (size != entry.size || crc != entry.crc32) {
+      bela::FPrintF(stderr, L"%s: %s size %d crc32 %08x, expected size %d crc32 %08x\n", archive, entry.path, size,
+                    crc, entry.size, entry.crc32);
+      failures++;
+    }
+  }
+  std::filesystem::remove_all(dest, e);
+  bela::FPrintF(stderr, L"%s threads %d: %s\n", archive, threads, failures == 0 ? L"ok" : L"FAILED");
+  return failures;
+}
+} // namespace
+
+int wmain(int argc, wchar_t **argv) {
+  std::filesystem::path corpusdir(argc > 1 ? argv[1] : CORPUS_DIR);
+  // the SFX archive has to be found behind the executable, not at the start of the file
+  baulk::archive::file_format_t afmt{baulk::archive::file_format_t::none};
+  int64_t offset = 0;
+  bela::error_code ec;
+  if (auto fd = baulk::archive::OpenFile((corpusdir / L"sfx.exe").native(), offset, afmt, ec);
+      !fd || afmt != baulk::archive::file_format_t::_7z || offset != 0x400) {
+    bela::FPrintF(stderr, L"sfx.exe: 7z overlay not found at 0x400 (offset %d) %s\n", offset, ec);
+    return 1;
+  }
+  int failures = 0;
+  for (const auto archive : {L"solid.7z", L"bcj2.7z", L"header.7z", L"sfx.exe", L"package.msi"}) {
+    for (const uint32_t threads : {1u, 0u}) {
+      failures += check_archive(corpusdir, archive, threads);
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
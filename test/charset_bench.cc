@@ -0,0 +1,54 @@
+//
+#include <baulk/archive.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <bela/str_cat.hpp>
+#include <chrono>
+
+// usage: charset_bench [names] [codepage]
+// encodes generated Chinese and Japanese file names in codepage (default 936), then decodes them with a detection
+// per name and with one Charset detected for all of them, prints the time taken and how many names differ
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 20000;
+  uint32_t codePage = 936;
+  if ((argc > 1 && (!bela::SimpleAtoi(argv[1], &count) || count == 0)) ||
+      (argc > 2 && !bela::SimpleAtoi(argv[2], &codePage))) {
+    bela::FPrintF(stderr, L"usage: %s [names] [codepage]\n", argv[0]);
+    return 1;
+  }
+  // 文档 图片 设置 数据 资料 说明 日本語 ファイル
+  constexpr std::wstring_view words[] = {L"\u6587\u6863", L"\u56FE\u7247", L"\u8BBE\u7F6E",
+                                         L"\u6570\u636E", L"\u8D44\u6599", L"\u8BF4\u660E",
+                                         L"\u65E5\u672C\u8A9E", L"\u30D5\u30A1\u30A4\u30EB"};
+  std::vector<std::string> encoded;
+  encoded.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    auto name = bela::StringCat(words[i % std::size(words)], L"/", words[(i / 3) % std::size(words)], L"_", i, L".txt");
+    auto sz =
+        WideCharToMultiByte(codePage, 0, name.data(), static_cast<int>(name.size()), nullptr, 0, nullptr, nullptr);
+    std::string s(static_cast<size_t>(sz), '\0');
+    WideCharToMultiByte(codePage, 0, name.data(), static_cast<int>(name.size()), s.data(), sz, nullptr, nullptr);
+    encoded.emplace_back(std::move(s));
+  }
+  std::vector<std::string_view> names(encoded.begin(), encoded.end());
+  std::vector<std::wstring> perName;
+  perName.reserve(count);
+  auto begin = std::chrono::steady_clock::now();
+  for (auto name : names) {
+    perName.emplace_back(baulk::archive::EncodeToNativePath(name, false));
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  bela::FPrintF(stderr, L"per name  %d names %.3fms\n", count, elapsed * 1000);
+  begin = std::chrono::steady_clock::now();
+  auto charset = baulk::archive::Charset::Detect(names);
+  size_t differ = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    if (charset.Decode(names[i]) != perName[i]) {
+      differ++;
+    }
+  }
+  elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  bela::FPrintF(stderr, L"charset   %d names %.3fms codepage %d, %d names differ\n", count, elapsed * 1000,
+                charset.CodePage(), differ);
+  return 0;
+}
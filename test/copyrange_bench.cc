@@ -0,0 +1,84 @@
+//
+#include <baulk/archive.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+
+// usage: copyrange_bench [MiB] [directory]
+// writes a source file of MiB megabytes (default 1024) into directory (default temp, use a ReFS or Dev Drive folder to
+// see block cloning) and copies it out the way STORE entries were, in 4 KB reads and writes, and with CopyRange at a
+// cluster aligned and at an unaligned offset
+int wmain(int argc, wchar_t **argv) {
+  int64_t mib = 1024;
+  if (argc > 1 && (!bela::SimpleAtoi(argv[1], &mib) || mib <= 0)) {
+    bela::FPrintF(stderr, L"usage: %s [MiB] [directory]\n", argv[0]);
+    return 1;
+  }
+  std::error_code e;
+  auto dir = argc > 2 ? std::filesystem::path(argv[2]) : std::filesystem::temp_directory_path(e);
+  auto source = dir / L"copyrange_bench.src";
+  auto target = dir / L"copyrange_bench.bin";
+  auto closer = bela::finally([&] {
+    std::filesystem::remove(source, e);
+    std::filesystem::remove(target, e);
+  });
+  constexpr int64_t header = 64 * 1024;
+  auto size = mib * 1024 * 1024;
+  bela::error_code ec;
+  {
+    auto fd = baulk::archive::File::NewFile(source, bela::Now(), true, ec);
+    if (!fd) {
+      bela::FPrintF(stderr, L"unable create %s error: %s\n", source.native(), ec);
+      return 1;
+    }
+    std::vector<uint8_t> chunk(1024 * 1024);
+    for (size_t i = 0; i < chunk.size(); i++) {
+      chunk[i] = static_cast<uint8_t>(i * 131);
+    }
+    for (int64_t n = 0; n < size + header; n += static_cast<int64_t>(chunk.size())) {
+      if (!fd->WriteFull(chunk.data(), chunk.size(), ec)) {
+        bela::FPrintF(stderr, L"unable write %s error: %s\n", source.native(), ec);
+        return 1;
+      }
+    }
+  }
+  auto src = CreateFileW(source.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+  if (src == INVALID_HANDLE_VALUE) {
+    bela::FPrintF(stderr, L"unable open %s error: %s\n", source.native(), bela::make_system_error_code());
+    return 1;
+  }
+  auto srcCloser = bela::finally([&] { CloseHandle(src); });
+  auto measure = [&](const wchar_t *label, auto &&copy) {
+    auto fd = baulk::archive::File::NewFile(target, bela::Now(), true, ec);
+    if (!fd) {
+      bela::FPrintF(stderr, L"unable create %s error: %s\n", target.native(), ec);
+      return false;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    if (!copy(*fd, ec)) {
+      bela::FPrintF(stderr, L"%s: %s\n", label, ec);
+      return false;
+    }
+    fd.reset();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    bela::FPrintF(stderr, L"%s %d MiB %.3fs %.1f MiB/s\n", label, mib, elapsed, static_cast<double>(mib) / elapsed);
+    return true;
+  };
+  auto ok = measure(L"4K read/write      ", [&](baulk::archive::File &fd, bela::error_code &ec) {
+    uint8_t buffer[4096];
+    for (int64_t n = 0; n < size; n += sizeof(buffer)) {
+      if (!baulk::archive::ReadAt(src, buffer, sizeof(buffer), header + n, ec) ||
+          !fd.WriteFull(buffer, sizeof(buffer), ec)) {
+        return false;
+      }
+    }
+    return true;
+  });
+  ok = ok && measure(L"CopyRange aligned  ", [&](baulk::archive::File &fd, bela::error_code &ec) {
+    return baulk::archive::CopyRange(src, header, fd, size, ec);
+  });
+  ok = ok && measure(L"CopyRange unaligned", [&](baulk::archive::File &fd, bela::error_code &ec) {
+    return baulk::archive::CopyRange(src, header - 512, fd, size, ec);
+  });
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,515 @@
+#!/usr/bin/env python3
+# make_corpus.py writes the archives archive_corpus checks, every byte is derived from fixed seeds so the output and
+# the crc32 table it prints are reproducible. Run it from any directory, the archives land next to this script.
+#
+#   solid.7z     LZMA2 solid folder, empty file, empty and nested directories, UTF-8 name
+#   bcj2.7z      BCJ2 folder: LZMA2 main stream, LZMA call and jump streams, stored range coder stream
+#   header.7z    encoded (LZMA) header, one LZMA2 folder and one copy folder
+#   sfx.exe      solid.7z behind a minimal PE image, the archive starts at the overlay
+#   package.msi  compound file with an installer database and an embedded cabinet, MSZIP and stored folders
+import lzma
+import os
+import random
+import struct
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MTIME = 133485408000000000  # 2024-01-01 FILETIME
+
+
+def crc32(b):
+    return zlib.crc32(b) & 0xFFFFFFFF
+
+
+def payloads(seed):
+    rng = random.Random(seed)
+    text = b''.join(b'line %05d of the corpus readme\r\n' % i for i in range(2000))
+    noise = bytes(rng.getrandbits(8) for _ in range(70000))
+    runs = b''.join(bytes([rng.getrandbits(8)]) * rng.randint(1, 300) for _ in range(600))
+    return text, noise, runs
+
+
+def x86_code(seed, size):
+    # opcodes with relative CALL/JMP/Jcc targets, some inside the buffer and some outside
+    rng = random.Random(seed)
+    out = bytearray()
+    while len(out) < size:
+        op = rng.randrange(6)
+        if op == 0:
+            out += b'\xE8' + struct.pack('<i', rng.randrange(-len(out), size - len(out)))
+        elif op == 1:
+            out += b'\xE9' + struct.pack('<i', rng.randrange(-len(out), size - len(out)))
+        elif op == 2:
+            out += b'\x0F' + bytes([0x80 | rng.randrange(16)]) + struct.pack('<i', rng.randrange(-4096, 4096))
+        elif op == 3:
+            out += b'\xE8' + struct.pack('<I', rng.getrandbits(32))
+        else:
+            out += bytes(rng.choice(b'\x55\x89\xE5\x83\xEC\x8B\x45\x08\x5D\xC3\x90\x31\xC0') for _ in range(rng.randint(1, 12)))
+    return bytes(out[:size])
+
+
+# ---------------------------------------------------------------- 7z
+def number(n):
+    for i in range(9):
+        if i == 8 or n < (1 << (7 * (i + 1))):
+            first = (0xFF << (8 - i)) & 0xFF
+            if i < 8:
+                first |= n >> (8 * i)
+            return bytes([first]) + (n & ((1 << (8 * i)) - 1)).to_bytes(i, 'little')
+
+
+def bits(values):
+    out = bytearray()
+    for i in range(0, len(values), 8):
+        b = 0
+        for j, v in enumerate(values[i:i + 8]):
+            if v:
+                b |= 0x80 >> j
+        out.append(b)
+    return bytes(out)
+
+
+def lzma2(data):
+    return lzma.compress(data, format=lzma.FORMAT_RAW, filters=[{'id': lzma.FILTER_LZMA2, 'dict_size': 1 << 20}])
+
+
+def lzma1(data):
+    return lzma.compress(data, format=lzma.FORMAT_RAW,
+                         filters=[{'id': lzma.FILTER_LZMA1, 'dict_size': 1 << 16, 'lc': 3, 'lp': 0, 'pb': 2}])
+
+
+LZMA2_PROPS = bytes([16])  # 1 MiB dictionary
+LZMA_PROPS = bytes([(2 * 5 + 0) * 9 + 3]) + struct.pack('<I', 1 << 16)
+
+
+def coder(method, props=b'', ins=1, outs=1):
+    flag = len(method)
+    body = b''
+    if ins != 1 or outs != 1:
+        flag |= 0x10
+        body += number(ins) + number(outs)
+    if props:
+        flag |= 0x20
+        body += number(len(props)) + props
+    return bytes([flag]) + method + body
+
+
+class Folder:
+    # coders: encoded coder records, bind: (in, out) pairs, packed: in stream indexes fed by the pack streams in
+    # order, sizes: one per coder out stream
+    def __init__(self, coders, sizes, packs, bind=(), packed=()):
+        self.coders, self.sizes, self.packs, self.bind, self.packed = coders, sizes, packs, bind, packed
+
+    def encode(self):
+        out = number(len(self.coders)) + b''.join(self.coders)
+        for i, o in self.bind:
+            out += number(i) + number(o)
+        if len(self.packed) > 1:
+            out += b''.join(number(i) for i in self.packed)
+        return out
+
+
+def lzma2_folder(data):
+    return Folder([coder(b'\x21', LZMA2_PROPS)], [len(data)], [lzma2(data)])
+
+
+def copy_folder(data):
+    return Folder([coder(b'\x00')], [len(data)], [data])
+
+
+class RangeEncoder:
+    def __init__(self):
+        self.low, self.range, self.cache, self.cache_size = 0, 0xFFFFFFFF, 0, 1
+        self.out = bytearray()
+
+    def shift_low(self):
+        if self.low < 0xFF000000 or self.low >= 1 << 32:
+            carry = self.low >> 32
+            temp = self.cache
+            while True:
+                self.out.append((temp + carry) & 0xFF)
+                temp = 0xFF
+                self.cache_size -= 1
+                if self.cache_size == 0:
+                    break
+            self.cache = (self.low >> 24) & 0xFF
+        self.cache_size += 1
+        self.low = (self.low & 0x00FFFFFF) << 8
+
+    def encode(self, probs, i, bit):
+        bound = (self.range >> 11) * probs[i]
+        if bit == 0:
+            self.range = bound
+            probs[i] += (2048 - probs[i]) >> 5
+        else:
+            self.low += bound
+            self.range -= bound
+            probs[i] -= probs[i] >> 5
+        while self.range < 1 << 24:
+            self.range = (self.range << 8) & 0xFFFFFFFF
+            self.shift_low()
+
+    def finish(self):
+        for _ in range(5):
+            self.shift_low()
+        return bytes(self.out)
+
+
+def bcj2_split(data):
+    def is_j(b0, b1):
+        return (b1 & 0xFE) == 0xE8 or (b0 == 0x0F and (b1 & 0xF0) == 0x80)
+
+    main, call, jump = bytearray(), bytearray(), bytearray()
+    rc = RangeEncoder()
+    probs = [1024] * 258
+    prev, i, n = 0, 0, len(data)
+    while i < n:
+        b = data[i]
+        main.append(b)
+        i += 1
+        if not is_j(prev, b) or i == n:
+            prev = b
+            continue
+        index = prev if b == 0xE8 else (256 if b == 0xE9 else 257)
+        convert = False
+        if i + 4 <= n:
+            dest = (struct.unpack_from('<I', data, i)[0] + i + 4) & 0xFFFFFFFF
+            convert = dest < n
+        if convert:
+            rc.encode(probs, index, 1)
+            (call if b == 0xE8 else jump).extend(struct.pack('>I', dest))
+            prev = data[i + 3]
+            i += 4
+        else:
+            rc.encode(probs, index, 0)
+            prev = b
+    return bytes(main), bytes(call), bytes(jump), rc.finish()
+
+
+def bcj2_folder(data):
+    main, call, jump, rc = bcj2_split(data)
+    coders = [coder(b'\x03\x03\x01\x1B', ins=4, outs=1), coder(b'\x21', LZMA2_PROPS),
+              coder(b'\x03\x01\x01', LZMA_PROPS), coder(b'\x03\x01\x01', LZMA_PROPS)]
+    # BCJ2 in 0..2 read the out streams of the LZMA coders, in 3 (range coder) and the LZMA inputs are packed
+    return Folder(coders, [len(data), len(main), len(call), len(jump)], [lzma2(main), lzma1(call), lzma1(jump), rc],
+                  bind=[(0, 1), (1, 2), (2, 3)], packed=[4, 5, 6, 3])
+
+
+def streams_info(folders, pack_pos, substreams):
+    packs = [p for f in folders for p in f.packs]
+    out = bytes([0x06]) + number(pack_pos) + number(len(packs)) + bytes([0x09])
+    out += b''.join(number(len(p)) for p in packs) + bytes([0x00])
+    out += bytes([0x07, 0x0B]) + number(len(folders)) + b'\x00' + b''.join(f.encode() for f in folders)
+    out += bytes([0x0C]) + b''.join(number(s) for f in folders for s in f.sizes)
+    if substreams is None:
+        # single stream folders (the encoded header) carry their crc32 in the folder
+        out += bytes([0x0A, 0x01]) + b''.join(struct.pack('<I', f.crc) for f in folders)
+        return out + bytes([0x00, 0x00])
+    out += bytes([0x00, 0x08, 0x0D]) + b''.join(number(len(s)) for s in substreams)
+    out += bytes([0x09]) + b''.join(number(len(x)) for s in substreams for x in s[:-1])
+    out += bytes([0x0A, 0x01]) + b''.join(struct.pack('<I', crc32(x)) for s in substreams for x in s)
+    return out + bytes([0x00, 0x00])
+
+
+def property_record(kind, data):
+    return bytes([kind]) + number(len(data)) + data
+
+
+def files_info(entries):
+    # entries: (name, data or None for a directory), files with data come in folder order
+    out = bytes([0x05]) + number(len(entries))
+    empty = [e[1] is None or len(e[1]) == 0 for e in entries]
+    if any(empty):
+        out += property_record(0x0E, bits(empty))
+        out += property_record(0x0F, bits([e[1] is not None for e, v in zip(entries, empty) if v]))
+    names = b'\x00' + b''.join(e[0].encode('utf-16-le') + b'\x00\x00' for e in entries)
+    out += property_record(0x11, names)
+    out += property_record(0x14, b'\x01\x00' + b''.join(struct.pack('<Q', MTIME) for _ in entries))
+    attributes = [0x10 if e[1] is None else 0x20 for e in entries]
+    out += property_record(0x15, b'\x01\x00' + b''.join(struct.pack('<I', a) for a in attributes))
+    return out + b'\x00'
+
+
+def make_7z(folders, groups, entries, encode_header=False):
+    data = b''.join(p for f in folders for p in f.packs)
+    header = bytes([0x01, 0x04]) + streams_info(folders, 0, groups) + files_info(entries) + b'\x00'
+    if encode_header:
+        packed = Folder([coder(b'\x03\x01\x01', LZMA_PROPS)], [len(header)], [lzma1(header)])
+        packed.crc = crc32(header)
+        header = bytes([0x17]) + streams_info([packed], len(data), None)
+        data += packed.packs[0]
+    start = struct.pack('<QQI', len(data), len(header), crc32(header))
+    return b'7z\xBC\xAF\x27\x1C\x00\x04' + struct.pack('<I', crc32(start)) + start + data + header
+
+
+def solid_7z():
+    text, noise, runs = payloads(7)
+    files = [('readme.txt', text), ('bin/noise.dat', noise), ('bin/runs.dat', runs),
+             ('données/é.txt', 'naïve café\n'.encode() * 50)]
+    entries = files + [('empty.txt', b''), ('emptydir', None), ('nested/a/b', None), ('bin', None),
+                       ('données', None), ('nested', None), ('nested/a', None)]
+    return make_7z([lzma2_folder(b''.join(d for _, d in files))], [[d for _, d in files]], entries), entries
+
+
+def bcj2_7z():
+    code, tail = x86_code(11, 150000), x86_code(12, 4099)
+    entries = [('app/code.bin', code), ('app/tail.bin', tail), ('app', None)]
+    return make_7z([bcj2_folder(code + tail)], [[code, tail]], entries), entries
+
+
+def header_7z():
+    text, noise, runs = payloads(21)
+    entries = [('docs/readme.txt', text), ('docs/runs.dat', runs), ('raw/noise.dat', noise), ('docs', None),
+               ('raw', None)]
+    folders = [lzma2_folder(text + runs), copy_folder(noise)]
+    return make_7z(folders, [[text, runs], [noise]], entries, encode_header=True), entries
+
+
+def minimal_pe():
+    dos = b'MZ' + b'\x00' * 58 + struct.pack('<I', 64)
+    coff = struct.pack('<HHIIIHH', 0x14C, 1, 0, 0, 0, 224, 0x0102)
+    opt = struct.pack('<HBBIIIIIIIIIHHHHHHIIIIHHIIIIII', 0x10B, 14, 0, 0x200, 0, 0, 0x1000, 0x1000, 0x1000,
+                      0x400000, 0x1000, 0x200, 6, 0, 0, 0, 6, 0, 0, 0x2000, 0x200, 0, 3, 0x8140, 0x100000, 0x1000,
+                      0x100000, 0x1000, 0, 16)
+    opt += b'\x00' * (224 - len(opt))
+    section = b'.text\x00\x00\x00' + struct.pack('<IIIIIIHHI', 0x200, 0x1000, 0x200, 0x200, 0, 0, 0, 0, 0x60000020)
+    headers = dos + b'PE\x00\x00' + coff + opt + section
+    headers += b'\x00' * (0x200 - len(headers))
+    return headers + b'\xC3' + b'\x00' * 0x1FF
+
+
+# ---------------------------------------------------------------- msi
+def encode_stream_name(name, table):
+    def mime(c):
+        if '0' <= c <= '9':
+            return ord(c) - 48
+        if 'A' <= c <= 'Z':
+            return ord(c) - 65 + 10
+        if 'a' <= c <= 'z':
+            return ord(c) - 97 + 36
+        return {'.': 62, '_': 63}.get(c, -1)
+
+    out = [0x4840] if table else []
+    i = 0
+    while i < len(name):
+        m = mime(name[i])
+        if m < 0:
+            out.append(ord(name[i]))
+            i += 1
+        elif i + 1 < len(name) and mime(name[i + 1]) >= 0:
+            out.append(0x3800 + m + (mime(name[i + 1]) << 6))
+            i += 2
+        else:
+            out.append(0x4800 + m)
+            i += 1
+    return out
+
+
+def cab_checksum(data, seed):
+    s = seed
+    n = len(data) // 4
+    for k in range(n):
+        s ^= struct.unpack_from('<I', data, k * 4)[0]
+    rem = data[n * 4:]
+    tail = 0
+    for b in rem:
+        tail = tail << 8 | b
+    return s ^ tail
+
+
+def make_cab(folders):
+    # folders: (method, [(name, data)]), the reserve fields are present to exercise their skipping
+    hdr_res, fold_res, data_res = 4, 2, 1
+    files_off = 36 + 4 + hdr_res + len(folders) * (8 + fold_res)
+    records = b''
+    for fi, (_, files) in enumerate(folders):
+        off = 0
+        for name, data in files:
+            records += struct.pack('<IIHHHH', len(data), off, fi, 0x5821, 0x6000, 0x20) + name.encode() + b'\x00'
+            off += len(data)
+    data_start = files_off + len(records)
+    blobs = b''
+    folder_records = b''
+    for method, files in folders:
+        joined = b''.join(d for _, d in files)
+        blocks = [joined[i:i + 32768] for i in range(0, len(joined), 32768)] or [b'']
+        start = data_start + len(blobs)
+        prev = None
+        for block in blocks:
+            if method == 1:
+                # each MSZIP block is a complete deflate stream primed with the previous block
+                co = zlib.compressobj(9, zlib.DEFLATED, -15, zdict=prev) if prev else zlib.compressobj(9, zlib.DEFLATED, -15)
+                packed = b'CK' + co.compress(block) + co.flush()
+            else:
+                packed = block
+            prev = block
+            sizes = struct.pack('<HH', len(packed), len(block))
+            blobs += struct.pack('<I', cab_checksum(sizes, cab_checksum(packed, 0))) + sizes + b'\x07' + packed
+        folder_records += struct.pack('<IHH', start, len(blocks), method) + b'\x00' * fold_res
+    total = data_start + len(blobs)
+    nfiles = sum(len(f) for _, f in folders)
+    header = b'MSCF' + struct.pack('<IIIIIBBHHHHH', 0, total, 0, files_off, 0, 3, 1, len(folders), nfiles, 4, 0, 0)
+    header += struct.pack('<HBB', hdr_res, fold_res, data_res) + b'\xAA' * hdr_res
+    return header + folder_records + records + blobs
+
+
+def make_msi():
+    strings = ['']
+
+    def sid(s):
+        if s is None:
+            return 0
+        if s not in strings:
+            strings.append(s)
+        return strings.index(s)
+
+    S, SN, I2, I2N, I4 = 0x0D48, 0x1D48, 0x0502, 0x1502, 0x0104
+    tables = {
+        'Directory': [('Directory', S), ('Directory_Parent', SN), ('DefaultDir', S)],
+        'Component': [('Component', S), ('ComponentId', SN), ('Directory_', S), ('Attributes', I2), ('Condition', SN),
+                      ('KeyPath', SN)],
+        'File': [('File', S), ('Component_', S), ('FileName', S), ('FileSize', I4), ('Version', SN), ('Language', SN),
+                 ('Attributes', I2N), ('Sequence', I2)],
+        'Media': [('DiskId', I2), ('LastSequence', I2), ('DiskPrompt', SN), ('Cabinet', SN), ('VolumeLabel', SN),
+                  ('Source', SN)],
+    }
+    text, noise, runs = payloads(31)
+    payload = {
+        'f1': text,
+        'f2': b'MZ' + bytes(range(256)) * 40,
+        'f3': noise + runs,
+        'f4': b'',
+        'f5': b'x' * 70000,
+    }
+    rows = {
+        'Directory': [('TARGETDIR', None, 'SourceDir'), ('ProgramFilesFolder', 'TARGETDIR', '.:PFiles'),
+                      ('APPDIR', 'ProgramFilesFolder', 'APP|My App'), ('BINDIR', 'APPDIR', 'bin'),
+                      ('DOTDIR', 'APPDIR', '.')],
+        'Component': [('C1', '{1}', 'APPDIR', 0, None, 'f1'), ('C2', '{2}', 'BINDIR', 0, None, 'f2'),
+                      ('C3', '{3}', 'DOTDIR', 0, None, 'f3')],
+        'File': [('f1', 'C1', 'README~1.TXT|readme.txt', len(payload['f1']), None, None, 0, 1),
+                 ('f2', 'C2', 'tool.exe', len(payload['f2']), '1.0', '0', 0, 2),
+                 ('f3', 'C3', 'data.bin', len(payload['f3']), None, None, None, 3),
+                 ('f4', 'C3', 'empty.txt', 0, None, None, 0, 4),
+                 ('f5', 'C2', 'zeros.dat', len(payload['f5']), None, None, 0x4000, 5)],
+        'Media': [(1, 5, None, '#cab1.cab', None, None)],
+    }
+
+    def table_stream(name):
+        out = b''
+        for ci, (_, ct) in enumerate(tables[name]):
+            for r in rows[name]:
+                v = r[ci]
+                if ct & 0x0800:
+                    out += struct.pack('<H', sid(v))
+                elif (ct & 0xFF) == 2:
+                    out += struct.pack('<H', 0 if v is None else (v + 0x8000) & 0xFFFF)
+                else:
+                    out += struct.pack('<I', 0 if v is None else (v + 0x80000000) & 0xFFFFFFFF)
+        return out
+
+    streams = {}
+    for t in tables:
+        streams[(t, True)] = table_stream(t)
+    columns = [(t, i + 1, cn, ct) for t, cols in tables.items() for i, (cn, ct) in enumerate(cols)]
+    streams[('_Columns', True)] = b''.join(
+        b''.join(struct.pack('<H', f(r)) for r in columns)
+        for f in (lambda r: sid(r[0]), lambda r: (r[1] + 0x8000) & 0xFFFF, lambda r: sid(r[2]),
+                  lambda r: (r[3] + 0x8000) & 0xFFFF))
+    streams[('_Tables', True)] = b''.join(struct.pack('<H', sid(t)) for t in tables)
+    pool = struct.pack('<HH', 1252, 0)
+    string_data = b''
+    for s in strings[1:]:
+        b = s.encode('cp1252')
+        pool += struct.pack('<HH', len(b), 1)
+        string_data += b
+    streams[('_StringPool', True)] = pool
+    streams[('_StringData', True)] = string_data
+    streams[('cab1.cab', False)] = make_cab([(1, [('f1', payload['f1']), ('f3', payload['f3'])]),
+                                             (0, [('f2', payload['f2']), ('f4', payload['f4'])]),
+                                             (1, [('f5', payload['f5'])])])
+    # summary information, PID_WORDCOUNT 2: compressed
+    section = struct.pack('<II', 0, 1) + struct.pack('<II', 15, 16) + struct.pack('<Ii', 3, 2)
+    section = struct.pack('<I', len(section)) + section[4:]
+    streams[('\x05SummaryInformation', None)] = struct.pack('<HHI', 0xFFFE, 0, 0) + b'\x00' * 16 + \
+        struct.pack('<I', 1) + bytes.fromhex('e0859ff2f94f6810ab9108002b27b3d9') + struct.pack('<I', 48) + section
+
+    SS, MSS, CUTOFF = 512, 64, 4096
+    ENDC, FREE, FATSECT = 0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFD
+    entries, mini, minifat, regular = [], b'', [], []
+    for (name, table), data in streams.items():
+        codes = [ord(c) for c in name] if table is None else encode_stream_name(name, table)
+        if len(data) < CUTOFF:
+            start = len(mini) // MSS if data else ENDC
+            count = (len(data) + MSS - 1) // MSS
+            for k in range(count):
+                minifat.append(len(minifat) + 1 if k < count - 1 else ENDC)
+            mini += data + b'\x00' * ((-len(data)) % MSS)
+            entries.append([codes, start, len(data)])
+        else:
+            entries.append([codes, None, len(data)])
+            regular.append((len(entries) - 1, data))
+
+    def sectors(n):
+        return (n + SS - 1) // SS
+
+    ndir, nminifat, nmini = sectors((len(entries) + 1) * 128), sectors(len(minifat) * 4), sectors(len(mini))
+    nreg = sum(sectors(len(d)) for _, d in regular)
+    nfat = 1
+    while nfat * (SS // 4) < nfat + ndir + nminifat + nmini + nreg:
+        nfat += 1
+    fat = [FATSECT] * nfat
+
+    def chain(count):
+        start = len(fat)
+        for k in range(count):
+            fat.append(len(fat) + 1 if k < count - 1 else ENDC)
+        return start if count else ENDC
+
+    dir_start, minifat_start, mini_start = chain(ndir), chain(nminifat), chain(nmini)
+    for index, data in regular:
+        entries[index][1] = chain(sectors(len(data)))
+    fat += [FREE] * (nfat * (SS // 4) - len(fat))
+
+    def dirent(codes, kind, left, right, child, start, size):
+        name = b''.join(struct.pack('<H', c) for c in codes) + b'\x00\x00'
+        return name + b'\x00' * (64 - len(name)) + struct.pack('<HBBIII', len(codes) * 2 + 2, kind, 1, left, right,
+                                                               child) + b'\x00' * 36 + struct.pack('<IQ', start, size)
+
+    directory = dirent([ord(c) for c in 'Root Entry'], 5, FREE, FREE, 1, mini_start, len(mini))
+    n = len(entries)
+    for i, (codes, start, size) in enumerate(entries):
+        index = i + 1
+        directory += dirent(codes, 2, 2 * index if 2 * index <= n else FREE,
+                            2 * index + 1 if 2 * index + 1 <= n else FREE, FREE, start, size)
+    directory += b'\x00' * (ndir * SS - len(directory))
+    header = bytes.fromhex('d0cf11e0a1b11ae1') + b'\x00' * 16 + struct.pack('<HHHHH', 0x3E, 3, 0xFFFE, 9, 6)
+    header += b'\x00' * 6 + struct.pack('<IIIIIIIII', 0, nfat, dir_start, 0, CUTOFF, minifat_start, nminifat, ENDC, 0)
+    header += b''.join(struct.pack('<I', x) for x in list(range(nfat)) + [FREE] * (109 - nfat))
+    body = b''.join(struct.pack('<I', x) for x in fat) + directory
+    table = b''.join(struct.pack('<I', x) for x in minifat)
+    body += table + b'\x00' * (nminifat * SS - len(table)) + mini + b'\x00' * (nmini * SS - len(mini))
+    for _, data in regular:
+        body += data + b'\x00' * ((-len(data)) % SS)
+    layout = [('My App/readme.txt', payload['f1']), ('My App/bin/tool.exe', payload['f2']),
+              ('My App/data.bin', payload['f3']), ('My App/empty.txt', payload['f4']),
+              ('My App/bin/zeros.dat', payload['f5'])]
+    return header + body, layout
+
+
+def main():
+    solid, solid_entries = solid_7z()
+    archives = [('solid.7z', solid, solid_entries), ('bcj2.7z',) + bcj2_7z(), ('header.7z',) + header_7z(),
+                ('sfx.exe', minimal_pe() + solid, solid_entries), ('package.msi',) + make_msi()]
+    for name, data, entries in archives:
+        with open(os.path.join(HERE, name), 'wb') as f:
+            f.write(data)
+        for path, contents in entries:
+            if contents is None:
+                print('    {L"%s", L"%s", -1, 0},' % (name, path))
+            else:
+                print('    {L"%s", L"%s", %d, 0x%08x},' % (name, path, len(contents), crc32(contents)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,76 @@
+//
+#include <baulk/archive/crc32.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+// usage: crc32_bench [megabytes]
+// compares slicing-by-16 with the runtime dispatched CRC-32 (PCLMULQDQ/VPCLMULQDQ/ARMv8) and checks that
+// block checksums summed on several threads combine to the sequential checksum
+int wmain(int argc, wchar_t **argv) {
+  uint32_t megabytes = 256;
+  if (argc > 1) {
+    if (!bela::SimpleAtoi(argv[1], &megabytes) || megabytes == 0) {
+      bela::FPrintF(stderr, L"invalid size: %s\n", argv[1]);
+      return 1;
+    }
+  }
+  std::vector<uint8_t> data(static_cast<size_t>(megabytes) << 20);
+  std::mt19937_64 engine(20240601);
+  for (auto &b : data) {
+    b = static_cast<uint8_t>(engine());
+  }
+  auto measure = [&](const wchar_t *name, size_t chunk, auto &&fn) -> uint32_t {
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t crc = 0;
+    for (size_t pos = 0; pos < data.size(); pos += chunk) {
+      crc = fn(data.data() + pos, (std::min)(chunk, data.size() - pos), crc);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    bela::FPrintF(stderr, L"%s chunk %7d: %08x %.1f MB/s\n", name, chunk, crc, megabytes / elapsed);
+    return crc;
+  };
+  uint32_t expected = 0;
+  for (const size_t chunk : {size_t{4096}, size_t{65536}, size_t{1} << 20}) {
+    auto a = measure(L"slicing16", chunk, [](const uint8_t *p, size_t n, uint32_t prev) {
+      return crc32_fast(p, n, prev);
+    });
+    auto b = measure(L"dispatch ", chunk, [](const uint8_t *p, size_t n, uint32_t prev) {
+      return baulk::archive::Crc32(p, n, prev);
+    });
+    if (a != b) {
+      bela::FPrintF(stderr, L"crc32 mismatch: %08x != %08x\n", a, b);
+      return 1;
+    }
+    expected = a;
+  }
+  auto concurrency = (std::max)(std::thread::hardware_concurrency(), 1u);
+  auto blockSize = (data.size() + concurrency - 1) / concurrency;
+  std::vector<uint32_t> blocks(concurrency);
+  std::vector<std::thread> workers;
+  auto begin = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < concurrency; i++) {
+    workers.emplace_back([&, i] {
+      auto pos = (std::min)(blockSize * i, data.size());
+      blocks[i] = baulk::archive::Crc32(data.data() + pos, (std::min)(blockSize, data.size() - pos));
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  uint32_t combined = 0;
+  for (uint32_t i = 0; i < concurrency; i++) {
+    auto pos = (std::min)(blockSize * i, data.size());
+    combined = baulk::archive::Crc32Combine(combined, blocks[i], (std::min)(blockSize, data.size() - pos));
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  bela::FPrintF(stderr, L"combined %d blocks: %08x %.1f MB/s\n", concurrency, combined, megabytes / elapsed);
+  if (combined != expected) {
+    bela::FPrintF(stderr, L"crc32 combine mismatch: %08x != %08x\n", combined, expected);
+    return 1;
+  }
+  return 0;
+}
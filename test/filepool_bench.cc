@@ -0,0 +1,61 @@
+//
+#include <baulk/archive.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+
+// usage: filepool_bench [entries] [threads]
+// writes entries files of 1 KB (default 100k) into a temporary folder, once on the calling thread with
+// File::NewFile, WriteFull and close, once through a FilePool, and prints the files per second of both
+int wmain(int argc, wchar_t **argv) {
+  size_t entries = 100000;
+  uint32_t threads = 4;
+  if ((argc > 1 && !bela::SimpleAtoi(argv[1], &entries)) || (argc > 2 && !bela::SimpleAtoi(argv[2], &threads)) ||
+      entries == 0) {
+    bela::FPrintF(stderr, L"usage: %s [entries] [threads]\n", argv[0]);
+    return 1;
+  }
+  std::error_code e;
+  auto root = std::filesystem::temp_directory_path(e) / L"filepool_bench";
+  std::vector<uint8_t> payload(1024, 'x');
+  auto prepare = [&](std::wstring_view name) {
+    auto dir = root / name;
+    std::filesystem::remove_all(dir, e);
+    for (size_t i = 0; i < entries; i += 1000) {
+      std::filesystem::create_directories(dir / bela::StringCat(L"dir", i / 1000), e);
+    }
+    return dir;
+  };
+  auto closer = bela::finally([&] { std::filesystem::remove_all(root, e); });
+  bela::error_code ec;
+  auto dir = prepare(L"sync");
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < entries; i++) {
+    auto fd = baulk::archive::File::Create(dir / bela::StringCat(L"dir", i / 1000, L"\\file", i, L".txt"),
+                                           bela::Now(), true, ec);
+    if (!fd || !fd->WriteFull(payload.data(), payload.size(), ec)) {
+      bela::FPrintF(stderr, L"unable write file: %s\n", ec);
+      return 1;
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  bela::FPrintF(stderr, L"calling thread: %d files %.3fs %.0f files/s\n", entries, elapsed,
+                static_cast<double>(entries) / elapsed);
+  dir = prepare(L"pool");
+  {
+    baulk::archive::FilePool pool(threads);
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; i++) {
+      pool.Write(dir / bela::StringCat(L"dir", i / 1000, L"\\file", i, L".txt"), std::vector<uint8_t>(payload),
+                 bela::Now(), true, false);
+    }
+    if (!pool.Wait(ec)) {
+      bela::FPrintF(stderr, L"unable write file: %s\n", ec);
+      return 1;
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    bela::FPrintF(stderr, L"pool (%d threads): %d files %.3fs %.0f files/s (%.0f files/s since start)\n", threads,
+                  pool.Files(), elapsed, static_cast<double>(pool.Files()) / elapsed, pool.FilesPerSecond());
+  }
+  return 0;
+}
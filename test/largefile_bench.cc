@@ -0,0 +1,64 @@
+//
+#include <baulk/archive.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+
+// usage: largefile_bench [MiB]
+// writes a file of MiB megabytes (default 1024) in 64 KB chunks the way entries are decoded: with WriteFull, through
+// a preallocated LargeFile with gathered writes and through a preallocated mapped LargeFile, and prints throughput
+int wmain(int argc, wchar_t **argv) {
+  int64_t mib = 1024;
+  if (argc > 1 && (!bela::SimpleAtoi(argv[1], &mib) || mib <= 0)) {
+    bela::FPrintF(stderr, L"usage: %s [MiB]\n", argv[0]);
+    return 1;
+  }
+  std::error_code e;
+  auto file = std::filesystem::temp_directory_path(e) / L"largefile_bench.bin";
+  auto closer = bela::finally([&] { std::filesystem::remove(file, e); });
+  auto size = mib * 1024 * 1024;
+  std::vector<uint8_t> chunk(64 * 1024);
+  for (size_t i = 0; i < chunk.size(); i++) {
+    chunk[i] = static_cast<uint8_t>(i * 131);
+  }
+  auto measure = [&](const wchar_t *label, auto &&write) {
+    bela::error_code ec;
+    auto fd = baulk::archive::File::NewFile(file, bela::Now(), true, ec);
+    if (!fd) {
+      bela::FPrintF(stderr, L"unable create %s error: %s\n", file.native(), ec);
+      return false;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    if (!write(*fd, ec)) {
+      bela::FPrintF(stderr, L"%s: %s\n", label, ec);
+      return false;
+    }
+    fd.reset();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    bela::FPrintF(stderr, L"%s %d MiB %.3fs %.1f MiB/s\n", label, mib, elapsed, static_cast<double>(mib) / elapsed);
+    return true;
+  };
+  auto fill = [&](auto &&w, bela::error_code &ec) {
+    for (int64_t n = 0; n < size; n += static_cast<int64_t>(chunk.size())) {
+      if (!w(chunk.data(), chunk.size(), ec)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto ok = measure(L"WriteFull        ", [&](baulk::archive::File &fd, bela::error_code &ec) {
+    return fill([&](const void *data, size_t len, bela::error_code &ec) { return fd.WriteFull(data, len, ec); }, ec);
+  });
+  for (auto mapped : {false, true}) {
+    ok = ok && measure(mapped ? L"LargeFile mapped " : L"LargeFile gather ",
+                       [&](baulk::archive::File &fd, bela::error_code &ec) {
+                         baulk::archive::LargeFile large(fd);
+                         large.Initialize(size, mapped);
+                         return fill([&](const void *data, size_t len,
+                                         bela::error_code &ec) { return large.Write(data, len, ec); },
+                                     ec) &&
+                                large.Finish(bela::Now(), ec);
+                       });
+  }
+  return ok ? 0 : 1;
+}
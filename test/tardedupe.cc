@@ -0,0 +1,130 @@
+//
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+
+// usage: tardedupe
+// extracts a tarball whose later entries overwrite earlier names, with dedupe and after hard link entries, on the
+// extracting thread and pipelined. Overwriting a name must not change the other names of its data
+namespace {
+struct tar_entry {
+  std::string_view name;
+  std::string_view contents;
+  char typeflag{'0'};
+  std::string_view linkname;
+};
+
+void put_octal(char *field, size_t width, uint64_t value) {
+  std::string digits;
+  do {
+    digits.insert(digits.begin(), static_cast<char>('0' + (value & 7)));
+    value >>= 3;
+  } while (value != 0);
+  digits.insert(digits.begin(), width - 1 - digits.size(), '0');
+  memcpy(field, digits.data(), digits.size());
+}
+
+std::string make_tar(std::initializer_list<tar_entry> entries) {
+  std::string tar;
+  for (const auto &e : entries) {
+    char hdr[512] = {0};
+    memcpy(hdr, e.name.data(), e.name.size());
+    put_octal(hdr + 100, 8, 0644);
+    put_octal(hdr + 108, 8, 0);
+    put_octal(hdr + 116, 8, 0);
+    put_octal(hdr + 124, 12, e.contents.size());
+    put_octal(hdr + 136, 12, 1700000000);
+    hdr[156] = e.typeflag;
+    memcpy(hdr + 157, e.linkname.data(), e.linkname.size());
+    memcpy(hdr + 257, "ustar\0" "00", 8);
+    memset(hdr + 148, ' ', 8);
+    uint64_t sum = 0;
+    for (auto c : hdr) {
+      sum += static_cast<uint8_t>(c);
+    }
+    put_octal(hdr + 148, 7, sum);
+    tar.append(hdr, sizeof(hdr));
+    tar.append(e.contents);
+    tar.append((512 - e.contents.size() % 512) % 512, '\0');
+  }
+  tar.append(1024, '\0');
+  return tar;
+}
+
+struct expected_file {
+  std::wstring_view name;
+  std::string_view contents;
+};
+
+int check(const std::filesystem::path &tarfile, const baulk::archive::ExtractorOptions &opts, const wchar_t *label,
+          std::initializer_list<expected_file> files) {
+  std::error_code e;
+  auto dest = std::filesystem::temp_directory_path(e) / L"tardedupe.out";
+  std::filesystem::remove_all(dest, e);
+  bela::error_code ec;
+  auto fd = bela::io::NewFile(tarfile.native(), ec);
+  if (!fd) {
+    bela::FPrintF(stderr, L"unable open %s error: %s\n", tarfile, ec);
+    return 1;
+  }
+  baulk::archive::tar::FileReader fr(std::move(*fd));
+  baulk::archive::tar::Extractor extractor(&fr, opts);
+  if (!extractor.InitializeExtractor(dest, ec) || !extractor.Extract(nullptr, nullptr, ec)) {
+    bela::FPrintF(stderr, L"%s: unable extract error: %s\n", label, ec);
+    return 1;
+  }
+  int failures = 0;
+  for (const auto &f : files) {
+    std::string contents;
+    if (!bela::io::ReadFile((dest / f.name).native(), contents, ec)) {
+      bela::FPrintF(stderr, L"%s: unable read %s error: %s\n", label, f.name, ec);
+      failures++;
+      continue;
+    }
+    if (contents != f.contents) {
+      bela::FPrintF(stderr, L"%s: %s is '%s', expected '%s'\n", label, f.name, contents, f.contents);
+      failures++;
+    }
+  }
+  std::filesystem::remove_all(dest, e);
+  bela::FPrintF(stderr, L"%s: %s\n", label, failures == 0 ? L"ok" : L"FAILED");
+  return failures;
+}
+} // namespace
+
+int wmain() {
+  std::error_code e;
+  auto tarfile = std::filesystem::temp_directory_path(e) / L"tardedupe.tar";
+  auto closer = bela::finally([&] { std::filesystem::remove(tarfile, e); });
+  // b.txt becomes a link to a.txt, then a.txt is replaced and c.txt has the contents a.txt had. e.txt is a hard link
+  // entry to d.txt, then d.txt is replaced
+  auto tar = make_tar({
+      {.name = "a.txt", .contents = "first contents"},
+      {.name = "b.txt", .contents = "first contents"},
+      {.name = "a.txt", .contents = "second contents"},
+      {.name = "c.txt", .contents = "first contents"},
+      {.name = "d.txt", .contents = "linked contents"},
+      {.name = "e.txt", .typeflag = '1', .linkname = "d.txt"},
+      {.name = "d.txt", .contents = "replaced"},
+  });
+  bela::error_code ec;
+  if (!bela::io::WriteText(tarfile.native(), {reinterpret_cast<const uint8_t *>(tar.data()), tar.size()}, ec)) {
+    bela::FPrintF(stderr, L"unable write %s error: %s\n", tarfile, ec);
+    return 1;
+  }
+  int failures = 0;
+  for (const auto dedupe : {true, false}) {
+    for (const auto pipelined : {false, true}) {
+      auto label = bela::StringCat(dedupe ? L"dedupe" : L"no dedupe", pipelined ? L" pipelined" : L"");
+      failures += check(tarfile, baulk::archive::ExtractorOptions{.pipelined = pipelined, .dedupe = dedupe},
+                        label.data(),
+                        {
+                            {L"a.txt", "second contents"},
+                            {L"b.txt", "first contents"},
+                            {L"c.txt", "first contents"},
+                            {L"d.txt", "replaced"},
+                            {L"e.txt", "linked contents"},
+                        });
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+//
+#include <baulk/archive/tar.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <bela/str_cat.hpp>
+#include <chrono>
+
+// usage: tarheader_bench [entries]
+// builds an in-memory ustar stream of empty files and measures parsing its header blocks in place, reading it with
+// Reader::Next returning a new Header and with Reader::Next reusing one
+namespace tar = baulk::archive::tar;
+
+class memoryReader : public tar::ExtractReader {
+public:
+  memoryReader(const std::string &b) : data(b) {}
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto n = (std::min)(len, data.size() - pos);
+    memcpy(buffer, data.data() + pos, n);
+    pos += n;
+    return static_cast<ssize_t>(n);
+  }
+  bool Discard(int64_t len, bela::error_code &ec) override {
+    pos += static_cast<size_t>(len);
+    return true;
+  }
+  bool WriteTo(const tar::Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) override {
+    auto n = (std::min)(static_cast<size_t>(filesize), data.size() - pos);
+    pos += n;
+    extracted += static_cast<int64_t>(n);
+    return w(data.data() + pos - n, n, ec);
+  }
+
+private:
+  const std::string &data;
+  size_t pos{0};
+};
+
+template <size_t N> void putOctal(char (&field)[N], int64_t v) {
+  for (size_t i = N - 1; i-- > 0; v >>= 3) {
+    field[i] = static_cast<char>('0' + (v & 7));
+  }
+  field[N - 1] = 0;
+}
+
+std::string generate(size_t entries) {
+  std::string b;
+  b.reserve((entries + 2) * sizeof(tar::ustar_header));
+  for (size_t i = 0; i < entries; i++) {
+    tar::ustar_header hdr{};
+    auto name = bela::StringNarrowCat("bench/dir", i / 1000, "/file", i, ".txt");
+    memcpy(hdr.name, name.data(), (std::min)(name.size(), sizeof(hdr.name)));
+    putOctal(hdr.mode, 0644);
+    putOctal(hdr.uid, 1000);
+    putOctal(hdr.gid, 1000);
+    putOctal(hdr.size, 0);
+    putOctal(hdr.mtime, 1700000000);
+    hdr.typeflag = tar::TypeReg;
+    memcpy(hdr.magic, "ustar", 6);
+    memcpy(hdr.version, "00", 2);
+    memcpy(hdr.uname, "baulk", 5);
+    memcpy(hdr.gname, "baulk", 5);
+    memset(hdr.chksum, ' ', sizeof(hdr.chksum));
+    int64_t sum = 0;
+    for (auto c : std::string_view(reinterpret_cast<const char *>(&hdr), sizeof(hdr))) {
+      sum += static_cast<uint8_t>(c);
+    }
+    putOctal(hdr.chksum, sum);
+    b.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+  }
+  b.append(2 * sizeof(tar::ustar_header), '\0');
+  return b;
+}
+
+template <typename F> void measure(const wchar_t *label, size_t entries, F &&f) {
+  auto begin = std::chrono::steady_clock::now();
+  auto n = f();
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  bela::FPrintF(stderr, L"%s %8d headers %.3fms %.1f ns/header\n", label, n, elapsed * 1000,
+                elapsed * 1e9 / static_cast<double>((std::max)(entries, size_t(1))));
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t entries = 100000;
+  if (argc > 1 && (!bela::SimpleAtoi(argv[1], &entries) || entries == 0)) {
+    bela::FPrintF(stderr, L"invalid entries: %s\n", argv[1]);
+    return 1;
+  }
+  auto b = generate(entries);
+  measure(L"ParseHeaderView  ", entries, [&]() {
+    size_t n = 0;
+    tar::HeaderView hv;
+    auto blocks = reinterpret_cast<const tar::ustar_header *>(b.data());
+    for (size_t i = 0; i < entries; i++) {
+      if (tar::ParseHeaderView(blocks[i], hv)) {
+        n++;
+      }
+    }
+    return n;
+  });
+  measure(L"Next() new Header", entries, [&]() {
+    size_t n = 0;
+    bela::error_code ec;
+    memoryReader mr(b);
+    tar::Reader tr(&mr);
+    while (tr.Next(ec)) {
+      n++;
+    }
+    return n;
+  });
+  measure(L"Next(Header &)   ", entries, [&]() {
+    size_t n = 0;
+    bela::error_code ec;
+    memoryReader mr(b);
+    tar::Reader tr(&mr);
+    tar::Header h;
+    while (tr.Next(h, ec)) {
+      n++;
+    }
+    return n;
+  });
+  return 0;
+}
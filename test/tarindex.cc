@@ -0,0 +1,78 @@
+//
+#include <baulk/archive.hpp>
+#include <baulk/archive/tar.hpp>
+#include <bela/terminal.hpp>
+#include <chrono>
+
+// usage: tarindex tarball [member]
+// builds the sidecar index of the tarball or loads it when it is up to date, lists the members and writes the
+// contents of member to stdout, without member it prints how long reading the last member takes
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s tarball [member]\n", argv[0]);
+    return 1;
+  }
+  bela::error_code ec;
+  int64_t offset = 0;
+  baulk::archive::file_format_t afmt{baulk::archive::file_format_t::none};
+  auto fd = baulk::archive::OpenFile(argv[1], offset, afmt, ec);
+  if (!fd) {
+    bela::FPrintF(stderr, L"unable open file %s error %s\n", argv[1], ec);
+    return 1;
+  }
+  baulk::archive::tar::FileReader fr(fd->NativeFD());
+  baulk::archive::tar::Index index;
+  auto begin = std::chrono::steady_clock::now();
+  if (!index.LoadOrBuild(fr, argv[1], offset, afmt, baulk::archive::tar::ReaderOptions{}, ec)) {
+    bela::FPrintF(stderr, L"unable build index error %s\n", ec);
+    return 1;
+  }
+  bela::FPrintF(stderr, L"%d entries %d checkpoints %.3fs\n", index.Entries().size(), index.Checkpoints().size(),
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+  if (argc < 3) {
+    for (const auto &e : index.Entries()) {
+      bela::FPrintF(stderr, L"%c %12d %s\n", e.typeflag == 0 ? '0' : e.typeflag, e.size, e.name);
+    }
+    if (index.Entries().empty()) {
+      return 0;
+    }
+    const auto &last = index.Entries().back();
+    begin = std::chrono::steady_clock::now();
+    int64_t total = 0;
+    if (!index.Extract(
+            fr, last,
+            [&](const void *, size_t len, bela::error_code &) {
+              total += static_cast<int64_t>(len);
+              return true;
+            },
+            ec)) {
+      bela::FPrintF(stderr, L"unable extract %s error %s\n", last.name, ec);
+      return 1;
+    }
+    bela::FPrintF(stderr, L"last member %s: %d bytes %.3fs\n", last.name, total,
+                  std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+    return 0;
+  }
+  auto name = bela::encode_into<wchar_t, char>(argv[2]);
+  auto e = index.Find(name);
+  if (e == nullptr) {
+    bela::FPrintF(stderr, L"%s not found\n", argv[2]);
+    return 1;
+  }
+  auto out = GetStdHandle(STD_OUTPUT_HANDLE);
+  if (!index.Extract(
+          fr, *e,
+          [&](const void *data, size_t len, bela::error_code &ec) {
+            DWORD written = 0;
+            if (WriteFile(out, data, static_cast<DWORD>(len), &written, nullptr) != TRUE) {
+              ec = bela::make_system_error_code(L"WriteFile() ");
+              return false;
+            }
+            return true;
+          },
+          ec)) {
+    bela::FPrintF(stderr, L"unable extract %s error %s\n", argv[2], ec);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,61 @@
+//
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+
+// usage: unpack_bench 7zfile|msifile [threads]
+// extracts the archive with the native 7z or msi extractor and prints the wall time
+template <typename E>
+int unpack(const std::filesystem::path &file, const std::filesystem::path &dest, uint32_t threads) {
+  E extractor(baulk::archive::ExtractorOptions{.threads = threads});
+  bela::error_code ec;
+  if (!extractor.OpenReader(file, dest, ec)) {
+    bela::FPrintF(stderr, L"unable open %s error: %s\n", file, ec);
+    return 1;
+  }
+  auto begin = std::chrono::steady_clock::now();
+  if (!extractor.Extract(nullptr, nullptr, ec)) {
+    bela::FPrintF(stderr, L"unable extract %s error: %s\n", file, ec);
+    return 1;
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  auto mbs = static_cast<double>(extractor.UncompressedSize()) / (1024.0 * 1024.0) / elapsed;
+  bela::FPrintF(stderr, L"extract %s to %s: %.3fs %.1f MB/s\n", file, dest, elapsed, mbs);
+  return 0;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s 7zfile|msifile [threads]\n", argv[0]);
+    return 1;
+  }
+  uint32_t threads = 0;
+  if (argc > 2) {
+    if (!bela::SimpleAtoi(argv[2], &threads)) {
+      bela::FPrintF(stderr, L"invalid threads: %s\n", argv[2]);
+      return 1;
+    }
+  }
+  std::filesystem::path file(argv[1]);
+  baulk::archive::file_format_t afmt{baulk::archive::file_format_t::none};
+  int64_t offset = 0;
+  bela::error_code ec;
+  if (auto fd = baulk::archive::OpenFile(file.native(), offset, afmt, ec); !fd) {
+    bela::FPrintF(stderr, L"unable open %s error: %s\n", file, ec);
+    return 1;
+  }
+  std::error_code e;
+  auto dest = std::filesystem::temp_directory_path(e) / L"unpack_bench.out";
+  std::filesystem::remove_all(dest, e);
+  switch (afmt) {
+  case baulk::archive::file_format_t::_7z:
+    return unpack<baulk::archive::n7z::Extractor>(file, dest, threads);
+  case baulk::archive::file_format_t::msi:
+    return unpack<baulk::archive::msi::PackageExtractor>(file, dest, threads);
+  default:
+    break;
+  }
+  bela::FPrintF(stderr, L"%s is neither a 7z archive nor an installer package\n", file);
+  return 1;
+}
@@ -0,0 +1,67 @@
+//
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+
+// usage: untar_bench tarball [threads]
+// extracts the tarball sequentially and pipelined, then prints the wall time and how busy each pipeline stage was
+bool untar(const std::filesystem::path &file, uint32_t threads, bool pipelined) {
+  bela::error_code ec;
+  int64_t offset = 0;
+  baulk::archive::file_format_t afmt{baulk::archive::file_format_t::none};
+  auto fd = baulk::archive::OpenFile(file.c_str(), offset, afmt, ec);
+  if (!fd) {
+    bela::FPrintF(stderr, L"unable open file %s error %s\n", file, ec);
+    return false;
+  }
+  baulk::archive::tar::FileReader fr(fd->NativeFD());
+  auto wr =
+      baulk::archive::tar::MakeReader(fr, offset, afmt, baulk::archive::tar::ReaderOptions{.threads = threads}, ec);
+  if (!wr && ec.code != baulk::archive::tar::ErrNoFilter) {
+    bela::FPrintF(stderr, L"unable open tar file %s error %s\n", file, ec);
+    return false;
+  }
+  std::error_code e;
+  auto dest = std::filesystem::temp_directory_path(e) / L"untar_bench.out";
+  std::filesystem::remove_all(dest, e);
+  baulk::archive::tar::Extractor extractor(wr ? wr.get() : static_cast<baulk::archive::tar::ExtractReader *>(&fr),
+                                           baulk::archive::ExtractorOptions{.pipelined = pipelined});
+  if (!extractor.InitializeExtractor(dest, ec)) {
+    bela::FPrintF(stderr, L"unable initialize extractor error: %s\n", ec);
+    return false;
+  }
+  auto begin = std::chrono::steady_clock::now();
+  if (!extractor.Extract(nullptr, nullptr, ec)) {
+    bela::FPrintF(stderr, L"unable extract %s error: %s\n", file, ec);
+    return false;
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  if (!pipelined) {
+    bela::FPrintF(stderr, L"sequential: %.3fs\n", elapsed);
+    return true;
+  }
+  const auto &st = extractor.Stats();
+  bela::FPrintF(stderr, L"pipelined:  %.3fs %.1f MB/s\n", elapsed,
+                static_cast<double>(st.decoded) / (1024.0 * 1024.0) / elapsed);
+  bela::FPrintF(stderr, L"  decode %.1f%% busy\n  parse  %.1f%% busy\n  write  %.1f%% busy\n",
+                st.decode.Utilization() * 100, st.parse.Utilization() * 100, st.write.Utilization() * 100);
+  return true;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s tarball [threads]\n", argv[0]);
+    return 1;
+  }
+  uint32_t threads = 1;
+  if (argc > 2 && !bela::SimpleAtoi(argv[2], &threads)) {
+    bela::FPrintF(stderr, L"invalid threads: %s\n", argv[2]);
+    return 1;
+  }
+  std::filesystem::path file(argv[1]);
+  if (!untar(file, threads, false) || !untar(file, threads, true)) {
+    return 1;
+  }
+  return 0;
+}
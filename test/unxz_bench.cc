@@ -0,0 +1,61 @@
+//
+#include <baulk/archive.hpp>
+#include <baulk/archive/tar.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+
+// usage: unxz_bench file.tar.xz [threads]
+// decodes the xz stream with the single-threaded reader and with the threaded one, the output is discarded
+bool decode(std::wstring_view file, uint32_t threads) {
+  bela::error_code ec;
+  int64_t offset = 0;
+  baulk::archive::file_format_t afmt{baulk::archive::file_format_t::none};
+  auto fd = baulk::archive::OpenFile(file, offset, afmt, ec);
+  if (!fd) {
+    bela::FPrintF(stderr, L"unable open file %s error %s\n", file, ec);
+    return false;
+  }
+  if (afmt != baulk::archive::file_format_t::xz) {
+    bela::FPrintF(stderr, L"%s is not a xz file\n", file);
+    return false;
+  }
+  baulk::archive::tar::FileReader fr(fd->NativeFD());
+  auto wr =
+      baulk::archive::tar::MakeReader(fr, offset, afmt, baulk::archive::tar::ReaderOptions{.threads = threads}, ec);
+  if (!wr) {
+    bela::FPrintF(stderr, L"unable open xz reader error %s\n", ec);
+    return false;
+  }
+  int64_t total = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (;;) {
+    int64_t extracted = 0;
+    auto ok = wr->WriteTo([](const void *, size_t, bela::error_code &) { return true; }, 4 * 1024 * 1024, extracted,
+                          ec);
+    total += extracted;
+    if (!ok) {
+      break;
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  bela::FPrintF(stderr, L"threads %d: %d bytes %.3fs %.1f MB/s\n", threads, total, elapsed,
+                static_cast<double>(total) / (1024.0 * 1024.0) / elapsed);
+  return true;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s file.tar.xz [threads]\n", argv[0]);
+    return 1;
+  }
+  uint32_t threads = 0;
+  if (argc > 2 && !bela::SimpleAtoi(argv[2], &threads)) {
+    bela::FPrintF(stderr, L"invalid threads: %s\n", argv[2]);
+    return 1;
+  }
+  if (!decode(argv[1], 1) || !decode(argv[1], threads)) {
+    return 1;
+  }
+  return 0;
+}
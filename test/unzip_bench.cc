@@ -0,0 +1,53 @@
+//
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+#include <thread>
+
+// usage: unzip_bench zipfile [max-threads]
+// extracts the archive with 1..N worker threads, using positional reads and a mapped archive,
+// and prints the wall time of each run
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s zipfile [max-threads]\n", argv[0]);
+    return 1;
+  }
+  uint32_t maxThreads = std::thread::hardware_concurrency();
+  if (argc > 2) {
+    if (!bela::SimpleAtoi(argv[2], &maxThreads) || maxThreads == 0) {
+      bela::FPrintF(stderr, L"invalid threads: %s\n", argv[2]);
+      return 1;
+    }
+  }
+  std::filesystem::path file(argv[1]);
+  std::error_code e;
+  auto dest = std::filesystem::temp_directory_path(e) / L"unzip_bench.out";
+  double baseline = 0;
+  for (const auto mapped : {false, true}) {
+    for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+      std::filesystem::remove_all(dest, e);
+      baulk::archive::zip::Extractor extractor(
+          baulk::archive::ExtractorOptions{.threads = threads, .memory_mapped = mapped});
+      bela::error_code ec;
+      if (!extractor.OpenReader(file, dest, ec)) {
+        bela::FPrintF(stderr, L"unable open %s error: %s\n", file, ec);
+        return 1;
+      }
+      auto begin = std::chrono::steady_clock::now();
+      if (!extractor.Extract(nullptr, nullptr, ec)) {
+        bela::FPrintF(stderr, L"unable extract %s error: %s\n", file, ec);
+        return 1;
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      if (threads == 1 && !mapped) {
+        baseline = elapsed;
+      }
+      auto mbs = static_cast<double>(extractor.UncompressedSize()) / (1024.0 * 1024.0) / elapsed;
+      bela::FPrintF(stderr, L"%s threads %2d: %.3fs %.1f MB/s speedup %.2fx\n", mapped ? L"mmap " : L"pread", threads,
+                    elapsed, mbs, baseline / elapsed);
+    }
+  }
+  std::filesystem::remove_all(dest, e);
+  return 0;
+}
@@ -0,0 +1,69 @@
+//
+#include <baulk/archive/zip.hpp>
+#include <baulk/archive/tar.hpp>
+#include <baulk/archive.hpp>
+#include <bela/terminal.hpp>
+
+// usage: unzip_stream zipfile|- [destination]
+// extracts a zip front to back like a download in progress, '-' reads the archive from stdin
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s zipfile|- [destination]\n", argv[0]);
+    return 1;
+  }
+  bela::error_code ec;
+  std::optional<baulk::archive::tar::FileReader> fr;
+  if (wcscmp(argv[1], L"-") == 0) {
+    fr.emplace(GetStdHandle(STD_INPUT_HANDLE));
+  } else {
+    auto fd = bela::io::NewFile(argv[1], ec);
+    if (!fd) {
+      bela::FPrintF(stderr, L"unable open %s error: %s\n", argv[1], ec);
+      return 1;
+    }
+    fr.emplace(std::move(*fd));
+  }
+  std::filesystem::path destination = argc > 2 ? std::filesystem::path(argv[2]) : std::filesystem::current_path();
+  baulk::archive::zip::StreamReader zr(&*fr);
+  std::wstring encoded_path;
+  for (;;) {
+    auto file = zr.Next(ec);
+    if (!file) {
+      if (ec == bela::ErrEnded) {
+        break;
+      }
+      bela::FPrintF(stderr, L"read entry error: %s\n", ec);
+      return 1;
+    }
+    auto out = baulk::archive::JoinSanitizeFsPath(destination, file->name, file->IsFileNameUTF8(), encoded_path);
+    if (!out) {
+      bela::FPrintF(stderr, L"skip dangerous path %s\n", file->name);
+      continue;
+    }
+    bela::FPrintF(stderr, L" x %s\n", file->name);
+    if (file->IsDir()) {
+      if (!baulk::archive::MakeDirectories(*out, file->time, ec)) {
+        bela::FPrintF(stderr, L"mkdir %s error: %s\n", out->native(), ec);
+        return 1;
+      }
+      continue;
+    }
+    auto fd = baulk::archive::File::NewFile(*out, file->time, true, ec);
+    if (!fd) {
+      bela::FPrintF(stderr, L"create %s error: %s\n", out->native(), ec);
+      return 1;
+    }
+    if (!zr.Decompress(
+            *file, [&](const void *data, size_t len) { return fd->WriteFull(data, len, ec); }, ec)) {
+      fd->Discard();
+      bela::FPrintF(stderr, L"decompress %s error: %s\n", file->name, ec);
+      return 1;
+    }
+  }
+  if (!zr.Finish(ec)) {
+    bela::FPrintF(stderr, L"central directory error: %s\n", ec);
+    return 1;
+  }
+  bela::FPrintF(stderr, L"%d entries match the central directory\n", zr.Files().size());
+  return 0;
+}
@@ -0,0 +1,50 @@
+//
+#include <baulk/archive/zip.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+
+// usage: zipdecoder_bench zipfile [rounds]
+// decompresses every entry to a null writer several times, the first round warms up the per-thread
+// decoder cache, later rounds should not allocate decoder contexts or I/O buffers
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s zipfile [rounds]\n", argv[0]);
+    return 1;
+  }
+  int rounds = 3;
+  if (argc > 2 && (!bela::SimpleAtoi(argv[2], &rounds) || rounds < 2)) {
+    bela::FPrintF(stderr, L"invalid rounds: %s\n", argv[2]);
+    return 1;
+  }
+  baulk::archive::zip::Reader zr;
+  bela::error_code ec;
+  if (!zr.OpenReader(argv[1], ec)) {
+    bela::FPrintF(stderr, L"unable open %s error: %s\n", argv[1], ec);
+    return 1;
+  }
+  auto discard = [](const void *, size_t) { return true; };
+  for (int r = 0; r < rounds; r++) {
+    auto before = baulk::archive::zip::DecoderStats();
+    auto begin = std::chrono::steady_clock::now();
+    size_t entries = 0;
+    for (const auto &file : zr.Files()) {
+      if (file.IsDir()) {
+        continue;
+      }
+      if (!zr.Decompress(file, discard, ec)) {
+        bela::FPrintF(stderr, L"unable decompress %s error: %s\n", file.name, ec);
+        return 1;
+      }
+      entries++;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    auto after = baulk::archive::zip::DecoderStats();
+    bela::FPrintF(stderr,
+                  L"round %d: %d entries %.3fs contexts created %d reused %d buffers allocated %d reused %d\n", r,
+                  entries, elapsed, after.contexts_created - before.contexts_created,
+                  after.contexts_reused - before.contexts_reused, after.buffers_allocated - before.buffers_allocated,
+                  after.buffers_reused - before.buffers_reused);
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+//
+#include <baulk/archive/zip.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+#include <filesystem>
+#include <psapi.h>
+#include "zipgen.hpp"
+
+// usage: zipdir_bench [entries...]
+// generates archives with the given entry counts and measures the time and working set of opening them
+// with a materialized and a streaming central directory
+size_t working_set() {
+  PROCESS_MEMORY_COUNTERS pmc{.cb = sizeof(PROCESS_MEMORY_COUNTERS)};
+  if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) != TRUE) {
+    return 0;
+  }
+  return pmc.WorkingSetSize;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  std::vector<size_t> counts;
+  for (int i = 1; i < argc; i++) {
+    size_t n = 0;
+    if (!bela::SimpleAtoi(argv[i], &n) || n == 0) {
+      bela::FPrintF(stderr, L"invalid entries: %s\n", argv[i]);
+      return 1;
+    }
+    counts.emplace_back(n);
+  }
+  if (counts.empty()) {
+    counts = {1000, 10000, 100000, 500000};
+  }
+  std::error_code e;
+  auto file = std::filesystem::temp_directory_path(e) / L"zipdir_bench.zip";
+  for (auto n : counts) {
+    bela::error_code ec;
+    if (!zipgen::Generate(file.native(), n, ec)) {
+      bela::FPrintF(stderr, L"unable generate %s error: %s\n", file.native(), ec);
+      return 1;
+    }
+    for (const auto mode : {baulk::archive::zip::directory_mode_t::materialized,
+                            baulk::archive::zip::directory_mode_t::streaming}) {
+      auto rss = working_set();
+      auto begin = std::chrono::steady_clock::now();
+      baulk::archive::zip::Reader zr(mode);
+      if (!zr.OpenReader(file.native(), ec)) {
+        bela::FPrintF(stderr, L"unable open %s error: %s\n", file.native(), ec);
+        return 1;
+      }
+      size_t entries = 0;
+      auto it = zr.Iterator();
+      baulk::archive::zip::File zf;
+      while (it.Next(zf, ec)) {
+        entries++;
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      auto grown = static_cast<double>(static_cast<int64_t>(working_set()) - static_cast<int64_t>(rss)) / 1024.0;
+      bela::FPrintF(stderr, L"%8d entries %s: open+walk %.3fms working set +%.1f KB\n", entries,
+                    mode == baulk::archive::zip::directory_mode_t::streaming ? L"streaming   " : L"materialized",
+                    elapsed * 1000, grown);
+    }
+  }
+  std::filesystem::remove(file, e);
+  return 0;
+}
@@ -0,0 +1,52 @@
+//
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <chrono>
+#include <filesystem>
+#include "zipgen.hpp"
+
+// usage: zipextract_bench [entries]
+// extracts a generated archive of empty files (default 100k entries) sequentially and with the worker pool, the I/O
+// operation counters of the process stand in for the number of file system calls
+int wmain(int argc, wchar_t **argv) {
+  size_t entries = 100000;
+  if (argc > 1 && (!bela::SimpleAtoi(argv[1], &entries) || entries == 0)) {
+    bela::FPrintF(stderr, L"usage: %s [entries]\n", argv[0]);
+    return 1;
+  }
+  std::error_code e;
+  auto temp = std::filesystem::temp_directory_path(e);
+  auto file = temp / L"zipextract_bench.zip";
+  bela::error_code ec;
+  if (!zipgen::Generate(file.native(), entries, ec)) {
+    bela::FPrintF(stderr, L"unable generate %s error: %s\n", file.native(), ec);
+    return 1;
+  }
+  auto closer = bela::finally([&] { std::filesystem::remove(file, e); });
+  for (uint32_t threads : {1U, 0U}) {
+    auto dest = temp / L"zipextract_bench";
+    std::filesystem::remove_all(dest, e);
+    baulk::archive::zip::Extractor extractor(baulk::archive::ExtractorOptions{.threads = threads});
+    if (!extractor.OpenReader(file, dest, ec)) {
+      bela::FPrintF(stderr, L"unable open %s error: %s\n", file.native(), ec);
+      return 1;
+    }
+    IO_COUNTERS before{0};
+    IO_COUNTERS after{0};
+    GetProcessIoCounters(GetCurrentProcess(), &before);
+    auto begin = std::chrono::steady_clock::now();
+    if (!extractor.Extract(nullptr, nullptr, ec)) {
+      bela::FPrintF(stderr, L"unable extract %s error: %s\n", file.native(), ec);
+      return 1;
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    GetProcessIoCounters(GetCurrentProcess(), &after);
+    bela::FPrintF(stderr, L"threads %d: %d entries %.3fms, %d other %d read %d write operations\n", threads, entries,
+                  elapsed, after.OtherOperationCount - before.OtherOperationCount,
+                  after.ReadOperationCount - before.ReadOperationCount,
+                  after.WriteOperationCount - before.WriteOperationCount);
+    std::filesystem::remove_all(dest, e);
+  }
+  return 0;
+}
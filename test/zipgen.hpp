@@ -0,0 +1,111 @@
+// synthetic zip archives for benchmarks
+#ifndef BAULK_TEST_ZIPGEN_HPP
+#define BAULK_TEST_ZIPGEN_HPP
+#include <bela/io.hpp>
+#include <bela/str_cat.hpp>
+#include <vector>
+#include <string>
+
+namespace zipgen {
+class Builder {
+public:
+  void put16(std::vector<uint8_t> &b, uint16_t v) {
+    b.push_back(static_cast<uint8_t>(v));
+    b.push_back(static_cast<uint8_t>(v >> 8));
+  }
+  void put32(std::vector<uint8_t> &b, uint32_t v) {
+    put16(b, static_cast<uint16_t>(v));
+    put16(b, static_cast<uint16_t>(v >> 16));
+  }
+  void put64(std::vector<uint8_t> &b, uint64_t v) {
+    put32(b, static_cast<uint32_t>(v));
+    put32(b, static_cast<uint32_t>(v >> 32));
+  }
+  // Add appends an empty stored entry
+  void Add(std::string_view name) {
+    auto offset = static_cast<uint32_t>(body.size());
+    put32(body, 0x04034b50);
+    put16(body, 20);     // version needed
+    put16(body, 0x800);  // utf-8 name
+    put16(body, 0);      // store
+    put16(body, 0);      // time
+    put16(body, 0x21);   // date 1980-01-01
+    put32(body, 0);      // crc32
+    put32(body, 0);      // compressed size
+    put32(body, 0);      // uncompressed size
+    put16(body, static_cast<uint16_t>(name.size()));
+    put16(body, 0);
+    body.insert(body.end(), name.begin(), name.end());
+
+    put32(directory, 0x02014b50);
+    put16(directory, 20); // version made by
+    put16(directory, 20); // version needed
+    put16(directory, 0x800);
+    put16(directory, 0);
+    put16(directory, 0);
+    put16(directory, 0x21);
+    put32(directory, 0);
+    put32(directory, 0);
+    put32(directory, 0);
+    put16(directory, static_cast<uint16_t>(name.size()));
+    put16(directory, 0); // extra
+    put16(directory, 0); // comment
+    put16(directory, 0); // disk
+    put16(directory, 0); // internal attributes
+    put32(directory, 0); // external attributes
+    put32(directory, offset);
+    directory.insert(directory.end(), name.begin(), name.end());
+    records++;
+  }
+  // Write writes the archive, ZIP64 end records are added when there are more than 65534 entries
+  bool Write(std::wstring_view file, bela::error_code &ec) {
+    std::vector<uint8_t> out(body);
+    auto dirOffset = static_cast<uint64_t>(out.size());
+    out.insert(out.end(), directory.begin(), directory.end());
+    auto dirSize = static_cast<uint64_t>(directory.size());
+    auto zip64 = records >= 0xFFFF;
+    if (zip64) {
+      auto end64Offset = static_cast<uint64_t>(out.size());
+      put32(out, 0x06064b50);
+      put64(out, 44);
+      put16(out, 45);
+      put16(out, 45);
+      put32(out, 0);
+      put32(out, 0);
+      put64(out, records);
+      put64(out, records);
+      put64(out, dirSize);
+      put64(out, dirOffset);
+      put32(out, 0x07064b50);
+      put32(out, 0);
+      put64(out, end64Offset);
+      put32(out, 1);
+    }
+    put32(out, 0x06054b50);
+    put16(out, 0);
+    put16(out, 0);
+    put16(out, zip64 ? 0xFFFF : static_cast<uint16_t>(records));
+    put16(out, zip64 ? 0xFFFF : static_cast<uint16_t>(records));
+    put32(out, static_cast<uint32_t>(dirSize));
+    put32(out, zip64 ? 0xFFFFFFFF : static_cast<uint32_t>(dirOffset));
+    put16(out, 0);
+    return bela::io::WriteText(file, out, ec);
+  }
+
+private:
+  std::vector<uint8_t> body;
+  std::vector<uint8_t> directory;
+  uint64_t records{0};
+};
+
+// Generate writes a zip with count entries spread over nested directories
+inline bool Generate(std::wstring_view file, size_t count, bela::error_code &ec) {
+  Builder b;
+  for (size_t i = 0; i < count; i++) {
+    b.Add(bela::StringNarrowCat("src/module", i / 1000, "/dir", (i / 100) % 10, "/File", i, ".txt"));
+  }
+  return b.Write(file, ec);
+}
+} // namespace zipgen
+
+#endif
@@ -0,0 +1,74 @@
+//
+#include <baulk/archive/zip.hpp>
+#include <bela/terminal.hpp>
+#include <bela/charconv.hpp>
+#include <bela/ascii.hpp>
+#include <chrono>
+#include <filesystem>
+#include "zipgen.hpp"
+
+// usage: zipindex_bench [entries] [lookups]
+// compares linear scans of Files() with Reader::Find on a generated archive (default 100k entries)
+template <typename F> double measure(F &&fn) {
+  auto begin = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t entries = 100000;
+  size_t lookups = 1000;
+  if ((argc > 1 && !bela::SimpleAtoi(argv[1], &entries)) || (argc > 2 && !bela::SimpleAtoi(argv[2], &lookups)) ||
+      entries == 0) {
+    bela::FPrintF(stderr, L"usage: %s [entries] [lookups]\n", argv[0]);
+    return 1;
+  }
+  std::error_code e;
+  auto file = std::filesystem::temp_directory_path(e) / L"zipindex_bench.zip";
+  bela::error_code ec;
+  if (!zipgen::Generate(file.native(), entries, ec)) {
+    bela::FPrintF(stderr, L"unable generate %s error: %s\n", file.native(), ec);
+    return 1;
+  }
+  auto closer = bela::finally([&] { std::filesystem::remove(file, e); });
+  baulk::archive::zip::Reader zr;
+  if (!zr.OpenReader(file.native(), ec)) {
+    bela::FPrintF(stderr, L"unable open %s error: %s\n", file.native(), ec);
+    return 1;
+  }
+  std::vector<std::string> names;
+  for (size_t i = 0; i < lookups; i++) {
+    names.emplace_back(zr.Files()[(i * 7919) % zr.Files().size()].name);
+  }
+  size_t found = 0;
+  auto scan = measure([&] {
+    for (const auto &n : names) {
+      for (const auto &f : zr.Files()) {
+        if (f.name == n) {
+          found++;
+          break;
+        }
+      }
+    }
+  });
+  auto build = measure([&] { found += zr.Find(names.front()) != nullptr ? 1 : 0; });
+  auto find = measure([&] {
+    for (const auto &n : names) {
+      found += zr.Find(n) != nullptr ? 1 : 0;
+    }
+  });
+  auto folded = measure([&] {
+    for (const auto &n : names) {
+      found += zr.Find(bela::AsciiStrToUpper(n), true) != nullptr ? 1 : 0;
+    }
+  });
+  size_t listed = 0;
+  auto list = measure([&] { listed = zr.List("src/module1/").size(); });
+  bela::FPrintF(stderr, L"%d entries, %d lookups (%d found)\n", zr.Files().size(), lookups, found);
+  bela::FPrintF(stderr, L"linear scan:        %.3fms\n", scan);
+  bela::FPrintF(stderr, L"index build:        %.3fms\n", build);
+  bela::FPrintF(stderr, L"Find:               %.3fms\n", find);
+  bela::FPrintF(stderr, L"Find (ignore case): %.3fms (includes build)\n", folded);
+  bela::FPrintF(stderr, L"List src/module1/:  %.3fms %d entries (includes sort)\n", list, listed);
+  return 0;
+}
@@ -6,7 +6,6 @@
 #include <bela/ascii.hpp>
 #include <bela/terminal.hpp>
 #include <baulk/vfs.hpp>
-#include <baulk/fs.hpp>
 #include <baulk/archive/extractor.hpp>
 #include <baulk/indicators.hpp>
 #include "executor.hpp"
@@ -98,14 +97,11 @@ bool extract_zip(const std::filesystem::path &archive_file, const std::filesyste
                   baulk::archive::FormatToMIME(afmt));
     return false;
   }
-  ZipExtractor extractor(std::move(*fd), archive_file, destination, baulk::archive::ExtractorOptions{});
+  ZipExtractor extractor(std::move(*fd), archive_file, destination, baulk::archive::ExtractorOptions{.flatten = true});
   if (!extractor.Initialize(bela::SizeUnInitialized, baseOffset, ec)) {
     return false;
   }
-  if (!extractor.Extract(ec)) {
-    return false;
-  }
-  return baulk::fs::MakeFlattened(destination, ec);
+  return extractor.Extract(ec);
 }
 
 void Executor::cleanup() {
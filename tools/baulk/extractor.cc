@@ -48,13 +48,36 @@ inline void progress_show(bela::terminal::terminal_size &termsz, const std::wstr
   bela::FPrintF(stderr, L"\x1b[2K\r\x1b[33mx ...\\%s\x1b[0m", bela::BaseName(filename));
 }
 
+// zip entries are independent, extract them on all cores. The archive is read with positional reads, a fault under a
+// mapping could not be turned into an error
+inline ExtractorOptions zip_options(const ExtractorOptions &opts) {
+  auto o = opts;
+  o.threads = 0;
+  return o;
+}
+
+// 7z folders are independent, decode them on all cores
+inline ExtractorOptions sevenzip_options(const ExtractorOptions &opts) {
+  auto o = opts;
+  o.threads = 0;
+  return o;
+}
+
+// cabinet folders are independent as well
+inline ExtractorOptions msi_options(const ExtractorOptions &opts) {
+  auto o = opts;
+  o.threads = 0;
+  return o;
+}
+
 class ZipExtractor final : public Extractor {
 public:
   ZipExtractor(bela::io::FD &&fd_, std::filesystem::path archive_file_, std::filesystem::path destination_,
                const ExtractorOptions &opts)
-      : fd(std::move(fd_)), extractor(opts), archive_file(std::move(archive_file_)),
-        destination(std::move(destination_)) {}
+      : fd(std::move(fd_)), extractor(zip_options(opts)), archive_file(std::move(archive_file_)),
+        destination(std::move(destination_)), flatten(opts.flatten) {}
   bool Extract(bela::error_code &ec) override;
+  bool Flattened() const override { return flatten; }
   bool Initialize(int64_t size, int64_t offset, bela::error_code &ec) {
     return extractor.OpenReader(fd, destination, size, offset, ec);
   }
@@ -64,6 +87,7 @@ private:
   std::filesystem::path archive_file;
   std::filesystem::path destination;
   baulk::archive::zip::Extractor extractor;
+  bool flatten{false};
 };
 
 bool ZipExtractor::Extract(bela::error_code &ec) {
@@ -95,6 +119,8 @@ public:
       : fd(std::move(fd_)), archive_file(std::move(archive_file_)), destination(std::move(destination_)), opts(opts_),
         offset(offset_), afmt(afmt_) {}
   bool Extract(bela::error_code &ec) override;
+  // tarballs flatten while extracting, a single compressed file does not
+  bool Flattened() const override { return flattened; }
 
 private:
   bool single_file_extract(bela::error_code &ec);
@@ -107,6 +133,7 @@ private:
   ExtractorOptions opts;
   int64_t offset{0};
   baulk::archive::file_format_t afmt;
+  bool flattened{false};
 };
 
 bool UniversalExtractor::tar_extract(baulk::archive::tar::FileReader &fr, baulk::archive::tar::ExtractReader *reader,
@@ -114,7 +141,10 @@ bool UniversalExtractor::tar_extract(baulk::archive::tar::FileReader &fr, baulk:
   if (auto size = fd.Size(ec); size == bela::SizeUnInitialized) {
     return false;
   }
-  baulk::archive::tar::Extractor extractor(reader, opts);
+  // compressed tarballs decode on their own thread while entries are parsed and written
+  auto o = opts;
+  o.pipelined = reader != &fr;
+  baulk::archive::tar::Extractor extractor(reader, o);
   if (!extractor.InitializeExtractor(destination, ec)) {
     return false;
   }
@@ -128,15 +158,24 @@ bool UniversalExtractor::tar_extract(baulk::archive::tar::FileReader &fr, baulk:
           nullptr, ec)) {
     return false;
   }
+  if (o.pipelined) {
+    const auto &st = extractor.Stats();
+    DbgPrint(L"tar pipeline %v: decoded %v bytes, decode %.1f%% parse %.1f%% write %.1f%% busy",
+             archive_file.filename(), st.decoded, st.decode.Utilization() * 100, st.parse.Utilization() * 100,
+             st.write.Utilization() * 100);
+  }
   if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
     bela::FPrintF(stderr, L"\n");
   }
+  flattened = opts.flatten;
   return true;
 }
 
 bool UniversalExtractor::tar_extract(bela::error_code &ec) {
   baulk::archive::tar::FileReader fr(fd.NativeFD());
-  if (auto wr = baulk::archive::tar::MakeReader(fr, offset, afmt, ec); wr) {
+  // multi-member gzip tarballs are inflated on all cores
+  if (auto wr = baulk::archive::tar::MakeReader(fr, offset, afmt, baulk::archive::tar::ReaderOptions{.threads = 0}, ec);
+      wr) {
     return tar_extract(fr, wr.get(), ec);
   }
   if (ec != baulk::archive::tar::ErrNoFilter) {
@@ -202,17 +241,60 @@ bool UniversalExtractor::Extract(bela::error_code &ec) {
 
 class MsiExtractor final : public Extractor {
 public:
-  MsiExtractor(std::filesystem::path archive_file_, std::filesystem::path destination_)
-      : archive_file(std::move(archive_file_)), destination(std::move(destination_)) {}
+  MsiExtractor(std::filesystem::path archive_file_, std::filesystem::path destination_, const ExtractorOptions &opts_)
+      : archive_file(std::move(archive_file_)), destination(std::move(destination_)), opts(msi_options(opts_)) {}
   bool Extract(bela::error_code &ec) override;
+  // both the native reader and the installer service are followed by MakeFlattened in Extract
+  bool Flattened() const override { return true; }
 
 private:
+  bool native_extract(bela::error_code &ec);
+  bool installer_extract(bela::error_code &ec);
   std::filesystem::path archive_file;
   std::filesystem::path destination;
+  ExtractorOptions opts;
 };
 
+// native_extract reads the package and its cabinets in-process, cabinet folders are decoded on all cores
+bool MsiExtractor::native_extract(bela::error_code &ec) {
+  baulk::archive::msi::PackageExtractor extractor(opts);
+  if (!extractor.OpenReader(archive_file, destination, ec)) {
+    // nothing is written yet, leave packages this reader does not understand to the installer service. Format errors
+    // are ErrGeneral, I/O errors keep their system code and are reported
+    if (ec.code == bela::ErrGeneral) {
+      ec.code = bela::ErrUnimplemented;
+    }
+    return false;
+  }
+  bela::terminal::terminal_size termsz;
+  terminal_size_initialize(termsz);
+  auto ret = extractor.Extract(
+      [&](const baulk::archive::msi::File &file, const std::wstring &relative_name) -> bool {
+        progress_show(termsz, relative_name);
+        return true;
+      },
+      nullptr, ec);
+  if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
+    bela::FPrintF(stderr, L"\n");
+  }
+  return ret;
+}
+
 bool MsiExtractor::Extract(bela::error_code &ec) {
   bela::FPrintF(stderr, L"Extracting \x1b[36m%v\x1b[0m ...\n", archive_file.filename());
+  if (native_extract(ec)) {
+    return baulk::fs::MakeFlattened(destination, ec);
+  }
+  if (ec.code != bela::ErrUnimplemented) {
+    return false;
+  }
+  DbgPrint(L"native msi extract %v: %v, fallback to msiexec", archive_file.filename(), ec);
+  ec.clear();
+  return installer_extract(ec);
+}
+
+// installer_extract runs an administrative install through the installer service
+bool MsiExtractor::installer_extract(bela::error_code &ec) {
   baulk::archive::msi::Extractor extractor;
   baulk::ProgressBar bar;
   bar.FileName(bela::StringCat(L"Extracting ", archive_file.filename()));
@@ -316,6 +398,68 @@ private:
   baulk::archive::file_format_t afmt;
 };
 
+// SevenZipExtractor decodes 7z archives in process, archives with coders it does not implement are left to 7z.exe
+// before anything is extracted
+class SevenZipExtractor final : public Extractor {
+public:
+  SevenZipExtractor(bela::io::FD &&fd_, std::filesystem::path archive_file_, std::filesystem::path destination_,
+                    const ExtractorOptions &opts)
+      : fd(std::move(fd_)), extractor(sevenzip_options(opts)), archive_file(std::move(archive_file_)),
+        destination(std::move(destination_)) {}
+  bool Extract(bela::error_code &ec) override;
+  // Initialize reads the header and checks the coders of every folder, nothing is written before both succeed
+  bool Initialize(int64_t offset, bela::error_code &ec) {
+    return extractor.OpenReader(fd, destination, bela::SizeUnInitialized, offset, ec) && extractor.CheckFolders(ec);
+  }
+
+private:
+  bela::io::FD fd;
+  std::filesystem::path archive_file;
+  std::filesystem::path destination;
+  baulk::archive::n7z::Extractor extractor;
+};
+
+bool SevenZipExtractor::Extract(bela::error_code &ec) {
+  bela::FPrintF(stderr, L"Extracting \x1b[36m%v\x1b[0m ...\n", archive_file.filename());
+  bela::terminal::terminal_size termsz;
+  terminal_size_initialize(termsz);
+  if (!extractor.Extract(
+          [&](const baulk::archive::n7z::File &file, const std::wstring &relative_name) -> bool {
+            progress_show(termsz, relative_name);
+            return true;
+          },
+          nullptr, ec)) {
+    if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
+      bela::FPrintF(stderr, L"\n");
+    }
+    return false;
+  }
+  if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
+    bela::FPrintF(stderr, L"\n");
+  }
+  return true;
+}
+
+// make_sevenzip_extractor prefers the native reader, falling back to 7z.exe when the header or a folder uses features
+// it lacks or fails to parse
+inline std::shared_ptr<Extractor> make_sevenzip_extractor(bela::io::FD &&fd, const std::filesystem::path &archive_file,
+                                                          const std::filesystem::path &destination,
+                                                          const ExtractorOptions &opts, int64_t offset,
+                                                          bela::error_code &ec) {
+  auto e = std::make_shared<SevenZipExtractor>(std::move(fd), archive_file, destination, opts);
+  if (e->Initialize(offset, ec)) {
+    return e;
+  }
+  // nothing is written yet, a header this reader rejects may still be one 7z.exe reads. Format errors are ErrGeneral,
+  // I/O errors keep their system code and are reported
+  if (ec.code != bela::ErrUnimplemented && ec.code != bela::ErrGeneral) {
+    return nullptr;
+  }
+  DbgPrint(L"native 7z open %v: %v, fallback to 7z.exe", archive_file.filename(), ec);
+  ec.clear();
+  return std::make_shared<_7zExtractor>(archive_file, destination, baulk::archive::file_format_t::_7z);
+}
+
 std::shared_ptr<Extractor> MakeExtractor(const std::filesystem::path &archive_file,
                                          const std::filesystem::path &destination, const ExtractorOptions &opts,
                                          bela::error_code &ec) {
@@ -360,13 +504,13 @@ std::shared_ptr<Extractor> MakeExtractor(const std::filesystem::path &archive_fi
   case baulk::archive::file_format_t::rar:
     [[fallthrough]];
   case baulk::archive::file_format_t::nsis:
-    [[fallthrough]];
-  case baulk::archive::file_format_t::_7z:
     fd->Assgin(INVALID_HANDLE_VALUE, false);
     return std::make_shared<_7zExtractor>(archive_file, destination, afmt);
+  case baulk::archive::file_format_t::_7z:
+    return make_sevenzip_extractor(std::move(*fd), archive_file, destination, opts, baseOffset, ec);
   case baulk::archive::file_format_t::msi:
     fd->Assgin(INVALID_HANDLE_VALUE, false);
-    return std::make_shared<MsiExtractor>(archive_file, destination);
+    return std::make_shared<MsiExtractor>(archive_file, destination, opts);
   case baulk::archive::file_format_t::exe:
     ec = bela::make_error_code(baulk::archive::ErrNoOverlayArchive, L"no overlay archive");
     return nullptr;
@@ -392,7 +536,7 @@ bool extract_exe(const std::filesystem::path &archive_file, const std::filesyste
 
 bool extract_msi(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
                  bela::error_code &ec) {
-  MsiExtractor extractor(archive_file, destination);
+  MsiExtractor extractor(archive_file, destination, ExtractorOptions{});
   if (!extractor.Extract(ec)) {
     baulk::DbgPrint(L"extract msi archive: %v error %v", archive_file.filename(), ec);
     return false;
@@ -414,14 +558,12 @@ bool extract_zip(const std::filesystem::path &archive_file, const std::filesyste
                   baulk::archive::FormatToMIME(afmt));
     return false;
   }
-  ZipExtractor extractor(std::move(*fd), archive_file, destination, baulk::archive::ExtractorOptions{});
+  // the single folders holding every entry are known from the central directory, files land in place at once
+  ZipExtractor extractor(std::move(*fd), archive_file, destination, baulk::archive::ExtractorOptions{.flatten = true});
   if (!extractor.Initialize(bela::SizeUnInitialized, baseOffset, ec)) {
     return false;
   }
-  if (!extractor.Extract(ec)) {
-    return false;
-  }
-  return baulk::fs::MakeFlattened(destination, ec);
+  return extractor.Extract(ec);
 }
 
 bool extract_7z(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
@@ -433,9 +575,17 @@ bool extract_7z(const std::filesystem::path &archive_file, const std::filesystem
     bela::FPrintF(stderr, L"baulk open archive %s error: %s\n", archive_file.filename(), ec);
     return false;
   }
-  fd->Assgin(INVALID_HANDLE_VALUE, false);
-  _7zExtractor extractor(archive_file, destination, afmt);
-  if (!extractor.Extract(ec)) {
+  if (afmt != baulk::archive::file_format_t::_7z) {
+    fd->Assgin(INVALID_HANDLE_VALUE, false);
+    _7zExtractor extractor(archive_file, destination, afmt);
+    if (!extractor.Extract(ec)) {
+      return false;
+    }
+    return baulk::fs::MakeFlattened(destination, ec);
+  }
+  auto extractor =
+      make_sevenzip_extractor(std::move(*fd), archive_file, destination, ExtractorOptions{}, baseOffset, ec);
+  if (!extractor || !extractor->Extract(ec)) {
     return false;
   }
   return baulk::fs::MakeFlattened(destination, ec);
@@ -450,17 +600,15 @@ bool extract_tar(const std::filesystem::path &archive_file, const std::filesyste
     bela::FPrintF(stderr, L"baulk open archive %s error: %s\n", archive_file.filename(), ec);
     return false;
   }
-  UniversalExtractor extractor(std::move(*fd), archive_file, destination, baulk::archive::ExtractorOptions{},
-                               baseOffset, afmt);
-  if (!extractor.Extract(ec)) {
-    return false;
-  }
-  return baulk::fs::MakeFlattened(destination, ec);
+  UniversalExtractor extractor(std::move(*fd), archive_file, destination,
+                               baulk::archive::ExtractorOptions{.flatten = true}, baseOffset, afmt);
+  return extractor.Extract(ec);
 }
 
 bool extract_auto(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
                   bela::error_code &ec) {
-  auto extractor = MakeExtractor(archive_file, destination, baulk::archive::ExtractorOptions{}, ec);
+  // zip and tar flatten while extracting, only 7z, single files and the installer need MakeFlattened afterwards
+  auto extractor = MakeExtractor(archive_file, destination, baulk::archive::ExtractorOptions{.flatten = true}, ec);
   if (!extractor) {
     return false;
   }
@@ -470,18 +618,24 @@ bool extract_auto(const std::filesystem::path &archive_file, const std::filesyst
   if (!extractor->Extract(ec)) {
     return false;
   }
+  if (extractor->Flattened()) {
+    return true;
+  }
   return baulk::fs::MakeFlattened(destination, ec);
 }
 
 bool extract_command_auto(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
                           bela::error_code &ec) {
-  auto extractor = MakeExtractor(archive_file, destination, baulk::archive::ExtractorOptions{}, ec);
+  auto extractor = MakeExtractor(archive_file, destination, baulk::archive::ExtractorOptions{.flatten = true}, ec);
   if (!extractor) {
     return false;
   }
   if (!extractor->Extract(ec)) {
     return false;
   }
+  if (extractor->Flattened()) {
+    return true;
+  }
   return baulk::fs::MakeFlattened(destination, ec);
 }
 
@@ -13,6 +13,8 @@ using baulk::archive::ExtractorOptions;
 class Extractor {
 public:
   virtual bool Extract(bela::error_code &ec) = 0;
+  // Flattened reports whether Extract left the destination flattened, callers run baulk::fs::MakeFlattened otherwise
+  virtual bool Flattened() const { return false; }
 };
 
 std::shared_ptr<Extractor> MakeExtractor(const std::filesystem::path &archive_file,